@@ -2,6 +2,20 @@
 
 #include "euler/app/dragonruby/image.h"
 
+#include "euler/util/pixel.h"
+
+euler::app::dragonruby::Image::Image(const std::string_view label,
+    const uint32_t *data, const int16_t width, const int16_t height,
+    const bool own_data)
+    : _data(const_cast<uint32_t *>(data))
+    , _label(label)
+    , _pixel_buffer(mrb_nil_value())
+    , _width(width)
+    , _height(height)
+    , _own_data(own_data)
+{
+}
+
 euler::app::dragonruby::Image::~Image()
 {
 	if (_own_data) free(_data);
@@ -45,17 +59,8 @@ euler::app::dragonruby::Image::blend_pixel(const int16_t x, const int16_t y,
     const util::Color color)
 {
 	if (color.alpha() == 0) return;
-	const uint8_t inv_a = 0xff - color.alpha();
-	const auto other = pixel(x, y);
-	const uint8_t r
-	    = ((color.red() * color.alpha()) + (other.red() * inv_a)) >> 8;
-	const uint8_t g
-	    = ((color.green() * color.alpha()) + (other.green() * inv_a)) >> 8;
-	const uint8_t b
-	    = ((color.blue() * color.alpha()) + (other.blue() * inv_a)) >> 8;
-	const uint8_t a = std::min(0xff, color.alpha() + other.alpha());
-	const auto blended = util::Color(r, g, b, a);
-	set_pixel(x, y, blended);
+	const uint32_t value = color.to_dragonruby();
+	util::pixel::blend_straight(&_data[y * _width + x], &value, 1);
 }
 
 bool
@@ -72,6 +77,13 @@ euler::app::dragonruby::Image::display(const Frame &spec) const
 	return nullptr;
 }
 
+void
+euler::app::dragonruby::Image::display(const Location &spec) const
+{
+	(void)spec;
+	// TODO
+}
+
 uint32_t *
 euler::app::dragonruby::Image::raw_data()
 {
@@ -104,8 +116,15 @@ euler::app::dragonruby::Image::stretch(float, float)
 	// TODO
 	return nullptr;
 }
+
 std::string
 euler::app::dragonruby::Image::label() const
 {
 	return _label;
 }
+
+std::pair<int16_t, int16_t>
+euler::app::dragonruby::Image::dimensions() const
+{
+	return { _width, _height };
+}
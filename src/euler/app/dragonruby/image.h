@@ -22,6 +22,7 @@ public:
 	void blend_pixel(int16_t, int16_t, util::Color) override;
 	bool is_loaded() const override;
 	util::Reference<util::Image> display(const Frame &spec) const override;
+	void display(const Location &spec) const override;
 	uint32_t *raw_data() override;
 	const uint32_t *raw_data() const override;
 	util::Reference<util::Image> transform(
@@ -29,6 +30,7 @@ public:
 	util::Reference<util::Image> rotate(float theta) const override;
 	util::Reference<util::Image> stretch(float x, float y) override;
 	std::string label() const override;
+	std::pair<int16_t, int16_t> dimensions() const override;
 
 private:
 	util::Reference<util::State> _state;
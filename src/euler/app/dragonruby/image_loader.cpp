@@ -0,0 +1,79 @@
+/* SPDX-License-Identifier: ISC */
+
+#include "euler/app/dragonruby/image_loader.h"
+
+#include <cstring>
+#include <limits>
+
+#include "euler/app/dragonruby/image.h"
+#include "euler/util/pixel.h"
+
+using euler::app::dragonruby::ImageLoader;
+
+ImageLoader::ImageLoader(drb_api_t *api, util::Reference<util::Jobs> jobs)
+    : util::ImageLoader(std::move(jobs))
+    , _api(api)
+{
+}
+
+ImageLoader::~ImageLoader()
+{
+	shutdown();
+}
+
+euler::util::Reference<euler::util::Image>
+ImageLoader::load_image(const char *path)
+{
+	Decoded decoded;
+	if (!decode_image(path, decoded)) return nullptr;
+	return finish_image(path, std::move(decoded));
+}
+
+euler::util::Reference<euler::util::Image>
+ImageLoader::create_image(const char *label, const int16_t w, const int16_t h,
+    const util::Color color)
+{
+	if (w <= 0 || h <= 0) return nullptr;
+	const size_t count = static_cast<size_t>(w) * h;
+	const auto data
+	    = static_cast<uint32_t *>(std::malloc(count * sizeof(uint32_t)));
+	if (data == nullptr) return nullptr;
+	util::pixel::fill(data, count, color.to_dragonruby());
+	auto image = util::make_reference<Image>(label, data, w, h, true);
+	_api->drb_upload_pixel_array(label, w, h, data);
+	return image;
+}
+
+bool
+ImageLoader::decode_image(const char *path, Decoded &out)
+{
+	int w = 0;
+	int h = 0;
+	void *pixels = _api->drb_load_image(path, &w, &h);
+	if (pixels == nullptr) return false;
+	constexpr int MAX_SIZE = std::numeric_limits<int16_t>::max();
+	const bool fits = w > 0 && h > 0 && w <= MAX_SIZE && h <= MAX_SIZE;
+	const size_t size = static_cast<size_t>(w) * h * sizeof(uint32_t);
+	/* the runtime owns its buffer, so copy into one Image can free */
+	if (fits) {
+		out.pixels.reset(static_cast<uint32_t *>(std::malloc(size)));
+		if (out.pixels != nullptr)
+			std::memcpy(out.pixels.get(), pixels, size);
+	}
+	_api->drb_free_image(pixels);
+	if (out.pixels == nullptr) return false;
+	out.width = static_cast<int16_t>(w);
+	out.height = static_cast<int16_t>(h);
+	return true;
+}
+
+euler::util::Reference<euler::util::Image>
+ImageLoader::finish_image(const std::string &path, Decoded &&decoded)
+{
+	const auto data = decoded.pixels.release();
+	auto image = util::make_reference<Image>(path, data, decoded.width,
+	    decoded.height, true);
+	_api->drb_upload_pixel_array(path.c_str(), decoded.width,
+	    decoded.height, data);
+	return image;
+}
@@ -0,0 +1,45 @@
+/* SPDX-License-Identifier: ISC */
+
+#ifndef EULER_APP_DRAGONRUBY_IMAGE_LOADER_H
+#define EULER_APP_DRAGONRUBY_IMAGE_LOADER_H
+
+#include <dragonruby.h>
+
+#include "euler/util/image_loader.h"
+
+namespace euler::app::dragonruby {
+/* Decodes through the runtime's image loader and uploads the result under
+ * the file's path, so sprites referring to that path draw the decoded pixels
+ * instead of making DragonRuby load the file when it is first drawn.
+ *
+ * Loads are not decoded asynchronously here. The drb_* functions make no
+ * thread-safety guarantees and there is no decoder of our own to use
+ * instead, so every call stays on the main thread: load_image_async only
+ * queues the path, and the per-frame poll from State#tick decodes the queue
+ * a few milliseconds at a time. */
+class ImageLoader final : public util::ImageLoader {
+public:
+	ImageLoader(drb_api_t *api, util::Reference<util::Jobs> jobs);
+	~ImageLoader() override;
+
+	[[nodiscard]] util::Reference<util::Image> load_image(
+	    const char *path) override;
+	[[nodiscard]] util::Reference<util::Image> create_image(
+	    const char *label, int16_t w, int16_t h, util::Color) override;
+
+protected:
+	[[nodiscard]] bool
+	decodes_on_workers() const override
+	{
+		return false;
+	}
+	bool decode_image(const char *path, Decoded &out) override;
+	util::Reference<util::Image> finish_image(const std::string &path,
+	    Decoded &&decoded) override;
+
+private:
+	drb_api_t *_api;
+};
+} /* namespace euler::app::dragonruby */
+
+#endif /* EULER_APP_DRAGONRUBY_IMAGE_LOADER_H */
@@ -23,6 +23,9 @@ State::State(const Arguments &args)
 	    = euler::util::make_reference<RubyState>(args.state, args.api);
 	_log = euler::util::make_reference<Logger>("euler",
 	    args.api->drb_log_write);
+	_jobs = euler::util::make_reference<util::Jobs>();
+	_image_loader
+	    = euler::util::make_reference<ImageLoader>(args.api, _jobs);
 	args.state->ud = util::Reference(this).wrap();
 }
 
@@ -40,15 +43,28 @@ State::log() const
 }
 
 euler::util::Reference<euler::util::Image>
-State::load_image(const char *)
+State::load_image(const char *path)
 {
-	return nullptr;
+	return _image_loader->load_image(path);
 }
 
 euler::util::Reference<euler::util::Image>
-State::create_image(const char *, int16_t, int16_t, util::Color)
+State::create_image(const char *label, const int16_t w, const int16_t h,
+    const util::Color color)
 {
-	return nullptr;
+	return _image_loader->create_image(label, w, h, color);
+}
+
+euler::util::Reference<euler::util::ImageLoader>
+State::image_loader()
+{
+	return _image_loader;
+}
+
+euler::util::Reference<euler::util::Jobs>
+State::jobs()
+{
+	return _jobs;
 }
 
 euler::util::Reference<euler::util::Window>
@@ -96,6 +112,12 @@ State::preinit()
 	return true;
 }
 
+void
+State::tick()
+{
+	_image_loader->poll();
+}
+
 #ifdef EULER_GUI_BUILD
 euler::util::Reference<euler::gui::Context>
 State::gui() const
@@ -108,8 +130,14 @@ void
 State::upload_image(const char *label, const util::Reference<util::Image> &img)
 {
 	const auto dr_img = img.cast_to<Image>();
-	_api->drb_upload_pixel_array(label, dr_img->_width, dr_img->_height,
-	    static_cast<const uint32_t *>(dr_img->_data));
+	upload_pixels(label, dr_img->_width, dr_img->_height, dr_img->_data);
+}
+
+void
+State::upload_pixels(const char *label, const int width, const int height,
+    const uint32_t *pixels)
+{
+	_api->drb_upload_pixel_array(label, width, height, pixels);
 }
 
 mrb_value
@@ -118,12 +146,31 @@ State::args() const
 	return _args;
 }
 
+void
+State::set_args(const mrb_value args)
+{
+	_args = args;
+}
+
 euler::util::Reference<euler::graphics::Target>
 State::renderer() const
 {
 	return _renderer;
 }
 
+void
+State::set_render_mode(const Target::RenderMode mode)
+{
+	_render_mode = mode;
+	if (_renderer.get() != nullptr) _renderer->set_render_mode(mode);
+}
+
+euler::app::dragonruby::Target::RenderMode
+State::render_mode() const
+{
+	return _render_mode;
+}
+
 State::Runtime
 State::runtime() const
 {
@@ -5,9 +5,11 @@
 
 #include <dragonruby.h>
 
+#include "euler/app/dragonruby/image_loader.h"
 #include "euler/app/dragonruby/logger.h"
 #include "euler/app/dragonruby/ruby_state.h"
 #include "euler/util/image.h"
+#include "euler/util/jobs.h"
 #include "euler/util/object.h"
 #include "euler/util/state.h"
 #include "target.h"
@@ -39,6 +41,9 @@ public:
 	    const char *path) override;
 	util::Reference<util::Image> create_image(const char *label, int16_t w,
 	    int16_t h, util::Color) override;
+	[[nodiscard]] util::Reference<util::ImageLoader>
+	image_loader() override;
+	[[nodiscard]] util::Reference<util::Jobs> jobs() override;
 	util::Reference<util::Window> window() override;
 #ifdef EULER_GUI
 	[[nodiscard]] util::Reference<gui::Context> gui() const override;
@@ -48,14 +53,26 @@ public:
 	const std::string &progname() const override;
 	const std::string &title() const override;
 	bool preinit() override;
+	/* runs deferred job callbacks and finishes asynchronous image
+	 * loads */
+	void tick() override;
 	void upload_image(const char *label,
 	    const util::Reference<util::Image> &img) override;
+	/* uploads a straight-alpha 0xAABBGGRR buffer under label */
+	void upload_pixels(const char *label, int width, int height,
+	    const uint32_t *pixels);
 
 	/* fetches the dragonruby context (current tick's args) */
 	mrb_value args() const;
+	/* set by State#tick for the length of a frame */
+	void set_args(mrb_value args);
 
 	[[nodiscard]] util::Reference<graphics::Target>
 	renderer() const override;
+	/* how the GUI target draws; kept here so it applies to a target
+	 * created after it is set */
+	void set_render_mode(Target::RenderMode mode);
+	[[nodiscard]] Target::RenderMode render_mode() const;
 	[[nodiscard]] Runtime runtime() const override;
 
 private:
@@ -65,7 +82,10 @@ private:
 	util::Reference<gui::Context> _gui;
 #endif
 	util::Reference<Window> _window;
-	util::Reference<target> _renderer;
+	util::Reference<util::Jobs> _jobs;
+	util::Reference<ImageLoader> _image_loader;
+	util::Reference<Target> _renderer;
+	Target::RenderMode _render_mode = Target::RenderMode::Primitives;
 	mrb_value _args = mrb_nil_value();
 	drb_api_t *_api;
 };
@@ -2,7 +2,9 @@
 
 #include "euler/app/dragonruby/target.h"
 
+#include <format>
 #include <iomanip>
+#include <numbers>
 
 #include <mapbox/earcut.hpp>
 
@@ -33,7 +35,12 @@ static constexpr auto all = Eigen::placeholders::all;
 #define STASH_SYM(HASH, KEY, VALUE)                                            \
 	STASH_VALUE(HASH, KEY, ruby()->symbol_value(_symbols.VALUE))
 
-Target::~Target() = default;
+Target::~Target()
+{
+	if (mrb_nil_p(_frame_outputs)) return;
+	if (const auto ruby = _ruby.strengthen(); ruby != nullptr)
+		ruby->gc_unregister(_frame_outputs);
+}
 
 euler::util::Reference<euler::util::State>
 Target::state() const
@@ -44,8 +51,12 @@ Target::state() const
 void
 Target::scissor(const ScissorCommand &cmd)
 {
-	(void)cmd;
-	/* This is a no-op for DragonRuby */
+	if (_mode == RenderMode::Raster) {
+		_raster.set_clip(cmd.position(0, 0), cmd.position(0, 1),
+		    cmd.size(0, 0), cmd.size(0, 1));
+		return;
+	}
+	/* This is a no-op for DragonRuby primitives */
 	state()->log()->warn("Scissor command is not supported for DragonRuby");
 }
 
@@ -55,6 +66,11 @@ Target::line(const LineCommand &cmd)
 	Vec2i16 p1 = cmd.points(0, all);
 	Vec2i16 p2 = cmd.points(1, all);
 	const auto th = cmd.line_thickness;
+	if (_mode == RenderMode::Raster) {
+		_raster.line(p1(0, 0), p1(0, 1), p2(0, 0), p2(0, 1), th,
+		    cmd.color);
+		return;
+	}
 	if (th == 1) {
 		const auto hash = ruby()->hash_new_capa(8);
 		STASH_INT(hash, x1, p1(0, 0));
@@ -88,32 +104,24 @@ Target::line(const LineCommand &cmd)
 void
 Target::curve(const CurveCommand &cmd)
 {
-	static constexpr int CURVE_SEGMENTS = 22;
-	static constexpr float STEP = 1.0f / CURVE_SEGMENTS;
-	const Vec2i16 p1 = cmd.points(0, all);
-	const Vec2i16 p2 = cmd.points(1, all);
-	const Vec2i16 p3 = cmd.points(2, all);
-	const Vec2i16 p4 = cmd.points(3, all);
-	Vec2i16 last = p1;
+	const auto &outline = _geometry.curve(cmd.points).outline;
+	const float ox = cmd.points(0, 0);
+	const float oy = cmd.points(0, 1);
+	if (_mode == RenderMode::Raster) {
+		_raster.polyline(outline, cmd.line_thickness, false, cmd.color,
+		    { ox, oy });
+		return;
+	}
 	LineCommand line_cmd = {
 		.points = {},
 		.color = cmd.color,
 		.line_thickness = cmd.line_thickness,
 	};
-	for (int i = 1; i <= CURVE_SEGMENTS; ++i) {
-		const float t = i * STEP;
-		const float u = 1 - t;
-		const float w1 = u * u * u;
-		const float w2 = 3 * u * u * t;
-		const float w3 = 3 * u * t * t;
-		const float w4 = t * t * t;
-		const float x = w1 * p1(0, 0) + w2 * p2(0, 0) + w3 * p3(0, 0)
-		    + w4 * p4(0, 0);
-		const float y = w1 * p1(0, 1) + w2 * p2(0, 1) + w3 * p3(0, 1)
-		    + w4 * p4(0, 1);
+	Vec2i16 last = cmd.points(0, all);
+	for (size_t i = 1; i < outline.size(); ++i) {
 		const Vec2i16 point = {
-			static_cast<int16_t>(x),
-			static_cast<int16_t>(y),
+			static_cast<int16_t>(std::lround(outline[i].x + ox)),
+			static_cast<int16_t>(std::lround(outline[i].y + oy)),
 		};
 		line_cmd.points(0, all) = last;
 		line_cmd.points(1, all) = point;
@@ -125,6 +133,10 @@ Target::curve(const CurveCommand &cmd)
 void
 Target::rect(const RectCommand &cmd)
 {
+	if (_mode == RenderMode::Raster) {
+		raster_rect(cmd);
+		return;
+	}
 	const int16_t x = cmd.position(0, 0);
 	const int16_t y = cmd.position(0, 1);
 	const int16_t w = cmd.size(0, 0);
@@ -211,6 +223,19 @@ Target::rect(const RectCommand &cmd)
 void
 Target::circle(const CircleCommand &cmd)
 {
+	if (_mode == RenderMode::Raster) {
+		/* Nuklear describes circles by their bounding box */
+		const float rx = cmd.size(0, 0) / 2.0f;
+		const float ry = cmd.size(0, 1) / 2.0f;
+		const float cx = cmd.center(0, 0) + rx;
+		const float cy = cmd.center(0, 1) + ry;
+		if (cmd.fill)
+			_raster.fill_ellipse(cx, cy, rx, ry, cmd.color);
+		else
+			_raster.stroke_ellipse(cx, cy, rx, ry,
+			    cmd.line_thickness, cmd.color);
+		return;
+	}
 	const char *path = cmd.fill ? "sprites/circle/solid.png"
 	                            : "sprites/circle/outline.png";
 	const auto hash = ruby()->hash_new_capa(11);
@@ -239,6 +264,35 @@ Target::circle(const CircleCommand &cmd)
 void
 Target::arc(const ArcCommand &cmd)
 {
+	if (_mode == RenderMode::Raster) {
+		/* angles arrive from Nuklear in radians */
+		const float cx = cmd.center(0, 0);
+		const float cy = cmd.center(0, 1);
+		const float a0 = cmd.angles(0, 0);
+		const float a1 = cmd.angles(0, 1);
+		if (std::abs(a1 - a0) >= 2.0f * std::numbers::pi_v<float>) {
+			const int16_t r = cmd.radius;
+			const int16_t d = 2 * r;
+			const int16_t x = cmd.center(0, 0) - r;
+			const int16_t y = cmd.center(0, 1) - r;
+			circle(CircleCommand {
+			    .center = { x, y },
+			    .size = { d, d },
+			    .color = cmd.color,
+			    .line_thickness = cmd.line_thickness,
+			    .fill = cmd.fill,
+			});
+			return;
+		}
+		const auto &mesh = _geometry.arc(cmd.radius, a0, a1, cmd.fill);
+		if (cmd.fill)
+			_raster.fill_polygon(mesh.outline, cmd.color,
+			    { cx, cy });
+		else
+			_raster.polyline(mesh.outline, cmd.line_thickness,
+			    false, cmd.color, { cx, cy });
+		return;
+	}
 	float a = cmd.angles(0, 0);
 	float b = cmd.angles(0, 1);
 	a = std::fmod(a, 360.0f);
@@ -296,6 +350,19 @@ Target::triangle(const TriangleCommand &cmd)
 	const Vec2i16 p1 = cmd.points(0, all);
 	const Vec2i16 p2 = cmd.points(1, all);
 	const Vec2i16 p3 = cmd.points(2, all);
+	if (_mode == RenderMode::Raster) {
+		graphics::Rasterizer::Point points[3];
+		for (int i = 0; i < 3; ++i) {
+			points[i] = { static_cast<float>(cmd.points(i, 0)),
+				static_cast<float>(cmd.points(i, 1)) };
+		}
+		if (cmd.fill)
+			_raster.fill_polygon(points, cmd.color);
+		else
+			_raster.polyline(points, cmd.line_thickness, true,
+			    cmd.color);
+		return;
+	}
 	const auto hash = ruby()->hash_new_capa(17);
 	STASH_INT(hash, x, p1(0, 0));
 	STASH_INT(hash, y, p1(0, 1));
@@ -315,15 +382,79 @@ Target::triangle(const TriangleCommand &cmd)
 }
 
 void
-Target::polygon(const PolygonCommand &)
+Target::polygon(const PolygonCommand &cmd)
 {
-	/* TODO */
+	if (cmd.points.rows() < 2) return;
+	if (_mode == RenderMode::Raster) {
+		/* the scanline fill handles concave outlines directly, so
+		 * there is no tessellation worth caching here */
+		_polygon.clear();
+		for (Eigen::Index i = 0; i < cmd.points.rows(); ++i) {
+			_polygon.push_back({
+			    static_cast<float>(cmd.points(i, 0)),
+			    static_cast<float>(cmd.points(i, 1)),
+			});
+		}
+		if (cmd.fill)
+			_raster.fill_polygon(_polygon, cmd.color);
+		else
+			_raster.polyline(_polygon, cmd.line_thickness, true,
+			    cmd.color);
+		return;
+	}
+	if (cmd.fill) {
+		for (const auto &tri : triangulate(cmd)) triangle(tri);
+		return;
+	}
+	LineCommand line_cmd = {
+		.points = {},
+		.color = cmd.color,
+		.line_thickness = cmd.line_thickness,
+	};
+	const Eigen::Index n = cmd.points.rows();
+	for (Eigen::Index i = 0; i < n; ++i) {
+		line_cmd.points(0, all) = cmd.points(i, all);
+		line_cmd.points(1, all) = cmd.points((i + 1) % n, all);
+		line(line_cmd);
+	}
+}
+
+std::pmr::vector<euler::graphics::Target::TriangleCommand>
+Target::triangulate(const PolygonCommand &cmd)
+{
+	const auto &mesh = _geometry.polygon(cmd.points, true);
+	const int16_t ox = cmd.points(0, 0);
+	const int16_t oy = cmd.points(0, 1);
+	std::pmr::vector<TriangleCommand> triangles(
+	    &state()->frame_arena());
+	triangles.reserve(mesh.indices.size() / 3);
+	for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+		TriangleCommand tri = {
+			.points = {},
+			.color = cmd.color,
+			.line_thickness = cmd.line_thickness,
+			.fill = true,
+		};
+		for (int j = 0; j < 3; ++j) {
+			const auto &p = mesh.outline[mesh.indices[i + j]];
+			tri.points(j, 0)
+			    = static_cast<int16_t>(std::lround(p.x + ox));
+			tri.points(j, 1)
+			    = static_cast<int16_t>(std::lround(p.y + oy));
+		}
+		triangles.push_back(tri);
+	}
+	return triangles;
 }
 
 /* TODO: currently background color is ignored */
 void
 Target::text(const TextCommand &cmd)
 {
+	if (_mode == RenderMode::Raster) {
+		if (raster_text(cmd)) return;
+		flush_raster();
+	}
 	const auto hash = ruby()->hash_new_capa(9);
 	STASH_INT(hash, x, cmd.position(0, 0));
 	STASH_INT(hash, y, cmd.position(0, 1));
@@ -337,6 +468,10 @@ Target::text(const TextCommand &cmd)
 void
 Target::image(const ImageCommand &cmd)
 {
+	if (_mode == RenderMode::Raster) {
+		if (raster_image(cmd)) return;
+		flush_raster();
+	}
 	const auto hash = ruby()->hash_new_capa(9);
 	STASH_INT(hash, x, cmd.position(0, 0));
 	STASH_INT(hash, y, cmd.position(0, 1));
@@ -347,6 +482,166 @@ Target::image(const ImageCommand &cmd)
 	push_output(_symbols.sprites, hash);
 }
 
+void
+Target::raster_rect(const RectCommand &cmd)
+{
+	const int x = cmd.position(0, 0);
+	const int y = cmd.position(0, 1);
+	const int w = cmd.size(0, 0);
+	const int h = cmd.size(0, 1);
+	const int th = std::max<int>(1, cmd.line_thickness);
+	if (cmd.fill) {
+		_raster.fill_rounded_rect(x, y, w, h, cmd.rounding, cmd.color);
+	} else if (cmd.rounding == 0 || th * 2 >= std::min(w, h)) {
+		_raster.stroke_rounded_rect(x, y, w, h, cmd.rounding, th,
+		    cmd.color);
+	} else {
+		/* stroke along the centre line of the border */
+		const float half = th / 2.0f;
+		const auto &mesh = _geometry.rounded_rect(w - th, h - th,
+		    std::max(0, cmd.rounding - th / 2), false);
+		_raster.polyline(mesh.outline, th, true, cmd.color,
+		    { x + half, y + half });
+	}
+}
+
+bool
+Target::raster_image(const ImageCommand &cmd)
+{
+	const uint32_t *pixels
+	    = cmd.image == nullptr ? nullptr : cmd.image->raw_data();
+	if (pixels == nullptr) return false;
+	const auto [src_w, src_h] = cmd.image->dimensions();
+	_raster.blit(pixels, src_w, src_h, cmd.position(0, 0),
+	    cmd.position(0, 1), cmd.size(0, 0), cmd.size(0, 1), cmd.color);
+	return true;
+}
+
+bool
+Target::raster_text(const TextCommand &cmd)
+{
+	if (cmd.font == nullptr) return false;
+	const auto &font = *cmd.font.get();
+	const auto sheet = glyph_sheet(font);
+	if (sheet == nullptr) return false;
+	const uint32_t *pixels = sheet->raw_data();
+	const auto [sheet_w, sheet_h] = sheet->dimensions();
+	const auto &layout = _text_layouts.layout(font, cmd.height, cmd.text);
+	const float x = cmd.position(0, 0);
+	const float y = cmd.position(0, 1);
+	for (const auto &quad : layout.quads) {
+		const graphics::Rasterizer::Rect source = {
+			static_cast<int>(quad.source_x),
+			static_cast<int>(quad.source_y),
+			static_cast<int>(quad.source_w),
+			static_cast<int>(quad.source_h),
+		};
+		_raster.blit(pixels, sheet_w, sheet_h, source,
+		    static_cast<int>(std::lround(x + quad.x)),
+		    static_cast<int>(std::lround(y + quad.y)),
+		    static_cast<int>(std::lround(quad.w)),
+		    static_cast<int>(std::lround(quad.h)), cmd.foreground);
+	}
+	return true;
+}
+
+euler::util::Reference<euler::util::Image>
+Target::glyph_sheet(const util::Font &font)
+{
+	auto path = font.path();
+	if (const auto it = _glyph_sheets.find(path); it != _glyph_sheets.end())
+		return it->second;
+	/* fonts the runtime renders itself (TTF) have no sheet to load */
+	auto sheet = state()->image_loader()->load_image(path.c_str());
+	if (sheet != nullptr && sheet->raw_data() == nullptr) sheet = nullptr;
+	_glyph_sheets.emplace(std::move(path), sheet);
+	return sheet;
+}
+
+void
+Target::set_render_mode(const RenderMode mode)
+{
+	_mode = mode;
+	_has_frame = false;
+	if (_mode == RenderMode::Primitives) _raster.resize(0, 0);
+}
+
+void
+Target::begin_frame()
+{
+	if (mrb_nil_p(_frame_outputs)) {
+		_frame_outputs = ruby()->ary_new();
+		ruby()->gc_register(_frame_outputs);
+	} else {
+		ruby()->ary_clear(_frame_outputs);
+	}
+	_has_frame = false;
+	_recording = true;
+	if (_mode != RenderMode::Raster) return;
+	update_size();
+	if (_raster.width() != _width || _raster.height() != _height)
+		_raster.resize(_width, _height);
+	_raster.reset_clip();
+	_raster.clear();
+	_raster_layers = 0;
+}
+
+void
+Target::end_frame()
+{
+	if (_mode == RenderMode::Raster) flush_raster();
+	_recording = false;
+	_has_frame = true;
+	_geometry.next_frame();
+	_text_layouts.next_frame();
+}
+
+bool
+Target::repeat_frame()
+{
+	if (!_has_frame || mrb_nil_p(_frame_outputs)) return false;
+	if (_mode == RenderMode::Raster) {
+		/* the uploaded texture is only valid at its original size */
+		update_size();
+		if (_raster.width() != _width || _raster.height() != _height)
+			return false;
+	}
+	const auto n = RARRAY_LEN(_frame_outputs);
+	for (mrb_int i = 0; i + 1 < n; i += 2) {
+		const auto sym = ruby()->ary_ref(_frame_outputs, i);
+		const auto output = ruby()->ary_ref(_frame_outputs, i + 1);
+		push_output(mrb_symbol(sym), output);
+	}
+	return true;
+}
+
+void
+Target::flush_raster()
+{
+	if (_raster.is_blank()) return;
+	const auto label = std::format("{}:{}", RASTER_LABEL, _raster_layers++);
+	_state.strengthen()->upload_pixels(label.c_str(), _raster.width(),
+	    _raster.height(), _raster.resolve());
+	_raster.clear();
+	const auto hash = ruby()->hash_new_capa(5);
+	STASH_INT(hash, x, 0);
+	STASH_INT(hash, y, 0);
+	STASH_INT(hash, w, _raster.width());
+	STASH_INT(hash, h, _raster.height());
+	STASH_STR(hash, path, label.c_str());
+	push_output(_symbols.sprites, hash);
+}
+
+void
+Target::push_output(const mrb_sym sym, const mrb_value value)
+{
+	const auto outputs = ruby()->funcall_argv(_render_target, sym);
+	ruby()->ary_push(outputs, value);
+	if (!_recording) return;
+	ruby()->ary_push(_frame_outputs, ruby()->symbol_value(sym));
+	ruby()->ary_push(_frame_outputs, value);
+}
+
 void
 Target::update_size()
 {
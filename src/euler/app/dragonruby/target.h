@@ -3,11 +3,15 @@
 #ifndef EULER_APP_DRAGONRUBY_RENDERER_H
 #define EULER_APP_DRAGONRUBY_RENDERER_H
 
+#include <memory_resource>
 #include <unordered_set>
 
+#include "euler/graphics/geometry_cache.h"
+#include "euler/graphics/rasterizer.h"
 #include "euler/graphics/target.h"
 #include "euler/util/image.h"
 #include "euler/util/object.h"
+#include "euler/util/text_layout.h"
 
 namespace euler::app::dragonruby {
 class RubyState;
@@ -15,6 +19,15 @@ class State;
 
 class Target final : public graphics::Target {
 public:
+	/* Primitives emits one DragonRuby output per command. Raster draws
+	 * commands, text included, into a pixel array that is uploaded and
+	 * displayed as one sprite per frame; only images and fonts without
+	 * CPU-side pixels split it into further layers. */
+	enum class RenderMode {
+		Primitives,
+		Raster,
+	};
+
 	~Target() override;
 	[[nodiscard]] util::Reference<util::State> state() const override;
 	void scissor(const ScissorCommand &cmd) override;
@@ -27,8 +40,30 @@ public:
 	void polygon(const PolygonCommand &cmd) override;
 	void text(const TextCommand &cmd) override;
 	void image(const ImageCommand &cmd) override;
+	void begin_frame() override;
+	void end_frame() override;
+	bool repeat_frame() override;
+
+	void set_render_mode(RenderMode mode);
+	[[nodiscard]] RenderMode
+	render_mode() const
+	{
+		return _mode;
+	}
 
 private:
+	static constexpr auto RASTER_LABEL = "euler:gui:raster";
+
+	void raster_rect(const RectCommand &cmd);
+	/* false if the command has no CPU-side pixels to draw from */
+	bool raster_image(const ImageCommand &cmd);
+	bool raster_text(const TextCommand &cmd);
+	util::Reference<util::Image> glyph_sheet(const util::Font &font);
+	/* Uploads what has been drawn since the last flush as one sprite and
+	 * clears the canvas. Commands that cannot be rasterized flush first
+	 * and then draw as primitives, so they stay in draw order. */
+	void flush_raster();
+
 	struct PointCommand {
 		Vec2i16 position;
 		int16_t radius;
@@ -44,7 +79,9 @@ private:
 	mrb_value args() const;
 	mrb_sym color_sym(util::Color);
 
-	std::vector<TriangleCommand> triangulate(const PolygonCommand &cmd);
+	/* allocated from the frame arena */
+	std::pmr::vector<TriangleCommand> triangulate(
+	    const PolygonCommand &cmd);
 
 	void thin_line(const LineCommand &cmd);
 
@@ -128,6 +165,21 @@ private:
 	std::unordered_map<util::Color, mrb_sym> _colors;
 	std::unordered_map<std::string, util::Reference<util::Image>> _uploaded;
 	util::Reference<util::Image> _canvas;
+	graphics::GeometryCache _geometry;
+	graphics::Rasterizer _raster;
+	/* scratch outline for raster polygons */
+	std::vector<graphics::Rasterizer::Point> _polygon;
+	RenderMode _mode = RenderMode::Primitives;
+	util::TextLayoutCache _text_layouts;
+	/* font sheets by path; null where the sheet has no CPU-side pixels */
+	std::unordered_map<std::string, util::Reference<util::Image>>
+	    _glyph_sheets;
+	/* raster sprites emitted this frame, each under its own label */
+	int _raster_layers = 0;
+	/* flat [sym, output, sym, output, ...] record of the last frame */
+	mrb_value _frame_outputs = mrb_nil_value();
+	bool _recording = false;
+	bool _has_frame = false;
 };
 } /* namespace euler::app::dragonruby */
 
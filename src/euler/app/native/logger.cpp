@@ -1,6 +1,7 @@
 /* SPDX-License-Identifier: ISC */
 
 #include <cassert>
+#include <format>
 
 #include <SDL3/SDL.h>
 
@@ -134,15 +135,27 @@ Logger::Sink::~Sink()
 	if (_own_file) fclose(_output);
 }
 void
-Logger::Sink::write_to(Severity severity, const std::string &msg) const
+Logger::Sink::write_to(Severity severity, const std::string_view msg,
+    const bool flush) const
 {
 	if (severity < _min_level) return;
 	std::lock_guard lock(_mutex);
-	fprintf(_output, "%s\n", msg.c_str());
+	fprintf(_output, "%.*s\n", static_cast<int>(msg.size()), msg.data());
+	if (flush) fflush(_output);
+}
+
+void
+Logger::Sink::flush() const
+{
+	std::lock_guard lock(_mutex);
 	fflush(_output);
 }
 
-Logger::Sink::Sink(FILE *output, Severity level, PrivateStruct) { }
+Logger::Sink::Sink(FILE *output, Severity level, PrivateStruct)
+    : _min_level(level)
+    , _output(output)
+{
+}
 
 std::shared_ptr<Logger::Sink>
 Logger::stdout_sink()
@@ -214,6 +227,7 @@ Logger::set_subsystem(std::string_view name)
 {
 	std::lock_guard lock(_subsystem_mutex);
 	_subsystem = name;
+	if (_binary != nullptr) _binary_subsystem = _binary->subsystem(name);
 }
 
 Severity
@@ -233,6 +247,73 @@ Logger::copy(std::optional<std::string_view> subsystem) const
 {
 }
 
+void
+Logger::enable_async(const size_t capacity,
+    const util::LogQueue::Overflow overflow)
+{
+	auto queue = std::make_shared<util::LogQueue>(
+	    [this](const Severity level, const std::string_view line) {
+		    deliver(level, line, false);
+	    },
+	    capacity, overflow, [this] { flush_sinks(); });
+	const auto previous = _queue.exchange(std::move(queue));
+	if (previous != nullptr) previous->flush();
+}
+
+void
+Logger::disable_async()
+{
+	/* the queue drains when the last thread pushing to it lets go */
+	_queue.store(nullptr);
+}
+
+void
+Logger::enable_binary(const std::filesystem::path &path)
+{
+	_binary = std::make_shared<util::BinaryLog>(path);
+	std::lock_guard lock(_subsystem_mutex);
+	_binary_subsystem = _binary->subsystem(_subsystem);
+}
+
+euler::util::BinaryLog::Channel
+Logger::binary_channel() const
+{
+	return { _binary.get(), _binary_subsystem.load() };
+}
+
+void
+Logger::flush() const
+{
+	if (const auto queue = _queue.load()) queue->flush();
+	if (_binary != nullptr) _binary->flush();
+	flush_sinks();
+}
+
+void
+Logger::deliver(const Severity level, const std::string_view line,
+    const bool flush) const
+{
+	std::lock_guard lock(_sinks_mutex);
+	if (_sinks.empty()) {
+		const auto out = output_stream(level);
+		fprintf(out, "%.*s\n", static_cast<int>(line.size()),
+		    line.data());
+		return;
+	}
+	for (const auto &sink : _sinks) sink->write_to(level, line, flush);
+}
+
+void
+Logger::flush_sinks() const
+{
+	{
+		std::lock_guard lock(_sinks_mutex);
+		for (const auto &sink : _sinks) sink->flush();
+	}
+	fflush(stdout);
+	fflush(stderr);
+}
+
 void
 Logger::write_log(Severity level, const std::string &message) const
 {
@@ -246,9 +327,13 @@ Logger::write_log(Severity level, const std::string &message) const
 	case Severity::Fatal: color = "\033[41m"; break; /* red bg */
 	default: color = ANSI_RESET_COLOR; break;        /* reset */
 	}
-	const auto out = output_stream(level);
-	fprintf(out, "%s[%s] %s: %s%s\n", color, subsystem().c_str(),
-	    severity_to_str(level), message.c_str(), ANSI_RESET_COLOR);
+	const auto line = std::format("{}[{}] {}: {}{}", color, subsystem(),
+	    severity_to_str(level), message, ANSI_RESET_COLOR);
+	if (const auto queue = _queue.load()) {
+		queue->push(level, line);
+		return;
+	}
+	deliver(level, line);
 }
 
 /* ReSharper disable once CppDFAUnreachableFunctionCall */
@@ -3,10 +3,12 @@
 #ifndef EULER_APP_NATIVE_LOGGER_H
 #define EULER_APP_NATIVE_LOGGER_H
 
+#include <atomic>
 #include <filesystem>
 #include <vector>
 #include <memory>
 
+#include "euler/util/log_queue.h"
 #include "euler/util/logger.h"
 
 namespace euler::app::native {
@@ -27,7 +29,11 @@ public:
 		~Sink();
 
 	private:
-		void write_to(Severity severity, const std::string &msg) const;
+		/* flush is false when writing from the log queue, which
+		 * flushes once per batch instead */
+		void write_to(Severity severity, std::string_view msg,
+		    bool flush = true) const;
+		void flush() const;
 
 		friend class Logger;
 		struct PrivateStruct { };
@@ -54,9 +60,22 @@ public:
 	[[nodiscard]] util::Reference<util::Logger> copy(
 	    std::optional<std::string_view> subsystem) const override;
 
+	/* Hands lines to a background thread instead of writing them on the
+	 * calling one. Lines logged before this call are written first. */
+	void enable_async(size_t capacity = 8192,
+	    util::LogQueue::Overflow overflow
+	    = util::LogQueue::Overflow::Count);
+	/* Writes out everything queued and goes back to writing directly. */
+	void disable_async();
+	/* Records to a BinaryLog at path from now on instead of writing text,
+	 * for log_decode to format later. Call before other threads log. */
+	void enable_binary(const std::filesystem::path &path);
+	void flush() const override;
+
 protected:
 	void write_log(Severity level,
 	    const std::string &message) const override;
+	[[nodiscard]] util::BinaryLog::Channel binary_channel() const override;
 
 private:
 
@@ -66,6 +85,9 @@ private:
 	// Color severity_color(Severity level) const;
 	// static std::string_view color_for(Color color);
 	static std::string_view severity_name(Severity level);
+	void deliver(Severity level, std::string_view line,
+	    bool flush = true) const;
+	void flush_sinks() const;
 
 	std::string _progname;
 	mutable std::mutex _progname_mutex;
@@ -74,6 +96,10 @@ private:
 	std::atomic<Severity> _severity = Severity::Info;
 	std::vector<std::shared_ptr<Sink>> _sinks;
 	mutable std::mutex _sinks_mutex;
+	std::shared_ptr<util::BinaryLog> _binary;
+	std::atomic<uint16_t> _binary_subsystem = 0;
+	/* declared last, so it drains while the sinks are still alive */
+	std::atomic<std::shared_ptr<util::LogQueue>> _queue;
 };
 } /* namespace euler::app::native */
 
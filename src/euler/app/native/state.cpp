@@ -4,9 +4,16 @@
 
 using euler::app::native::State;
 
+void
+State::tick()
+{
+	/* nothing to poll yet; pacing is done by app::State's scheduler */
+}
+
 bool
 State::loop(int &exit_code)
 {
 	(void)exit_code;
-	return true;
-}
\ No newline at end of file
+	tick();
+	return phase() != Phase::Quit;
+}
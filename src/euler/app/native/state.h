@@ -52,6 +52,7 @@ protected:
 public:
 	[[nodiscard]] util::Reference<util::ImageLoader>
 	image_loader() override;
+	[[nodiscard]] util::Reference<util::Jobs> jobs() override;
 
 private:
 
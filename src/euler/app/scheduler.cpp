@@ -0,0 +1,150 @@
+/* SPDX-License-Identifier: ISC */
+
+#include "euler/app/scheduler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+using euler::app::Scheduler;
+
+void
+Scheduler::Histogram::add(const double ms)
+{
+	const auto bucket = static_cast<size_t>(std::max(0.0, ms) / BUCKET_MS);
+	++_buckets[std::min(bucket, BUCKETS)];
+	/* Welford, so the variance does not need a second pass */
+	++_count;
+	const double delta = ms - _mean;
+	_mean += delta / static_cast<double>(_count);
+	_m2 += delta * (ms - _mean);
+}
+
+void
+Scheduler::Histogram::reset()
+{
+	_buckets.fill(0);
+	_count = 0;
+	_mean = 0.0;
+	_m2 = 0.0;
+}
+
+double
+Scheduler::Histogram::percentile(const double q) const
+{
+	if (_count == 0) return 0.0;
+	const auto target = static_cast<uint64_t>(
+	    std::ceil(std::clamp(q, 0.0, 1.0) * static_cast<double>(_count)));
+	uint64_t seen = 0;
+	for (size_t i = 0; i <= BUCKETS; ++i) {
+		seen += _buckets[i];
+		if (seen >= std::max<uint64_t>(target, 1))
+			return static_cast<double>(std::min(i + 1, BUCKETS))
+			    * BUCKET_MS;
+	}
+	return static_cast<double>(BUCKETS) * BUCKET_MS;
+}
+
+double
+Scheduler::Histogram::mean() const
+{
+	return _mean;
+}
+
+double
+Scheduler::Histogram::stddev() const
+{
+	if (_count < 2) return 0.0;
+	return std::sqrt(_m2 / static_cast<double>(_count - 1));
+}
+
+Scheduler::Scheduler(const Settings &settings)
+{
+	set_settings(settings);
+}
+
+void
+Scheduler::set_settings(const Settings &settings)
+{
+	_settings = settings;
+	_settings.update_rate = std::max(settings.update_rate, 1.0);
+	_settings.max_updates = std::max(settings.max_updates, 1);
+	_step = Seconds(1.0 / _settings.update_rate);
+	_frame_budget = Seconds(settings.render_rate > 0.0
+		? 1.0 / settings.render_rate
+		: 0.0);
+}
+
+void
+Scheduler::reset_stats()
+{
+	_stats = Stats {};
+	_histogram.reset();
+}
+
+void
+Scheduler::wait_until(const Clock::time_point deadline) const
+{
+	const auto threshold = _settings.spin_threshold;
+	for (auto now = Clock::now(); now < deadline; now = Clock::now()) {
+		const auto left = deadline - now;
+		if (left > threshold)
+			std::this_thread::sleep_for(left - threshold);
+		else
+			std::this_thread::yield();
+	}
+}
+
+void
+Scheduler::frame(const Callbacks &callbacks)
+{
+	if (_frame_budget.count() > 0.0 && _started) {
+		wait_until(_next_frame);
+		/* schedule from the deadline rather than from now, so the
+		 * cap does not drift, but never try to make up a backlog */
+		const auto budget = std::chrono::duration_cast<
+		    Clock::duration>(_frame_budget);
+		_next_frame = std::max(_next_frame + budget, Clock::now());
+	}
+
+	const auto now = Clock::now();
+	if (!_started) {
+		_started = true;
+		_last_frame = now;
+		_next_frame = now;
+		_fps_window_start = now;
+	}
+	const Seconds elapsed = now - _last_frame;
+	_last_frame = now;
+	if (_stats.frames > 0) _histogram.add(elapsed.count() * 1000.0);
+	++_stats.frames;
+
+	++_fps_window_frames;
+	if (now - _fps_window_start >= Seconds(1.0)) {
+		const Seconds window = now - _fps_window_start;
+		_stats.fps = static_cast<double>(_fps_window_frames)
+		    / window.count();
+		_fps_window_start = now;
+		_fps_window_frames = 0;
+	}
+
+	if (callbacks.input) callbacks.input();
+
+	_accumulator += elapsed;
+	int updates = 0;
+	while (_accumulator >= _step && updates < _settings.max_updates) {
+		if (callbacks.update) callbacks.update(_step.count());
+		_accumulator -= _step;
+		++updates;
+	}
+	_stats.updates += updates;
+	if (_accumulator >= _step) {
+		/* too far behind to catch up; keep the fractional step so
+		 * alpha stays meaningful */
+		const auto dropped = std::floor(_accumulator / _step);
+		_stats.dropped_updates += static_cast<uint64_t>(dropped);
+		_accumulator -= _step * dropped;
+	}
+
+	if (callbacks.draw) callbacks.draw(alpha());
+}
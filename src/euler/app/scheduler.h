@@ -0,0 +1,143 @@
+/* SPDX-License-Identifier: ISC */
+
+#ifndef EULER_APP_SCHEDULER_H
+#define EULER_APP_SCHEDULER_H
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+
+namespace euler::app {
+
+/* Frame pacing with a fixed update step and a variable render rate. Each
+ * frame runs input once, then as many fixed updates as real time has
+ * accumulated (up to a catch-up limit), then draw with the interpolation
+ * factor between the last two updates. With a render cap set, the frame
+ * first waits for its slot by sleeping until close to the deadline and then
+ * spinning, which keeps the OS timer's slack out of the frame time. */
+class Scheduler {
+public:
+	using Clock = std::chrono::steady_clock;
+
+	struct Settings {
+		/* fixed updates per second */
+		double update_rate = 60.0;
+		/* frames per second to cap rendering at; 0 leaves frames
+		 * uncapped, for hosts that pace frames themselves */
+		double render_rate = 0.0;
+		/* updates allowed per frame before time is dropped */
+		int max_updates = 5;
+		/* how close to a deadline to stop sleeping and spin */
+		std::chrono::microseconds spin_threshold { 2000 };
+	};
+
+	struct Callbacks {
+		std::function<void()> input;
+		std::function<void(double dt)> update;
+		std::function<void(double alpha)> draw;
+	};
+
+	/* Frame-to-frame times, in milliseconds. */
+	class Histogram {
+	public:
+		static constexpr double BUCKET_MS = 0.25;
+		static constexpr size_t BUCKETS = 400;
+
+		void add(double ms);
+		void reset();
+		/* upper bound of the bucket holding quantile q (0..1); times
+		 * past the last bucket report as its bound */
+		[[nodiscard]] double percentile(double q) const;
+		[[nodiscard]] double mean() const;
+		[[nodiscard]] double stddev() const;
+		[[nodiscard]] uint64_t
+		count() const
+		{
+			return _count;
+		}
+		[[nodiscard]] const std::array<uint32_t, BUCKETS + 1> &
+		buckets() const
+		{
+			return _buckets;
+		}
+
+	private:
+		/* the last bucket collects everything past the range */
+		std::array<uint32_t, BUCKETS + 1> _buckets {};
+		uint64_t _count = 0;
+		double _mean = 0.0;
+		double _m2 = 0.0;
+	};
+
+	struct Stats {
+		/* frames per second over the last full second */
+		double fps = 0.0;
+		uint64_t frames = 0;
+		uint64_t updates = 0;
+		/* fixed steps discarded by the catch-up limit */
+		uint64_t dropped_updates = 0;
+	};
+
+	explicit Scheduler(const Settings &settings);
+	Scheduler()
+	    : Scheduler(Settings {})
+	{
+	}
+
+	/* Runs one frame; any callback may be empty. */
+	void frame(const Callbacks &callbacks);
+
+	void set_settings(const Settings &settings);
+	[[nodiscard]] const Settings &
+	settings() const
+	{
+		return _settings;
+	}
+
+	/* seconds per fixed update */
+	[[nodiscard]] double
+	dt() const
+	{
+		return _step.count();
+	}
+	/* fraction of a step accumulated past the last update, for
+	 * interpolating draws */
+	[[nodiscard]] double
+	alpha() const
+	{
+		return _accumulator / _step;
+	}
+	[[nodiscard]] const Stats &
+	stats() const
+	{
+		return _stats;
+	}
+	[[nodiscard]] const Histogram &
+	histogram() const
+	{
+		return _histogram;
+	}
+	void reset_stats();
+
+private:
+	using Seconds = std::chrono::duration<double>;
+
+	void wait_until(Clock::time_point deadline) const;
+
+	Settings _settings;
+	Seconds _step;
+	Seconds _frame_budget { 0.0 };
+	Seconds _accumulator { 0.0 };
+	Clock::time_point _last_frame;
+	Clock::time_point _next_frame;
+	Clock::time_point _fps_window_start;
+	uint64_t _fps_window_frames = 0;
+	bool _started = false;
+	Stats _stats;
+	Histogram _histogram;
+};
+
+} /* namespace euler::app */
+
+#endif /* EULER_APP_SCHEDULER_H */
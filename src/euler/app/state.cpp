@@ -5,8 +5,15 @@
 #include <cassert>
 
 #include "euler/physics/ext.h"
+#ifdef EULER_MATH
+#include "euler/math/math.h"
+#endif
 #include "euler/util/logger.h"
 #include "euler/util/ext.h"
+#include "euler/util/profiler.h"
+#ifdef EULER_NATIVE
+#include "euler/vulkan/ext.h"
+#endif
 
 #ifndef EULER_GV_STATE
 #define EULER_GV_STATE app
@@ -21,6 +28,25 @@ State::~State() = default;
 State::State(const Arguments &args)
     : EULER_APP_NAMESPACE::State(args)
 {
+	_phases = {
+		.input =
+		    [this] {
+			    dispatch(Phase::Input, mrb()->intern_cstr("input"),
+				0, nullptr);
+		    },
+		.update =
+		    [this](const double dt) {
+			    const auto arg = mrb()->float_value(dt);
+			    dispatch(Phase::Update,
+				mrb()->intern_cstr("update"), 1, &arg);
+		    },
+		.draw =
+		    [this](const double alpha) {
+			    const auto arg = mrb()->float_value(alpha);
+			    dispatch(Phase::Draw, mrb()->intern_cstr("draw"), 1,
+				&arg);
+		    },
+	};
 }
 
 euler::util::State::nthread_t
@@ -90,6 +116,133 @@ state_dt(mrb_state *mrb, const mrb_value self)
 	return state->mrb()->float_value(state->dt());
 }
 
+static mrb_value
+state_alpha(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = State::get(mrb)->unwrap<State>(self);
+	return state->mrb()->float_value(state->alpha());
+}
+
+static mrb_value
+state_frame_stats(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = State::get(mrb)->unwrap<State>(self);
+	const auto &ruby = state->mrb();
+	const auto &scheduler = state->scheduler();
+	const auto &stats = scheduler.stats();
+	const auto &histogram = scheduler.histogram();
+	const auto hash = ruby->hash_new_capa(9);
+	ruby->hash_set(hash, "fps", ruby->float_value(stats.fps));
+	ruby->hash_set(hash, "frames", ruby->int_value(stats.frames));
+	ruby->hash_set(hash, "updates", ruby->int_value(stats.updates));
+	ruby->hash_set(hash, "dropped_updates",
+	    ruby->int_value(stats.dropped_updates));
+	ruby->hash_set(hash, "mean_ms", ruby->float_value(histogram.mean()));
+	ruby->hash_set(hash, "stddev_ms",
+	    ruby->float_value(histogram.stddev()));
+	ruby->hash_set(hash, "p50_ms",
+	    ruby->float_value(histogram.percentile(0.5)));
+	ruby->hash_set(hash, "p95_ms",
+	    ruby->float_value(histogram.percentile(0.95)));
+	ruby->hash_set(hash, "p99_ms",
+	    ruby->float_value(histogram.percentile(0.99)));
+	return hash;
+}
+
+static mrb_value
+state_frame_memory(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = State::get(mrb)->unwrap<State>(self);
+	const auto &ruby = state->mrb();
+	const auto &stats = state->frame_arena().last_frame();
+	const auto hash = ruby->hash_new_capa(4);
+	ruby->hash_set(hash, "allocations", ruby->int_value(stats.allocations));
+	ruby->hash_set(hash, "bytes", ruby->int_value(stats.bytes));
+	ruby->hash_set(hash, "heap_allocations",
+	    ruby->int_value(stats.heap_allocations));
+	ruby->hash_set(hash, "capacity", ruby->int_value(stats.capacity));
+	return hash;
+}
+
+static mrb_value
+state_set_update_rate(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = State::get(mrb)->unwrap<State>(self);
+	mrb_float rate;
+	state->mrb()->get_args("f", &rate);
+	auto settings = state->scheduler().settings();
+	settings.update_rate = rate;
+	state->scheduler().set_settings(settings);
+	return state->mrb()->float_value(rate);
+}
+
+static mrb_value
+state_set_render_rate(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = State::get(mrb)->unwrap<State>(self);
+	mrb_float rate;
+	state->mrb()->get_args("f", &rate);
+#ifdef EULER_DRAGONRUBY
+	/* DragonRuby paces frames before calling State#tick, so a cap would
+	 * only sleep inside its frame */
+	if (rate != 0.0) {
+		state->mrb()->raise(state->mrb()->argument_error(),
+		    "DragonRuby paces frames itself; render_rate must be 0");
+	}
+#endif
+	auto settings = state->scheduler().settings();
+	settings.render_rate = rate;
+	state->scheduler().set_settings(settings);
+	return state->mrb()->float_value(rate);
+}
+
+#ifdef EULER_DRAGONRUBY
+/* DragonRuby owns the main loop, so the game's tick method calls this once
+ * per frame with its args to run Euler's frame: the arena reset, job and
+ * image polling, the scheduler's phases and the profiler's frame boundary. */
+static mrb_value
+state_tick(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = State::get(mrb)->unwrap<State>(self);
+	mrb_value args = mrb_nil_value();
+	state->mrb()->get_args("|o", &args);
+	state->set_args(args);
+	state->tick();
+	state->set_args(mrb_nil_value());
+	return mrb_nil_value();
+}
+
+static mrb_value
+state_render_mode(mrb_state *mrb, const mrb_value self)
+{
+	using RenderMode = euler::app::dragonruby::Target::RenderMode;
+	const auto state = State::get(mrb)->unwrap<State>(self);
+	switch (state->render_mode()) {
+	case RenderMode::Primitives: return EULER_SYM_VAL(primitives);
+	case RenderMode::Raster: return EULER_SYM_VAL(raster);
+	default: std::unreachable();
+	}
+}
+
+static mrb_value
+state_set_render_mode(mrb_state *mrb, const mrb_value self)
+{
+	using RenderMode = euler::app::dragonruby::Target::RenderMode;
+	const auto state = State::get(mrb)->unwrap<State>(self);
+	mrb_sym mode;
+	state->mrb()->get_args("n", &mode);
+	if (mode == EULER_SYM(primitives)) {
+		state->set_render_mode(RenderMode::Primitives);
+	} else if (mode == EULER_SYM(raster)) {
+		state->set_render_mode(RenderMode::Raster);
+	} else {
+		state->mrb()->raise(state->mrb()->argument_error(),
+		    "invalid render mode");
+	}
+	return mrb_symbol_value(mode);
+}
+#endif
+
 static mrb_value
 state_progname(mrb_state *mrb, const mrb_value self)
 {
@@ -119,13 +272,16 @@ State::initialize()
 
 	// mods.graphics.mod = graphics::init(self, mods.mod);
 	// mods.gui.mod = gui::init(self, mods.mod);
-	// #ifdef EULER_MATH
-	// 	mods.math.mod = math::init(self, mods.mod);
-	// #endif
+#ifdef EULER_MATH
+	mods.math.mod = math::init(self, mods.mod);
+#endif
 #ifdef EULER_PHYSICS
 	mods.physics.mod = physics::init(self, mods.mod);
 #endif
 	mods.util.mod = util::init(self, mods.mod);
+#ifdef EULER_NATIVE
+	mods.vulkan.mod = vulkan::init(self, mods.mod);
+#endif
 	log()->debug("Core modules initialized");
 
 	if (!EULER_APP_NAMESPACE::State::initialize()) return false;
@@ -149,7 +305,19 @@ State::last_tick() const
 float
 State::fps() const
 {
-	return _fps;
+	return static_cast<float>(_scheduler.stats().fps);
+}
+
+float
+State::dt() const
+{
+	return static_cast<float>(_scheduler.dt());
+}
+
+float
+State::alpha() const
+{
+	return static_cast<float>(_scheduler.alpha());
 }
 
 euler::util::State::tick_t
@@ -161,16 +329,47 @@ State::total_ticks() const
 void
 State::tick()
 {
-	_last_tick = _tick;
-	_tick = ticks();
-	++_total_ticks;
-	if (_tick - _last_frame_tick < 1000) return;
-	const auto frames = _total_ticks - _last_frame_total_ticks;
-	const auto milliseconds = _tick - _last_frame_tick;
-	const auto seconds = static_cast<double>(milliseconds) / 1000.0;
-	_fps = static_cast<float>(static_cast<double>(frames) / seconds);
-	_last_frame_tick = _tick;
-	_last_frame_total_ticks = _total_ticks;
+	frame_arena().reset();
+	{
+		util::Profiler::Zone zone("frame");
+		_last_tick = _tick;
+		_tick = ticks();
+		++_total_ticks;
+		EULER_APP_NAMESPACE::State::tick();
+		_scheduler.frame(_phases);
+	}
+	util::Profiler::get().end_frame();
+}
+
+static const char *
+phase_zone(const euler::util::State::Phase phase)
+{
+	using Phase = euler::util::State::Phase;
+	switch (phase) {
+	case Phase::Load:
+		return "load";
+	case Phase::Input:
+		return "input";
+	case Phase::Update:
+		return "update";
+	case Phase::Draw:
+		return "draw";
+	case Phase::Quit:
+		return "quit";
+	}
+	return "phase";
+}
+
+void
+State::dispatch(const Phase phase, const mrb_sym method, const mrb_int argc,
+    const mrb_value *argv)
+{
+	set_phase(phase);
+	util::Profiler::Zone zone(phase_zone(phase));
+	const auto self = self_value();
+	if (mrb_nil_p(self)) return;
+	if (!mrb()->obj_respond_to(mrb()->obj_class(self), method)) return;
+	mrb()->funcall_argv(self, method, argc, argv);
 }
 
 RClass *
@@ -221,6 +420,22 @@ State::initialize_self()
 	mrb()->define_method(cls, "ticks", state_ticks, MRB_ARGS_NONE());
 	mrb()->define_method(cls, "fps", state_fps, MRB_ARGS_NONE());
 	mrb()->define_method(cls, "dt", state_dt, MRB_ARGS_NONE());
+	mrb()->define_method(cls, "alpha", state_alpha, MRB_ARGS_NONE());
+	mrb()->define_method(cls, "frame_stats", state_frame_stats,
+	    MRB_ARGS_NONE());
+	mrb()->define_method(cls, "frame_memory", state_frame_memory,
+	    MRB_ARGS_NONE());
+	mrb()->define_method(cls, "update_rate=", state_set_update_rate,
+	    MRB_ARGS_REQ(1));
+	mrb()->define_method(cls, "render_rate=", state_set_render_rate,
+	    MRB_ARGS_REQ(1));
+#ifdef EULER_DRAGONRUBY
+	mrb()->define_method(cls, "tick", state_tick, MRB_ARGS_OPT(1));
+	mrb()->define_method(cls, "render_mode", state_render_mode,
+	    MRB_ARGS_NONE());
+	mrb()->define_method(cls, "render_mode=", state_set_render_mode,
+	    MRB_ARGS_REQ(1));
+#endif
 	mrb()->define_method(cls, "progname", state_progname, MRB_ARGS_NONE());
 	mrb()->define_method(cls, "title", state_title, MRB_ARGS_NONE());
 	const auto ptr = util::WeakReference(this).wrap();
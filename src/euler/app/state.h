@@ -3,6 +3,7 @@
 #ifndef EULER_APP_STATE_H
 #define EULER_APP_STATE_H
 
+#include "euler/app/scheduler.h"
 #include "euler/util/object.h"
 
 #ifdef EULER_PHYSICS
@@ -31,8 +32,24 @@ public:
 	bool initialize() override;
 	[[nodiscard]] tick_t last_tick() const override;
 	[[nodiscard]] float fps() const override;
+	[[nodiscard]] float dt() const override;
+	/* interpolation factor between the last two fixed updates */
+	[[nodiscard]] float alpha() const;
 	[[nodiscard]] tick_t total_ticks() const override;
+	/* Runs one frame through the scheduler: the input phase, the fixed
+	 * updates that are due, then draw. The native loop calls this; on
+	 * DragonRuby, the game's tick calls it through State#tick. */
 	void tick() override;
+	[[nodiscard]] Scheduler &
+	scheduler()
+	{
+		return _scheduler;
+	}
+	[[nodiscard]] const Scheduler &
+	scheduler() const
+	{
+		return _scheduler;
+	}
 	[[nodiscard]] RClass *object_class() const override;
 	void *unwrap(mrb_value value, const mrb_data_type *type) const override;
 
@@ -61,6 +78,9 @@ protected:
 
 private:
 	void initialize_self();
+	/* calls method on the state object, if it defines it */
+	void dispatch(Phase phase, mrb_sym method, mrb_int argc,
+	    const mrb_value *argv);
 
 private:
 #ifdef EULER_PHYSICS
@@ -68,14 +88,11 @@ private:
 #endif
 	bool _initialized_self = false;
 	Phase _phase = Phase::Update;
-	float _fps = 0;
 	tick_t _last_tick = 0;
 	tick_t _tick = 0;
 	tick_t _total_ticks = 0;
-	// frames elapsed over the last second
-	tick_t _frames = 0;
-	tick_t _last_frame_tick = 0;
-	tick_t _last_frame_total_ticks = 0;
+	Scheduler _scheduler;
+	Scheduler::Callbacks _phases;
 	Modules _modules = {};
 	mrb_value _self_value = mrb_nil_value();
 };
@@ -0,0 +1,271 @@
+/* SPDX-License-Identifier: ISC */
+
+#include "euler/graphics/atlas.h"
+
+#include <algorithm>
+#include <format>
+#include <sstream>
+
+#include "euler/util/image_loader.h"
+#include "euler/util/pixel.h"
+
+using euler::graphics::Atlas;
+
+static constexpr std::string_view MAGIC = "euler-atlas";
+static constexpr int FORMAT_VERSION = 1;
+
+Atlas::Atlas(const util::Reference<util::State> &state, std::string label,
+    const Settings &settings)
+    : _state(state)
+    , _label(std::move(label))
+    , _settings(settings)
+{
+}
+
+int
+Atlas::reserved(const int16_t size) const
+{
+	return size + 2 * _settings.extrude + _settings.padding;
+}
+
+void
+Atlas::add(const std::string &name, const util::Reference<util::Image> &image)
+{
+	if (image == nullptr) return;
+	const auto [w, h] = image->dimensions();
+	if (const auto it = _index.find(name); it != _index.end()) {
+		auto &slot = _slots[it->second];
+		if (slot.width == w && slot.height == h) {
+			slot.image = image;
+			slot.dirty = true;
+			return;
+		}
+		/* the old rect stays reserved, unnamed, until repack() */
+		slot.name.clear();
+		slot.image = nullptr;
+		_index.erase(it);
+	}
+	const auto queued = std::ranges::find(_queued, name,
+	    [](const auto &pair) -> const std::string & { return pair.first; });
+	if (queued != _queued.end()) queued->second = image;
+	else _queued.emplace_back(name, image);
+}
+
+bool
+Atlas::add(const char *path)
+{
+	const auto image = _state->image_loader()->load_image(path);
+	if (image == nullptr) return false;
+	add(path, image);
+	return true;
+}
+
+std::optional<std::pair<int, euler::graphics::SkylinePacker::Rect>>
+Atlas::allocate(const int16_t w, const int16_t h)
+{
+	const int rw = reserved(w);
+	const int rh = reserved(h);
+	if (rw > _settings.page_size || rh > _settings.page_size)
+		return std::nullopt;
+	for (size_t i = 0; i < _pages.size(); ++i) {
+		if (const auto rect = _pages[i].packer.insert(rw, rh))
+			return std::pair { static_cast<int>(i), *rect };
+	}
+	auto &page = _pages.emplace_back();
+	page.packer.reset(_settings.page_size, _settings.page_size);
+	return std::pair { static_cast<int>(_pages.size() - 1),
+		*page.packer.insert(rw, rh) };
+}
+
+void
+Atlas::copy_into_page(const Slot &slot)
+{
+	auto &page = _pages[slot.page];
+	if (page.image == nullptr) {
+		page.image = _state->image_loader()->create_image(
+		    page_label(slot.page).c_str(), _settings.page_size,
+		    _settings.page_size, util::Color(0, 0, 0, 0));
+		if (page.image == nullptr) return;
+	}
+	uint32_t *data = page.image->raw_data();
+	if (data == nullptr || slot.image->raw_data() == nullptr) return;
+
+	const int e = _settings.extrude;
+	const int x = slot.rect.x + e;
+	const int y = slot.rect.y + e;
+	const int w = slot.width;
+	const int h = slot.height;
+	const int stride = page.image->dimensions().first;
+	page.image->blit(*slot.image.get(), static_cast<int16_t>(x),
+	    static_cast<int16_t>(y), util::Image::BlendMode::Copy);
+	/* repeat the outer rows, then the outer columns including the
+	 * corners */
+	for (int i = 1; i <= e; ++i) {
+		std::copy_n(data + y * stride + x, w,
+		    data + (y - i) * stride + x);
+		std::copy_n(data + (y + h - 1) * stride + x, w,
+		    data + (y + h - 1 + i) * stride + x);
+	}
+	if (e > 0) {
+		for (int row = y - e; row < y + h + e; ++row) {
+			uint32_t *line = data + row * stride;
+			util::pixel::fill(line + x - e, e, line[x]);
+			util::pixel::fill(line + x + w, e, line[x + w - 1]);
+		}
+	}
+	page.dirty = true;
+}
+
+bool
+Atlas::build()
+{
+	bool ok = true;
+	/* tallest first packs a skyline noticeably tighter */
+	std::ranges::stable_sort(_queued, std::ranges::greater {},
+	    [](const auto &pair) {
+		    const auto [w, h] = pair.second->dimensions();
+		    return std::pair { h, w };
+	    });
+	for (const auto &[name, image] : _queued) {
+		const auto [w, h] = image->dimensions();
+		const auto placed = allocate(w, h);
+		if (!placed) {
+			ok = false;
+			continue;
+		}
+		_index[name] = _slots.size();
+		_slots.push_back(Slot {
+		    .name = name,
+		    .image = image,
+		    .rect = placed->second,
+		    .page = placed->first,
+		    .width = w,
+		    .height = h,
+		    .dirty = true,
+		});
+	}
+	_queued.clear();
+
+	for (auto &slot : _slots) {
+		if (!slot.dirty) continue;
+		slot.dirty = false;
+		if (slot.image != nullptr) copy_into_page(slot);
+	}
+	for (size_t i = 0; i < _pages.size(); ++i) {
+		auto &page = _pages[i];
+		if (!page.dirty) continue;
+		page.dirty = false;
+		_state->upload_image(page_label(static_cast<int>(i)).c_str(),
+		    page.image);
+	}
+	return ok;
+}
+
+void
+Atlas::reset()
+{
+	_pages.clear();
+	_slots.clear();
+	_index.clear();
+}
+
+bool
+Atlas::repack()
+{
+	decltype(_queued) images;
+	images.reserve(_slots.size() + _queued.size());
+	for (auto &slot : _slots) {
+		if (slot.image == nullptr || slot.name.empty()) continue;
+		images.emplace_back(std::move(slot.name),
+		    std::move(slot.image));
+	}
+	std::ranges::move(_queued, std::back_inserter(images));
+	reset();
+	_queued = std::move(images);
+	return build();
+}
+
+std::optional<Atlas::Entry>
+Atlas::find(const std::string &name) const
+{
+	const auto it = _index.find(name);
+	if (it == _index.end()) return std::nullopt;
+	const auto &slot = _slots[it->second];
+	if (slot.image == nullptr) return std::nullopt;
+	Entry entry;
+	entry.page = slot.page;
+	entry.location.x = static_cast<float>(slot.rect.x + _settings.extrude);
+	entry.location.y = static_cast<float>(slot.rect.y + _settings.extrude);
+	entry.location.width = slot.width;
+	entry.location.height = slot.height;
+	return entry;
+}
+
+std::string
+Atlas::page_label(const int page) const
+{
+	return std::format("{}:{}", _label, page);
+}
+
+std::string
+Atlas::serialize() const
+{
+	std::string out = std::format("{} {} {} {} {}\n", MAGIC,
+	    FORMAT_VERSION, _settings.page_size, _settings.padding,
+	    _settings.extrude);
+	for (const auto &slot : _slots) {
+		out += std::format("{} {} {} {} {} {}\n", slot.page,
+		    slot.rect.x, slot.rect.y, slot.width, slot.height,
+		    slot.name);
+	}
+	return out;
+}
+
+bool
+Atlas::deserialize(const std::string_view data)
+{
+	if (!_slots.empty() || !_pages.empty()) return false;
+	std::istringstream stream { std::string(data) };
+	std::string magic;
+	int version = 0;
+	int page_size = 0;
+	int padding = 0;
+	int extrude = 0;
+	stream >> magic >> version >> page_size >> padding >> extrude;
+	if (!stream || magic != MAGIC || version != FORMAT_VERSION
+	    || page_size != _settings.page_size
+	    || padding != _settings.padding || extrude != _settings.extrude)
+		return false;
+
+	/* placement is deterministic, so replaying the inserts in order
+	 * rebuilds the skylines; any mismatch means the data is stale */
+	Slot slot;
+	while (stream >> slot.page >> slot.rect.x >> slot.rect.y
+	    >> slot.width >> slot.height) {
+		std::getline(stream, slot.name);
+		if (!slot.name.empty() && slot.name.front() == ' ')
+			slot.name.erase(0, 1);
+		if (slot.page < 0 || slot.page > static_cast<int>(_pages.size())
+		    || slot.width <= 0 || slot.height <= 0) {
+			reset();
+			return false;
+		}
+		if (slot.page == static_cast<int>(_pages.size())) {
+			_pages.emplace_back().packer.reset(_settings.page_size,
+			    _settings.page_size);
+		}
+		const auto rect = _pages[slot.page].packer.insert(
+		    reserved(slot.width), reserved(slot.height));
+		if (!rect || rect->x != slot.rect.x || rect->y != slot.rect.y) {
+			reset();
+			return false;
+		}
+		slot.rect = *rect;
+		if (!slot.name.empty()) _index[slot.name] = _slots.size();
+		_slots.push_back(std::move(slot));
+		slot = Slot {};
+	}
+	if (stream.eof()) return true;
+	reset();
+	return false;
+}
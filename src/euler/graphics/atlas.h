@@ -0,0 +1,115 @@
+/* SPDX-License-Identifier: ISC */
+
+#ifndef EULER_GRAPHICS_ATLAS_H
+#define EULER_GRAPHICS_ATLAS_H
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "euler/graphics/skyline_packer.h"
+#include "euler/util/image.h"
+#include "euler/util/object.h"
+#include "euler/util/state.h"
+
+namespace euler::graphics {
+
+/* Packs many small images into a few large pages so they can share a
+ * texture. Images are added by name and placed by the next build(); pages
+ * only grow, so adding images later packs them into the remaining space and
+ * re-uploads just the pages that changed. Each image is surrounded by its
+ * edge pixels repeated extrude times, plus padding transparent pixels, so
+ * filtering at the border does not bleed in neighbouring sprites. */
+class Atlas final : public util::Object {
+public:
+	struct Settings {
+		int16_t page_size = 2048;
+		int16_t padding = 1;
+		int16_t extrude = 1;
+	};
+
+	struct Entry {
+		/* index of the page; see page_label() */
+		int page = 0;
+		util::Image::Location location;
+	};
+
+	Atlas(const util::Reference<util::State> &state, std::string label,
+	    const Settings &settings);
+	Atlas(const util::Reference<util::State> &state, std::string label)
+	    : Atlas(state, std::move(label), Settings {})
+	{
+	}
+	~Atlas() override = default;
+
+	/* Queues image under name, replacing any earlier image with that
+	 * name. The space an image of a different size used is not
+	 * reclaimed until repack(). */
+	void add(const std::string &name,
+	    const util::Reference<util::Image> &image);
+	/* Loads path synchronously and adds it under its path. */
+	bool add(const char *path);
+
+	/* Places every queued image, copies its pixels into its page and
+	 * uploads the pages that changed. Returns false if some image did not
+	 * fit on an empty page; the rest are still placed. */
+	bool build();
+	/* Discards the layout and packs every image again from scratch. */
+	bool repack();
+
+	[[nodiscard]] std::optional<Entry> find(const std::string &name) const;
+	[[nodiscard]] std::string page_label(int page) const;
+	[[nodiscard]] size_t
+	page_count() const
+	{
+		return _pages.size();
+	}
+
+	/* Writes the layout as text, in insertion order. */
+	[[nodiscard]] std::string serialize() const;
+	/* Restores a layout written by serialize() with the same settings.
+	 * Only valid on an empty atlas. Images added afterwards under a
+	 * saved name reuse the saved rect when their size still matches, so
+	 * the packing work is skipped entirely. */
+	bool deserialize(std::string_view data);
+
+private:
+	struct Slot {
+		std::string name;
+		util::Reference<util::Image> image;
+		/* reserved area, including extrusion and padding */
+		SkylinePacker::Rect rect;
+		int page = 0;
+		int16_t width = 0;
+		int16_t height = 0;
+		bool dirty = false;
+	};
+
+	struct Page {
+		SkylinePacker packer;
+		util::Reference<util::Image> image;
+		bool dirty = false;
+	};
+
+	[[nodiscard]] int reserved(int16_t size) const;
+	/* finds room for w x h pixels, adding a page if needed */
+	std::optional<std::pair<int, SkylinePacker::Rect>> allocate(int16_t w,
+	    int16_t h);
+	void copy_into_page(const Slot &slot);
+	void reset();
+
+	util::Reference<util::State> _state;
+	std::string _label;
+	Settings _settings;
+	std::vector<Page> _pages;
+	std::vector<Slot> _slots;
+	std::unordered_map<std::string, size_t> _index;
+	std::vector<std::pair<std::string, util::Reference<util::Image>>>
+	    _queued;
+};
+
+} /* namespace euler::graphics */
+
+#endif /* EULER_GRAPHICS_ATLAS_H */
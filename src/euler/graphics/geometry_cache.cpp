@@ -0,0 +1,238 @@
+/* SPDX-License-Identifier: ISC */
+
+#include "euler/graphics/geometry_cache.h"
+
+#include <array>
+#include <cmath>
+#include <numbers>
+
+#include <mapbox/earcut.hpp>
+
+using euler::graphics::GeometryCache;
+
+/* angles are keyed in 1/4096ths of a radian, radii in quarter pixels */
+static constexpr float ANGLE_QUANTUM = 4096.0f;
+static constexpr float RADIUS_QUANTUM = 4.0f;
+static constexpr int MAX_CURVE_SEGMENTS = 128;
+
+size_t
+GeometryCache::KeyHash::operator()(const Key &key) const
+{
+	/* FNV-1a over the key words */
+	uint64_t hash = 0xcbf29ce484222325ull;
+	for (const int32_t word : key.data) {
+		hash ^= static_cast<uint32_t>(word);
+		hash *= 0x100000001b3ull;
+	}
+	return static_cast<size_t>(hash);
+}
+
+void
+GeometryCache::begin_key(const Kind kind)
+{
+	_probe.data.clear();
+	_probe.data.push_back(static_cast<int32_t>(kind));
+}
+
+std::pair<GeometryCache::Entry *, bool>
+GeometryCache::lookup()
+{
+	if (const auto it = _entries.find(_probe); it != _entries.end()) {
+		++_hits;
+		it->second.last_used = _frame;
+		return { &it->second, true };
+	}
+	++_misses;
+	auto [it, _] = _entries.emplace(_probe, Entry {});
+	it->second.last_used = _frame;
+	return { &it->second, false };
+}
+
+void
+GeometryCache::fan(Mesh &mesh)
+{
+	const auto n = static_cast<uint32_t>(mesh.outline.size());
+	mesh.indices.clear();
+	if (n < 3) return;
+	mesh.indices.reserve((n - 2) * 3);
+	for (uint32_t i = 1; i + 1 < n; ++i) {
+		mesh.indices.push_back(0);
+		mesh.indices.push_back(i);
+		mesh.indices.push_back(i + 1);
+	}
+}
+
+void
+GeometryCache::triangulate(Mesh &mesh)
+{
+	using Vertex = std::array<float, 2>;
+	std::vector<std::vector<Vertex>> rings(1);
+	rings[0].reserve(mesh.outline.size());
+	for (const auto &p : mesh.outline) rings[0].push_back({ p.x, p.y });
+	mesh.indices = mapbox::earcut<uint32_t>(rings);
+}
+
+const GeometryCache::Mesh &
+GeometryCache::curve(const Eigen::Matrix<int16_t, 4, 2> &points)
+{
+	begin_key(Kind::Curve);
+	for (int i = 1; i < 4; ++i) {
+		_probe.data.push_back(points(i, 0) - points(0, 0));
+		_probe.data.push_back(points(i, 1) - points(0, 1));
+	}
+	auto [entry, found] = lookup();
+	if (found) return entry->mesh;
+
+	const auto &k = _probe.data;
+	const float p1x = k[1];
+	const float p1y = k[2];
+	const float p2x = k[3];
+	const float p2y = k[4];
+	const float p3x = k[5];
+	const float p3y = k[6];
+	/* Wang's bound on the second difference, for a quarter pixel
+	 * flattening tolerance */
+	const float dx = std::max(std::abs(-2.0f * p1x + p2x),
+	    std::abs(p1x - 2.0f * p2x + p3x));
+	const float dy = std::max(std::abs(-2.0f * p1y + p2y),
+	    std::abs(p1y - 2.0f * p2y + p3y));
+	const float m = std::hypot(dx, dy);
+	const int segments = std::clamp(
+	    static_cast<int>(std::ceil(std::sqrt(3.0f * m))), 1,
+	    MAX_CURVE_SEGMENTS);
+
+	auto &outline = entry->mesh.outline;
+	outline.reserve(segments + 1);
+	outline.push_back({ 0.0f, 0.0f });
+	for (int i = 1; i <= segments; ++i) {
+		const float t = static_cast<float>(i) / segments;
+		const float u = 1 - t;
+		const float w2 = 3 * u * u * t;
+		const float w3 = 3 * u * t * t;
+		const float w4 = t * t * t;
+		outline.push_back({
+		    w2 * p1x + w3 * p2x + w4 * p3x,
+		    w2 * p1y + w3 * p2y + w4 * p3y,
+		});
+	}
+	return entry->mesh;
+}
+
+const GeometryCache::Mesh &
+GeometryCache::arc(const float radius, const float a0, const float a1,
+    const bool fill)
+{
+	begin_key(Kind::Arc);
+	const auto qr
+	    = static_cast<int32_t>(std::lround(radius * RADIUS_QUANTUM));
+	const auto qa0 = static_cast<int32_t>(std::lround(a0 * ANGLE_QUANTUM));
+	const auto qa1 = static_cast<int32_t>(std::lround(a1 * ANGLE_QUANTUM));
+	_probe.data.insert(_probe.data.end(), { qr, qa0, qa1, fill });
+	auto [entry, found] = lookup();
+	if (found) return entry->mesh;
+
+	/* build from the quantized values so every hit is identical */
+	const float r = static_cast<float>(qr) / RADIUS_QUANTUM;
+	const float b0 = static_cast<float>(qa0) / ANGLE_QUANTUM;
+	const float b1 = static_cast<float>(qa1) / ANGLE_QUANTUM;
+	const int n = Rasterizer::segments_for(r, b1 - b0);
+	const float step = (b1 - b0) / static_cast<float>(n);
+	auto &mesh = entry->mesh;
+	mesh.outline.reserve(n + 2);
+	if (fill) mesh.outline.push_back({ 0.0f, 0.0f });
+	for (int i = 0; i <= n; ++i) {
+		const float a = b0 + step * static_cast<float>(i);
+		mesh.outline.push_back({ std::cos(a) * r, std::sin(a) * r });
+	}
+	/* a wedge is star-shaped around its centre, so a fan is valid */
+	if (fill) fan(mesh);
+	return mesh;
+}
+
+const GeometryCache::Mesh &
+GeometryCache::rounded_rect(const int16_t w, const int16_t h,
+    const uint16_t radius, const bool fill)
+{
+	begin_key(Kind::RoundedRect);
+	_probe.data.insert(_probe.data.end(), { w, h, radius, fill });
+	auto [entry, found] = lookup();
+	if (found) return entry->mesh;
+
+	constexpr float PI = std::numbers::pi_v<float>;
+	const float fw = w;
+	const float fh = h;
+	const float r = std::min<float>(radius, std::min(fw, fh) / 2.0f);
+	const int n = Rasterizer::segments_for(r, PI / 2.0f);
+	auto &mesh = entry->mesh;
+	mesh.outline.reserve(4 * (n + 1));
+	const auto corner = [&](const float cx, const float cy,
+	                        const float start) {
+		for (int i = 0; i <= n; ++i) {
+			const float a = start + PI / 2.0f * i / n;
+			mesh.outline.push_back({
+			    cx + std::cos(a) * r,
+			    cy + std::sin(a) * r,
+			});
+		}
+	};
+	corner(r, r, PI);
+	corner(fw - r, r, 1.5f * PI);
+	corner(fw - r, fh - r, 0.0f);
+	corner(r, fh - r, 0.5f * PI);
+	/* rounded rects are convex */
+	if (fill) fan(mesh);
+	return mesh;
+}
+
+const GeometryCache::Mesh &
+GeometryCache::polygon(
+    const Eigen::Matrix<int16_t, Eigen::Dynamic, 2> &points, const bool fill)
+{
+	begin_key(Kind::Polygon);
+	_probe.data.push_back(fill);
+	const Eigen::Index n = points.rows();
+	for (Eigen::Index i = 1; i < n; ++i) {
+		_probe.data.push_back(points(i, 0) - points(0, 0));
+		_probe.data.push_back(points(i, 1) - points(0, 1));
+	}
+	auto [entry, found] = lookup();
+	if (found) return entry->mesh;
+
+	auto &mesh = entry->mesh;
+	mesh.outline.reserve(n);
+	for (Eigen::Index i = 0; i < n; ++i) {
+		mesh.outline.push_back({
+		    static_cast<float>(points(i, 0) - points(0, 0)),
+		    static_cast<float>(points(i, 1) - points(0, 1)),
+		});
+	}
+	if (fill) triangulate(mesh);
+	return mesh;
+}
+
+void
+GeometryCache::next_frame()
+{
+	++_frame;
+	/* sweeping is linear in the entry count, so only do it periodically */
+	if (_frame % _max_age != 0) return;
+	std::erase_if(_entries, [this](const auto &pair) {
+		return _frame - pair.second.last_used > _max_age;
+	});
+}
+
+void
+GeometryCache::clear()
+{
+	_entries.clear();
+}
+
+GeometryCache::Stats
+GeometryCache::stats() const
+{
+	return Stats {
+		.hits = _hits,
+		.misses = _misses,
+		.entries = _entries.size(),
+	};
+}
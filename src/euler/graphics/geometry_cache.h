@@ -0,0 +1,111 @@
+/* SPDX-License-Identifier: ISC */
+
+#ifndef EULER_GRAPHICS_GEOMETRY_CACHE_H
+#define EULER_GRAPHICS_GEOMETRY_CACHE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include <Eigen/Eigen>
+
+#include "euler/graphics/rasterizer.h"
+
+namespace euler::graphics {
+
+/* Caches tessellated outlines and triangulations for the shapes a Target
+ * draws every frame. Entries are keyed by quantized, translation-free command
+ * parameters, so the same widget chrome drawn at a different position still
+ * hits. All returned geometry is relative to the shape's anchor point (first
+ * control point, arc centre or rect origin) and must be offset by the
+ * caller. Returned references stay valid until the entry is evicted by
+ * next_frame(). */
+class GeometryCache {
+public:
+	using Point = Rasterizer::Point;
+
+	struct Mesh {
+		/* outline, in drawing order */
+		std::vector<Point> outline;
+		/* triangle list indexing into outline; empty if the shape was
+		 * only requested as an outline */
+		std::vector<uint32_t> indices;
+	};
+
+	struct Stats {
+		uint64_t hits = 0;
+		uint64_t misses = 0;
+		size_t entries = 0;
+	};
+
+	/* Frames an entry may go unused before it is evicted. */
+	static constexpr uint64_t DEFAULT_MAX_AGE = 120;
+
+	explicit GeometryCache(uint64_t max_age = DEFAULT_MAX_AGE)
+	    : _max_age(std::max<uint64_t>(max_age, 1))
+	{
+	}
+
+	/* Cubic Bezier through four control points. */
+	const Mesh &curve(const Eigen::Matrix<int16_t, 4, 2> &points);
+	/* Arc around the origin; angles in radians. With fill the outline
+	 * starts at the centre and is triangulated as a fan. */
+	const Mesh &arc(float radius, float a0, float a1, bool fill);
+	/* Rounded rectangle with its top left corner at the origin. */
+	const Mesh &rounded_rect(int16_t w, int16_t h, uint16_t radius,
+	    bool fill);
+	/* Simple polygon, triangulated with earcut when fill is set. */
+	const Mesh &polygon(
+	    const Eigen::Matrix<int16_t, Eigen::Dynamic, 2> &points, bool fill);
+
+	/* Evicts entries that have not been used for max_age frames. */
+	void next_frame();
+	void clear();
+
+	[[nodiscard]] Stats stats() const;
+
+private:
+	enum class Kind : int32_t {
+		Curve,
+		Arc,
+		RoundedRect,
+		Polygon,
+	};
+
+	struct Key {
+		std::vector<int32_t> data;
+		bool
+		operator==(const Key &other) const
+		{
+			return data == other.data;
+		}
+	};
+
+	struct KeyHash {
+		size_t operator()(const Key &key) const;
+	};
+
+	struct Entry {
+		Mesh mesh;
+		uint64_t last_used = 0;
+	};
+
+	/* starts building _probe for a lookup of the given kind */
+	void begin_key(Kind kind);
+	/* returns the entry for _probe, and whether it already existed */
+	std::pair<Entry *, bool> lookup();
+	static void triangulate(Mesh &mesh);
+	static void fan(Mesh &mesh);
+
+	std::unordered_map<Key, Entry, KeyHash> _entries;
+	Key _probe;
+	uint64_t _frame = 0;
+	uint64_t _max_age;
+	uint64_t _hits = 0;
+	uint64_t _misses = 0;
+};
+
+} /* namespace euler::graphics */
+
+#endif /* EULER_GRAPHICS_GEOMETRY_CACHE_H */
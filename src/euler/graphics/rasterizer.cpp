@@ -0,0 +1,567 @@
+/* SPDX-License-Identifier: ISC */
+
+#include "euler/graphics/rasterizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+
+#include "euler/util/pixel.h"
+
+using euler::graphics::Rasterizer;
+namespace pixel = euler::util::pixel;
+
+static constexpr float TAU = 2.0f * std::numbers::pi_v<float>;
+
+static uint32_t
+blend_one(const uint32_t dst, const uint32_t src)
+{
+	const uint32_t inv_a = 0xFF - (src >> 24);
+	uint32_t out = 0;
+	for (int shift = 0; shift < 32; shift += 8) {
+		const uint32_t d = dst >> shift & 0xFF;
+		const uint32_t s = src >> shift & 0xFF;
+		const uint32_t c = s + pixel::div255(d * inv_a);
+		out |= std::min(0xFFu, c) << shift;
+	}
+	return out;
+}
+
+void
+Rasterizer::resize(const int width, const int height)
+{
+	_width = std::max(0, width);
+	_height = std::max(0, height);
+	_pixels.assign(static_cast<size_t>(_width) * _height, 0);
+	_dirty = {};
+	reset_clip();
+}
+
+void
+Rasterizer::clear(const util::Color color)
+{
+	const uint32_t value = pixel::premultiply(color);
+	if (value != 0) {
+		pixel::fill(_pixels.data(), _pixels.size(), value);
+		_dirty = { 0, 0, _width, _height };
+		return;
+	}
+	/* only the dirty rectangle can hold anything but transparency */
+	for (int row = _dirty.y0; row < _dirty.y1; ++row) {
+		pixel::fill(_pixels.data() + static_cast<size_t>(row) * _width
+			+ _dirty.x0,
+		    _dirty.x1 - _dirty.x0, 0);
+	}
+	_dirty = {};
+}
+
+void
+Rasterizer::set_clip(const int x, const int y, const int w, const int h)
+{
+	_clip.x0 = std::clamp(x, 0, _width);
+	_clip.y0 = std::clamp(y, 0, _height);
+	_clip.x1 = std::clamp(x + w, _clip.x0, _width);
+	_clip.y1 = std::clamp(y + h, _clip.y0, _height);
+}
+
+void
+Rasterizer::reset_clip()
+{
+	_clip = { 0, 0, _width, _height };
+}
+
+void
+Rasterizer::touch(const int x0, const int y0, const int x1, const int y1)
+{
+	if (is_blank()) {
+		_dirty = { x0, y0, x1, y1 };
+		return;
+	}
+	_dirty.x0 = std::min(_dirty.x0, x0);
+	_dirty.y0 = std::min(_dirty.y0, y0);
+	_dirty.x1 = std::max(_dirty.x1, x1);
+	_dirty.y1 = std::max(_dirty.y1, y1);
+}
+
+void
+Rasterizer::span(const int y, int x0, int x1, const uint32_t value)
+{
+	if (y < _clip.y0 || y >= _clip.y1) return;
+	x0 = std::max(x0, _clip.x0);
+	x1 = std::min(x1, _clip.x1);
+	if (x0 >= x1) return;
+	touch(x0, y, x1, y + 1);
+	pixel::blend(_pixels.data() + static_cast<size_t>(y) * _width + x0,
+	    x1 - x0, value);
+}
+
+void
+Rasterizer::fill_rect(const int x, const int y, const int w, const int h,
+    const util::Color color)
+{
+	const uint32_t value = pixel::premultiply(color);
+	if (value >> 24 == 0) return;
+	const int y0 = std::max(y, _clip.y0);
+	const int y1 = std::min(y + h, _clip.y1);
+	for (int row = y0; row < y1; ++row) span(row, x, x + w, value);
+}
+
+void
+Rasterizer::stroke_rect(const int x, const int y, const int w, const int h,
+    int thickness, const util::Color color)
+{
+	thickness = std::max(1, std::min({ thickness, w / 2, h / 2 }));
+	if (thickness * 2 >= w || thickness * 2 >= h) {
+		fill_rect(x, y, w, h, color);
+		return;
+	}
+	fill_rect(x, y, w, thickness, color);
+	fill_rect(x, y + h - thickness, w, thickness, color);
+	fill_rect(x, y + thickness, thickness, h - 2 * thickness, color);
+	fill_rect(x + w - thickness, y + thickness, thickness,
+	    h - 2 * thickness, color);
+}
+
+void
+Rasterizer::fill_rounded_rect(const int x, const int y, const int w,
+    const int h, int radius, const util::Color color)
+{
+	radius = std::clamp(radius, 0, std::min(w, h) / 2);
+	if (radius == 0) {
+		fill_rect(x, y, w, h, color);
+		return;
+	}
+	const uint32_t value = pixel::premultiply(color);
+	if (value >> 24 == 0) return;
+	const float r = static_cast<float>(radius);
+	const int y0 = std::max(y, _clip.y0);
+	const int y1 = std::min(y + h, _clip.y1);
+	for (int row = y0; row < y1; ++row) {
+		/* distance into the corner band, measured from pixel centres */
+		float dy = 0.0f;
+		if (row < y + radius)
+			dy = static_cast<float>(y + radius - row) - 0.5f;
+		else if (row >= y + h - radius)
+			dy = static_cast<float>(row - (y + h - radius)) + 0.5f;
+		const float dx = r - std::sqrt(std::max(0.0f, r * r - dy * dy));
+		const int inset = static_cast<int>(std::lround(dx));
+		span(row, x + inset, x + w - inset, value);
+	}
+}
+
+void
+Rasterizer::stroke_rounded_rect(const int x, const int y, const int w,
+    const int h, int radius, const int thickness, const util::Color color)
+{
+	radius = std::clamp(radius, 0, std::min(w, h) / 2);
+	if (radius == 0) {
+		stroke_rect(x, y, w, h, thickness, color);
+		return;
+	}
+	const float half = static_cast<float>(thickness) / 2.0f;
+	const float fx0 = static_cast<float>(x) + half;
+	const float fy0 = static_cast<float>(y) + half;
+	const float fx1 = static_cast<float>(x + w) - half;
+	const float fy1 = static_cast<float>(y + h) - half;
+	const float r = std::max(0.0f, static_cast<float>(radius) - half);
+	constexpr float PI = std::numbers::pi_v<float>;
+	_path.clear();
+	arc_points(fx0 + r, fy0 + r, r, PI, 1.5f * PI, _path);
+	arc_points(fx1 - r, fy0 + r, r, 1.5f * PI, TAU, _path);
+	arc_points(fx1 - r, fy1 - r, r, 0.0f, 0.5f * PI, _path);
+	arc_points(fx0 + r, fy1 - r, r, 0.5f * PI, PI, _path);
+	polyline(_path, thickness, true, color);
+}
+
+void
+Rasterizer::thin_line(int x0, int y0, const int x1, const int y1,
+    const uint32_t value, const bool first, const bool last)
+{
+	const int dx = std::abs(x1 - x0);
+	const int dy = -std::abs(y1 - y0);
+	const int sx = x0 < x1 ? 1 : -1;
+	const int sy = y0 < y1 ? 1 : -1;
+	int err = dx + dy;
+	bool start = true;
+	for (;;) {
+		const bool end = x0 == x1 && y0 == y1;
+		const bool skip = (start && !first) || (end && !last);
+		if (!skip && x0 >= _clip.x0 && x0 < _clip.x1 && y0 >= _clip.y0
+		    && y0 < _clip.y1) {
+			uint32_t &dst
+			    = _pixels[static_cast<size_t>(y0) * _width + x0];
+			dst = blend_one(dst, value);
+			touch(x0, y0, x0 + 1, y0 + 1);
+		}
+		if (end) break;
+		start = false;
+		const int e2 = 2 * err;
+		if (e2 >= dy) {
+			err += dy;
+			x0 += sx;
+		}
+		if (e2 <= dx) {
+			err += dx;
+			y0 += sy;
+		}
+	}
+}
+
+void
+Rasterizer::line(const float x0, const float y0, const float x1,
+    const float y1, const int thickness, const util::Color color)
+{
+	const uint32_t value = pixel::premultiply(color);
+	if (value >> 24 == 0) return;
+	if (thickness <= 1) {
+		thin_line(static_cast<int>(std::lround(x0)),
+		    static_cast<int>(std::lround(y0)),
+		    static_cast<int>(std::lround(x1)),
+		    static_cast<int>(std::lround(y1)), value);
+		return;
+	}
+	const float dx = x1 - x0;
+	const float dy = y1 - y0;
+	const float len = std::hypot(dx, dy);
+	if (len == 0.0f) return;
+	const float half = static_cast<float>(thickness) / 2.0f;
+	const float nx = -dy / len * half;
+	const float ny = dx / len * half;
+	_quad.assign({
+	    { x0 + nx, y0 + ny },
+	    { x1 + nx, y1 + ny },
+	    { x1 - nx, y1 - ny },
+	    { x0 - nx, y0 - ny },
+	});
+	fill_polygon(_quad, color);
+}
+
+void
+Rasterizer::polyline(const std::span<const Point> points, const int thickness,
+    const bool closed, const util::Color color, const Point offset)
+{
+	const uint32_t value = pixel::premultiply(color);
+	if (value >> 24 == 0 || points.size() < 2) return;
+	const size_t n = points.size();
+	const size_t segments = closed ? n : n - 1;
+	if (thickness <= 1) {
+		/* every segment but the first starts on a pixel the previous
+		 * one drew, and a closed outline ends on the very first one */
+		for (size_t i = 0; i < segments; ++i) {
+			const Point &a = points[i];
+			const Point &b = points[(i + 1) % n];
+			thin_line(static_cast<int>(std::lround(a.x + offset.x)),
+			    static_cast<int>(std::lround(a.y + offset.y)),
+			    static_cast<int>(std::lround(b.x + offset.x)),
+			    static_cast<int>(std::lround(b.y + offset.y)),
+			    value, i == 0, !closed || i + 1 < segments);
+		}
+		return;
+	}
+	const float half = static_cast<float>(thickness) / 2.0f;
+	_strokes.clear();
+	for (size_t i = 0; i < segments; ++i) {
+		const Point a = { points[i].x + offset.x,
+			points[i].y + offset.y };
+		const Point &next = points[(i + 1) % n];
+		const Point b = { next.x + offset.x, next.y + offset.y };
+		const float dx = b.x - a.x;
+		const float dy = b.y - a.y;
+		const float len = std::hypot(dx, dy);
+		if (len == 0.0f) continue;
+		const float nx = -dy / len * half;
+		const float ny = dx / len * half;
+		Stroke stroke = {
+			.corners = {
+			    { a.x + nx, a.y + ny },
+			    { b.x + nx, b.y + ny },
+			    { b.x - nx, b.y - ny },
+			    { a.x - nx, a.y - ny },
+			},
+			.y0 = 0,
+			.y1 = 0,
+		};
+		float min_y = stroke.corners[0].y;
+		float max_y = min_y;
+		for (const auto &p : stroke.corners) {
+			min_y = std::min(min_y, p.y);
+			max_y = std::max(max_y, p.y);
+		}
+		stroke.y0 = std::max(_clip.y0,
+		    static_cast<int>(std::floor(min_y)));
+		stroke.y1 = std::min(_clip.y1,
+		    static_cast<int>(std::ceil(max_y)));
+		if (stroke.y0 < stroke.y1) _strokes.push_back(stroke);
+	}
+	fill_strokes(value);
+}
+
+/* Fills the union of the quads in _strokes. Each row merges the spans of the
+ * quads crossing it before blending, so where segments overlap at a joint
+ * the pixels are still blended once. */
+void
+Rasterizer::fill_strokes(const uint32_t value)
+{
+	if (_strokes.empty()) return;
+	std::sort(_strokes.begin(), _strokes.end(),
+	    [](const Stroke &a, const Stroke &b) { return a.y0 < b.y0; });
+	int end = 0;
+	for (const auto &stroke : _strokes) end = std::max(end, stroke.y1);
+	_active.clear();
+	size_t next = 0;
+	for (int row = _strokes.front().y0; row < end; ++row) {
+		while (next < _strokes.size() && _strokes[next].y0 <= row)
+			_active.push_back(next++);
+		std::erase_if(_active,
+		    [&](const size_t i) { return _strokes[i].y1 <= row; });
+		const float sy = static_cast<float>(row) + 0.5f;
+		_runs.clear();
+		for (const size_t index : _active) {
+			const auto &c = _strokes[index].corners;
+			float lo = 0.0f;
+			float hi = 0.0f;
+			int crossings = 0;
+			for (size_t i = 0, j = 3; i < 4; j = i++) {
+				if ((c[i].y < sy) == (c[j].y < sy)) continue;
+				const Point &a = c[i];
+				const Point &b = c[j];
+				const float t = (sy - a.y) / (b.y - a.y);
+				const float x = a.x + t * (b.x - a.x);
+				lo = crossings == 0 ? x : std::min(lo, x);
+				hi = crossings == 0 ? x : std::max(hi, x);
+				++crossings;
+			}
+			if (crossings < 2) continue;
+			const int x0 = static_cast<int>(std::ceil(lo - 0.5f));
+			const int x1 = static_cast<int>(std::ceil(hi - 0.5f));
+			if (x0 < x1) _runs.push_back({ x0, x1 });
+		}
+		std::sort(_runs.begin(), _runs.end(),
+		    [](const Run &a, const Run &b) { return a.x0 < b.x0; });
+		for (size_t i = 0; i < _runs.size();) {
+			Run run = _runs[i++];
+			while (i < _runs.size() && _runs[i].x0 <= run.x1)
+				run.x1 = std::max(run.x1, _runs[i++].x1);
+			span(row, run.x0, run.x1, value);
+		}
+	}
+}
+
+/* Even-odd scanline fill, sampling each row at its pixel centre. */
+void
+Rasterizer::fill_polygon(const std::span<const Point> points,
+    const util::Color color, const Point offset)
+{
+	const uint32_t value = pixel::premultiply(color);
+	if (value >> 24 == 0 || points.size() < 3) return;
+	float min_y = points[0].y;
+	float max_y = points[0].y;
+	for (const auto &p : points) {
+		min_y = std::min(min_y, p.y);
+		max_y = std::max(max_y, p.y);
+	}
+	min_y += offset.y;
+	max_y += offset.y;
+	const int y0 = std::max(_clip.y0, static_cast<int>(std::floor(min_y)));
+	const int y1 = std::min(_clip.y1, static_cast<int>(std::ceil(max_y)));
+	const size_t n = points.size();
+	for (int row = y0; row < y1; ++row) {
+		/* sample position in the points' own space */
+		const float sy = static_cast<float>(row) + 0.5f - offset.y;
+		_nodes.clear();
+		for (size_t i = 0, j = n - 1; i < n; j = i++) {
+			const Point &a = points[i];
+			const Point &b = points[j];
+			if ((a.y < sy) == (b.y < sy)) continue;
+			const float t = (sy - a.y) / (b.y - a.y);
+			_nodes.push_back(a.x + t * (b.x - a.x) + offset.x);
+		}
+		std::sort(_nodes.begin(), _nodes.end());
+		for (size_t i = 0; i + 1 < _nodes.size(); i += 2) {
+			const int x0
+			    = static_cast<int>(std::ceil(_nodes[i] - 0.5f));
+			const int x1
+			    = static_cast<int>(std::ceil(_nodes[i + 1] - 0.5f));
+			span(row, x0, x1, value);
+		}
+	}
+}
+
+void
+Rasterizer::ellipse_spans(const float cx, const float cy, const float rx,
+    const float ry, const uint32_t value)
+{
+	if (rx <= 0.0f || ry <= 0.0f) return;
+	const int y0
+	    = std::max(_clip.y0, static_cast<int>(std::floor(cy - ry)));
+	const int y1
+	    = std::min(_clip.y1, static_cast<int>(std::ceil(cy + ry)));
+	for (int row = y0; row < y1; ++row) {
+		const float dy = (static_cast<float>(row) + 0.5f - cy) / ry;
+		const float t = 1.0f - dy * dy;
+		if (t <= 0.0f) continue;
+		const float hw = rx * std::sqrt(t);
+		span(row, static_cast<int>(std::ceil(cx - hw - 0.5f)),
+		    static_cast<int>(std::ceil(cx + hw - 0.5f)), value);
+	}
+}
+
+void
+Rasterizer::fill_ellipse(const float cx, const float cy, const float rx,
+    const float ry, const util::Color color)
+{
+	const uint32_t value = pixel::premultiply(color);
+	if (value >> 24 == 0) return;
+	ellipse_spans(cx, cy, rx, ry, value);
+}
+
+void
+Rasterizer::stroke_ellipse(const float cx, const float cy, const float rx,
+    const float ry, const int thickness, const util::Color color)
+{
+	const uint32_t value = pixel::premultiply(color);
+	if (value >> 24 == 0 || rx <= 0.0f || ry <= 0.0f) return;
+	const float th = static_cast<float>(std::max(1, thickness));
+	const float irx = rx - th;
+	const float iry = ry - th;
+	if (irx <= 0.0f || iry <= 0.0f) {
+		ellipse_spans(cx, cy, rx, ry, value);
+		return;
+	}
+	/* fill the ring row by row so no pixel is blended twice */
+	const int y0
+	    = std::max(_clip.y0, static_cast<int>(std::floor(cy - ry)));
+	const int y1
+	    = std::min(_clip.y1, static_cast<int>(std::ceil(cy + ry)));
+	for (int row = y0; row < y1; ++row) {
+		const float fy = static_cast<float>(row) + 0.5f - cy;
+		const float to = 1.0f - (fy / ry) * (fy / ry);
+		if (to <= 0.0f) continue;
+		const float ow = rx * std::sqrt(to);
+		const int ol = static_cast<int>(std::ceil(cx - ow - 0.5f));
+		const int orr = static_cast<int>(std::ceil(cx + ow - 0.5f));
+		const float ti = 1.0f - (fy / iry) * (fy / iry);
+		if (ti <= 0.0f) {
+			span(row, ol, orr, value);
+			continue;
+		}
+		const float iw = irx * std::sqrt(ti);
+		const int il = static_cast<int>(std::ceil(cx - iw - 0.5f));
+		const int ir = static_cast<int>(std::ceil(cx + iw - 0.5f));
+		span(row, ol, il, value);
+		span(row, ir, orr, value);
+	}
+}
+
+int
+Rasterizer::segments_for(const float radius, const float sweep)
+{
+	/* keep the chord error under roughly a quarter pixel */
+	const float err = std::min(1.0f, 0.25f / std::max(radius, 1.0f));
+	const float full = std::ceil(TAU / std::acos(1.0f - err));
+	const int n = static_cast<int>(std::ceil(full * std::abs(sweep) / TAU));
+	return std::clamp(n, 2, 256);
+}
+
+void
+Rasterizer::arc_points(const float cx, const float cy, const float radius,
+    const float a0, const float a1, std::vector<Point> &out) const
+{
+	const int n = segments_for(radius, a1 - a0);
+	const float step = (a1 - a0) / static_cast<float>(n);
+	for (int i = 0; i <= n; ++i) {
+		const float a = a0 + step * static_cast<float>(i);
+		out.push_back({ cx + std::cos(a) * radius,
+		    cy + std::sin(a) * radius });
+	}
+}
+
+void
+Rasterizer::fill_arc(const float cx, const float cy, const float radius,
+    const float a0, const float a1, const util::Color color)
+{
+	if (std::abs(a1 - a0) >= TAU) {
+		fill_ellipse(cx, cy, radius, radius, color);
+		return;
+	}
+	_path.clear();
+	_path.push_back({ cx, cy });
+	arc_points(cx, cy, radius, a0, a1, _path);
+	fill_polygon(_path, color);
+}
+
+void
+Rasterizer::stroke_arc(const float cx, const float cy, const float radius,
+    const float a0, const float a1, const int thickness,
+    const util::Color color)
+{
+	if (std::abs(a1 - a0) >= TAU) {
+		stroke_ellipse(cx, cy, radius, radius, thickness, color);
+		return;
+	}
+	_path.clear();
+	arc_points(cx, cy, radius, a0, a1, _path);
+	polyline(_path, thickness, false, color);
+}
+
+void
+Rasterizer::blit(const uint32_t *src, const int src_w, const int src_h,
+    const int x, const int y, const int w, const int h,
+    const std::optional<util::Color> tint)
+{
+	blit(src, src_w, src_h, Rect { 0, 0, src_w, src_h }, x, y, w, h, tint);
+}
+
+void
+Rasterizer::blit(const uint32_t *src, const int src_w, const int src_h,
+    Rect source, const int x, const int y, const int w, const int h,
+    const std::optional<util::Color> tint)
+{
+	if (src == nullptr || w <= 0 || h <= 0) return;
+	const int sx0 = std::clamp(source.x, 0, std::max(0, src_w));
+	const int sy0 = std::clamp(source.y, 0, std::max(0, src_h));
+	source.w = std::clamp(source.x + source.w, sx0, std::max(0, src_w))
+	    - sx0;
+	source.h = std::clamp(source.y + source.h, sy0, std::max(0, src_h))
+	    - sy0;
+	source.x = sx0;
+	source.y = sy0;
+	if (source.w <= 0 || source.h <= 0) return;
+	const int x0 = std::max(x, _clip.x0);
+	const int x1 = std::min(x + w, _clip.x1);
+	const int y0 = std::max(y, _clip.y0);
+	const int y1 = std::min(y + h, _clip.y1);
+	if (x0 >= x1 || y0 >= y1) return;
+	touch(x0, y0, x1, y1);
+	const uint32_t t = tint.has_value() ? pixel::pack(*tint) : 0xFFFFFFFF;
+	for (int row = y0; row < y1; ++row) {
+		const int sy = source.y + (row - y) * source.h / h;
+		const uint32_t *src_row
+		    = src + static_cast<size_t>(sy) * src_w + source.x;
+		uint32_t *dst
+		    = _pixels.data() + static_cast<size_t>(row) * _width;
+		for (int col = x0; col < x1; ++col) {
+			const uint32_t s = src_row[(col - x) * source.w / w];
+			uint32_t a = pixel::div255((s >> 24) * (t >> 24));
+			if (a == 0) continue;
+			uint32_t value = a << 24;
+			for (int shift = 0; shift < 24; shift += 8) {
+				const uint32_t c = pixel::div255(
+				    (s >> shift & 0xFF) * (t >> shift & 0xFF));
+				value |= pixel::div255(c * a) << shift;
+			}
+			dst[col] = blend_one(dst[col], value);
+		}
+	}
+}
+
+const uint32_t *
+Rasterizer::resolve()
+{
+	for (int row = _dirty.y0; row < _dirty.y1; ++row) {
+		pixel::unpremultiply(_pixels.data()
+			+ static_cast<size_t>(row) * _width + _dirty.x0,
+		    _dirty.x1 - _dirty.x0);
+	}
+	return _pixels.data();
+}
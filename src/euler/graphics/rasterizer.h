@@ -0,0 +1,155 @@
+/* SPDX-License-Identifier: ISC */
+
+#ifndef EULER_GRAPHICS_RASTERIZER_H
+#define EULER_GRAPHICS_RASTERIZER_H
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include "euler/util/color.h"
+
+namespace euler::graphics {
+
+/* CPU rasterizer drawing into a single premultiplied 0xAABBGGRR canvas, so a
+ * whole frame of primitives can be handed to the runtime as one texture.
+ * Coordinates are in pixels with the origin at the top left of the canvas;
+ * everything is clipped against the current clip rectangle. */
+class Rasterizer {
+public:
+	struct Point {
+		float x;
+		float y;
+	};
+
+	struct Rect {
+		int x;
+		int y;
+		int w;
+		int h;
+	};
+
+	Rasterizer() = default;
+
+	void resize(int width, int height);
+	void clear(util::Color color = util::Color(0, 0, 0, 0));
+
+	void set_clip(int x, int y, int w, int h);
+	void reset_clip();
+
+	void fill_rect(int x, int y, int w, int h, util::Color color);
+	void stroke_rect(int x, int y, int w, int h, int thickness,
+	    util::Color color);
+	void fill_rounded_rect(int x, int y, int w, int h, int radius,
+	    util::Color color);
+	void stroke_rounded_rect(int x, int y, int w, int h, int radius,
+	    int thickness, util::Color color);
+	void line(float x0, float y0, float x1, float y1, int thickness,
+	    util::Color color);
+	/* offset is added to every point, so cached relative geometry can be
+	 * drawn without copying it */
+	void polyline(std::span<const Point> points, int thickness,
+	    bool closed, util::Color color, Point offset = { 0.0f, 0.0f });
+	void fill_polygon(std::span<const Point> points, util::Color color,
+	    Point offset = { 0.0f, 0.0f });
+	void fill_ellipse(float cx, float cy, float rx, float ry,
+	    util::Color color);
+	void stroke_ellipse(float cx, float cy, float rx, float ry,
+	    int thickness, util::Color color);
+	/* Angles are in radians, sweeping from a0 to a1. */
+	void fill_arc(float cx, float cy, float radius, float a0, float a1,
+	    util::Color color);
+	void stroke_arc(float cx, float cy, float radius, float a0, float a1,
+	    int thickness, util::Color color);
+	/* Nearest-neighbour scaled copy of a straight-alpha source image,
+	 * optionally multiplied by tint. */
+	void blit(const uint32_t *src, int src_w, int src_h, int x, int y,
+	    int w, int h, std::optional<util::Color> tint = std::nullopt);
+	/* As above, reading only the source rectangle of the image; used to
+	 * draw single glyphs off a font sheet. */
+	void blit(const uint32_t *src, int src_w, int src_h, Rect source, int x,
+	    int y, int w, int h, std::optional<util::Color> tint = std::nullopt);
+
+	/* Converts the pixels drawn since the last clear to straight alpha for
+	 * upload. The canvas must be cleared before drawing into it again. */
+	const uint32_t *resolve();
+
+	/* true if nothing has been drawn since the last clear */
+	[[nodiscard]] bool
+	is_blank() const
+	{
+		return _dirty.x0 >= _dirty.x1;
+	}
+
+	/* Number of segments that keeps the chord error of an arc with the
+	 * given radius and sweep (radians) under a quarter pixel. */
+	static int segments_for(float radius, float sweep);
+
+	[[nodiscard]] int
+	width() const
+	{
+		return _width;
+	}
+	[[nodiscard]] int
+	height() const
+	{
+		return _height;
+	}
+	[[nodiscard]] const uint32_t *
+	data() const
+	{
+		return _pixels.data();
+	}
+
+private:
+	struct Clip {
+		int x0 = 0;
+		int y0 = 0;
+		int x1 = 0;
+		int y1 = 0;
+	};
+
+	/* one segment of a thick polyline, with the rows it covers */
+	struct Stroke {
+		Point corners[4];
+		int y0;
+		int y1;
+	};
+
+	struct Run {
+		int x0;
+		int x1;
+	};
+
+	void touch(int x0, int y0, int x1, int y1);
+	void span(int y, int x0, int x1, uint32_t value);
+	/* first and last say whether the end pixels are drawn, so polylines
+	 * do not blend their shared vertices twice */
+	void thin_line(int x0, int y0, int x1, int y1, uint32_t value,
+	    bool first = true, bool last = true);
+	void fill_strokes(uint32_t value);
+	void ellipse_spans(float cx, float cy, float rx, float ry,
+	    uint32_t value);
+	void arc_points(float cx, float cy, float radius, float a0, float a1,
+	    std::vector<Point> &out) const;
+
+	std::vector<uint32_t> _pixels;
+	/* scratch storage reused across calls to avoid per-shape allocation */
+	std::vector<float> _nodes;
+	std::vector<Point> _path;
+	std::vector<Point> _quad;
+	std::vector<Stroke> _strokes;
+	std::vector<size_t> _active;
+	std::vector<Run> _runs;
+	int _width = 0;
+	int _height = 0;
+	Clip _clip;
+	/* bounds of everything drawn since the last clear; the rest of the
+	 * canvas is known to be transparent */
+	Clip _dirty;
+};
+
+} /* namespace euler::graphics */
+
+#endif /* EULER_GRAPHICS_RASTERIZER_H */
@@ -0,0 +1,103 @@
+/* SPDX-License-Identifier: ISC */
+
+#include "euler/graphics/skyline_packer.h"
+
+#include <algorithm>
+#include <limits>
+
+using euler::graphics::SkylinePacker;
+
+SkylinePacker::SkylinePacker(const int width, const int height)
+{
+	reset(width, height);
+}
+
+void
+SkylinePacker::reset(const int width, const int height)
+{
+	_width = std::max(0, width);
+	_height = std::max(0, height);
+	_used = 0;
+	_skyline.clear();
+	_skyline.push_back({ 0, 0, _width });
+}
+
+int
+SkylinePacker::fit(const size_t i, const int w, const int h) const
+{
+	const int x = _skyline[i].x;
+	if (x + w > _width) return -1;
+	int y = 0;
+	int remaining = w;
+	for (size_t j = i; remaining > 0; ++j) {
+		if (j == _skyline.size()) return -1;
+		y = std::max(y, _skyline[j].y);
+		if (y + h > _height) return -1;
+		remaining -= _skyline[j].w;
+	}
+	return y;
+}
+
+void
+SkylinePacker::place(const size_t i, const Rect &rect)
+{
+	const Node node { rect.x, rect.y + rect.h, rect.w };
+	_skyline.insert(_skyline.begin() + static_cast<ptrdiff_t>(i), node);
+	/* trim or drop the nodes the new one now shadows */
+	const int right = node.x + node.w;
+	size_t j = i + 1;
+	while (j < _skyline.size() && _skyline[j].x < right) {
+		const int overlap = right - _skyline[j].x;
+		if (overlap < _skyline[j].w) {
+			_skyline[j].x += overlap;
+			_skyline[j].w -= overlap;
+			break;
+		}
+		_skyline.erase(_skyline.begin() + static_cast<ptrdiff_t>(j));
+	}
+	/* merge neighbours at the same height */
+	for (size_t k = 0; k + 1 < _skyline.size();) {
+		if (_skyline[k].y == _skyline[k + 1].y) {
+			_skyline[k].w += _skyline[k + 1].w;
+			_skyline.erase(
+			    _skyline.begin() + static_cast<ptrdiff_t>(k + 1));
+		} else {
+			++k;
+		}
+	}
+	_used += static_cast<int64_t>(rect.w) * rect.h;
+}
+
+std::optional<SkylinePacker::Rect>
+SkylinePacker::insert(const int w, const int h)
+{
+	if (w <= 0 || h <= 0) return std::nullopt;
+	/* lowest top edge wins, ties go to the narrowest supporting node to
+	 * keep wide gaps open for wide rects */
+	int best_top = std::numeric_limits<int>::max();
+	int best_width = std::numeric_limits<int>::max();
+	size_t best = _skyline.size();
+	for (size_t i = 0; i < _skyline.size(); ++i) {
+		const int y = fit(i, w, h);
+		if (y < 0) continue;
+		const int top = y + h;
+		if (top < best_top
+		    || (top == best_top && _skyline[i].w < best_width)) {
+			best_top = top;
+			best_width = _skyline[i].w;
+			best = i;
+		}
+	}
+	if (best == _skyline.size()) return std::nullopt;
+	const Rect rect { _skyline[best].x, best_top - h, w, h };
+	place(best, rect);
+	return rect;
+}
+
+float
+SkylinePacker::occupancy() const
+{
+	const auto area = static_cast<int64_t>(_width) * _height;
+	if (area == 0) return 0.0f;
+	return static_cast<float>(_used) / static_cast<float>(area);
+}
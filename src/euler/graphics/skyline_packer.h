@@ -0,0 +1,67 @@
+/* SPDX-License-Identifier: ISC */
+
+#ifndef EULER_GRAPHICS_SKYLINE_PACKER_H
+#define EULER_GRAPHICS_SKYLINE_PACKER_H
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace euler::graphics {
+
+/* Bottom-left skyline rectangle packer for a single page. Placement is
+ * deterministic, so inserting the same sequence of sizes into a page of the
+ * same size always produces the same rects; Atlas relies on this to restore
+ * a serialized layout. A failed insert leaves the packer unchanged. */
+class SkylinePacker {
+public:
+	struct Rect {
+		int x = 0;
+		int y = 0;
+		int w = 0;
+		int h = 0;
+		bool
+		operator==(const Rect &) const
+		    = default;
+	};
+
+	SkylinePacker() = default;
+	SkylinePacker(int width, int height);
+
+	void reset(int width, int height);
+	std::optional<Rect> insert(int w, int h);
+
+	[[nodiscard]] int
+	width() const
+	{
+		return _width;
+	}
+	[[nodiscard]] int
+	height() const
+	{
+		return _height;
+	}
+	/* fraction of the page covered by inserted rects */
+	[[nodiscard]] float occupancy() const;
+
+private:
+	struct Node {
+		int x;
+		int y;
+		int w;
+	};
+
+	/* top of a w wide rect resting on the skyline from node i, or -1 if
+	 * it does not fit there */
+	[[nodiscard]] int fit(size_t i, int w, int h) const;
+	void place(size_t i, const Rect &rect);
+
+	std::vector<Node> _skyline;
+	int64_t _used = 0;
+	int _width = 0;
+	int _height = 0;
+};
+
+} /* namespace euler::graphics */
+
+#endif /* EULER_GRAPHICS_SKYLINE_PACKER_H */
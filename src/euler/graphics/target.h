@@ -111,6 +111,24 @@ public:
 	virtual void text(const TextCommand &cmd) = 0;
 	virtual void image(const ImageCommand &cmd) = 0;
 
+	/* Bracket a frame's worth of commands. Targets that batch output (for
+	 * example into a single uploaded texture) flush in end_frame. */
+	virtual void
+	begin_frame()
+	{
+	}
+	virtual void
+	end_frame()
+	{
+	}
+	/* Re-emits the output of the last completed frame. Returns false if
+	 * the target has nothing cached and the frame must be redrawn. */
+	virtual bool
+	repeat_frame()
+	{
+		return false;
+	}
+
 	virtual void render(mrb_value target,
 		std::function<void(const util::Reference<UserInterface> &)> ui) = 0;
 
@@ -1,6 +1,8 @@
 /* SPDX-License-Identifier: ISC */
 
 #include "euler/gui/context.h"
+
+#include <cstring>
 // #include "../../../cmake-build-debug/_deps/nuklear-src/nuklear.h"
 
 #include "euler/gui/internal.h"
@@ -8,6 +10,7 @@
 #include "euler/gui/widget.h"
 #include "euler/util/ext.h"
 #include "euler/util/logger.h"
+#include "euler/util/profiler.h"
 #include "euler/util/window.h"
 
 using euler::gui::Context;
@@ -96,7 +99,22 @@ void
 Context::render()
 {
 	using Renderer = graphics::Target;
+	util::Profiler::Zone zone("gui.render");
+	/* Nuklear's command buffer is a flat, deterministic encoding of the
+	 * frame; if it is byte-identical to the last one the target can replay
+	 * its previous output instead. */
+	const auto *memory = static_cast<const char *>(
+	    nk_buffer_memory_const(&_context.memory));
+	const size_t size = _context.memory.allocated;
+	if (size == _last_commands.size()
+	    && std::memcmp(memory, _last_commands.data(), size) == 0
+	    && _renderer->repeat_frame()) {
+		nk_clear(&_context);
+		return;
+	}
+	_last_commands.assign(memory, memory + size);
 	const nk_command *cmd = nullptr;
+	_renderer->begin_frame();
 	nk_foreach (cmd, &_context) {
 		switch (cmd->type) {
 		case NK_COMMAND_NOP: break;
@@ -305,6 +323,8 @@ Context::render()
 			const Renderer::PolygonCommand polygon_filled = {
 				.points = std::move(points),
 				.color = util::Color::from_nk(casted->color),
+				.line_thickness = 1,
+				.fill = true,
 			};
 			_renderer->polygon(polygon_filled);
 		} break;
@@ -359,6 +379,7 @@ Context::render()
 			break;
 		}
 	}
+	_renderer->end_frame();
 	nk_clear(&_context);
 }
 
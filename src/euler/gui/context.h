@@ -71,6 +71,9 @@ private:
 	Widget::ID _widget_counter = 0;
 	nk_context _context = {};
 	util::Reference<graphics::Target> _renderer;
+	/* copy of the previous frame's command buffer, used to skip
+	 * re-dispatching an unchanged UI */
+	std::vector<char> _last_commands;
 
 	// nk_font_atlas _atlas = {};
 	// util::Color _clear_color = util::COLOR_BLACK;
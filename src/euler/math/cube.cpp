@@ -0,0 +1,959 @@
+/* SPDX-License-Identifier: ISC */
+
+#include "euler/math/cube.h"
+
+#include <sstream>
+
+#include <mruby/array.h>
+#include <mruby/range.h>
+
+#include "euler/math/ufunc.h"
+#include "euler/util/math.h"
+#include "euler/util/state.h"
+
+using euler::math::Cube;
+using euler::math::CubeBuffer;
+using euler::math::CubeLayout;
+using euler::math::CubeView;
+using euler::math::DenseMatrix;
+using euler::math::Matrix;
+using euler::math::size_type;
+using Type = Matrix::Type;
+
+CubeBuffer::CubeBuffer(const size_type size, const Type type)
+{
+	Matrix::visit_type(type, [&]<typename T>(T) {
+		_storage = CubeElements<T>(CubeElements<T>::Zero(size));
+	});
+}
+
+CubeBuffer::CubeBuffer(Storage storage)
+    : _storage(std::move(storage))
+{
+}
+
+size_type
+CubeBuffer::size() const
+{
+	return std::visit([](const auto &e) { return e.size(); }, _storage);
+}
+
+Cube::Cube()
+    : _buffer(util::make_reference<CubeBuffer>(0, Type::Double))
+{
+}
+
+Cube::Cube(const size_type rows, const size_type columns,
+    const size_type slices, const Type type)
+    : _buffer(util::make_reference<CubeBuffer>(rows * columns * slices, type))
+    , _rows(rows)
+    , _columns(columns)
+    , _slices(slices)
+{
+}
+
+Cube::~Cube() { _buffer->detach(); }
+
+void
+Cube::replace_buffer(util::Reference<CubeBuffer> buffer)
+{
+	_buffer->detach();
+	_buffer = std::move(buffer);
+}
+
+void
+Cube::resize(const size_type rows, const size_type columns,
+    const size_type slices, const Type type)
+{
+	replace_buffer(util::make_reference<CubeBuffer>(rows * columns * slices,
+	    type));
+	_rows = rows;
+	_columns = columns;
+	_slices = slices;
+}
+
+bool
+Cube::reshape(const size_type rows, const size_type columns,
+    const size_type slices)
+{
+	if (rows * columns * slices != size()) return false;
+	replace_buffer(util::make_reference<CubeBuffer>(_buffer->storage()));
+	_rows = rows;
+	_columns = columns;
+	_slices = slices;
+	return true;
+}
+
+CubeLayout
+Cube::slice_layout(const size_type slice) const
+{
+	return {
+		.offset = index(0, 0, slice),
+		.rows = _rows,
+		.columns = _columns,
+		.inner_stride = 1,
+		.outer_stride = _rows,
+	};
+}
+
+CubeLayout
+Cube::column_layout(const size_type column) const
+{
+	return {
+		.offset = index(0, column, 0),
+		.rows = _rows,
+		.columns = _slices,
+		.inner_stride = 1,
+		.outer_stride = _rows * _columns,
+	};
+}
+
+CubeLayout
+Cube::row_layout(const size_type row) const
+{
+	return {
+		.offset = index(row, 0, 0),
+		.rows = _columns,
+		.columns = _slices,
+		.inner_stride = _rows,
+		.outer_stride = _rows * _columns,
+	};
+}
+
+static const Eigen::IOFormat FORMAT(Eigen::StreamPrecision,
+    Eigen::DontAlignCols, ", ", ", ", "[", "]", "[", "]");
+
+/* Widens integers so that int16 doesn't print as characters. */
+template <typename M>
+static void
+print(std::ostream &out, const M &m)
+{
+	using T = typename M::Scalar;
+	if constexpr (std::is_floating_point_v<T>) {
+		out << m.format(FORMAT);
+	} else if constexpr (std::is_signed_v<T>) {
+		out << m.template cast<int64_t>().format(FORMAT);
+	} else {
+		out << m.template cast<uint64_t>().format(FORMAT);
+	}
+}
+
+std::string
+Cube::to_string() const
+{
+	std::ostringstream out;
+	out << "Cube(" << _rows << "x" << _columns << "x" << _slices << " "
+	    << Matrix::type_name(type()) << ")[";
+	Matrix::visit_type(type(), [&]<typename T>(T) {
+		const auto &elements = _buffer->as<T>();
+		for (size_type k = 0; k < _slices; ++k) {
+			if (k > 0) out << ", ";
+			print(out,
+			    Eigen::Map<const DenseMatrix<T>>(
+				elements.data() + index(0, 0, k), _rows,
+				_columns));
+		}
+	});
+	out << "]";
+	return out.str();
+}
+
+CubeView::CubeView(util::Reference<CubeBuffer> buffer,
+    const CubeLayout &layout)
+    : _buffer(std::move(buffer))
+    , _layout(layout)
+{
+}
+
+void
+CubeView::separate()
+{
+	/* Attached, the writes are meant for the cube; detached but not shared,
+	 * nobody else can see them. */
+	if (_buffer->attached() || _buffer->reference_count() == 1) return;
+	Matrix::visit_type(type(), [&]<typename T>(T) {
+		CubeElements<T> elements(_layout.rows * _layout.columns);
+		Eigen::Map<DenseMatrix<T>>(elements.data(), _layout.rows,
+		    _layout.columns)
+		    = read<T>();
+		auto own = util::make_reference<CubeBuffer>(
+		    CubeBuffer::Storage(std::move(elements)));
+		own->detach();
+		_buffer = std::move(own);
+	});
+	_layout.offset = 0;
+	_layout.inner_stride = 1;
+	_layout.outer_stride = _layout.rows;
+}
+
+void
+CubeView::copy_to(Matrix &out) const
+{
+	out.resize(_layout.rows, _layout.columns, type());
+	Matrix::visit_type(type(),
+	    [&]<typename T>(T) { out.as<T>() = read<T>(); });
+}
+
+std::string
+CubeView::to_string() const
+{
+	std::ostringstream out;
+	out << "CubeView(" << _layout.rows << "x" << _layout.columns << " "
+	    << Matrix::type_name(type()) << ")";
+	Matrix::visit_type(type(),
+	    [&]<typename T>(T) { print(out, read<T>()); });
+	return out.str();
+}
+
+static Type
+read_type(mrb_state *mrb, const mrb_sym sym)
+{
+	const auto state = euler::util::State::get(mrb);
+	const auto name = state->mrb()->sym_name(sym);
+	const auto type = Matrix::parse_type(name);
+	if (!type.has_value()) {
+		state->mrb()->raisef(state->mrb()->argument_error(),
+		    "Unknown cube type %s", name);
+	}
+	return *type;
+}
+
+static void
+check_size(mrb_state *mrb, const mrb_int rows, const mrb_int columns,
+    const mrb_int slices)
+{
+	if (rows >= 0 && columns >= 0 && slices >= 0) return;
+	const auto state = euler::util::State::get(mrb);
+	state->mrb()->raise(state->mrb()->argument_error(),
+	    "Cube dimensions must not be negative");
+}
+
+static void
+check_index(mrb_state *mrb, const Cube &cube, const mrb_int row,
+    const mrb_int column, const mrb_int slice)
+{
+	if (row >= 0 && row < cube.row_count() && column >= 0
+	    && column < cube.column_count() && slice >= 0
+	    && slice < cube.slice_count())
+		return;
+	const auto state = euler::util::State::get(mrb);
+	state->mrb()->raisef(state->mrb()->index_error(),
+	    "Index (%i, %i, %i) outside of a %ix%ix%i cube", row, column, slice,
+	    static_cast<mrb_int>(cube.row_count()),
+	    static_cast<mrb_int>(cube.column_count()),
+	    static_cast<mrb_int>(cube.slice_count()));
+}
+
+static void
+check_index(mrb_state *mrb, const CubeView &view, const mrb_int row,
+    const mrb_int column)
+{
+	if (row >= 0 && row < view.row_count() && column >= 0
+	    && column < view.column_count())
+		return;
+	const auto state = euler::util::State::get(mrb);
+	state->mrb()->raisef(state->mrb()->index_error(),
+	    "Index (%i, %i) outside of a %ix%i view", row, column,
+	    static_cast<mrb_int>(view.row_count()),
+	    static_cast<mrb_int>(view.column_count()));
+}
+
+/* Raises unless 0 <= index < count. */
+static void
+check_part(mrb_state *mrb, const mrb_int index, const size_type count,
+    const char *part)
+{
+	if (index >= 0 && index < count) return;
+	const auto state = euler::util::State::get(mrb);
+	state->mrb()->raisef(state->mrb()->index_error(),
+	    "No %s %i in a cube with %i %ss", part, index,
+	    static_cast<mrb_int>(count), part);
+}
+
+static mrb_value
+wrap_view(mrb_state *mrb, const Cube &cube, const CubeLayout &layout)
+{
+	const auto state = euler::util::State::get(mrb);
+	auto view
+	    = euler::util::make_reference<CubeView>(cube.buffer(), layout);
+	return state->wrap(view);
+}
+
+/* Reads the bounds of clamp(min, max) or clamp(range). */
+static void
+read_bounds(mrb_state *mrb, double &lo, double &hi)
+{
+	const auto state = euler::util::State::get(mrb);
+	mrb_value min, max = mrb_nil_value();
+	const auto argc = state->mrb()->get_args("o|o", &min, &max);
+	if (argc == 1) {
+		if (!mrb_range_p(min)) {
+			state->mrb()->raise(state->mrb()->type_error(),
+			    "Expected a Range or two numbers");
+		}
+		const auto range = state->mrb()->range_ptr(min);
+		min = RANGE_BEG(range);
+		max = RANGE_END(range);
+	}
+	lo = state->mrb()->to_flo(min);
+	hi = state->mrb()->to_flo(max);
+}
+
+static mrb_value
+cube_allocate(mrb_state *mrb, mrb_value)
+{
+	const auto state = euler::util::State::get(mrb);
+	auto cube = euler::util::make_reference<Cube>();
+	return state->wrap(cube);
+}
+
+/**
+ * @overload Euler::Math::Cube#initialize(rows, columns, slices, type = :double)
+ *   Creates a zero-filled cube.
+ *   @param rows [Integer] The number of rows.
+ *   @param columns [Integer] The number of columns.
+ *   @param slices [Integer] The number of slices.
+ *   @param type [Symbol] The element type, as for Matrix.
+ */
+static mrb_value
+cube_initialize(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	mrb_int rows, columns, slices;
+	mrb_sym type = EULER_SYM(double);
+	state->mrb()->get_args("iii|n", &rows, &columns, &slices, &type);
+	check_size(mrb, rows, columns, slices);
+	const auto parsed = read_type(mrb, type);
+	auto cube = euler::util::Reference<Cube>::unwrap(mrb, self);
+	cube->resize(rows, columns, slices, parsed);
+	return mrb_nil_value();
+}
+
+static mrb_value
+cube_dtype(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	const auto cube = state->unwrap<Cube>(self);
+	const auto name = Matrix::type_name(cube->type());
+	return mrb_symbol_value(state->mrb()->intern_cstr(name));
+}
+
+static mrb_value
+cube_row_count(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	const auto cube = state->unwrap<Cube>(self);
+	return state->mrb()->int_value(cube->row_count());
+}
+
+static mrb_value
+cube_column_count(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	const auto cube = state->unwrap<Cube>(self);
+	return state->mrb()->int_value(cube->column_count());
+}
+
+static mrb_value
+cube_slice_count(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	const auto cube = state->unwrap<Cube>(self);
+	return state->mrb()->int_value(cube->slice_count());
+}
+
+/**
+ * @overload Euler::Math::Cube#[](row, column, slice)
+ *   @return [Numeric] The element.
+ *   @raise [IndexError] If the element is outside the cube.
+ */
+static mrb_value
+cube_get(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	mrb_int row, column, slice;
+	state->mrb()->get_args("iii", &row, &column, &slice);
+	const auto cube = state->unwrap<Cube>(self);
+	check_index(mrb, *cube.get(), row, column, slice);
+	const auto i = cube->index(row, column, slice);
+	return std::visit(
+	    [&](const auto &e) {
+		    return euler::util::wrap_num(state->mrb(), e[i]);
+	    },
+	    cube->buffer()->storage());
+}
+
+/**
+ * @overload Euler::Math::Cube#[]=(row, column, slice, value)
+ *   Views of the cube see the change.
+ *   @param value [Numeric] The new element, converted to the cube's type.
+ *   @raise [IndexError] If the element is outside the cube.
+ */
+static mrb_value
+cube_set(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	mrb_int row, column, slice;
+	mrb_value value;
+	state->mrb()->get_args("iiio", &row, &column, &slice, &value);
+	auto cube = state->unwrap<Cube>(self);
+	check_index(mrb, *cube.get(), row, column, slice);
+	const auto i = cube->index(row, column, slice);
+	Matrix::visit_type(cube->type(), [&]<typename T>(T) {
+		cube->buffer()->as<T>()[i]
+		    = euler::util::unwrap_num<T>(state, value);
+	});
+	return value;
+}
+
+/**
+ * @overload Euler::Math::Cube#to_a
+ *   @return [Array<Array<Array<Numeric>>>] The rows of each slice.
+ */
+static mrb_value
+cube_to_a(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	const auto cube = state->unwrap<Cube>(self);
+	const auto &ruby = state->mrb();
+	const auto out = ruby->ary_new_capa(cube->slice_count());
+	std::visit(
+	    [&](const auto &e) {
+		    for (size_type k = 0; k < cube->slice_count(); ++k) {
+			    const auto slice
+				= ruby->ary_new_capa(cube->row_count());
+			    for (size_type i = 0; i < cube->row_count(); ++i) {
+				    const auto row = ruby->ary_new_capa(
+					cube->column_count());
+				    for (size_type j = 0;
+					j < cube->column_count(); ++j) {
+					    const auto v
+						= e[cube->index(i, j, k)];
+					    ruby->ary_push(row,
+						euler::util::wrap_num(ruby,
+						    v));
+				    }
+				    ruby->ary_push(slice, row);
+			    }
+			    ruby->ary_push(out, slice);
+		    }
+	    },
+	    cube->buffer()->storage());
+	return out;
+}
+
+/**
+ * @overload Euler::Math::Cube#fill(value)
+ *   @param value [Numeric] The new value of every element.
+ *   @return [self]
+ */
+static mrb_value
+cube_fill(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	mrb_value value;
+	state->mrb()->get_args("o", &value);
+	auto cube = state->unwrap<Cube>(self);
+	Matrix::visit_type(cube->type(), [&]<typename T>(T) {
+		cube->buffer()->as<T>().setConstant(
+		    euler::util::unwrap_num<T>(state, value));
+	});
+	return self;
+}
+
+/**
+ * @overload Euler::Math::Cube#clamp(min, max)
+ *   Limits every element to the range [min, max], in place.
+ *   @return [self]
+ * @overload Euler::Math::Cube#clamp(range)
+ *   @param range [Range] The bounds, both inclusive.
+ *   @return [self]
+ */
+static mrb_value
+cube_clamp(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	double lo, hi;
+	read_bounds(mrb, lo, hi);
+	auto cube = state->unwrap<Cube>(self);
+	Matrix::visit_type(cube->type(), [&]<typename T>(T) {
+		auto &e = cube->buffer()->as<T>();
+		e = e.max(euler::math::ufunc::saturate<T>(lo))
+			.min(euler::math::ufunc::saturate<T>(hi));
+	});
+	return self;
+}
+
+/**
+ * @overload Euler::Math::Cube#slice(index)
+ *   @param index [Integer] The slice index.
+ *   @return [Euler::Math::CubeView] A rows x columns view of the slice,
+ *     sharing the cube's elements.
+ *   @raise [IndexError] If there is no such slice.
+ */
+static mrb_value
+cube_slice(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	mrb_int index;
+	state->mrb()->get_args("i", &index);
+	const auto cube = state->unwrap<Cube>(self);
+	check_part(mrb, index, cube->slice_count(), "slice");
+	return wrap_view(mrb, *cube.get(), cube->slice_layout(index));
+}
+
+/**
+ * @overload Euler::Math::Cube#column(index)
+ *   @param index [Integer] The column index.
+ *   @return [Euler::Math::CubeView] A rows x slices view holding that column
+ *     of each slice, sharing the cube's elements.
+ *   @raise [IndexError] If there is no such column.
+ */
+static mrb_value
+cube_column(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	mrb_int index;
+	state->mrb()->get_args("i", &index);
+	const auto cube = state->unwrap<Cube>(self);
+	check_part(mrb, index, cube->column_count(), "column");
+	return wrap_view(mrb, *cube.get(), cube->column_layout(index));
+}
+
+/**
+ * @overload Euler::Math::Cube#row(index)
+ *   @param index [Integer] The row index.
+ *   @return [Euler::Math::CubeView] A columns x slices view holding that row
+ *     of each slice, sharing the cube's elements.
+ *   @raise [IndexError] If there is no such row.
+ */
+static mrb_value
+cube_row(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	mrb_int index;
+	state->mrb()->get_args("i", &index);
+	const auto cube = state->unwrap<Cube>(self);
+	check_part(mrb, index, cube->row_count(), "row");
+	return wrap_view(mrb, *cube.get(), cube->row_layout(index));
+}
+
+/* An array of the count views that layout gives. */
+template <typename F>
+static mrb_value
+views(mrb_state *mrb, const mrb_value self, const size_type count,
+    const F &layout)
+{
+	const auto state = euler::util::State::get(mrb);
+	const auto cube = state->unwrap<Cube>(self);
+	const auto out = state->mrb()->ary_new_capa(count);
+	for (size_type i = 0; i < count; ++i) {
+		state->mrb()->ary_push(out,
+		    wrap_view(mrb, *cube.get(), layout(*cube.get(), i)));
+	}
+	return out;
+}
+
+/**
+ * @overload Euler::Math::Cube#slices
+ *   @return [Array<Euler::Math::CubeView>] A view of every slice.
+ */
+static mrb_value
+cube_slices(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	const auto cube = state->unwrap<Cube>(self);
+	return views(mrb, self, cube->slice_count(),
+	    [](const Cube &c, const size_type i) { return c.slice_layout(i); });
+}
+
+/**
+ * @overload Euler::Math::Cube#columns
+ *   @return [Array<Euler::Math::CubeView>] A view of every column.
+ */
+static mrb_value
+cube_columns(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	const auto cube = state->unwrap<Cube>(self);
+	return views(mrb, self, cube->column_count(),
+	    [](const Cube &c, const size_type i) {
+		    return c.column_layout(i);
+	    });
+}
+
+/**
+ * @overload Euler::Math::Cube#rows
+ *   @return [Array<Euler::Math::CubeView>] A view of every row.
+ */
+static mrb_value
+cube_rows(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	const auto cube = state->unwrap<Cube>(self);
+	return views(mrb, self, cube->row_count(),
+	    [](const Cube &c, const size_type i) { return c.row_layout(i); });
+}
+
+/**
+ * @overload Euler::Math::Cube#each_slice
+ *   Yields a view of each slice in turn.
+ *   @yieldparam slice [Euler::Math::CubeView]
+ *   @return [self]
+ */
+static mrb_value
+cube_each_slice(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	mrb_value block;
+	state->mrb()->get_args("&", &block);
+	if (mrb_nil_p(block)) {
+		state->mrb()->raise(state->mrb()->argument_error(),
+		    "each_slice needs a block");
+	}
+	const auto cube = state->unwrap<Cube>(self);
+	/* the block may resize the cube; its views then see the old slices */
+	const auto buffer = cube->buffer();
+	const auto count = cube->slice_count();
+	for (size_type k = 0; k < count; ++k) {
+		auto view = euler::util::make_reference<CubeView>(buffer,
+		    cube->slice_layout(k));
+		state->mrb()->yield(block, state->wrap(view));
+	}
+	return self;
+}
+
+static mrb_value
+copy_to_matrix(mrb_state *mrb, const Cube &cube, const CubeLayout &layout)
+{
+	const auto state = euler::util::State::get(mrb);
+	const CubeView view(cube.buffer(), layout);
+	auto matrix = euler::util::make_reference<Matrix>();
+	view.copy_to(*matrix.get());
+	return state->wrap(matrix);
+}
+
+/**
+ * @overload Euler::Math::Cube#column_to_matrix(index)
+ *   @param index [Integer] The column index.
+ *   @return [Euler::Math::Matrix] A rows x slices copy of the column.
+ *   @raise [IndexError] If there is no such column.
+ */
+static mrb_value
+cube_column_to_matrix(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	mrb_int index;
+	state->mrb()->get_args("i", &index);
+	const auto cube = state->unwrap<Cube>(self);
+	check_part(mrb, index, cube->column_count(), "column");
+	return copy_to_matrix(mrb, *cube.get(), cube->column_layout(index));
+}
+
+/**
+ * @overload Euler::Math::Cube#row_to_matrix(index)
+ *   @param index [Integer] The row index.
+ *   @return [Euler::Math::Matrix] A columns x slices copy of the row.
+ *   @raise [IndexError] If there is no such row.
+ */
+static mrb_value
+cube_row_to_matrix(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	mrb_int index;
+	state->mrb()->get_args("i", &index);
+	const auto cube = state->unwrap<Cube>(self);
+	check_part(mrb, index, cube->row_count(), "row");
+	return copy_to_matrix(mrb, *cube.get(), cube->row_layout(index));
+}
+
+/**
+ * @overload Euler::Math::Cube#reshape(rows, columns, slices)
+ *   Reinterprets the elements, in memory order, as a cube of another shape.
+ *   Views taken before are detached.
+ *   @return [self]
+ *   @raise [ArgumentError] If the element count would change.
+ */
+static mrb_value
+cube_reshape(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	mrb_int rows, columns, slices;
+	state->mrb()->get_args("iii", &rows, &columns, &slices);
+	check_size(mrb, rows, columns, slices);
+	auto cube = state->unwrap<Cube>(self);
+	if (!cube->reshape(rows, columns, slices)) {
+		state->mrb()->raise(state->mrb()->argument_error(),
+		    "Reshaping can't change the number of elements");
+	}
+	return self;
+}
+
+/**
+ * @overload Euler::Math::Cube#zeros(rows, columns, slices)
+ *   Resizes the cube, keeping its type, and sets every element to zero.
+ *   Views taken before are detached.
+ *   @return [self]
+ */
+static mrb_value
+cube_zeros(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	mrb_int rows, columns, slices;
+	state->mrb()->get_args("iii", &rows, &columns, &slices);
+	check_size(mrb, rows, columns, slices);
+	auto cube = state->unwrap<Cube>(self);
+	cube->resize(rows, columns, slices, cube->type());
+	return self;
+}
+
+static mrb_value
+cube_to_s(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	const auto cube = state->unwrap<Cube>(self);
+	const auto str = cube->to_string();
+	return state->mrb()->str_new(str.data(), str.size());
+}
+
+RClass *
+Cube::init(const util::Reference<util::State> &state, RClass *mod,
+    RClass *super)
+{
+	const auto &mrb = state->mrb();
+	const auto cls = mrb->define_class_under(mod, "Cube",
+	    super != nullptr ? super : state->object_class());
+	MRB_SET_INSTANCE_TT(cls, MRB_TT_DATA);
+	mrb->define_class_method(cls, "allocate", cube_allocate,
+	    MRB_ARGS_NONE());
+	mrb->define_method(cls, "initialize", cube_initialize,
+	    MRB_ARGS_ARG(3, 1));
+	mrb->define_method(cls, "dtype", cube_dtype, MRB_ARGS_NONE());
+	mrb->define_method(cls, "row_count", cube_row_count, MRB_ARGS_NONE());
+	mrb->define_method(cls, "column_count", cube_column_count,
+	    MRB_ARGS_NONE());
+	mrb->define_method(cls, "slice_count", cube_slice_count,
+	    MRB_ARGS_NONE());
+	mrb->define_method(cls, "[]", cube_get, MRB_ARGS_REQ(3));
+	mrb->define_method(cls, "[]=", cube_set, MRB_ARGS_REQ(4));
+	mrb->define_method(cls, "to_a", cube_to_a, MRB_ARGS_NONE());
+	mrb->define_method(cls, "fill", cube_fill, MRB_ARGS_REQ(1));
+	mrb->define_method(cls, "clamp", cube_clamp, MRB_ARGS_ARG(1, 1));
+	mrb->define_method(cls, "slice", cube_slice, MRB_ARGS_REQ(1));
+	mrb->define_method(cls, "column", cube_column, MRB_ARGS_REQ(1));
+	mrb->define_method(cls, "row", cube_row, MRB_ARGS_REQ(1));
+	mrb->define_method(cls, "slices", cube_slices, MRB_ARGS_NONE());
+	mrb->define_method(cls, "columns", cube_columns, MRB_ARGS_NONE());
+	mrb->define_method(cls, "rows", cube_rows, MRB_ARGS_NONE());
+	mrb->define_method(cls, "each_slice", cube_each_slice,
+	    MRB_ARGS_BLOCK());
+	mrb->define_method(cls, "column_to_matrix", cube_column_to_matrix,
+	    MRB_ARGS_REQ(1));
+	mrb->define_method(cls, "row_to_matrix", cube_row_to_matrix,
+	    MRB_ARGS_REQ(1));
+	mrb->define_method(cls, "reshape", cube_reshape, MRB_ARGS_REQ(3));
+	mrb->define_method(cls, "zeros", cube_zeros, MRB_ARGS_REQ(3));
+	mrb->define_method(cls, "to_s", cube_to_s, MRB_ARGS_NONE());
+	mrb->define_method(cls, "inspect", cube_to_s, MRB_ARGS_NONE());
+	return cls;
+}
+
+static mrb_value
+view_dtype(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	const auto view = state->unwrap<CubeView>(self);
+	const auto name = Matrix::type_name(view->type());
+	return mrb_symbol_value(state->mrb()->intern_cstr(name));
+}
+
+static mrb_value
+view_row_count(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	const auto view = state->unwrap<CubeView>(self);
+	return state->mrb()->int_value(view->row_count());
+}
+
+static mrb_value
+view_column_count(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	const auto view = state->unwrap<CubeView>(self);
+	return state->mrb()->int_value(view->column_count());
+}
+
+/**
+ * @overload Euler::Math::CubeView#attached?
+ *   @return [Boolean] Whether writes still reach the cube, which stops being
+ *     the case once it is freed, reshaped or resized.
+ */
+static mrb_value
+view_attached(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	const auto view = state->unwrap<CubeView>(self);
+	return mrb_bool_value(view->attached());
+}
+
+/**
+ * @overload Euler::Math::CubeView#[](row, column)
+ *   @return [Numeric] The element.
+ *   @raise [IndexError] If the element is outside the view.
+ */
+static mrb_value
+view_get(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	mrb_int row, column;
+	state->mrb()->get_args("ii", &row, &column);
+	const auto view = state->unwrap<CubeView>(self);
+	check_index(mrb, *view.get(), row, column);
+	mrb_value out = mrb_nil_value();
+	Matrix::visit_type(view->type(), [&]<typename T>(T) {
+		out = euler::util::wrap_num(state->mrb(),
+		    view->read<T>()(row, column));
+	});
+	return out;
+}
+
+/**
+ * @overload Euler::Math::CubeView#[]=(row, column, value)
+ *   @param value [Numeric] The new element, converted to the view's type.
+ *   @raise [IndexError] If the element is outside the view.
+ */
+static mrb_value
+view_set(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	mrb_int row, column;
+	mrb_value value;
+	state->mrb()->get_args("iio", &row, &column, &value);
+	auto view = state->unwrap<CubeView>(self);
+	check_index(mrb, *view.get(), row, column);
+	Matrix::visit_type(view->type(), [&]<typename T>(T) {
+		const auto element = euler::util::unwrap_num<T>(state, value);
+		view->write<T>()(row, column) = element;
+	});
+	return value;
+}
+
+/**
+ * @overload Euler::Math::CubeView#fill(value)
+ *   @param value [Numeric] The new value of every element.
+ *   @return [self]
+ */
+static mrb_value
+view_fill(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	mrb_value value;
+	state->mrb()->get_args("o", &value);
+	auto view = state->unwrap<CubeView>(self);
+	Matrix::visit_type(view->type(), [&]<typename T>(T) {
+		const auto element = euler::util::unwrap_num<T>(state, value);
+		view->write<T>().setConstant(element);
+	});
+	return self;
+}
+
+/**
+ * @overload Euler::Math::CubeView#assign(matrix)
+ *   Copies a matrix of the same shape into the view, converting its elements
+ *   to the view's type.
+ *   @param matrix [Euler::Math::Matrix]
+ *   @return [self]
+ *   @raise [ArgumentError] If the shapes differ.
+ */
+static mrb_value
+view_assign(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	mrb_value value;
+	state->mrb()->get_args("o", &value);
+	{
+		auto view = state->unwrap<CubeView>(self);
+		const auto matrix = state->unwrap<Matrix>(value);
+		if (matrix->row_count() == view->row_count()
+		    && matrix->column_count() == view->column_count()) {
+			Matrix::visit_type(view->type(), [&]<typename T>(T) {
+				view->write<T>() = matrix->cast<T>();
+			});
+			return self;
+		}
+	}
+	state->mrb()->raise(state->mrb()->argument_error(),
+	    "Matrix and view shapes don't match");
+}
+
+/**
+ * @overload Euler::Math::CubeView#to_a
+ *   @return [Array<Array<Numeric>>] The rows of the view.
+ */
+static mrb_value
+view_to_a(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	const auto view = state->unwrap<CubeView>(self);
+	const auto &ruby = state->mrb();
+	const auto out = ruby->ary_new_capa(view->row_count());
+	Matrix::visit_type(view->type(), [&]<typename T>(T) {
+		const auto m = view->read<T>();
+		for (size_type i = 0; i < m.rows(); ++i) {
+			const auto row = ruby->ary_new_capa(m.cols());
+			for (size_type j = 0; j < m.cols(); ++j) {
+				ruby->ary_push(row,
+				    euler::util::wrap_num(ruby, m(i, j)));
+			}
+			ruby->ary_push(out, row);
+		}
+	});
+	return out;
+}
+
+/**
+ * @overload Euler::Math::CubeView#to_matrix
+ *   @return [Euler::Math::Matrix] A copy of the view.
+ */
+static mrb_value
+view_to_matrix(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	const auto view = state->unwrap<CubeView>(self);
+	auto matrix = euler::util::make_reference<Matrix>();
+	view->copy_to(*matrix.get());
+	return state->wrap(matrix);
+}
+
+static mrb_value
+view_to_s(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	const auto view = state->unwrap<CubeView>(self);
+	const auto str = view->to_string();
+	return state->mrb()->str_new(str.data(), str.size());
+}
+
+RClass *
+CubeView::init(const util::Reference<util::State> &state, RClass *mod,
+    RClass *)
+{
+	const auto &mrb = state->mrb();
+	const auto cls
+	    = mrb->define_class_under(mod, "CubeView", state->object_class());
+	MRB_SET_INSTANCE_TT(cls, MRB_TT_DATA);
+	mrb->define_method(cls, "dtype", view_dtype, MRB_ARGS_NONE());
+	mrb->define_method(cls, "row_count", view_row_count, MRB_ARGS_NONE());
+	mrb->define_method(cls, "column_count", view_column_count,
+	    MRB_ARGS_NONE());
+	mrb->define_method(cls, "attached?", view_attached, MRB_ARGS_NONE());
+	mrb->define_method(cls, "[]", view_get, MRB_ARGS_REQ(2));
+	mrb->define_method(cls, "[]=", view_set, MRB_ARGS_REQ(3));
+	mrb->define_method(cls, "fill", view_fill, MRB_ARGS_REQ(1));
+	mrb->define_method(cls, "assign", view_assign, MRB_ARGS_REQ(1));
+	mrb->define_method(cls, "to_a", view_to_a, MRB_ARGS_NONE());
+	mrb->define_method(cls, "to_matrix", view_to_matrix, MRB_ARGS_NONE());
+	mrb->define_method(cls, "to_s", view_to_s, MRB_ARGS_NONE());
+	mrb->define_method(cls, "inspect", view_to_s, MRB_ARGS_NONE());
+	return cls;
+}
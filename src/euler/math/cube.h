@@ -0,0 +1,261 @@
+/* SPDX-License-Identifier: ISC */
+
+#ifndef EULER_MATH_CUBE_H
+#define EULER_MATH_CUBE_H
+
+#include <string>
+#include <variant>
+
+#include <Eigen/Eigen>
+
+#include "euler/math/matrix.h"
+#include "euler/util/ext.h"
+#include "euler/util/object.h"
+#include "euler/util/types.h"
+
+namespace euler::math {
+
+template <typename T> using CubeElements = Eigen::Array<T, Eigen::Dynamic, 1>;
+
+/* The elements of a cube, shared by the cube and every view taken from it.
+ * The cube owns one buffer at a time; when it is resized or freed it detaches
+ * the buffer it had, which tells the views still holding it that their
+ * writes no longer reach a cube. */
+class CubeBuffer final : public util::Object {
+public:
+	/* in the same order as Matrix::Type */
+	using Storage = std::variant<CubeElements<float>, CubeElements<double>,
+	    CubeElements<int16_t>, CubeElements<int32_t>,
+	    CubeElements<int64_t>, CubeElements<uint16_t>,
+	    CubeElements<uint32_t>, CubeElements<uint64_t>>;
+
+	/* Zero-filled. */
+	CubeBuffer(size_type size, Matrix::Type type);
+	explicit CubeBuffer(Storage storage);
+
+	[[nodiscard]] Matrix::Type
+	type() const
+	{
+		return static_cast<Matrix::Type>(_storage.index());
+	}
+
+	[[nodiscard]] size_type size() const;
+
+	[[nodiscard]] Storage &
+	storage()
+	{
+		return _storage;
+	}
+
+	[[nodiscard]] const Storage &
+	storage() const
+	{
+		return _storage;
+	}
+
+	/* The elements as T, which must be the buffer's type. */
+	template <typename T>
+	[[nodiscard]] CubeElements<T> &
+	as()
+	{
+		return std::get<CubeElements<T>>(_storage);
+	}
+
+	template <typename T>
+	[[nodiscard]] const CubeElements<T> &
+	as() const
+	{
+		return std::get<CubeElements<T>>(_storage);
+	}
+
+	[[nodiscard]] bool
+	attached() const
+	{
+		return _attached;
+	}
+
+	void
+	detach()
+	{
+		_attached = false;
+	}
+
+private:
+	Storage _storage;
+	bool _attached = true;
+};
+
+/* Where the elements of a two-dimensional view sit in a buffer: element
+ * (i, j) is at offset + i * inner_stride + j * outer_stride. */
+struct CubeLayout {
+	size_type offset = 0;
+	size_type rows = 0;
+	size_type columns = 0;
+	size_type inner_stride = 1;
+	size_type outer_stride = 0;
+};
+
+/* A rows x columns x slices array in one contiguous buffer, column-major
+ * within a slice and slice after slice, so that each slice is laid out like a
+ * Matrix. Slices, columns and rows are handed out as CubeViews over the same
+ * buffer rather than copied. */
+class Cube final : public util::Object {
+	BIND_MRUBY("Euler::Math::Cube", Cube, math.cube);
+
+public:
+	using Type = Matrix::Type;
+
+	Cube();
+	Cube(size_type rows, size_type columns, size_type slices,
+	    Type type = Type::Double);
+	~Cube() override;
+
+	[[nodiscard]] Type
+	type() const
+	{
+		return _buffer->type();
+	}
+
+	[[nodiscard]] size_type
+	row_count() const
+	{
+		return _rows;
+	}
+
+	[[nodiscard]] size_type
+	column_count() const
+	{
+		return _columns;
+	}
+
+	[[nodiscard]] size_type
+	slice_count() const
+	{
+		return _slices;
+	}
+
+	[[nodiscard]] size_type
+	size() const
+	{
+		return _rows * _columns * _slices;
+	}
+
+	[[nodiscard]] size_type
+	index(const size_type row, const size_type column,
+	    const size_type slice) const
+	{
+		return row + _rows * (column + _columns * slice);
+	}
+
+	/* Zero-filled, in a new buffer; views of the old one are detached. */
+	void resize(size_type rows, size_type columns, size_type slices,
+	    Type type);
+	/* Keeps the elements in memory order, in a new buffer so that views
+	 * of the old shape are detached. False, leaving the cube alone, if
+	 * the element count would change. */
+	bool reshape(size_type rows, size_type columns, size_type slices);
+
+	[[nodiscard]] util::Reference<CubeBuffer> &
+	buffer()
+	{
+		return _buffer;
+	}
+
+	[[nodiscard]] const util::Reference<CubeBuffer> &
+	buffer() const
+	{
+		return _buffer;
+	}
+
+	/* rows x columns: the matrix at slice. */
+	[[nodiscard]] CubeLayout slice_layout(size_type slice) const;
+	/* rows x slices: column of every slice, side by side. */
+	[[nodiscard]] CubeLayout column_layout(size_type column) const;
+	/* columns x slices: row of every slice, side by side. */
+	[[nodiscard]] CubeLayout row_layout(size_type row) const;
+
+	[[nodiscard]] std::string to_string() const;
+
+private:
+	void replace_buffer(util::Reference<CubeBuffer> buffer);
+
+	util::Reference<CubeBuffer> _buffer;
+	size_type _rows = 0;
+	size_type _columns = 0;
+	size_type _slices = 0;
+};
+
+/* A strided two-dimensional window into a cube's buffer. Reads and writes go
+ * straight to the cube while it still owns the buffer. Once the cube has been
+ * freed or resized, the first write copies the window into a buffer of the
+ * view's own, unless no other view shares the old one. */
+class CubeView final : public util::Object {
+	BIND_MRUBY("Euler::Math::CubeView", CubeView, math.cube_view);
+
+public:
+	template <typename T>
+	using Map = Eigen::Map<T, Eigen::Unaligned,
+	    Eigen::Stride<Eigen::Dynamic, Eigen::Dynamic>>;
+
+	CubeView(util::Reference<CubeBuffer> buffer, const CubeLayout &layout);
+
+	[[nodiscard]] Matrix::Type
+	type() const
+	{
+		return _buffer->type();
+	}
+
+	[[nodiscard]] size_type
+	row_count() const
+	{
+		return _layout.rows;
+	}
+
+	[[nodiscard]] size_type
+	column_count() const
+	{
+		return _layout.columns;
+	}
+
+	/* Whether writes still reach the cube the view was taken from. */
+	[[nodiscard]] bool
+	attached() const
+	{
+		return _buffer->attached();
+	}
+
+	template <typename T>
+	[[nodiscard]] Map<const DenseMatrix<T>>
+	read() const
+	{
+		return { _buffer->as<T>().data() + _layout.offset,
+			_layout.rows, _layout.columns,
+			{ _layout.outer_stride, _layout.inner_stride } };
+	}
+
+	/* Copies first if the buffer is detached and shared. */
+	template <typename T>
+	[[nodiscard]] Map<DenseMatrix<T>>
+	write()
+	{
+		separate();
+		return { _buffer->as<T>().data() + _layout.offset,
+			_layout.rows, _layout.columns,
+			{ _layout.outer_stride, _layout.inner_stride } };
+	}
+
+	/* Copies the elements into out, which takes the view's shape and
+	 * type. */
+	void copy_to(Matrix &out) const;
+	[[nodiscard]] std::string to_string() const;
+
+private:
+	void separate();
+
+	util::Reference<CubeBuffer> _buffer;
+	CubeLayout _layout;
+};
+
+} /* namespace euler::math */
+
+#endif /* EULER_MATH_CUBE_H */
@@ -0,0 +1,558 @@
+/* SPDX-License-Identifier: ISC */
+
+#include "euler/math/expression.h"
+
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "euler/util/state.h"
+
+using euler::math::DenseMatrix;
+using euler::math::Expression;
+using euler::math::Matrix;
+using euler::math::size_type;
+using Node = Expression::Node;
+using Op = Expression::Op;
+
+Expression::NodePtr
+Expression::leaf(const util::Reference<Matrix> &matrix)
+{
+	auto node = std::make_shared<Node>();
+	node->op = Op::Matrix;
+	node->type = matrix->type();
+	node->rows = matrix->row_count();
+	node->columns = matrix->column_count();
+	node->matrix = matrix;
+	return node;
+}
+
+Expression::NodePtr
+Expression::scalar(const double value)
+{
+	auto node = std::make_shared<Node>();
+	node->op = Op::Scalar;
+	node->scalar = value;
+	return node;
+}
+
+/* Whether an integer node applies value exactly. */
+static bool
+is_whole(const double value)
+{
+	return std::trunc(value) == value && std::abs(value) < 0x1p63;
+}
+
+Expression::NodePtr
+Expression::binary(const Op op, NodePtr lhs, NodePtr rhs)
+{
+	if (lhs->is_scalar() && rhs->is_scalar()) return nullptr;
+	auto node = std::make_shared<Node>();
+	node->op = op;
+	const auto &shaped = lhs->is_scalar() ? rhs : lhs;
+	node->rows = shaped->rows;
+	node->columns = shaped->columns;
+	node->type = shaped->type;
+	if (!lhs->is_scalar() && !rhs->is_scalar()) {
+		node->type = Matrix::promote(lhs->type, rhs->type);
+	} else {
+		/* int_matrix * 0.5 is a Double, not int_matrix * 0 */
+		const auto &scalar = lhs->is_scalar() ? lhs : rhs;
+		if (!is_whole(scalar->scalar)
+		    && node->type != Matrix::Type::Float)
+			node->type = Matrix::Type::Double;
+	}
+	switch (op) {
+	case Op::Add:
+	case Op::Subtract:
+		if (lhs->is_scalar() || rhs->is_scalar()) break;
+		if (lhs->rows != rhs->rows || lhs->columns != rhs->columns)
+			return nullptr;
+		break;
+	case Op::Multiply:
+		if (lhs->is_scalar() || rhs->is_scalar()) break;
+		if (lhs->columns != rhs->rows) return nullptr;
+		node->columns = rhs->columns;
+		break;
+	case Op::Divide:
+		if (lhs->is_scalar() || !rhs->is_scalar()) return nullptr;
+		break;
+	default: return nullptr;
+	}
+	node->lhs = std::move(lhs);
+	node->rhs = std::move(rhs);
+	return node;
+}
+
+Expression::NodePtr
+Expression::unary(const Op op, NodePtr operand)
+{
+	auto node = std::make_shared<Node>();
+	node->op = op;
+	node->type = operand->type;
+	node->rows = operand->rows;
+	node->columns = operand->columns;
+	if (op == Op::Transpose) std::swap(node->rows, node->columns);
+	node->lhs = std::move(operand);
+	return node;
+}
+
+static bool
+node_references(const Node &node, const Matrix *matrix)
+{
+	if (node.op == Op::Matrix) return node.matrix.get() == matrix;
+	if (node.lhs != nullptr && node_references(*node.lhs, matrix))
+		return true;
+	return node.rhs != nullptr && node_references(*node.rhs, matrix);
+}
+
+bool
+Expression::references(const Matrix *matrix) const
+{
+	return node_references(*_root, matrix);
+}
+
+static bool
+node_current(const Node &node)
+{
+	if (node.op == Op::Matrix) {
+		return node.matrix->row_count() == node.rows
+		    && node.matrix->column_count() == node.columns
+		    && node.matrix->type() == node.type;
+	}
+	if (node.lhs != nullptr && !node_current(*node.lhs)) return false;
+	return node.rhs == nullptr || node_current(*node.rhs);
+}
+
+bool
+Expression::is_current() const
+{
+	return node_current(*_root);
+}
+
+namespace {
+/* A term of the flattened sum: coefficient * lhs, or coefficient * lhs * rhs
+ * for a matrix product. */
+struct Term {
+	double coefficient;
+	const Node *lhs;
+	const Node *rhs;
+};
+
+/* A matrix read by the evaluation, borrowed when it already has the right
+ * type and otherwise computed into owned. */
+template <typename T> struct Operand {
+	const DenseMatrix<T> *borrowed = nullptr;
+	DenseMatrix<T> owned;
+	bool transposed = false;
+
+	template <typename F>
+	void
+	with(F &&fn) const
+	{
+		const auto &m = borrowed != nullptr ? *borrowed : owned;
+		if (transposed) fn(m.transpose());
+		else fn(m);
+	}
+};
+} /* namespace */
+
+template <typename T>
+static T
+coefficient(const double value)
+{
+	/* through int64_t so that -1 wraps for unsigned types */
+	if constexpr (std::is_floating_point_v<T>) return static_cast<T>(value);
+	else return static_cast<T>(static_cast<int64_t>(value));
+}
+
+template <typename T>
+static void evaluate_node(const Node &node, DenseMatrix<T> &out);
+
+static bool
+is_integral(const Matrix::Type type)
+{
+	return type != Matrix::Type::Float && type != Matrix::Type::Double;
+}
+
+/* Evaluates node in its own type and converts the result, so integer
+ * subtrees keep their arithmetic: (int_m / 2) * 1.5 truncates before
+ * scaling. */
+template <typename T>
+static void
+evaluate_as(const Node &node, DenseMatrix<T> &out)
+{
+	if (node.type == Matrix::type_of<T>()) {
+		evaluate_node<T>(node, out);
+		return;
+	}
+	Matrix::visit_type(node.type, [&]<typename U>(U) {
+		DenseMatrix<U> own;
+		evaluate_node<U>(node, own);
+		out = own.template cast<T>();
+	});
+}
+
+template <typename T>
+static void
+collect(const Node &node, const double scale, std::vector<Term> &terms,
+    double &constant)
+{
+	/* integer subtrees of another type, and integer division, are
+	 * evaluated as steps of their own rather than folded into T */
+	if (is_integral(node.type)
+	    && (node.type != Matrix::type_of<T>() || node.op == Op::Divide)) {
+		terms.push_back({ scale, &node, nullptr });
+		return;
+	}
+	switch (node.op) {
+	case Op::Add:
+		collect<T>(*node.lhs, scale, terms, constant);
+		collect<T>(*node.rhs, scale, terms, constant);
+		return;
+	case Op::Subtract:
+		collect<T>(*node.lhs, scale, terms, constant);
+		collect<T>(*node.rhs, -scale, terms, constant);
+		return;
+	case Op::Negate: collect<T>(*node.lhs, -scale, terms, constant); return;
+	case Op::Scalar: constant += scale * node.scalar; return;
+	case Op::Multiply:
+		if (node.lhs->is_scalar()) {
+			collect<T>(*node.rhs, scale * node.lhs->scalar, terms,
+			    constant);
+		} else if (node.rhs->is_scalar()) {
+			collect<T>(*node.lhs, scale * node.rhs->scalar, terms,
+			    constant);
+		} else {
+			terms.push_back({ scale, node.lhs.get(),
+			    node.rhs.get() });
+		}
+		return;
+	case Op::Divide:
+		collect<T>(*node.lhs, scale / node.rhs->scalar, terms,
+		    constant);
+		return;
+	default: break;
+	}
+	terms.push_back({ scale, &node, nullptr });
+}
+
+template <typename T>
+static Operand<T>
+operand(const Node &node)
+{
+	Operand<T> out;
+	const Node *inner = &node;
+	while (inner->op == Op::Transpose) {
+		out.transposed = !out.transposed;
+		inner = inner->lhs.get();
+	}
+	if (inner->op != Op::Matrix) evaluate_as<T>(*inner, out.owned);
+	else if (inner->matrix->type() == Matrix::type_of<T>())
+		out.borrowed = &inner->matrix->template as<T>();
+	else out.owned = inner->matrix->template cast<T>();
+	return out;
+}
+
+/* out = (or +=) the sum of up to three scaled operands, in one pass. */
+template <typename T>
+static void
+fuse(DenseMatrix<T> &out, const Operand<T> *ops, const T *c,
+    const size_t count, const bool accumulate)
+{
+	const auto store = [&](const auto &value) {
+		if (accumulate) out += value;
+		else out = value;
+	};
+	switch (count) {
+	case 1: ops[0].with([&](const auto &a) { store(c[0] * a); }); break;
+	case 2:
+		ops[0].with([&](const auto &a) {
+			ops[1].with([&](const auto &b) {
+				store(c[0] * a + c[1] * b);
+			});
+		});
+		break;
+	default:
+		ops[0].with([&](const auto &a) {
+			ops[1].with([&](const auto &b) {
+				ops[2].with([&](const auto &d) {
+					store(c[0] * a + c[1] * b + c[2] * d);
+				});
+			});
+		});
+		break;
+	}
+}
+
+template <typename T>
+static void
+evaluate_node(const Node &node, DenseMatrix<T> &out)
+{
+	if constexpr (!std::is_floating_point_v<T>) {
+		if (node.op == Op::Divide) {
+			evaluate_node<T>(*node.lhs, out);
+			out.array() /= coefficient<T>(node.rhs->scalar);
+			return;
+		}
+	}
+	std::vector<Term> terms;
+	double constant = 0.0;
+	collect<T>(node, 1.0, terms, constant);
+
+	std::vector<Operand<T>> plain;
+	std::vector<T> scales;
+	for (const auto &term : terms) {
+		if (term.rhs != nullptr) continue;
+		plain.push_back(operand<T>(*term.lhs));
+		scales.push_back(coefficient<T>(term.coefficient));
+	}
+	out.resize(node.rows, node.columns);
+	bool assigned = false;
+	for (size_t i = 0; i < plain.size(); i += 3) {
+		fuse(out, plain.data() + i, scales.data() + i,
+		    std::min<size_t>(3, plain.size() - i), assigned);
+		assigned = true;
+	}
+	if (constant != 0.0 || (!assigned && plain.size() == terms.size())) {
+		const auto value = coefficient<T>(constant);
+		if (assigned) out.array() += value;
+		else out.setConstant(value);
+		assigned = true;
+	}
+	for (const auto &term : terms) {
+		if (term.rhs == nullptr) continue;
+		const auto lhs = operand<T>(*term.lhs);
+		const auto rhs = operand<T>(*term.rhs);
+		const auto scale = coefficient<T>(term.coefficient);
+		lhs.with([&](const auto &a) {
+			rhs.with([&](const auto &b) {
+				/* scale and accumulation both fold into the
+				 * GEMM call */
+				if (assigned) out.noalias() += scale * a * b;
+				else out.noalias() = scale * a * b;
+			});
+		});
+		assigned = true;
+	}
+}
+
+void
+Expression::evaluate_into(Matrix &target) const
+{
+	Matrix::visit_type(_root->type, [&]<typename T>(T) {
+		if (target.type() == _root->type && !references(&target)) {
+			evaluate_node<T>(*_root, target.as<T>());
+			return;
+		}
+		DenseMatrix<T> out;
+		evaluate_node<T>(*_root, out);
+		target.storage() = std::move(out);
+	});
+}
+
+euler::util::Reference<Matrix>
+Expression::evaluate() const
+{
+	auto matrix = util::make_reference<Matrix>();
+	evaluate_into(*matrix.get());
+	return matrix;
+}
+
+Expression::NodePtr
+Expression::read(mrb_state *mrb, const mrb_value value)
+{
+	const auto state = util::State::get(mrb);
+	const auto &math = state->modules().math;
+	if (mrb_integer_p(value) || mrb_float_p(value))
+		return scalar(state->mrb()->to_flo(value));
+	if (state->mrb()->obj_is_kind_of(value, math.matrix))
+		return leaf(util::Reference<Matrix>::unwrap(mrb, value));
+	if (state->mrb()->obj_is_kind_of(value, math.expression))
+		return util::Reference<Expression>::unwrap(mrb, value)->root();
+	state->mrb()->raise(state->mrb()->type_error(),
+	    "Expected a Matrix, an Expression or a number");
+}
+
+static mrb_value
+wrap_node(mrb_state *mrb, Expression::NodePtr node)
+{
+	const auto state = euler::util::State::get(mrb);
+	auto expression
+	    = euler::util::make_reference<Expression>(std::move(node));
+	return state->wrap(expression);
+}
+
+static const char *
+op_verb(const Op op)
+{
+	switch (op) {
+	case Op::Add: return "add";
+	case Op::Subtract: return "subtract";
+	case Op::Multiply: return "multiply";
+	default: return "divide";
+	}
+}
+
+template <Op O>
+static mrb_value
+expression_binary(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	mrb_value other;
+	state->mrb()->get_args("o", &other);
+	const auto lhs = Expression::read(mrb, self);
+	const auto rhs = Expression::read(mrb, other);
+	if constexpr (O == Op::Divide) {
+		const bool integral = lhs->type != Matrix::Type::Float
+		    && lhs->type != Matrix::Type::Double;
+		if (rhs->is_scalar() && rhs->scalar == 0.0 && integral) {
+			state->mrb()->raise(state->mrb()->zero_division_error(),
+			    "divided by 0");
+		}
+	}
+	auto node = Expression::binary(O, lhs, rhs);
+	if (node == nullptr) {
+		char message[128];
+		if (O == Op::Divide) {
+			snprintf(message, sizeof(message),
+			    "Can only divide by a number");
+		} else {
+			snprintf(message, sizeof(message),
+			    "Cannot %s a %ldx%ld and a %ldx%ld matrix",
+			    op_verb(O), static_cast<long>(lhs->rows),
+			    static_cast<long>(lhs->columns),
+			    static_cast<long>(rhs->rows),
+			    static_cast<long>(rhs->columns));
+		}
+		state->mrb()->raise(state->mrb()->argument_error(), message);
+	}
+	return wrap_node(mrb, std::move(node));
+}
+
+template <Op O>
+static mrb_value
+expression_unary(mrb_state *mrb, const mrb_value self)
+{
+	auto operand = Expression::read(mrb, self);
+	return wrap_node(mrb, Expression::unary(O, std::move(operand)));
+}
+
+void
+Expression::define_arithmetic(const util::Reference<util::State> &state,
+    RClass *cls)
+{
+	const auto &mrb = state->mrb();
+	mrb->define_method(cls, "+", expression_binary<Op::Add>,
+	    MRB_ARGS_REQ(1));
+	mrb->define_method(cls, "-", expression_binary<Op::Subtract>,
+	    MRB_ARGS_REQ(1));
+	mrb->define_method(cls, "*", expression_binary<Op::Multiply>,
+	    MRB_ARGS_REQ(1));
+	mrb->define_method(cls, "/", expression_binary<Op::Divide>,
+	    MRB_ARGS_REQ(1));
+	mrb->define_method(cls, "-@", expression_unary<Op::Negate>,
+	    MRB_ARGS_NONE());
+	mrb->define_method(cls, "transpose", expression_unary<Op::Transpose>,
+	    MRB_ARGS_NONE());
+	mrb->define_method(cls, "t", expression_unary<Op::Transpose>,
+	    MRB_ARGS_NONE());
+}
+
+/**
+ * @overload Euler::Math::Expression#evaluate
+ *   Computes the expression.
+ *   @return [Euler::Math::Matrix] A new matrix holding the result.
+ */
+static mrb_value
+expression_evaluate(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	mrb_value result = mrb_nil_value();
+	{
+		const auto expression
+		    = euler::util::Reference<Expression>::unwrap(mrb, self);
+		if (expression->is_current()) {
+			auto matrix = expression->evaluate();
+			result = state->wrap(matrix);
+		}
+	}
+	if (mrb_nil_p(result)) {
+		state->mrb()->raise(state->mrb()->argument_error(),
+		    Expression::STALE_ERROR);
+	}
+	return result;
+}
+
+static mrb_value
+expression_to_a(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	const auto matrix = expression_evaluate(mrb, self);
+	return state->mrb()->funcall(matrix, "to_a", 0);
+}
+
+static mrb_value
+expression_row_count(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	const auto expression
+	    = euler::util::Reference<Expression>::unwrap(mrb, self);
+	return state->mrb()->int_value(expression->root()->rows);
+}
+
+static mrb_value
+expression_column_count(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	const auto expression
+	    = euler::util::Reference<Expression>::unwrap(mrb, self);
+	return state->mrb()->int_value(expression->root()->columns);
+}
+
+static mrb_value
+expression_dtype(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	const auto expression
+	    = euler::util::Reference<Expression>::unwrap(mrb, self);
+	const auto name = Matrix::type_name(expression->root()->type);
+	return mrb_symbol_value(state->mrb()->intern_cstr(name));
+}
+
+static mrb_value
+expression_inspect(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	const auto expression
+	    = euler::util::Reference<Expression>::unwrap(mrb, self);
+	const auto &root = expression->root();
+	char buf[96];
+	snprintf(buf, sizeof(buf), "#<Euler::Math::Expression %ldx%ld %s>",
+	    static_cast<long>(root->rows), static_cast<long>(root->columns),
+	    Matrix::type_name(root->type));
+	return state->mrb()->str_new_cstr(buf);
+}
+
+RClass *
+Expression::init(const util::Reference<util::State> &state, RClass *mod,
+    RClass *)
+{
+	const auto &mrb = state->mrb();
+	const auto cls
+	    = mrb->define_class_under(mod, "Expression", state->object_class());
+	MRB_SET_INSTANCE_TT(cls, MRB_TT_DATA);
+	define_arithmetic(state, cls);
+	mrb->define_method(cls, "evaluate", expression_evaluate,
+	    MRB_ARGS_NONE());
+	mrb->define_method(cls, "to_a", expression_to_a, MRB_ARGS_NONE());
+	mrb->define_method(cls, "row_count", expression_row_count,
+	    MRB_ARGS_NONE());
+	mrb->define_method(cls, "column_count", expression_column_count,
+	    MRB_ARGS_NONE());
+	mrb->define_method(cls, "dtype", expression_dtype, MRB_ARGS_NONE());
+	mrb->define_method(cls, "inspect", expression_inspect,
+	    MRB_ARGS_NONE());
+	mrb->define_method(cls, "to_s", expression_inspect, MRB_ARGS_NONE());
+	return cls;
+}
@@ -0,0 +1,105 @@
+/* SPDX-License-Identifier: ISC */
+
+#ifndef EULER_MATH_EXPRESSION_H
+#define EULER_MATH_EXPRESSION_H
+
+#include <memory>
+
+#include "euler/math/matrix.h"
+
+namespace euler::math {
+
+/* Unevaluated arithmetic on matrices, built by Matrix's Ruby operators so
+ * that `a * b + c * 2` costs one evaluation instead of a temporary per
+ * operator. Evaluation flattens the tree into a sum of scaled terms: runs of
+ * plain terms are added in a single fused Eigen loop, and each matrix product
+ * accumulates straight into the result through Eigen's GEMM, scale and
+ * transposes included. Only operands that are themselves compound, such as
+ * the (a + b) in (a + b) * c, get a temporary.
+ *
+ * Integer matrices stay integer under whole-number scalars; any other
+ * scalar makes the node Double, so int_matrix * 0.5 isn't truncated to zero.
+ *
+ * Leaves hold references, not copies: changing a matrix before evaluating an
+ * expression that uses it changes the result. Reshaping or retyping one
+ * makes the expression stale, and evaluating it raises ArgumentError. */
+class Expression final : public util::Object {
+	BIND_MRUBY("Euler::Math::Expression", Expression, math.expression);
+
+public:
+	enum class Op {
+		Matrix,
+		Scalar,
+		Add,
+		Subtract,
+		/* matrix product, or scaling when either side is a scalar */
+		Multiply,
+		/* by a scalar */
+		Divide,
+		Negate,
+		Transpose,
+	};
+
+	struct Node;
+	using NodePtr = std::shared_ptr<const Node>;
+
+	struct Node {
+		Op op;
+		Matrix::Type type = Matrix::Type::Double;
+		/* 0 by 0 for scalars, which broadcast */
+		size_type rows = 0;
+		size_type columns = 0;
+		util::Reference<Matrix> matrix;
+		double scalar = 0.0;
+		NodePtr lhs;
+		NodePtr rhs;
+
+		[[nodiscard]] bool
+		is_scalar() const
+		{
+			return op == Op::Scalar;
+		}
+	};
+
+	static NodePtr leaf(const util::Reference<Matrix> &matrix);
+	static NodePtr scalar(double value);
+	/* Returns nullptr if the shapes don't conform. */
+	static NodePtr binary(Op op, NodePtr lhs, NodePtr rhs);
+	static NodePtr unary(Op op, NodePtr operand);
+	/* A node for a Ruby number, Matrix or Expression; raises TypeError for
+	 * anything else. */
+	static NodePtr read(mrb_state *mrb, mrb_value value);
+	/* The operators shared by Matrix and Expression. */
+	static void define_arithmetic(const util::Reference<util::State> &state,
+	    RClass *cls);
+
+	explicit Expression(NodePtr root)
+	    : _root(std::move(root))
+	{
+	}
+
+	[[nodiscard]] const NodePtr &
+	root() const
+	{
+		return _root;
+	}
+
+	/* Whether every matrix still has the shape and type it had when the
+	 * expression was built; evaluating requires it. */
+	[[nodiscard]] bool is_current() const;
+	[[nodiscard]] util::Reference<Matrix> evaluate() const;
+	/* Writes the result into target, reusing its storage when the
+	 * expression doesn't read from it. */
+	void evaluate_into(Matrix &target) const;
+	/* what Ruby raises with, as ArgumentError, when !is_current() */
+	static constexpr auto STALE_ERROR
+	    = "A matrix in the expression was reshaped after it was built";
+	[[nodiscard]] bool references(const Matrix *matrix) const;
+
+private:
+	NodePtr _root;
+};
+
+} /* namespace euler::math */
+
+#endif /* EULER_MATH_EXPRESSION_H */
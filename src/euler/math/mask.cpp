@@ -0,0 +1,332 @@
+/* SPDX-License-Identifier: ISC */
+
+#include "euler/math/mask.h"
+
+#include <algorithm>
+#include <cstdio>
+
+#include <mruby/array.h>
+
+#include "euler/util/state.h"
+
+using euler::math::Mask;
+
+Mask::Mask(const util::size_type rows, const util::size_type columns,
+    const bool value)
+{
+	resize(rows, columns);
+	if (value) fill(true);
+}
+
+void
+Mask::resize(const util::size_type rows, const util::size_type columns)
+{
+	_rows = rows;
+	_columns = columns;
+	_words.assign((size() + WORD_BITS - 1) / WORD_BITS, 0);
+}
+
+void
+Mask::fill(const bool value)
+{
+	std::fill(_words.begin(), _words.end(), value ? ~Word(0) : Word(0));
+	clear_tail();
+}
+
+void
+Mask::assign(const Mask &other)
+{
+	_rows = other._rows;
+	_columns = other._columns;
+	_words = other._words;
+}
+
+void
+Mask::clear_tail()
+{
+	const auto used = size() % WORD_BITS;
+	if (used != 0) _words.back() &= (Word(1) << used) - 1;
+}
+
+size_t
+Mask::count(const size_t begin, const size_t end) const
+{
+	size_t out = 0;
+	const auto last = (end + WORD_BITS - 1) / WORD_BITS;
+	for (size_t i = begin / WORD_BITS; i < last; ++i)
+		out += std::popcount(_words[i]);
+	return out;
+}
+
+bool
+Mask::any() const
+{
+	return std::any_of(_words.begin(), _words.end(),
+	    [](const Word word) { return word != 0; });
+}
+
+Mask &
+Mask::operator&=(const Mask &other)
+{
+	for (size_t i = 0; i < _words.size(); ++i) _words[i] &= other._words[i];
+	return *this;
+}
+
+Mask &
+Mask::operator|=(const Mask &other)
+{
+	for (size_t i = 0; i < _words.size(); ++i) _words[i] |= other._words[i];
+	return *this;
+}
+
+Mask &
+Mask::operator^=(const Mask &other)
+{
+	for (size_t i = 0; i < _words.size(); ++i) _words[i] ^= other._words[i];
+	return *this;
+}
+
+void
+Mask::invert()
+{
+	for (auto &word : _words) word = ~word;
+	clear_tail();
+}
+
+static mrb_value
+mask_allocate(mrb_state *mrb, mrb_value)
+{
+	const auto state = euler::util::State::get(mrb);
+	auto mask = euler::util::make_reference<Mask>();
+	return state->wrap(mask);
+}
+
+/**
+ * @overload Euler::Math::Mask#initialize(rows, columns, value = false)
+ *   Masks are usually made by comparing matrices, as in `m > 0`.
+ *   @param rows [Integer] The number of rows.
+ *   @param columns [Integer] The number of columns.
+ *   @param value [Boolean] The initial value of every element.
+ */
+static mrb_value
+mask_initialize(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	mrb_int rows, columns;
+	mrb_bool value = false;
+	state->mrb()->get_args("ii|b", &rows, &columns, &value);
+	if (rows < 0 || columns < 0) {
+		state->mrb()->raise(state->mrb()->argument_error(),
+		    "Mask dimensions must not be negative");
+	}
+	auto mask = euler::util::Reference<Mask>::unwrap(mrb, self);
+	mask->resize(rows, columns);
+	if (value) mask->fill(true);
+	return mrb_nil_value();
+}
+
+static mrb_value
+mask_row_count(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	const auto mask = euler::util::Reference<Mask>::unwrap(mrb, self);
+	return state->mrb()->int_value(mask->row_count());
+}
+
+static mrb_value
+mask_column_count(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	const auto mask = euler::util::Reference<Mask>::unwrap(mrb, self);
+	return state->mrb()->int_value(mask->column_count());
+}
+
+static mrb_value
+mask_size(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	const auto mask = euler::util::Reference<Mask>::unwrap(mrb, self);
+	return state->mrb()->int_value(static_cast<mrb_int>(mask->size()));
+}
+
+/**
+ * @overload Euler::Math::Mask#count
+ *   @return [Integer] The number of true elements.
+ */
+static mrb_value
+mask_count(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	const auto mask = euler::util::Reference<Mask>::unwrap(mrb, self);
+	return state->mrb()->int_value(static_cast<mrb_int>(mask->count()));
+}
+
+static mrb_value
+mask_any(mrb_state *mrb, const mrb_value self)
+{
+	const auto mask = euler::util::Reference<Mask>::unwrap(mrb, self);
+	return mrb_bool_value(mask->any());
+}
+
+static mrb_value
+mask_all(mrb_state *mrb, const mrb_value self)
+{
+	const auto mask = euler::util::Reference<Mask>::unwrap(mrb, self);
+	return mrb_bool_value(mask->all());
+}
+
+/**
+ * @overload Euler::Math::Mask#[](row, column)
+ *   @return [Boolean] The element.
+ *   @raise [IndexError] If the element is outside the mask.
+ */
+static mrb_value
+mask_get(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	mrb_int row, column;
+	state->mrb()->get_args("ii", &row, &column);
+	mrb_int rows, columns;
+	{
+		const auto mask = state->unwrap<Mask>(self);
+		rows = mask->row_count();
+		columns = mask->column_count();
+		if (row >= 0 && row < rows && column >= 0 && column < columns) {
+			const auto index = column * rows + row;
+			return mrb_bool_value(mask->get(index));
+		}
+	}
+	state->mrb()->raisef(state->mrb()->index_error(),
+	    "Index (%i, %i) outside of a %ix%i mask", row, column, rows,
+	    columns);
+}
+
+/**
+ * @overload Euler::Math::Mask#&(other)
+ *   Like | and ^, combines two masks of the same shape element by element.
+ *   @param other [Euler::Math::Mask]
+ *   @return [Euler::Math::Mask]
+ */
+template <typename F>
+static mrb_value
+mask_combine(mrb_state *mrb, const mrb_value self, const F &combine)
+{
+	const auto state = euler::util::State::get(mrb);
+	mrb_value other_value;
+	state->mrb()->get_args("o", &other_value);
+	{
+		const auto mask = state->unwrap<Mask>(self);
+		const auto other = state->unwrap<Mask>(other_value);
+		const auto rows = mask->row_count();
+		if (other->same_shape(rows, mask->column_count())) {
+			auto out = euler::util::make_reference<Mask>();
+			out->assign(*mask.get());
+			combine(*out.get(), *other.get());
+			return state->wrap(out);
+		}
+	}
+	state->mrb()->raise(state->mrb()->argument_error(),
+	    "Cannot combine masks of different shapes");
+}
+
+static mrb_value
+mask_and(mrb_state *mrb, const mrb_value self)
+{
+	return mask_combine(mrb, self,
+	    [](Mask &out, const Mask &other) { out &= other; });
+}
+
+static mrb_value
+mask_or(mrb_state *mrb, const mrb_value self)
+{
+	return mask_combine(mrb, self,
+	    [](Mask &out, const Mask &other) { out |= other; });
+}
+
+static mrb_value
+mask_xor(mrb_state *mrb, const mrb_value self)
+{
+	return mask_combine(mrb, self,
+	    [](Mask &out, const Mask &other) { out ^= other; });
+}
+
+/**
+ * @overload Euler::Math::Mask#~
+ *   @return [Euler::Math::Mask] A mask with every element negated.
+ */
+static mrb_value
+mask_invert(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	const auto mask = state->unwrap<Mask>(self);
+	auto out = euler::util::make_reference<Mask>();
+	out->assign(*mask.get());
+	out->invert();
+	return state->wrap(out);
+}
+
+/**
+ * @overload Euler::Math::Mask#to_a
+ *   @return [Array<Array<Boolean>>] The rows of the mask.
+ */
+static mrb_value
+mask_to_a(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	const auto mask = state->unwrap<Mask>(self);
+	const auto &ruby = state->mrb();
+	const auto rows = mask->row_count();
+	const auto out = ruby->ary_new_capa(rows);
+	for (euler::util::size_type i = 0; i < rows; ++i) {
+		const auto row = ruby->ary_new_capa(mask->column_count());
+		for (euler::util::size_type j = 0; j < mask->column_count();
+		    ++j) {
+			const auto index = static_cast<size_t>(j * rows + i);
+			ruby->ary_push(row, mrb_bool_value(mask->get(index)));
+		}
+		ruby->ary_push(out, row);
+	}
+	return out;
+}
+
+static mrb_value
+mask_to_s(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	const auto mask = state->unwrap<Mask>(self);
+	char buf[96];
+	const auto len = snprintf(buf, sizeof(buf), "Mask(%lldx%lld, %zu set)",
+	    static_cast<long long>(mask->row_count()),
+	    static_cast<long long>(mask->column_count()), mask->count());
+	return state->mrb()->str_new(buf, len);
+}
+
+RClass *
+Mask::init(const util::Reference<util::State> &state, RClass *mod,
+    RClass *super)
+{
+	const auto &mrb = state->mrb();
+	const auto cls = mrb->define_class_under(mod, "Mask",
+	    super != nullptr ? super : state->object_class());
+	MRB_SET_INSTANCE_TT(cls, MRB_TT_DATA);
+	mrb->define_class_method(cls, "allocate", mask_allocate,
+	    MRB_ARGS_NONE());
+	mrb->define_method(cls, "initialize", mask_initialize,
+	    MRB_ARGS_ARG(2, 1));
+	mrb->define_method(cls, "row_count", mask_row_count, MRB_ARGS_NONE());
+	mrb->define_method(cls, "column_count", mask_column_count,
+	    MRB_ARGS_NONE());
+	mrb->define_method(cls, "size", mask_size, MRB_ARGS_NONE());
+	mrb->define_method(cls, "count", mask_count, MRB_ARGS_NONE());
+	mrb->define_method(cls, "any?", mask_any, MRB_ARGS_NONE());
+	mrb->define_method(cls, "all?", mask_all, MRB_ARGS_NONE());
+	mrb->define_method(cls, "[]", mask_get, MRB_ARGS_REQ(2));
+	mrb->define_method(cls, "&", mask_and, MRB_ARGS_REQ(1));
+	mrb->define_method(cls, "|", mask_or, MRB_ARGS_REQ(1));
+	mrb->define_method(cls, "^", mask_xor, MRB_ARGS_REQ(1));
+	mrb->define_method(cls, "~", mask_invert, MRB_ARGS_NONE());
+	mrb->define_method(cls, "to_a", mask_to_a, MRB_ARGS_NONE());
+	mrb->define_method(cls, "to_s", mask_to_s, MRB_ARGS_NONE());
+	mrb->define_method(cls, "inspect", mask_to_s, MRB_ARGS_NONE());
+	return cls;
+}
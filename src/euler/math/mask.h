@@ -0,0 +1,120 @@
+/* SPDX-License-Identifier: ISC */
+
+#ifndef EULER_MATH_MASK_H
+#define EULER_MATH_MASK_H
+
+#include <bit>
+#include <cstdint>
+#include <vector>
+
+#include "euler/util/ext.h"
+#include "euler/util/object.h"
+#include "euler/util/types.h"
+
+namespace euler::math {
+
+/* One bit per coefficient of a matrix, in the same column-major order, as
+ * produced by Matrix's comparison operators. Bits past the last coefficient
+ * are always clear, so whole words can be counted and combined directly. */
+class Mask final : public util::Object {
+	BIND_MRUBY("Euler::Math::Mask", Mask, math.mask);
+
+public:
+	using Word = uint64_t;
+	static constexpr size_t WORD_BITS = 64;
+
+	Mask() = default;
+	Mask(util::size_type rows, util::size_type columns, bool value = false);
+
+	[[nodiscard]] util::size_type
+	row_count() const
+	{
+		return _rows;
+	}
+
+	[[nodiscard]] util::size_type
+	column_count() const
+	{
+		return _columns;
+	}
+
+	[[nodiscard]] size_t
+	size() const
+	{
+		return static_cast<size_t>(_rows * _columns);
+	}
+
+	/* Every bit clear. */
+	void resize(util::size_type rows, util::size_type columns);
+	void fill(bool value);
+	/* Takes other's shape and bits. */
+	void assign(const Mask &other);
+
+	[[nodiscard]] bool
+	get(const size_t index) const
+	{
+		return (_words[index / WORD_BITS] >> (index % WORD_BITS)) & 1;
+	}
+
+	void
+	set(const size_t index, const bool value)
+	{
+		const auto bit = Word(1) << (index % WORD_BITS);
+		if (value) _words[index / WORD_BITS] |= bit;
+		else _words[index / WORD_BITS] &= ~bit;
+	}
+
+	[[nodiscard]] Word *
+	words()
+	{
+		return _words.data();
+	}
+
+	[[nodiscard]] const Word *
+	words() const
+	{
+		return _words.data();
+	}
+
+	/* Set bits among coefficients [begin, end); begin must be a multiple
+	 * of WORD_BITS. */
+	[[nodiscard]] size_t count(size_t begin, size_t end) const;
+
+	[[nodiscard]] size_t
+	count() const
+	{
+		return count(0, size());
+	}
+
+	[[nodiscard]] bool any() const;
+
+	[[nodiscard]] bool
+	all() const
+	{
+		return count() == size();
+	}
+
+	[[nodiscard]] bool
+	same_shape(const util::size_type rows,
+	    const util::size_type columns) const
+	{
+		return _rows == rows && _columns == columns;
+	}
+
+	/* The other mask must have the same shape. */
+	Mask &operator&=(const Mask &other);
+	Mask &operator|=(const Mask &other);
+	Mask &operator^=(const Mask &other);
+	void invert();
+
+private:
+	void clear_tail();
+
+	util::size_type _rows = 0;
+	util::size_type _columns = 0;
+	std::vector<Word> _words;
+};
+
+} /* namespace euler::math */
+
+#endif /* EULER_MATH_MASK_H */
@@ -2,152 +2,36 @@
 
 #include "euler/math/math.h"
 
-using namespace euler;
-using namespace euler::math;
-
-
-using size_type = util::size_type;
-static constexpr auto Dynamic = util::Dynamic;
-
-class Matrix : public util::Object {
-	BIND_MRUBY("Euler::Math::Matrix", Matrix, math.matrix);
-
-public:
-	enum class Type {
-		Float,
-		Double,
-		Int16,
-		Int32,
-		Int64,
-		UInt16,
-		UInt32,
-		UInt64,
-	};
-	[[nodiscard]] virtual Type type() const = 0;
-	[[nodiscard]] virtual bool is_fixed() const = 0;
-	[[nodiscard]] virtual bool is_row_vector() const = 0;
-	[[nodiscard]] virtual bool is_vector() const = 0;
-	[[nodiscard]] virtual size_type row_count() const = 0;
-	[[nodiscard]] virtual size_type column_count() const = 0;
-	[[nodiscard]] virtual util::Reference<Matrix> size() const = 0;
-	[[nodiscard]] virtual std::string to_string() const = 0;
-};
-
-template <size_type Rows, size_type Columns> class SizedMatrix : public Matrix {
-public:
-	static_assert(Rows != Dynamic && Columns != Dynamic);
-
-	[[nodiscard]] size_type
-	row_count() const override
-	{
-		return Rows;
-	}
-
-	size_type
-	column_count() const override
-	{
-		return Columns;
-	}
-
-	bool
-	is_fixed() const override
-	{
-		return true;
-	}
-};
-
-template <> class SizedMatrix<Dynamic, Dynamic> : public Matrix {
-public:
-	size_type
-	row_count() const override
-	{
-		return _row_count;
-	}
-
-	size_type
-	column_count() const override
-	{
-		return _column_count;
-	}
-
-	bool
-	is_fixed() const override
-	{
-		return false;
-	}
-
-	bool
-	is_row_vector() const override
-	{
-		return false;
-	}
-
-	bool
-	is_vector() const override
-	{
-		return false;
-	}
-
-private:
-	size_type _row_count = 0;
-	size_type _column_count = 0;
-};
-
-template <> class SizedMatrix<Dynamic, 1> : public Matrix {
-public:
-	size_type
-	row_count() const override
-	{
-		return _row_count;
-	}
-
-	size_type
-	column_count() const override
-	{
-		return 1;
-	}
-
-private:
-	size_type _row_count = 0;
-};
-
-template <> class SizedMatrix<1, Dynamic> : public Matrix {
-public:
-	size_type
-	row_count() const override
-	{
-		return 1;
-	}
-
-	size_type
-	column_count() const override
-	{
-		return _column_count;
-	}
-
-private:
-	size_type _column_count = 0;
-};
-
-template <typename T = float, size_type Rows = Dynamic,
-    size_type Columns = Dynamic>
-class MatrixImpl : public SizedMatrix<Rows, Columns> {
-	static constexpr bool is_fixed = Rows != Dynamic && Columns != Dynamic;
-
-public:
-	typedef T value_type;
-	static constexpr size_type row_count = Rows;
-	static constexpr size_type column_count = Columns;
-	typedef Eigen::Matrix<value_type, row_count, column_count> matrix_type;
-
-private:
-	matrix_type _matrix;
-};
-
-template <typename T = float, size_type Rows = Dynamic>
-using Vector = MatrixImpl<T, Rows, 1>;
-
-template <typename T = float, size_type Columns = Dynamic>
-using RowVector = MatrixImpl<T, 1, Columns>;
-
-
+#include "euler/math/cube.h"
+#include "euler/math/expression.h"
+#include "euler/math/mask.h"
+#include "euler/math/matrix.h"
+#include "euler/math/random.h"
+#include "euler/math/running_statistic.h"
+#include "euler/math/small.h"
+#include "euler/math/sparse_matrix.h"
+#include "euler/math/sparse_solve_factorizer.h"
+#include "euler/util/state.h"
+
+RClass *
+euler::math::init(const util::Reference<util::State> &state, RClass *mod,
+    RClass *)
+{
+	const auto &mrb = state->mrb();
+	auto &math = state->modules().math;
+	math.mod = mrb->define_module_under(mod, "Math");
+	math.nonscalar = mrb->define_class_under(math.mod, "Nonscalar",
+	    state->object_class());
+	math.cube = Cube::init(state, math.mod, math.nonscalar);
+	math.cube_view = CubeView::init(state, math.mod);
+	math.expression = Expression::init(state, math.mod);
+	math.mask = Mask::init(state, math.mod);
+	math.matrix = Matrix::init(state, math.mod, math.nonscalar);
+	math.random = Random::init(state, math.mod);
+	math.running_stat = RunningStatistic::init(state, math.mod);
+	math.sparse_matrix = SparseMatrix::init(state, math.mod);
+	math.sparse_solve_factorizer = SparseSolveFactorizer::init(state,
+	    math.mod);
+	init_small(state, math.mod);
+	return math.mod;
+}
@@ -2,3 +2,642 @@
 
 #include "euler/math/matrix.h"
 
+#include <cstdio>
+#include <sstream>
+
+#include <mruby/array.h>
+#include <mruby/range.h>
+
+#include "euler/math/expression.h"
+#include "euler/math/mask.h"
+#include "euler/math/transform2d.h"
+#include "euler/math/ufunc.h"
+#include "euler/util/math.h"
+#include "euler/util/state.h"
+
+using euler::math::DenseMatrix;
+using euler::math::Expression;
+using euler::math::Matrix;
+using euler::math::size_type;
+namespace ufunc = euler::math::ufunc;
+using Type = Matrix::Type;
+
+static constexpr const char *TYPE_NAMES[] = {
+	"float",
+	"double",
+	"int16",
+	"int32",
+	"int64",
+	"uint16",
+	"uint32",
+	"uint64",
+};
+
+const char *
+Matrix::type_name(const Type type)
+{
+	return TYPE_NAMES[static_cast<size_t>(type)];
+}
+
+std::optional<Type>
+Matrix::parse_type(const std::string_view name)
+{
+	for (size_t i = 0; i < std::size(TYPE_NAMES); ++i)
+		if (name == TYPE_NAMES[i]) return static_cast<Type>(i);
+	return std::nullopt;
+}
+
+static bool
+is_floating(const Type type)
+{
+	return type == Type::Float || type == Type::Double;
+}
+
+static bool
+is_signed(const Type type)
+{
+	return type == Type::Int16 || type == Type::Int32
+	    || type == Type::Int64 || is_floating(type);
+}
+
+static int
+width(const Type type)
+{
+	switch (type) {
+	case Type::Int16:
+	case Type::UInt16: return 16;
+	case Type::Float:
+	case Type::Int32:
+	case Type::UInt32: return 32;
+	default: return 64;
+	}
+}
+
+Type
+Matrix::promote(const Type a, const Type b)
+{
+	if (a == b) return a;
+	if (is_floating(a) || is_floating(b)) {
+		/* float only holds integers up to 16 bits exactly */
+		const auto other = is_floating(a) ? b : a;
+		if (a == Type::Double || b == Type::Double) return Type::Double;
+		return width(other) <= 16 ? Type::Float : Type::Double;
+	}
+	const auto bits = std::max(width(a), width(b));
+	if (is_signed(a) == is_signed(b)) return width(a) == bits ? a : b;
+	/* mixed signedness needs room for the unsigned side's range */
+	const auto unsigned_bits = is_signed(a) ? width(b) : width(a);
+	if (unsigned_bits < bits) return is_signed(a) ? a : b;
+	return unsigned_bits == 16 ? Type::Int32 : Type::Int64;
+}
+
+Matrix::Matrix(const size_type rows, const size_type columns, const Type type)
+{
+	resize(rows, columns, type);
+}
+
+size_type
+Matrix::row_count() const
+{
+	return std::visit([](const auto &m) { return m.rows(); }, _storage);
+}
+
+size_type
+Matrix::column_count() const
+{
+	return std::visit([](const auto &m) { return m.cols(); }, _storage);
+}
+
+void
+Matrix::resize(const size_type rows, const size_type columns, const Type type)
+{
+	visit_type(type, [&]<typename T>(T) {
+		_storage = DenseMatrix<T>(DenseMatrix<T>::Zero(rows, columns));
+	});
+}
+
+std::string
+Matrix::to_string() const
+{
+	std::ostringstream out;
+	static const Eigen::IOFormat FORMAT(Eigen::StreamPrecision,
+	    Eigen::DontAlignCols, ", ", ", ", "[", "]", "[", "]");
+	out << "Matrix(" << row_count() << "x" << column_count() << " "
+	    << type_name(type()) << ")";
+	std::visit(
+	    [&](const auto &m) {
+		    /* int16 would otherwise print as characters on some
+		     * platforms; widen everything integral */
+		    using T = typename std::decay_t<decltype(m)>::Scalar;
+		    if constexpr (std::is_floating_point_v<T>) {
+			    out << m.format(FORMAT);
+		    } else if constexpr (std::is_signed_v<T>) {
+			    out << m.template cast<int64_t>().format(FORMAT);
+		    } else {
+			    out << m.template cast<uint64_t>().format(FORMAT);
+		    }
+	    },
+	    _storage);
+	return out.str();
+}
+
+/* Converts a Ruby number to an element; integers wrap the way a C cast does,
+ * so -1 becomes the largest value of an unsigned type. */
+template <typename T>
+static T
+read_element(mrb_state *mrb, const mrb_value value)
+{
+	const auto state = euler::util::State::get(mrb);
+	if constexpr (std::is_floating_point_v<T>) {
+		return static_cast<T>(state->mrb()->to_flo(value));
+	} else {
+		return static_cast<T>(mrb_integer(state->mrb()->to_int(value)));
+	}
+}
+
+static Type
+read_type(mrb_state *mrb, const mrb_sym sym)
+{
+	const auto state = euler::util::State::get(mrb);
+	const auto name = state->mrb()->sym_name(sym);
+	const auto type = Matrix::parse_type(name);
+	if (!type.has_value()) {
+		state->mrb()->raisef(state->mrb()->argument_error(),
+		    "Unknown matrix type %s", name);
+	}
+	return *type;
+}
+
+static void
+check_size(mrb_state *mrb, const mrb_int rows, const mrb_int columns)
+{
+	if (rows >= 0 && columns >= 0) return;
+	const auto state = euler::util::State::get(mrb);
+	state->mrb()->raise(state->mrb()->argument_error(),
+	    "Matrix dimensions must not be negative");
+}
+
+/* Wraps a new matrix before anything can raise, so that an error while
+ * filling it in leaves the garbage collector to free it. */
+static mrb_value
+new_matrix(mrb_state *mrb, const size_type rows, const size_type columns,
+    const Type type, Matrix *&matrix)
+{
+	const auto state = euler::util::State::get(mrb);
+	auto ref = euler::util::make_reference<Matrix>(rows, columns, type);
+	matrix = ref.get();
+	return state->wrap(ref);
+}
+
+static mrb_value
+matrix_allocate(mrb_state *mrb, mrb_value)
+{
+	const auto state = euler::util::State::get(mrb);
+	auto matrix = euler::util::make_reference<Matrix>();
+	return state->wrap(matrix);
+}
+
+/**
+ * @overload Euler::Math::Matrix#initialize(rows, columns, type = :double)
+ *   Creates a zero-filled matrix.
+ *   @param rows [Integer] The number of rows.
+ *   @param columns [Integer] The number of columns.
+ *   @param type [Symbol] The element type: :float, :double, :int16,
+ *     :int32, :int64, :uint16, :uint32 or :uint64.
+ */
+static mrb_value
+matrix_initialize(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	mrb_int rows, columns;
+	mrb_sym type = EULER_SYM(double);
+	state->mrb()->get_args("ii|n", &rows, &columns, &type);
+	check_size(mrb, rows, columns);
+	const auto parsed = read_type(mrb, type);
+	auto matrix = euler::util::Reference<Matrix>::unwrap(mrb, self);
+	matrix->resize(rows, columns, parsed);
+	return mrb_nil_value();
+}
+
+/* Fills a new matrix from an array of rows, or from a flat array as a column
+ * vector. */
+static mrb_value
+matrix_from_rows(mrb_state *mrb, const mrb_value *rows, const mrb_int count,
+    const Type type)
+{
+	const auto state = euler::util::State::get(mrb);
+	const bool nested = count > 0 && mrb_array_p(rows[0]);
+	const mrb_int columns = !nested ? 1 : RARRAY_LEN(rows[0]);
+	for (mrb_int i = 0; nested && i < count; ++i) {
+		if (!mrb_array_p(rows[i]) || RARRAY_LEN(rows[i]) != columns) {
+			state->mrb()->raise(state->mrb()->argument_error(),
+			    "Matrix rows must be arrays of the same length");
+		}
+	}
+	Matrix *matrix;
+	const auto out = new_matrix(mrb, count, columns, type, matrix);
+	Matrix::visit_type(type, [&]<typename T>(T) {
+		auto &m = matrix->as<T>();
+		for (mrb_int i = 0; i < count; ++i) {
+			if (!nested) {
+				m(i, 0) = read_element<T>(mrb, rows[i]);
+				continue;
+			}
+			const auto row = RARRAY_PTR(rows[i]);
+			for (mrb_int j = 0; j < columns; ++j)
+				m(i, j) = read_element<T>(mrb, row[j]);
+		}
+	});
+	return out;
+}
+
+/**
+ * @overload Euler::Math::Matrix.[](*rows)
+ *   Creates a double matrix from its rows.
+ *   @example
+ *     Euler::Math::Matrix[[1, 2], [3, 4]]
+ *   @param rows [Array<Array<Numeric>>] The rows, all the same length.
+ *   @return [Euler::Math::Matrix]
+ */
+static mrb_value
+matrix_brackets(mrb_state *mrb, mrb_value)
+{
+	const auto state = euler::util::State::get(mrb);
+	mrb_value *rows;
+	mrb_int count;
+	state->mrb()->get_args("*", &rows, &count);
+	return matrix_from_rows(mrb, rows, count, Type::Double);
+}
+
+/**
+ * @overload Euler::Math::Matrix.from_a(array, type = :double)
+ *   Creates a matrix from an array of rows. A flat array becomes a column
+ *   vector.
+ *   @param array [Array<Array<Numeric>>, Array<Numeric>] The elements.
+ *   @param type [Symbol] The element type.
+ *   @return [Euler::Math::Matrix]
+ */
+static mrb_value
+matrix_from_a(mrb_state *mrb, mrb_value)
+{
+	const auto state = euler::util::State::get(mrb);
+	mrb_value array;
+	mrb_sym type = EULER_SYM(double);
+	state->mrb()->get_args("A|n", &array, &type);
+	const auto parsed = read_type(mrb, type);
+	return matrix_from_rows(mrb, RARRAY_PTR(array), RARRAY_LEN(array),
+	    parsed);
+}
+
+/**
+ * @overload Euler::Math::Matrix.identity(size, type = :double)
+ *   @param size [Integer] The number of rows and columns.
+ *   @param type [Symbol] The element type.
+ *   @return [Euler::Math::Matrix] An identity matrix.
+ */
+static mrb_value
+matrix_identity(mrb_state *mrb, mrb_value)
+{
+	const auto state = euler::util::State::get(mrb);
+	mrb_int size;
+	mrb_sym type = EULER_SYM(double);
+	state->mrb()->get_args("i|n", &size, &type);
+	check_size(mrb, size, size);
+	const auto parsed = read_type(mrb, type);
+	Matrix *matrix;
+	const auto out = new_matrix(mrb, size, size, parsed, matrix);
+	Matrix::visit_type(parsed,
+	    [&]<typename T>(T) { matrix->as<T>().setIdentity(); });
+	return out;
+}
+
+template <int V>
+static mrb_value
+matrix_constant(mrb_state *mrb, mrb_value)
+{
+	const auto state = euler::util::State::get(mrb);
+	mrb_int rows, columns;
+	mrb_sym type = EULER_SYM(double);
+	state->mrb()->get_args("ii|n", &rows, &columns, &type);
+	check_size(mrb, rows, columns);
+	const auto parsed = read_type(mrb, type);
+	Matrix *matrix;
+	const auto out = new_matrix(mrb, rows, columns, parsed, matrix);
+	if constexpr (V != 0) {
+		Matrix::visit_type(parsed, [&]<typename T>(T) {
+			matrix->as<T>().setConstant(static_cast<T>(V));
+		});
+	}
+	return out;
+}
+
+static mrb_value
+matrix_dtype(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	const auto matrix = euler::util::Reference<Matrix>::unwrap(mrb, self);
+	const auto name = Matrix::type_name(matrix->type());
+	return mrb_symbol_value(state->mrb()->intern_cstr(name));
+}
+
+static mrb_value
+matrix_row_count(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	const auto matrix = euler::util::Reference<Matrix>::unwrap(mrb, self);
+	return state->mrb()->int_value(matrix->row_count());
+}
+
+static mrb_value
+matrix_column_count(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	const auto matrix = euler::util::Reference<Matrix>::unwrap(mrb, self);
+	return state->mrb()->int_value(matrix->column_count());
+}
+
+static void
+check_index(mrb_state *mrb, const Matrix &matrix, const mrb_int row,
+    const mrb_int column)
+{
+	if (row >= 0 && row < matrix.row_count() && column >= 0
+	    && column < matrix.column_count())
+		return;
+	const auto state = euler::util::State::get(mrb);
+	state->mrb()->raisef(state->mrb()->index_error(),
+	    "Index (%i, %i) outside of a %ix%i matrix", row, column,
+	    static_cast<mrb_int>(matrix.row_count()),
+	    static_cast<mrb_int>(matrix.column_count()));
+}
+
+/**
+ * @overload Euler::Math::Matrix#[](row, column)
+ *   @param row [Integer] The row index.
+ *   @param column [Integer] The column index.
+ *   @return [Numeric] The element.
+ *   @raise [IndexError] If the element is outside the matrix.
+ */
+static mrb_value
+matrix_get(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	mrb_int row, column;
+	state->mrb()->get_args("ii", &row, &column);
+	const auto matrix = state->unwrap<Matrix>(self);
+	check_index(mrb, *matrix.get(), row, column);
+	return std::visit(
+	    [&](const auto &m) {
+		    return euler::util::wrap_num(state->mrb(), m(row, column));
+	    },
+	    matrix->storage());
+}
+
+/* m[mask] = value */
+static mrb_value
+matrix_set_masked(mrb_state *mrb, const mrb_value self,
+    const mrb_value mask_value, const mrb_value value)
+{
+	const auto state = euler::util::State::get(mrb);
+	const char *error = "Mask and matrix shapes don't match";
+	{
+		auto matrix = state->unwrap<Matrix>(self);
+		const auto mask = state->unwrap<euler::math::Mask>(mask_value);
+		const auto rows = matrix->row_count();
+		const auto columns = matrix->column_count();
+		euler::util::Reference<Matrix> holder;
+		ufunc::Operand operand;
+		if (!ufunc::read_operand(mrb, value, operand, holder)) {
+			error = "Expected a Matrix or a number";
+		} else if (mask->same_shape(rows, columns)
+		    && (operand.matrix == nullptr
+			|| (operand.matrix->row_count() == rows
+			    && operand.matrix->column_count() == columns))) {
+			auto jobs = state->jobs();
+			ufunc::assign(*matrix.get(), *mask.get(), operand,
+			    jobs.get());
+			return value;
+		}
+	}
+	state->mrb()->raise(state->mrb()->argument_error(), error);
+}
+
+/**
+ * @overload Euler::Math::Matrix#[]=(row, column, value)
+ *   @param row [Integer] The row index.
+ *   @param column [Integer] The column index.
+ *   @param value [Numeric] The new element, converted to the matrix's type.
+ *   @raise [IndexError] If the element is outside the matrix.
+ * @overload Euler::Math::Matrix#[]=(mask, value)
+ *   Sets the elements where mask is set.
+ *   @param mask [Euler::Math::Mask] A mask of the same shape.
+ *   @param value [Euler::Math::Matrix, Numeric] A number, or a matrix of the
+ *     same shape to take the elements from.
+ */
+static mrb_value
+matrix_set(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	mrb_value first, second, value = mrb_nil_value();
+	const auto argc = state->mrb()->get_args("oo|o", &first, &second,
+	    &value);
+	if (argc == 2) return matrix_set_masked(mrb, self, first, second);
+	const auto row = mrb_integer(state->mrb()->to_int(first));
+	const auto column = mrb_integer(state->mrb()->to_int(second));
+	auto matrix = state->unwrap<Matrix>(self);
+	check_index(mrb, *matrix.get(), row, column);
+	Matrix::visit_type(matrix->type(), [&]<typename T>(T) {
+		matrix->as<T>()(row, column) = read_element<T>(mrb, value);
+	});
+	return value;
+}
+
+/**
+ * @overload Euler::Math::Matrix#to_a
+ *   @return [Array<Array<Numeric>>] The rows of the matrix.
+ */
+static mrb_value
+matrix_to_a(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	const auto matrix = state->unwrap<Matrix>(self);
+	const auto &ruby = state->mrb();
+	const auto out = ruby->ary_new_capa(matrix->row_count());
+	std::visit(
+	    [&](const auto &m) {
+		    for (size_type i = 0; i < m.rows(); ++i) {
+			    const auto row = ruby->ary_new_capa(m.cols());
+			    for (size_type j = 0; j < m.cols(); ++j) {
+				    ruby->ary_push(row,
+					euler::util::wrap_num(ruby, m(i, j)));
+			    }
+			    ruby->ary_push(out, row);
+		    }
+	    },
+	    matrix->storage());
+	return out;
+}
+
+/**
+ * @overload Euler::Math::Matrix#fill(value)
+ *   Sets every element to value.
+ *   @param value [Numeric] The new value.
+ *   @return [self]
+ */
+static mrb_value
+matrix_fill(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	mrb_value value;
+	state->mrb()->get_args("o", &value);
+	auto matrix = state->unwrap<Matrix>(self);
+	Matrix::visit_type(matrix->type(), [&]<typename T>(T) {
+		matrix->as<T>().setConstant(read_element<T>(mrb, value));
+	});
+	return self;
+}
+
+/**
+ * @overload Euler::Math::Matrix#clamp(min, max)
+ *   Limits every element to the range [min, max], in place.
+ *   @param min [Numeric] The lower bound.
+ *   @param max [Numeric] The upper bound.
+ *   @return [self]
+ * @overload Euler::Math::Matrix#clamp(range)
+ *   @param range [Range] The bounds, both inclusive.
+ *   @return [self]
+ */
+static mrb_value
+matrix_clamp(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	mrb_value min, max = mrb_nil_value();
+	const auto argc = state->mrb()->get_args("o|o", &min, &max);
+	if (argc == 1) {
+		if (!mrb_range_p(min)) {
+			state->mrb()->raise(state->mrb()->type_error(),
+			    "Expected a Range or two numbers");
+		}
+		const auto range = state->mrb()->range_ptr(min);
+		min = RANGE_BEG(range);
+		max = RANGE_END(range);
+	}
+	const auto lo = state->mrb()->to_flo(min);
+	const auto hi = state->mrb()->to_flo(max);
+	auto matrix = state->unwrap<Matrix>(self);
+	auto jobs = state->jobs();
+	ufunc::clamp(*matrix.get(), lo, hi, jobs.get());
+	return self;
+}
+
+/**
+ * @overload Euler::Math::Matrix#assign(expression)
+ *   Evaluates an expression into this matrix, reusing its storage when the
+ *   type matches and the expression doesn't read from it. The matrix takes
+ *   the expression's shape and type.
+ *   @param expression [Euler::Math::Expression, Euler::Math::Matrix]
+ *   @return [self]
+ */
+static mrb_value
+matrix_assign(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	mrb_value value;
+	state->mrb()->get_args("o", &value);
+	const char *error = nullptr;
+	RClass *error_class = nullptr;
+	{
+		const Expression expression(Expression::read(mrb, value));
+		auto matrix = state->unwrap<Matrix>(self);
+		if (expression.root()->is_scalar()) {
+			error = "Cannot assign a number to a matrix; use fill";
+			error_class = state->mrb()->type_error();
+		} else if (!expression.is_current()) {
+			error = Expression::STALE_ERROR;
+			error_class = state->mrb()->argument_error();
+		} else {
+			expression.evaluate_into(*matrix.get());
+		}
+	}
+	if (error != nullptr) state->mrb()->raise(error_class, error);
+	return self;
+}
+
+static mrb_value
+matrix_dup(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	const auto matrix = state->unwrap<Matrix>(self);
+	auto copy = euler::util::make_reference<Matrix>(matrix->storage());
+	return state->wrap(copy);
+}
+
+/**
+ * @overload Euler::Math::Matrix#cast(type)
+ *   @param type [Symbol] The element type of the copy.
+ *   @return [Euler::Math::Matrix] A copy converted to type.
+ */
+static mrb_value
+matrix_cast(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	mrb_sym type;
+	state->mrb()->get_args("n", &type);
+	const auto parsed = read_type(mrb, type);
+	const auto matrix = state->unwrap<Matrix>(self);
+	Matrix::Storage storage;
+	Matrix::visit_type(parsed,
+	    [&]<typename T>(T) { storage = matrix->template cast<T>(); });
+	auto copy = euler::util::make_reference<Matrix>(std::move(storage));
+	return state->wrap(copy);
+}
+
+static mrb_value
+matrix_to_s(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	const auto matrix = state->unwrap<Matrix>(self);
+	const auto str = matrix->to_string();
+	return state->mrb()->str_new(str.data(), str.size());
+}
+
+RClass *
+Matrix::init(const util::Reference<util::State> &state, RClass *mod,
+    RClass *super)
+{
+	const auto &mrb = state->mrb();
+	const auto cls = mrb->define_class_under(mod, "Matrix",
+	    super != nullptr ? super : state->object_class());
+	MRB_SET_INSTANCE_TT(cls, MRB_TT_DATA);
+	mrb->define_class_method(cls, "allocate", matrix_allocate,
+	    MRB_ARGS_NONE());
+	mrb->define_class_method(cls, "[]", matrix_brackets, MRB_ARGS_ANY());
+	mrb->define_class_method(cls, "from_a", matrix_from_a,
+	    MRB_ARGS_ARG(1, 1));
+	mrb->define_class_method(cls, "identity", matrix_identity,
+	    MRB_ARGS_ARG(1, 1));
+	mrb->define_class_method(cls, "zeros", matrix_constant<0>,
+	    MRB_ARGS_ARG(2, 1));
+	mrb->define_class_method(cls, "ones", matrix_constant<1>,
+	    MRB_ARGS_ARG(2, 1));
+	mrb->define_method(cls, "initialize", matrix_initialize,
+	    MRB_ARGS_ARG(2, 1));
+	mrb->define_method(cls, "dtype", matrix_dtype, MRB_ARGS_NONE());
+	mrb->define_method(cls, "row_count", matrix_row_count,
+	    MRB_ARGS_NONE());
+	mrb->define_method(cls, "column_count", matrix_column_count,
+	    MRB_ARGS_NONE());
+	mrb->define_method(cls, "[]", matrix_get, MRB_ARGS_REQ(2));
+	mrb->define_method(cls, "[]=", matrix_set, MRB_ARGS_ARG(2, 1));
+	mrb->define_method(cls, "to_a", matrix_to_a, MRB_ARGS_NONE());
+	mrb->define_method(cls, "fill", matrix_fill, MRB_ARGS_REQ(1));
+	mrb->define_method(cls, "clamp", matrix_clamp, MRB_ARGS_ARG(1, 1));
+	mrb->define_method(cls, "assign", matrix_assign, MRB_ARGS_REQ(1));
+	mrb->define_method(cls, "dup", matrix_dup, MRB_ARGS_NONE());
+	mrb->define_method(cls, "cast", matrix_cast, MRB_ARGS_REQ(1));
+	mrb->define_method(cls, "to_s", matrix_to_s, MRB_ARGS_NONE());
+	mrb->define_method(cls, "inspect", matrix_to_s, MRB_ARGS_NONE());
+	Expression::define_arithmetic(state, cls);
+	ufunc::define(state, cls);
+	transform2d::define(state, cls);
+	return cls;
+}
@@ -3,12 +3,177 @@
 #ifndef EULER_MATH_MATRIX_H
 #define EULER_MATH_MATRIX_H
 
+#include <optional>
+#include <string>
+#include <variant>
+
+#include <Eigen/Eigen>
+
+#include "euler/util/ext.h"
 #include "euler/util/object.h"
+#include "euler/util/types.h"
 
 namespace euler::math {
-class Matrix final : public util::Object { };
-} /* namespace euler::math */
 
+using size_type = util::size_type;
 
-#endif /* EULER_MATH_MATRIX_H */
+template <typename T>
+using DenseMatrix = Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic>;
+
+/* Dense, column-major matrix of any of the element types in Type. The element
+ * type is picked at runtime, so the storage is a variant over one Eigen matrix
+ * per type; code that does arithmetic visits it once and then runs fully
+ * typed. */
+class Matrix final : public util::Object {
+	BIND_MRUBY("Euler::Math::Matrix", Matrix, math.matrix);
+
+public:
+	/* in the same order as the alternatives of Storage */
+	enum class Type {
+		Float,
+		Double,
+		Int16,
+		Int32,
+		Int64,
+		UInt16,
+		UInt32,
+		UInt64,
+	};
+
+	using Storage = std::variant<DenseMatrix<float>, DenseMatrix<double>,
+	    DenseMatrix<int16_t>, DenseMatrix<int32_t>, DenseMatrix<int64_t>,
+	    DenseMatrix<uint16_t>, DenseMatrix<uint32_t>,
+	    DenseMatrix<uint64_t>>;
+
+	template <typename T>
+	static constexpr Type
+	type_of()
+	{
+		if constexpr (std::is_same_v<T, float>) return Type::Float;
+		else if constexpr (std::is_same_v<T, double>)
+			return Type::Double;
+		else if constexpr (std::is_same_v<T, int16_t>)
+			return Type::Int16;
+		else if constexpr (std::is_same_v<T, int32_t>)
+			return Type::Int32;
+		else if constexpr (std::is_same_v<T, int64_t>)
+			return Type::Int64;
+		else if constexpr (std::is_same_v<T, uint16_t>)
+			return Type::UInt16;
+		else if constexpr (std::is_same_v<T, uint32_t>)
+			return Type::UInt32;
+		else return Type::UInt64;
+	}
+
+	/* Calls fn with a value of the element type that type names. */
+	template <typename F>
+	static void
+	visit_type(const Type type, F &&fn)
+	{
+		switch (type) {
+		case Type::Float: fn(float {}); break;
+		case Type::Double: fn(double {}); break;
+		case Type::Int16: fn(int16_t {}); break;
+		case Type::Int32: fn(int32_t {}); break;
+		case Type::Int64: fn(int64_t {}); break;
+		case Type::UInt16: fn(uint16_t {}); break;
+		case Type::UInt32: fn(uint32_t {}); break;
+		case Type::UInt64: fn(uint64_t {}); break;
+		}
+	}
+
+	static const char *type_name(Type type);
+	static std::optional<Type> parse_type(std::string_view name);
+	/* The type both operands of a mixed expression are converted to. */
+	static Type promote(Type a, Type b);
+
+	Matrix() = default;
+	Matrix(size_type rows, size_type columns, Type type = Type::Double);
+	explicit Matrix(Storage storage)
+	    : _storage(std::move(storage))
+	{
+	}
+
+	[[nodiscard]] Type
+	type() const
+	{
+		return static_cast<Type>(_storage.index());
+	}
+
+	[[nodiscard]] size_type row_count() const;
+	[[nodiscard]] size_type column_count() const;
+
+	[[nodiscard]] bool
+	is_vector() const
+	{
+		return column_count() == 1;
+	}
 
+	[[nodiscard]] bool
+	is_row_vector() const
+	{
+		return row_count() == 1;
+	}
+
+	/* Zero-filled. */
+	void resize(size_type rows, size_type columns, Type type);
+
+	[[nodiscard]] Storage &
+	storage()
+	{
+		return _storage;
+	}
+
+	[[nodiscard]] const Storage &
+	storage() const
+	{
+		return _storage;
+	}
+
+	/* The storage as T, which must be the matrix's type. */
+	template <typename T>
+	[[nodiscard]] DenseMatrix<T> &
+	as()
+	{
+		return std::get<DenseMatrix<T>>(_storage);
+	}
+
+	template <typename T>
+	[[nodiscard]] const DenseMatrix<T> &
+	as() const
+	{
+		return std::get<DenseMatrix<T>>(_storage);
+	}
+
+	/* The storage as T, converted into scratch if the matrix has some
+	 * other type. */
+	template <typename T>
+	[[nodiscard]] const DenseMatrix<T> &
+	as(DenseMatrix<T> &scratch) const
+	{
+		if (type() == type_of<T>()) return as<T>();
+		scratch = cast<T>();
+		return scratch;
+	}
+
+	/* A copy converted to T. */
+	template <typename T>
+	[[nodiscard]] DenseMatrix<T>
+	cast() const
+	{
+		return std::visit(
+		    [](const auto &m) -> DenseMatrix<T> {
+			    return m.template cast<T>();
+		    },
+		    _storage);
+	}
+
+	[[nodiscard]] std::string to_string() const;
+
+private:
+	Storage _storage;
+};
+
+} /* namespace euler::math */
+
+#endif /* EULER_MATH_MATRIX_H */
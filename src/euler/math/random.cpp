@@ -0,0 +1,468 @@
+/* SPDX-License-Identifier: ISC */
+
+#include "euler/math/random.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numbers>
+
+#include <Eigen/Eigen>
+
+#include "euler/math/cube.h"
+#include "euler/math/matrix.h"
+#include "euler/math/ufunc.h"
+#include "euler/util/state.h"
+
+using euler::math::Cube;
+using euler::math::Matrix;
+using euler::math::Philox;
+using euler::math::Random;
+namespace ufunc = euler::math::ufunc;
+
+/* multipliers and Weyl key increments from the paper */
+static constexpr uint32_t M0 = 0xD2511F53;
+static constexpr uint32_t M1 = 0xCD9E8D57;
+static constexpr uint32_t W0 = 0x9E3779B9;
+static constexpr uint32_t W1 = 0xBB67AE85;
+static constexpr int ROUNDS = 10;
+
+Philox::Counter
+Philox::generate(Counter counter, Key key)
+{
+	for (int round = 0; round < ROUNDS; ++round) {
+		if (round > 0) {
+			key[0] += W0;
+			key[1] += W1;
+		}
+		const auto p0 = static_cast<uint64_t>(M0) * counter[0];
+		const auto p1 = static_cast<uint64_t>(M1) * counter[2];
+		counter = {
+			static_cast<uint32_t>(p1 >> 32) ^ counter[1] ^ key[0],
+			static_cast<uint32_t>(p1),
+			static_cast<uint32_t>(p0 >> 32) ^ counter[3] ^ key[1],
+			static_cast<uint32_t>(p0),
+		};
+	}
+	return counter;
+}
+
+/* Values transformed at a time: enough for Eigen to vectorize over, few
+ * enough to stay on the stack. Even, so that batches hold whole blocks. */
+static constexpr size_t BATCH = 256;
+
+template <typename T>
+using Batch = Eigen::Array<T, Eigen::Dynamic, 1, 0, BATCH, 1>;
+using Bits = Eigen::Map<const Eigen::Array<uint64_t, Eigen::Dynamic, 1>>;
+
+/* A block as two 64-bit values. */
+static void
+block_bits(const Philox::Key key, const uint64_t block, uint64_t *out)
+{
+	const auto r = Philox::generate(Philox::counter(block), key);
+	out[0] = r[0] | static_cast<uint64_t>(r[1]) << 32;
+	out[1] = r[2] | static_cast<uint64_t>(r[3]) << 32;
+}
+
+/* Writes out[begin, end), taking element i from block base + i / 2; begin
+ * and end need not be even, so any split of a fill gives the same values. */
+template <typename T, typename F>
+static void
+generate(const Philox::Key key, const uint64_t base, const std::span<T> out,
+    const size_t begin, const size_t end, const F &transform)
+{
+	alignas(64) std::array<uint64_t, BATCH> bits;
+	Batch<T> values;
+	const auto start = begin & ~size_t { 1 };
+	for (size_t first = start; first < end; first += BATCH) {
+		const auto last = std::min(first + BATCH, end + (end & 1));
+		const auto n = last - first;
+		for (size_t j = 0; j < n; j += 2)
+			block_bits(key, base + (first + j) / 2, &bits[j]);
+		values.resize(static_cast<Eigen::Index>(n));
+		transform(Bits(bits.data(), static_cast<Eigen::Index>(n)),
+		    values);
+		const auto from = std::max(first, begin);
+		const auto to = std::min(last, end);
+		std::copy(values.data() + (from - first),
+		    values.data() + (to - first), out.data() + from);
+	}
+}
+
+template <typename T, typename F>
+static void
+fill(euler::util::Jobs *jobs, const Philox::Key key, const uint64_t base,
+    const std::span<T> out, const F &transform)
+{
+	const auto body = [&](const size_t begin, const size_t end) {
+		generate(key, base, out, begin, end, transform);
+	};
+	if (jobs == nullptr || out.size() < ufunc::PARALLEL_THRESHOLD) {
+		body(0, out.size());
+		return;
+	}
+	jobs->parallel_for(0, out.size(), ufunc::GRAIN, body);
+}
+
+/* [0, 1) from the top bits: 24 for float, 53 otherwise. */
+template <typename T, typename B>
+static auto
+unit(const B &bits)
+{
+	if constexpr (std::is_same_v<T, float>) {
+		return (bits.template shiftRight<40>().template cast<float>()
+		    * 0x1p-24f);
+	} else {
+		return (bits.template shiftRight<11>().template cast<double>()
+		    * 0x1p-53);
+	}
+}
+
+Random::Random(const uint64_t seed)
+    : _seed(seed)
+{
+}
+
+void
+Random::reseed(const uint64_t seed)
+{
+	_seed = seed;
+	_position = 0;
+}
+
+uint64_t
+Random::take(const size_t count)
+{
+	const auto first = _position;
+	_position += (count + 1) / 2;
+	return first;
+}
+
+template <typename T>
+void
+Random::uniform(const std::span<T> out, const double min, const double max,
+    util::Jobs *jobs)
+{
+	const auto base = take(out.size());
+	if constexpr (std::is_floating_point_v<T>) {
+		const auto lo = static_cast<T>(min);
+		const auto width = static_cast<T>(max - min);
+		/* u * width + lo can round up to max itself */
+		const auto hi = max > min
+		    ? std::nextafter(static_cast<T>(max), lo)
+		    : std::numeric_limits<T>::infinity();
+		fill(jobs, Philox::key(_seed), base, out,
+		    [&](const Bits &bits, Batch<T> &values) {
+			    values = (unit<T>(bits) * width + lo).min(hi);
+		    });
+	} else {
+		/* the whole numbers inside [min, max] */
+		const auto lo = std::ceil(min);
+		const auto width = std::floor(max) - lo + 1.0;
+		const auto hi = ufunc::saturate<T>(std::floor(max));
+		fill(jobs, Philox::key(_seed), base, out,
+		    [&](const Bits &bits, Batch<T> &values) {
+			    const Batch<double> x
+				= (unit<double>(bits) * width + lo).floor();
+			    values = x.unaryExpr([hi](const double v) {
+				    return std::min(ufunc::saturate<T>(v), hi);
+			    });
+		    });
+	}
+}
+
+template <typename T>
+void
+Random::normal(const std::span<T> out, const double mean,
+    const double deviation, util::Jobs *jobs)
+{
+	static_assert(std::is_floating_point_v<T>);
+	using Half = Eigen::Map<const Eigen::Array<uint64_t, Eigen::Dynamic, 1>,
+	    0, Eigen::InnerStride<2>>;
+	using Out = Eigen::Map<Batch<T>, 0, Eigen::InnerStride<2>>;
+	const auto base = take(out.size());
+	fill(jobs, Philox::key(_seed), base, out,
+	    [&](const Bits &bits, Batch<T> &values) {
+		    const auto n = bits.size() / 2;
+		    const Half first(bits.data(), n);
+		    const Half second(bits.data() + 1, n);
+		    /* (0, 1], so that the logarithm is finite */
+		    const Batch<double> radius
+			= ((unit<double>(first) + 0x1p-53).log() * -2.0).sqrt()
+			* deviation;
+		    const Batch<double> angle
+			= unit<double>(second) * (2.0 * std::numbers::pi);
+		    Out(values.data(), n)
+			= (radius * angle.cos() + mean).template cast<T>();
+		    Out(values.data() + 1, n)
+			= (radius * angle.sin() + mean).template cast<T>();
+	    });
+}
+
+#define INSTANTIATE(T)                                                         \
+	template void Random::uniform(std::span<T>, double, double,           \
+	    util::Jobs *);
+INSTANTIATE(float)
+INSTANTIATE(double)
+INSTANTIATE(int16_t)
+INSTANTIATE(int32_t)
+INSTANTIATE(int64_t)
+INSTANTIATE(uint16_t)
+INSTANTIATE(uint32_t)
+INSTANTIATE(uint64_t)
+#undef INSTANTIATE
+template void Random::normal(std::span<float>, double, double, util::Jobs *);
+template void Random::normal(std::span<double>, double, double, util::Jobs *);
+
+double
+Random::uniform(const double min, const double max)
+{
+	uint64_t bits[2];
+	block_bits(Philox::key(_seed), take(1), bits);
+	const auto u = static_cast<double>(bits[0] >> 11) * 0x1p-53;
+	const auto x = min + (max - min) * u;
+	return max > min ? std::min(x, std::nextafter(max, min)) : x;
+}
+
+double
+Random::normal(const double mean, const double deviation)
+{
+	uint64_t bits[2];
+	block_bits(Philox::key(_seed), take(1), bits);
+	const auto u = static_cast<double>(bits[0] >> 11) * 0x1p-53 + 0x1p-53;
+	const auto v = static_cast<double>(bits[1] >> 11) * 0x1p-53;
+	return mean
+	    + deviation * std::sqrt(-2.0 * std::log(u))
+	    * std::cos(2.0 * std::numbers::pi * v);
+}
+
+static mrb_value
+random_allocate(mrb_state *mrb, mrb_value)
+{
+	const auto state = euler::util::State::get(mrb);
+	auto random = euler::util::make_reference<Random>();
+	return state->wrap(random);
+}
+
+/**
+ * @overload Euler::Math::Random#initialize(seed = 0)
+ *   @param seed [Integer] The seed; equal seeds give equal streams, whatever
+ *     the number of worker threads.
+ */
+static mrb_value
+random_initialize(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	mrb_int seed = 0;
+	state->mrb()->get_args("|i", &seed);
+	auto random = euler::util::Reference<Random>::unwrap(mrb, self);
+	random->reseed(static_cast<uint64_t>(seed));
+	return mrb_nil_value();
+}
+
+static mrb_value
+random_seed(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	const auto random = state->unwrap<Random>(self);
+	return state->mrb()->int_value(static_cast<mrb_int>(random->seed()));
+}
+
+/**
+ * @overload Euler::Math::Random#seed=(seed)
+ *   Reseeds the stream and rewinds it to the start.
+ *   @param seed [Integer]
+ */
+static mrb_value
+random_set_seed(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	mrb_int seed;
+	state->mrb()->get_args("i", &seed);
+	auto random = state->unwrap<Random>(self);
+	random->reseed(static_cast<uint64_t>(seed));
+	return state->mrb()->int_value(seed);
+}
+
+/**
+ * @overload Euler::Math::Random#position
+ *   @return [Integer] How many blocks of the stream have been used. Each
+ *     block gives two values, and every draw or fill starts on a new one.
+ */
+static mrb_value
+random_position(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	const auto random = state->unwrap<Random>(self);
+	const auto position = static_cast<mrb_int>(random->position());
+	return state->mrb()->int_value(position);
+}
+
+/**
+ * @overload Euler::Math::Random#position=(position)
+ *   Jumps to a block of the stream, for instance to replay a fill.
+ *   @param position [Integer]
+ */
+static mrb_value
+random_set_position(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	mrb_int position;
+	state->mrb()->get_args("i", &position);
+	if (position < 0) {
+		state->mrb()->raise(state->mrb()->argument_error(),
+		    "Position must not be negative");
+	}
+	auto random = state->unwrap<Random>(self);
+	random->set_position(static_cast<uint64_t>(position));
+	return state->mrb()->int_value(position);
+}
+
+/**
+ * @overload Euler::Math::Random#uniform(min = 0.0, max = 1.0)
+ *   @return [Float] A number in [min, max).
+ */
+static mrb_value
+random_uniform(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	mrb_float min = 0.0, max = 1.0;
+	state->mrb()->get_args("|ff", &min, &max);
+	auto random = state->unwrap<Random>(self);
+	return state->mrb()->float_value(random->uniform(min, max));
+}
+
+/**
+ * @overload Euler::Math::Random#normal(mean = 0.0, deviation = 1.0)
+ *   @return [Float] A normally distributed number.
+ */
+static mrb_value
+random_normal(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	mrb_float mean = 0.0, deviation = 1.0;
+	state->mrb()->get_args("|ff", &mean, &deviation);
+	auto random = state->unwrap<Random>(self);
+	return state->mrb()->float_value(random->normal(mean, deviation));
+}
+
+template <typename F>
+static void
+visit_elements(Matrix &matrix, const F &fn)
+{
+	Matrix::visit_type(matrix.type(), [&]<typename T>(T) {
+		auto &m = matrix.as<T>();
+		fn(std::span<T>(m.data(), static_cast<size_t>(m.size())));
+	});
+}
+
+template <typename F>
+static void
+visit_elements(Cube &cube, const F &fn)
+{
+	Matrix::visit_type(cube.type(), [&]<typename T>(T) {
+		auto &e = cube.buffer()->as<T>();
+		fn(std::span<T>(e.data(), static_cast<size_t>(e.size())));
+	});
+}
+
+/**
+ * @overload Euler::Math::Matrix#randu(random, min = 0.0, max = 1.0)
+ *   Fills the matrix in place from random, in [min, max) for float and
+ *   double matrices and with whole numbers in [min, max] for integer ones.
+ *   @param random [Euler::Math::Random]
+ *   @return [self]
+ * @overload Euler::Math::Cube#randu(random, min = 0.0, max = 1.0)
+ *   As Matrix#randu; views of the cube see the new elements.
+ *   @return [self]
+ */
+template <typename Target>
+static mrb_value
+target_randu(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	mrb_value value;
+	mrb_float min = 0.0, max = 1.0;
+	state->mrb()->get_args("o|ff", &value, &min, &max);
+	if (max < min) {
+		state->mrb()->raise(state->mrb()->argument_error(),
+		    "max must not be less than min");
+	}
+	auto random = state->unwrap<Random>(value);
+	auto target = state->unwrap<Target>(self);
+	auto jobs = state->jobs();
+	visit_elements(*target.get(), [&]<typename T>(const std::span<T> out) {
+		random->uniform(out, min, max, jobs.get());
+	});
+	return self;
+}
+
+/**
+ * @overload Euler::Math::Matrix#randn(random, mean = 0.0, deviation = 1.0)
+ *   Fills a float or double matrix in place with normally distributed
+ *   values from random.
+ *   @param random [Euler::Math::Random]
+ *   @return [self]
+ *   @raise [TypeError] If the matrix has an integer type.
+ * @overload Euler::Math::Cube#randn(random, mean = 0.0, deviation = 1.0)
+ *   As Matrix#randn; views of the cube see the new elements.
+ *   @return [self]
+ */
+template <typename Target>
+static mrb_value
+target_randn(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	mrb_value value;
+	mrb_float mean = 0.0, deviation = 1.0;
+	state->mrb()->get_args("o|ff", &value, &mean, &deviation);
+	{
+		auto random = state->unwrap<Random>(value);
+		auto target = state->unwrap<Target>(self);
+		auto jobs = state->jobs();
+		bool floating = false;
+		visit_elements(*target.get(),
+		    [&]<typename T>(const std::span<T> out) {
+			    if constexpr (std::is_floating_point_v<T>) {
+				    random->normal(out, mean, deviation,
+					jobs.get());
+				    floating = true;
+			    }
+		    });
+		if (floating) return self;
+	}
+	state->mrb()->raise(state->mrb()->type_error(),
+	    "randn needs float or double elements");
+}
+
+RClass *
+Random::init(const util::Reference<util::State> &state, RClass *mod,
+    RClass *)
+{
+	const auto &mrb = state->mrb();
+	const auto &math = state->modules().math;
+	const auto cls
+	    = mrb->define_class_under(mod, "Random", state->object_class());
+	MRB_SET_INSTANCE_TT(cls, MRB_TT_DATA);
+	mrb->define_class_method(cls, "allocate", random_allocate,
+	    MRB_ARGS_NONE());
+	mrb->define_method(cls, "initialize", random_initialize,
+	    MRB_ARGS_OPT(1));
+	mrb->define_method(cls, "seed", random_seed, MRB_ARGS_NONE());
+	mrb->define_method(cls, "seed=", random_set_seed, MRB_ARGS_REQ(1));
+	mrb->define_method(cls, "position", random_position, MRB_ARGS_NONE());
+	mrb->define_method(cls, "position=", random_set_position,
+	    MRB_ARGS_REQ(1));
+	mrb->define_method(cls, "uniform", random_uniform, MRB_ARGS_OPT(2));
+	mrb->define_method(cls, "normal", random_normal, MRB_ARGS_OPT(2));
+	/* fills, on the classes that hold their elements contiguously */
+	mrb->define_method(math.matrix, "randu", target_randu<Matrix>,
+	    MRB_ARGS_ARG(1, 2));
+	mrb->define_method(math.matrix, "randn", target_randn<Matrix>,
+	    MRB_ARGS_ARG(1, 2));
+	mrb->define_method(math.cube, "randu", target_randu<Cube>,
+	    MRB_ARGS_ARG(1, 2));
+	mrb->define_method(math.cube, "randn", target_randn<Cube>,
+	    MRB_ARGS_ARG(1, 2));
+	return cls;
+}
@@ -0,0 +1,97 @@
+/* SPDX-License-Identifier: ISC */
+
+#ifndef EULER_MATH_RANDOM_H
+#define EULER_MATH_RANDOM_H
+
+#include <array>
+#include <cstdint>
+#include <span>
+
+#include "euler/util/ext.h"
+#include "euler/util/jobs.h"
+#include "euler/util/object.h"
+
+namespace euler::math {
+
+/* Philox4x32-10 (Salmon et al., "Parallel Random Numbers: As Easy as 1, 2,
+ * 3"): a keyed bijection on 128-bit counters, so any block of the stream can
+ * be produced without producing the ones before it. */
+class Philox {
+public:
+	using Counter = std::array<uint32_t, 4>;
+	using Key = std::array<uint32_t, 2>;
+
+	static Counter generate(Counter counter, Key key);
+
+	/* Block index of a stream as a counter, and a 64-bit seed as a key. */
+	static Counter
+	counter(const uint64_t block)
+	{
+		return { static_cast<uint32_t>(block),
+			static_cast<uint32_t>(block >> 32), 0, 0 };
+	}
+
+	static Key
+	key(const uint64_t seed)
+	{
+		return { static_cast<uint32_t>(seed),
+			static_cast<uint32_t>(seed >> 32) };
+	}
+};
+
+/* A seeded stream of Philox blocks, each of which yields two values. Element
+ * i of a fill always comes from block position() + i / 2, however the fill is
+ * split between threads, so a seed gives the same values on any number of
+ * workers; the fill then moves position() past the blocks it used. */
+class Random final : public util::Object {
+	BIND_MRUBY("Euler::Math::Random", Random, math.random);
+
+public:
+	explicit Random(uint64_t seed = 0);
+
+	[[nodiscard]] uint64_t
+	seed() const
+	{
+		return _seed;
+	}
+
+	/* Restarts the stream from block zero. */
+	void reseed(uint64_t seed);
+
+	[[nodiscard]] uint64_t
+	position() const
+	{
+		return _position;
+	}
+
+	void
+	set_position(const uint64_t position)
+	{
+		_position = position;
+	}
+
+	/* Floating types get [min, max); integer types get whole numbers in
+	 * [min, max], evenly spread for ranges up to 2^53. */
+	template <typename T>
+	void uniform(std::span<T> out, double min, double max,
+	    util::Jobs *jobs);
+	/* Box-Muller, one pair per block. Floating types only. */
+	template <typename T>
+	void normal(std::span<T> out, double mean, double deviation,
+	    util::Jobs *jobs);
+
+	/* Single draws, one block each. */
+	double uniform(double min, double max);
+	double normal(double mean, double deviation);
+
+private:
+	/* The blocks the next count values come from. */
+	uint64_t take(size_t count);
+
+	uint64_t _seed;
+	uint64_t _position = 0;
+};
+
+} /* namespace euler::math */
+
+#endif /* EULER_MATH_RANDOM_H */
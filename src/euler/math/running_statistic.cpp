@@ -0,0 +1,595 @@
+/* SPDX-License-Identifier: ISC */
+
+#include "euler/math/running_statistic.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <string>
+
+#include <Eigen/Eigen>
+#include <mruby/array.h>
+
+#include "euler/math/matrix.h"
+#include "euler/math/small.h"
+#include "euler/util/state.h"
+
+using euler::math::P2Quantile;
+using euler::math::RunningStatistic;
+
+P2Quantile::P2Quantile(const double p)
+    : _p(p)
+{
+	reset();
+}
+
+void
+P2Quantile::reset()
+{
+	_count = 0;
+	_increments = { 0.0, _p / 2.0, _p, (1.0 + _p) / 2.0, 1.0 };
+	for (int i = 0; i < MARKERS; ++i) {
+		_positions[i] = i + 1;
+		_desired[i] = 1.0 + 4.0 * _increments[i];
+	}
+}
+
+void
+P2Quantile::push(const double value)
+{
+	/* the first five values are kept as they are, and become the
+	 * markers once sorted */
+	if (_count < MARKERS) {
+		_heights[_count++] = value;
+		if (_count == MARKERS)
+			std::sort(_heights.begin(), _heights.end());
+		return;
+	}
+	++_count;
+	int cell;
+	if (value < _heights[0]) {
+		_heights[0] = value;
+		cell = 0;
+	} else if (value >= _heights[MARKERS - 1]) {
+		_heights[MARKERS - 1] = value;
+		cell = MARKERS - 2;
+	} else {
+		cell = 0;
+		while (value >= _heights[cell + 1]) ++cell;
+	}
+	for (int i = cell + 1; i < MARKERS; ++i) _positions[i] += 1.0;
+	for (int i = 0; i < MARKERS; ++i) _desired[i] += _increments[i];
+
+	for (int i = 1; i < MARKERS - 1; ++i) {
+		const auto offset = _desired[i] - _positions[i];
+		if (!(offset >= 1.0 && _positions[i + 1] - _positions[i] > 1.0)
+		    && !(offset <= -1.0
+			&& _positions[i - 1] - _positions[i] < -1.0))
+			continue;
+		const double d = offset > 0.0 ? 1.0 : -1.0;
+		const auto below = _positions[i] - _positions[i - 1];
+		const auto above = _positions[i + 1] - _positions[i];
+		const auto parabolic = _heights[i]
+		    + d / (_positions[i + 1] - _positions[i - 1])
+			* ((below + d) * (_heights[i + 1] - _heights[i]) / above
+			    + (above - d) * (_heights[i] - _heights[i - 1])
+				/ below);
+		const auto inside = parabolic > _heights[i - 1]
+		    && parabolic < _heights[i + 1];
+		if (inside) {
+			_heights[i] = parabolic;
+		} else {
+			/* the parabola overshot a neighbour; fall back to
+			 * moving linearly towards it */
+			const auto j = d > 0.0 ? i + 1 : i - 1;
+			_heights[i] += d * (_heights[j] - _heights[i])
+			    / (_positions[j] - _positions[i]);
+		}
+		_positions[i] += d;
+	}
+}
+
+double
+P2Quantile::estimate() const
+{
+	if (_count >= MARKERS) {
+		/* the outer markers are the exact extremes */
+		if (_p <= 0.0) return _heights[0];
+		if (_p >= 1.0) return _heights[MARKERS - 1];
+		return _heights[2];
+	}
+	std::array<double, MARKERS> sorted = _heights;
+	std::sort(sorted.begin(), sorted.begin() + _count);
+	const auto rank = _p * static_cast<double>(_count - 1);
+	const auto lower = static_cast<size_t>(std::floor(rank));
+	const auto upper = std::min<size_t>(lower + 1, _count - 1);
+	return sorted[lower]
+	    + (sorted[upper] - sorted[lower]) * (rank - std::floor(rank));
+}
+
+void
+P2Quantile::merge(const P2Quantile &other)
+{
+	if (other._count < MARKERS) {
+		for (uint64_t i = 0; i < other._count; ++i)
+			push(other._heights[i]);
+		return;
+	}
+	if (_count < MARKERS) {
+		const auto pending = _heights;
+		const auto pending_count = _count;
+		*this = other;
+		for (uint64_t i = 0; i < pending_count; ++i) push(pending[i]);
+		return;
+	}
+	const auto total = _count + other._count;
+	const auto weight = static_cast<double>(other._count)
+	    / static_cast<double>(total);
+	_heights[0] = std::min(_heights[0], other._heights[0]);
+	_heights[MARKERS - 1] = std::max(_heights[MARKERS - 1],
+	    other._heights[MARKERS - 1]);
+	for (int i = 1; i < MARKERS - 1; ++i) {
+		_heights[i] += (other._heights[i] - _heights[i]) * weight;
+		/* a marker's rank in the union is about the sum of its ranks,
+		 * kept strictly between its neighbours' */
+		_positions[i] = std::clamp(_positions[i] + other._positions[i],
+		    _positions[i - 1] + 1.0,
+		    static_cast<double>(total) - (MARKERS - 1 - i));
+	}
+	_count = total;
+	_positions[MARKERS - 1] = static_cast<double>(total);
+	for (int i = 0; i < MARKERS; ++i) {
+		_desired[i] = 1.0
+		    + static_cast<double>(total - 1) * _increments[i];
+	}
+}
+
+RunningStatistic::RunningStatistic(const std::span<const double> quantiles)
+{
+	track(quantiles);
+}
+
+void
+RunningStatistic::track(const std::span<const double> quantiles)
+{
+	_quantile_count = std::min(quantiles.size(), MAX_QUANTILES);
+	for (size_t i = 0; i < _quantile_count; ++i)
+		_quantiles[i] = P2Quantile(quantiles[i]);
+	reset();
+}
+
+void
+RunningStatistic::push(const double value)
+{
+	for (size_t i = 0; i < _quantile_count; ++i) _quantiles[i].push(value);
+	if (_samples == 0) {
+		_min = _max = value;
+	} else {
+		_min = std::min(_min, value);
+		_max = std::max(_max, value);
+	}
+	/* Welford */
+	++_samples;
+	const auto delta = value - _mean;
+	_mean += delta / static_cast<double>(_samples);
+	_m2 += delta * (value - _mean);
+}
+
+template <typename T>
+void
+RunningStatistic::push(const std::span<const T> values)
+{
+	if (values.empty()) return;
+	for (size_t i = 0; i < _quantile_count; ++i) {
+		for (const auto value : values)
+			_quantiles[i].push(static_cast<double>(value));
+	}
+	const Eigen::Map<const Eigen::Array<T, Eigen::Dynamic, 1>> batch(
+	    values.data(), static_cast<Eigen::Index>(values.size()));
+	const auto x = batch.template cast<double>();
+	/* two passes over the batch, which is the stable way to get its
+	 * variance and vectorizes cleanly */
+	const auto count = static_cast<double>(values.size());
+	const auto mean = x.sum() / count;
+	const auto m2 = (x - mean).square().sum();
+	combine(values.size(), mean, m2, x.minCoeff(), x.maxCoeff());
+}
+
+template void RunningStatistic::push(std::span<const float>);
+template void RunningStatistic::push(std::span<const double>);
+template void RunningStatistic::push(std::span<const int16_t>);
+template void RunningStatistic::push(std::span<const int32_t>);
+template void RunningStatistic::push(std::span<const int64_t>);
+template void RunningStatistic::push(std::span<const uint16_t>);
+template void RunningStatistic::push(std::span<const uint32_t>);
+template void RunningStatistic::push(std::span<const uint64_t>);
+
+void
+RunningStatistic::combine(const uint64_t count, const double mean,
+    const double m2, const double min, const double max)
+{
+	if (count == 0) return;
+	if (_samples == 0) {
+		_samples = count;
+		_mean = mean;
+		_m2 = m2;
+		_min = min;
+		_max = max;
+		return;
+	}
+	const auto total = _samples + count;
+	const auto a = static_cast<double>(_samples);
+	const auto b = static_cast<double>(count);
+	const auto n = static_cast<double>(total);
+	const auto delta = mean - _mean;
+	_mean += delta * b / n;
+	_m2 += m2 + delta * delta * a * b / n;
+	_samples = total;
+	_min = std::min(_min, min);
+	_max = std::max(_max, max);
+}
+
+void
+RunningStatistic::merge(const RunningStatistic &other)
+{
+	for (size_t i = 0; i < _quantile_count; ++i)
+		_quantiles[i].merge(other._quantiles[i]);
+	combine(other._samples, other._mean, other._m2, other._min, other._max);
+}
+
+bool
+RunningStatistic::same_quantiles(const RunningStatistic &other) const
+{
+	if (_quantile_count != other._quantile_count) return false;
+	for (size_t i = 0; i < _quantile_count; ++i)
+		if (_quantiles[i].p() != other._quantiles[i].p()) return false;
+	return true;
+}
+
+void
+RunningStatistic::reset()
+{
+	_samples = 0;
+	_mean = _m2 = _min = _max = 0.0;
+	for (size_t i = 0; i < _quantile_count; ++i) _quantiles[i].reset();
+}
+
+double
+RunningStatistic::variance() const
+{
+	if (_samples < 2) return 0.0;
+	return _m2 / static_cast<double>(_samples);
+}
+
+double
+RunningStatistic::sample_variance() const
+{
+	if (_samples < 2) return 0.0;
+	return _m2 / static_cast<double>(_samples - 1);
+}
+
+double
+RunningStatistic::standard_deviation() const
+{
+	return std::sqrt(variance());
+}
+
+std::optional<double>
+RunningStatistic::quantile(const double p) const
+{
+	if (_samples == 0) return std::nullopt;
+	for (const auto &q : quantiles())
+		if (q.p() == p) return q.estimate();
+	return std::nullopt;
+}
+
+static mrb_value
+running_stat_allocate(mrb_state *mrb, mrb_value)
+{
+	const auto state = euler::util::State::get(mrb);
+	auto stat = euler::util::make_reference<RunningStatistic>();
+	return state->wrap(stat);
+}
+
+/**
+ * @overload Euler::Math::RunningStatistic#initialize(*quantiles)
+ *   @example Frame times with their median and 99th percentile
+ *     stat = Euler::Math::RunningStatistic.new(0.5, 0.99)
+ *   @param quantiles [Array<Float>] Up to eight quantiles to estimate, each
+ *     in [0, 1].
+ */
+static mrb_value
+running_stat_initialize(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	mrb_value *args;
+	mrb_int argc;
+	state->mrb()->get_args("*", &args, &argc);
+	if (argc > static_cast<mrb_int>(RunningStatistic::MAX_QUANTILES)) {
+		state->mrb()->raisef(state->mrb()->argument_error(),
+		    "At most %i quantiles can be tracked",
+		    static_cast<mrb_int>(RunningStatistic::MAX_QUANTILES));
+	}
+	std::array<double, RunningStatistic::MAX_QUANTILES> quantiles;
+	for (mrb_int i = 0; i < argc; ++i) {
+		quantiles[i] = state->mrb()->to_flo(args[i]);
+		if (!(quantiles[i] >= 0.0 && quantiles[i] <= 1.0)) {
+			state->mrb()->raise(state->mrb()->argument_error(),
+			    "Quantiles must be between 0 and 1");
+		}
+	}
+	auto stat = euler::util::Reference<RunningStatistic>::unwrap(mrb, self);
+	stat->track(std::span<const double>(quantiles.data(), argc));
+	return mrb_nil_value();
+}
+
+template <typename S>
+static bool
+push_small(RunningStatistic &stat, mrb_state *mrb, const mrb_value value)
+{
+	const auto elements = S::elements(mrb, value);
+	if (elements == nullptr) return false;
+	stat.push(std::span<const float>(elements, S::SIZE));
+	return true;
+}
+
+/* Reads the array in fixed-size blocks, so a batch of any length is pushed
+ * without allocating. */
+static void
+push_array(RunningStatistic &stat, mrb_state *mrb, const mrb_value array)
+{
+	const auto state = euler::util::State::get(mrb);
+	std::array<double, 256> block;
+	const auto length = RARRAY_LEN(array);
+	for (mrb_int begin = 0; begin < length; begin += block.size()) {
+		const auto end = std::min<mrb_int>(length,
+		    begin + static_cast<mrb_int>(block.size()));
+		for (mrb_int i = begin; i < end; ++i) {
+			block[i - begin]
+			    = state->mrb()->to_flo(RARRAY_PTR(array)[i]);
+		}
+		stat.push(std::span<const double>(block.data(), end - begin));
+	}
+}
+
+/**
+ * @overload Euler::Math::RunningStatistic#push(value)
+ *   Also available as <<.
+ *   @param value [Numeric, Array<Numeric>, Euler::Math::Matrix,
+ *     Euler::Math::Vec2, Euler::Math::Vec3, Euler::Math::Vec4] A number, or
+ *     a batch of them.
+ *   @return [self]
+ */
+static mrb_value
+running_stat_push(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	mrb_value value;
+	state->mrb()->get_args("o", &value);
+	auto stat = state->unwrap<RunningStatistic>(self);
+	if (mrb_integer_p(value) || mrb_float_p(value)) {
+		stat->push(state->mrb()->to_flo(value));
+		return self;
+	}
+	if (mrb_array_p(value)) {
+		push_array(*stat.get(), mrb, value);
+		return self;
+	}
+	if (state->mrb()->obj_is_kind_of(value, state->modules().math.matrix)) {
+		const auto matrix = state->unwrap<euler::math::Matrix>(value);
+		std::visit(
+		    [&](const auto &m) {
+			    const auto size = static_cast<size_t>(m.size());
+			    stat->push(std::span(m.data(), size));
+		    },
+		    matrix->storage());
+		return self;
+	}
+	if (push_small<euler::math::SmallVec2>(*stat.get(), mrb, value)
+	    || push_small<euler::math::SmallVec3>(*stat.get(), mrb, value)
+	    || push_small<euler::math::SmallVec4>(*stat.get(), mrb, value))
+		return self;
+	state->mrb()->raise(state->mrb()->type_error(),
+	    "Expected a number, an Array, a Matrix or a vector");
+}
+
+static void
+check_mergeable(mrb_state *mrb, const RunningStatistic &a,
+    const RunningStatistic &b)
+{
+	if (a.same_quantiles(b)) return;
+	const auto state = euler::util::State::get(mrb);
+	state->mrb()->raise(state->mrb()->argument_error(),
+	    "Cannot merge statistics that track different quantiles");
+}
+
+/**
+ * @overload Euler::Math::RunningStatistic#merge!(other)
+ *   Adds every value other has seen, as if they had been pushed here. The
+ *   quantile estimates are combined approximately.
+ *   @param other [Euler::Math::RunningStatistic] A statistic tracking the
+ *     same quantiles.
+ *   @return [self]
+ */
+static mrb_value
+running_stat_merge_bang(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	mrb_value other_value;
+	state->mrb()->get_args("o", &other_value);
+	auto stat = state->unwrap<RunningStatistic>(self);
+	const auto other = state->unwrap<RunningStatistic>(other_value);
+	check_mergeable(mrb, *stat.get(), *other.get());
+	stat->merge(*other.get());
+	return self;
+}
+
+/**
+ * @overload Euler::Math::RunningStatistic#merge(other)
+ *   @param other [Euler::Math::RunningStatistic] A statistic tracking the
+ *     same quantiles.
+ *   @return [Euler::Math::RunningStatistic] A new statistic of the values
+ *     both have seen.
+ */
+static mrb_value
+running_stat_merge(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	mrb_value other_value;
+	state->mrb()->get_args("o", &other_value);
+	const auto stat = state->unwrap<RunningStatistic>(self);
+	const auto other = state->unwrap<RunningStatistic>(other_value);
+	check_mergeable(mrb, *stat.get(), *other.get());
+	std::array<double, RunningStatistic::MAX_QUANTILES> quantiles;
+	const auto tracked = stat->quantiles();
+	for (size_t i = 0; i < tracked.size(); ++i)
+		quantiles[i] = tracked[i].p();
+	auto out = euler::util::make_reference<RunningStatistic>(
+	    std::span<const double>(quantiles.data(), tracked.size()));
+	out->merge(*stat.get());
+	out->merge(*other.get());
+	return state->wrap(out);
+}
+
+static mrb_value
+running_stat_reset(mrb_state *mrb, const mrb_value self)
+{
+	auto stat = euler::util::Reference<RunningStatistic>::unwrap(mrb, self);
+	stat->reset();
+	return self;
+}
+
+static mrb_value
+running_stat_samples(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	const auto stat = state->unwrap<RunningStatistic>(self);
+	return state->mrb()->int_value(static_cast<mrb_int>(stat->count()));
+}
+
+template <double (RunningStatistic::*Getter)() const>
+static mrb_value
+running_stat_float(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	const auto stat = state->unwrap<RunningStatistic>(self);
+	return state->mrb()->float_value(((*stat.get()).*Getter)());
+}
+
+/**
+ * @overload Euler::Math::RunningStatistic#min
+ *   Like max.
+ *   @return [Float, nil] nil if no value was pushed.
+ */
+template <double (RunningStatistic::*Getter)() const>
+static mrb_value
+running_stat_bound(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	const auto stat = state->unwrap<RunningStatistic>(self);
+	if (stat->count() == 0) return mrb_nil_value();
+	return state->mrb()->float_value(((*stat.get()).*Getter)());
+}
+
+/**
+ * @overload Euler::Math::RunningStatistic#quantile(p)
+ *   @param p [Float] One of the quantiles given to new.
+ *   @return [Float, nil] The estimate, or nil if no value was pushed.
+ *   @raise [ArgumentError] If p isn't tracked.
+ */
+static mrb_value
+running_stat_quantile(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	mrb_float p;
+	state->mrb()->get_args("f", &p);
+	bool tracked = false;
+	{
+		const auto stat = state->unwrap<RunningStatistic>(self);
+		for (const auto &q : stat->quantiles()) tracked |= q.p() == p;
+		if (tracked) {
+			const auto estimate = stat->quantile(p);
+			if (!estimate.has_value()) return mrb_nil_value();
+			return state->mrb()->float_value(*estimate);
+		}
+	}
+	state->mrb()->raise(state->mrb()->argument_error(),
+	    "That quantile isn't tracked; pass it to new");
+}
+
+/**
+ * @overload Euler::Math::RunningStatistic#quantiles
+ *   @return [Array<Float>] The tracked quantiles.
+ */
+static mrb_value
+running_stat_quantiles(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	const auto stat = state->unwrap<RunningStatistic>(self);
+	const auto tracked = stat->quantiles();
+	const auto out = state->mrb()->ary_new_capa(tracked.size());
+	for (const auto &q : tracked)
+		state->mrb()->ary_push(out, state->mrb()->float_value(q.p()));
+	return out;
+}
+
+static mrb_value
+running_stat_to_s(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	const auto stat = state->unwrap<RunningStatistic>(self);
+	char buf[128];
+	const auto len = snprintf(buf, sizeof(buf),
+	    "RunningStatistic(count=%llu, mean=%g, stddev=%g)",
+	    static_cast<unsigned long long>(stat->count()), stat->mean(),
+	    stat->standard_deviation());
+	return state->mrb()->str_new(buf, len);
+}
+
+RClass *
+RunningStatistic::init(const util::Reference<util::State> &state,
+    RClass *mod, RClass *super)
+{
+	const auto &mrb = state->mrb();
+	const auto cls = mrb->define_class_under(mod, "RunningStatistic",
+	    super != nullptr ? super : state->object_class());
+	MRB_SET_INSTANCE_TT(cls, MRB_TT_DATA);
+	mrb->define_class_method(cls, "allocate", running_stat_allocate,
+	    MRB_ARGS_NONE());
+	mrb->define_method(cls, "initialize", running_stat_initialize,
+	    MRB_ARGS_ANY());
+	mrb->define_method(cls, "push", running_stat_push, MRB_ARGS_REQ(1));
+	mrb->define_method(cls, "<<", running_stat_push, MRB_ARGS_REQ(1));
+	mrb->define_method(cls, "merge", running_stat_merge, MRB_ARGS_REQ(1));
+	mrb->define_method(cls, "merge!", running_stat_merge_bang,
+	    MRB_ARGS_REQ(1));
+	mrb->define_method(cls, "reset", running_stat_reset, MRB_ARGS_NONE());
+	mrb->define_method(cls, "count", running_stat_samples, MRB_ARGS_NONE());
+	mrb->define_method(cls, "mean",
+	    running_stat_float<&RunningStatistic::mean>, MRB_ARGS_NONE());
+	mrb->define_method(cls, "sum",
+	    running_stat_float<&RunningStatistic::sum>, MRB_ARGS_NONE());
+	mrb->define_method(cls, "variance",
+	    running_stat_float<&RunningStatistic::variance>, MRB_ARGS_NONE());
+	mrb->define_method(cls, "sample_variance",
+	    running_stat_float<&RunningStatistic::sample_variance>,
+	    MRB_ARGS_NONE());
+	mrb->define_method(cls, "standard_deviation",
+	    running_stat_float<&RunningStatistic::standard_deviation>,
+	    MRB_ARGS_NONE());
+	mrb->define_method(cls, "stddev",
+	    running_stat_float<&RunningStatistic::standard_deviation>,
+	    MRB_ARGS_NONE());
+	mrb->define_method(cls, "min",
+	    running_stat_bound<&RunningStatistic::min>, MRB_ARGS_NONE());
+	mrb->define_method(cls, "max",
+	    running_stat_bound<&RunningStatistic::max>, MRB_ARGS_NONE());
+	mrb->define_method(cls, "quantile", running_stat_quantile,
+	    MRB_ARGS_REQ(1));
+	mrb->define_method(cls, "quantiles", running_stat_quantiles,
+	    MRB_ARGS_NONE());
+	mrb->define_method(cls, "to_s", running_stat_to_s, MRB_ARGS_NONE());
+	mrb->define_method(cls, "inspect", running_stat_to_s,
+	    MRB_ARGS_NONE());
+	return cls;
+}
@@ -0,0 +1,143 @@
+/* SPDX-License-Identifier: ISC */
+
+#ifndef EULER_MATH_RUNNING_STATISTIC_H
+#define EULER_MATH_RUNNING_STATISTIC_H
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <span>
+
+#include "euler/util/ext.h"
+#include "euler/util/object.h"
+
+namespace euler::math {
+
+/* Streaming estimate of one quantile in constant memory, after Jain and
+ * Chlamtac's P-square algorithm: five markers track the minimum, the maximum,
+ * the quantile itself and the two halfway points between, and are nudged
+ * along a parabola as values arrive. */
+class P2Quantile {
+public:
+	P2Quantile() = default;
+	explicit P2Quantile(double p);
+
+	[[nodiscard]] double
+	p() const
+	{
+		return _p;
+	}
+
+	void push(double value);
+	/* Exact for up to five values, an estimate after that. Undefined if
+	 * nothing was pushed. */
+	[[nodiscard]] double estimate() const;
+	/* Approximate: the markers of the two estimators are averaged by
+	 * count, which is close for similar distributions but not exact. */
+	void merge(const P2Quantile &other);
+	void reset();
+
+private:
+	static constexpr int MARKERS = 5;
+
+	double _p = 0.5;
+	uint64_t _count = 0;
+	std::array<double, MARKERS> _heights {};
+	std::array<double, MARKERS> _positions {};
+	std::array<double, MARKERS> _desired {};
+	std::array<double, MARKERS> _increments {};
+};
+
+/* Count, mean, variance, minimum and maximum of a stream of values, plus up
+ * to MAX_QUANTILES streaming quantiles, all in constant memory. The moments
+ * use Welford's update for single values and Chan's pairwise combination for
+ * batches and merges, so per-thread partials can be merged without losing
+ * precision. Not synchronized; give each thread its own and merge them. */
+class RunningStatistic final : public util::Object {
+	BIND_MRUBY("Euler::Math::RunningStatistic", RunningStatistic,
+	    math.running_stat);
+
+public:
+	static constexpr size_t MAX_QUANTILES = 8;
+
+	RunningStatistic() = default;
+	/* At most MAX_QUANTILES, each in [0, 1]. */
+	explicit RunningStatistic(std::span<const double> quantiles);
+
+	void push(double value);
+	/* Vectorized over the batch; values are pushed one at a time only into
+	 * the quantile estimators, if there are any. */
+	template <typename T> void push(std::span<const T> values);
+	/* Replaces the tracked quantiles and forgets every value. */
+	void track(std::span<const double> quantiles);
+	/* other must track the same quantiles in the same order. */
+	void merge(const RunningStatistic &other);
+	[[nodiscard]] bool same_quantiles(const RunningStatistic &other) const;
+	void reset();
+
+	[[nodiscard]] uint64_t
+	count() const
+	{
+		return _samples;
+	}
+
+	[[nodiscard]] double
+	mean() const
+	{
+		return _mean;
+	}
+
+	[[nodiscard]] double
+	sum() const
+	{
+		return _mean * static_cast<double>(_samples);
+	}
+
+	/* Population variance; 0 for fewer than two values. */
+	[[nodiscard]] double variance() const;
+	/* Bessel-corrected; 0 for fewer than two values. */
+	[[nodiscard]] double sample_variance() const;
+	[[nodiscard]] double standard_deviation() const;
+
+	/* Both are undefined for an empty statistic. */
+	[[nodiscard]] double
+	min() const
+	{
+		return _min;
+	}
+
+	[[nodiscard]] double
+	max() const
+	{
+		return _max;
+	}
+
+	[[nodiscard]] std::span<const P2Quantile>
+	quantiles() const
+	{
+		return { _quantiles.data(), _quantile_count };
+	}
+
+	/* The estimate for p, if p is one of the tracked quantiles and any
+	 * value was pushed. */
+	[[nodiscard]] std::optional<double> quantile(double p) const;
+
+private:
+	/* Chan et al.: folds in a batch of count values with the given mean,
+	 * sum of squared deviations, minimum and maximum. */
+	void combine(uint64_t count, double mean, double m2, double min,
+	    double max);
+
+	uint64_t _samples = 0;
+	double _mean = 0.0;
+	/* sum of squared deviations from the mean */
+	double _m2 = 0.0;
+	double _min = 0.0;
+	double _max = 0.0;
+	size_t _quantile_count = 0;
+	std::array<P2Quantile, MAX_QUANTILES> _quantiles;
+};
+
+} /* namespace euler::math */
+
+#endif /* EULER_MATH_RUNNING_STATISTIC_H */
@@ -0,0 +1,723 @@
+/* SPDX-License-Identifier: ISC */
+
+#include "euler/math/small.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <mruby/array.h>
+#include <mruby/data.h>
+#include <mruby/istruct.h>
+
+#include "euler/math/matrix.h"
+#include "euler/util/state.h"
+
+using euler::math::Small;
+
+namespace {
+/* Blocks for the Small types too big for an istruct. mruby objects are created
+ * and collected on the thread that runs their state, so a list per thread
+ * needs no locking. */
+template <size_t Bytes> class BlockPool {
+public:
+	static void *
+	take()
+	{
+		auto &blocks = free_blocks();
+		if (blocks.empty()) return ::operator new(Bytes);
+		const auto block = blocks.back();
+		blocks.pop_back();
+		return block;
+	}
+
+	static void
+	give(mrb_state *, void *block)
+	{
+		if (block == nullptr) return;
+		auto &blocks = free_blocks();
+		if (blocks.size() < LIMIT) blocks.push_back(block);
+		else ::operator delete(block);
+	}
+
+private:
+	static constexpr size_t LIMIT = 4096;
+
+	struct List {
+		std::vector<void *> blocks;
+
+		List() { blocks.reserve(LIMIT); }
+
+		~List()
+		{
+			for (const auto block : blocks)
+				::operator delete(block);
+		}
+	};
+
+	static std::vector<void *> &
+	free_blocks()
+	{
+		thread_local List list;
+		return list.blocks;
+	}
+};
+
+template <int Rows, int Columns> struct Layout {
+	static constexpr size_t BYTES = sizeof(float) * Rows * Columns;
+	static constexpr bool INLINE = BYTES <= ISTRUCT_DATA_SIZE;
+	using Pool = BlockPool<BYTES>;
+};
+} /* namespace */
+
+template <int Rows, int Columns>
+static constexpr const char *
+class_name()
+{
+	if constexpr (Columns == 1) {
+		constexpr const char *NAMES[] = { "Vec2", "Vec3", "Vec4" };
+		return NAMES[Rows - 2];
+	} else {
+		constexpr const char *NAMES[] = { "Mat2", "Mat3", "Mat4" };
+		return NAMES[Rows - 2];
+	}
+}
+
+template <int Rows, int Columns>
+static const mrb_data_type DATA_TYPE = {
+	.struct_name = class_name<Rows, Columns>(),
+	.dfree = Layout<Rows, Columns>::Pool::give,
+};
+
+template <int Rows, int Columns>
+RClass *
+Small<Rows, Columns>::fetch_class(const util::Reference<util::State> &state)
+{
+	const auto &math = state->modules().math;
+	if constexpr (Columns == 1) {
+		if constexpr (Rows == 2) return math.vec2;
+		else if constexpr (Rows == 3) return math.vec3;
+		else return math.vec4;
+	} else {
+		if constexpr (Rows == 2) return math.mat2;
+		else if constexpr (Rows == 3) return math.mat3;
+		else return math.mat4;
+	}
+}
+
+template <int Rows, int Columns>
+float *
+Small<Rows, Columns>::elements(mrb_state *mrb, const mrb_value value)
+{
+	const auto state = util::State::get(mrb);
+	if constexpr (Layout<Rows, Columns>::INLINE) {
+		if (!mrb_istruct_p(value)
+		    || !state->mrb()->obj_is_kind_of(value, fetch_class(state)))
+			return nullptr;
+		return static_cast<float *>(mrb_istruct_ptr(value));
+	} else {
+		return static_cast<float *>(state->mrb()->data_get_ptr(value,
+		    &DATA_TYPE<Rows, Columns>));
+	}
+}
+
+template <int Rows, int Columns>
+float *
+Small<Rows, Columns>::checked_elements(mrb_state *mrb, const mrb_value value)
+{
+	if (const auto out = elements(mrb, value); out != nullptr) return out;
+	const auto state = util::State::get(mrb);
+	state->mrb()->raisef(state->mrb()->type_error(),
+	    "Expected a Euler::Math::%s", class_name<Rows, Columns>());
+}
+
+template <int Rows, int Columns>
+mrb_value
+Small<Rows, Columns>::create(mrb_state *mrb, float *&out)
+{
+	const auto state = util::State::get(mrb);
+	const auto cls = fetch_class(state);
+	if constexpr (Layout<Rows, Columns>::INLINE) {
+		const auto object
+		    = state->mrb()->obj_alloc(MRB_TT_ISTRUCT, cls);
+		const auto value = mrb_obj_value(object);
+		out = static_cast<float *>(mrb_istruct_ptr(value));
+		return value;
+	} else {
+		out = static_cast<float *>(Layout<Rows, Columns>::Pool::take());
+		return mrb_obj_value(state->mrb()->data_object_alloc(cls, out,
+		    &DATA_TYPE<Rows, Columns>));
+	}
+}
+
+template <int Rows, int Columns>
+static mrb_value
+small_allocate(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	const auto block = Layout<Rows, Columns>::Pool::take();
+	Small<Rows, Columns>::map(static_cast<float *>(block)).setZero();
+	return mrb_obj_value(state->mrb()->data_object_alloc(
+	    mrb_class_ptr(self), block, &DATA_TYPE<Rows, Columns>));
+}
+
+static float
+read_float(mrb_state *mrb, const mrb_value value)
+{
+	const auto state = euler::util::State::get(mrb);
+	return static_cast<float>(state->mrb()->to_flo(value));
+}
+
+static bool
+is_number(const mrb_value value)
+{
+	return mrb_float_p(value) || mrb_integer_p(value);
+}
+
+/**
+ * @overload Euler::Math::Vec3#initialize(x, y, z)
+ *   Vectors take one number per component, or none for a zero vector.
+ * @overload Euler::Math::Mat3#initialize(*rows)
+ *   Matrices take their rows as arrays, or every element in row-major order,
+ *   or nothing for an identity matrix.
+ */
+template <int Rows, int Columns>
+static mrb_value
+small_initialize(mrb_state *mrb, const mrb_value self)
+{
+	using S = Small<Rows, Columns>;
+	const auto state = euler::util::State::get(mrb);
+	mrb_value *args;
+	mrb_int count;
+	state->mrb()->get_args("*", &args, &count);
+	auto m = S::map(S::checked_elements(mrb, self));
+	if (count == 0) {
+		if constexpr (S::IS_VECTOR) m.setZero();
+		else m.setIdentity();
+		return mrb_nil_value();
+	}
+	if (count == S::SIZE) {
+		for (int i = 0; i < S::SIZE; ++i)
+			m(i / Columns, i % Columns) = read_float(mrb, args[i]);
+		return mrb_nil_value();
+	}
+	bool rows = !S::IS_VECTOR && count == Rows;
+	for (int i = 0; rows && i < Rows; ++i)
+		rows = mrb_array_p(args[i]) && RARRAY_LEN(args[i]) == Columns;
+	if (!rows) {
+		state->mrb()->raisef(state->mrb()->argument_error(),
+		    "Wrong arguments for Euler::Math::%s",
+		    class_name<Rows, Columns>());
+	}
+	for (int i = 0; i < Rows; ++i) {
+		const auto row = RARRAY_PTR(args[i]);
+		for (int j = 0; j < Columns; ++j)
+			m(i, j) = read_float(mrb, row[j]);
+	}
+	return mrb_nil_value();
+}
+
+template <int Rows, int Columns>
+static mrb_value
+small_initialize_copy(mrb_state *mrb, const mrb_value self)
+{
+	using S = Small<Rows, Columns>;
+	const auto state = euler::util::State::get(mrb);
+	mrb_value other;
+	state->mrb()->get_args("o", &other);
+	const auto source = S::checked_elements(mrb, other);
+	if constexpr (!Layout<Rows, Columns>::INLINE) {
+		/* dup allocates the copy without calling allocate */
+		if (S::elements(mrb, self) == nullptr) {
+			mrb_data_init(self, Layout<Rows, Columns>::Pool::take(),
+			    &DATA_TYPE<Rows, Columns>);
+		}
+	}
+	S::map(S::checked_elements(mrb, self)) = typename S::ConstMap(source);
+	return self;
+}
+
+/**
+ * @overload Euler::Math::Mat3.identity
+ *   @return [Euler::Math::Mat3] An identity matrix.
+ */
+template <int Rows, int Columns>
+static mrb_value
+small_identity(mrb_state *mrb, mrb_value)
+{
+	using S = Small<Rows, Columns>;
+	float *out;
+	const auto result = S::create(mrb, out);
+	S::map(out).setIdentity();
+	return result;
+}
+
+template <int Rows, int Columns, int I>
+static mrb_value
+small_component(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	const auto m = Small<Rows, Columns>::checked_elements(mrb, self);
+	return state->mrb()->float_value(m[I]);
+}
+
+template <int Rows, int Columns, int I>
+static mrb_value
+small_set_component(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	mrb_float value;
+	state->mrb()->get_args("f", &value);
+	Small<Rows, Columns>::checked_elements(mrb, self)[I]
+	    = static_cast<float>(value);
+	return state->mrb()->float_value(value);
+}
+
+/* Reads the index arguments of [] and []=: one for vectors, a row and a
+ * column for matrices. */
+template <int Rows, int Columns>
+static int
+read_index(mrb_state *mrb, const mrb_value *args, const mrb_int count)
+{
+	const auto state = euler::util::State::get(mrb);
+	constexpr int EXPECTED = Columns == 1 ? 1 : 2;
+	if (count != EXPECTED) {
+		state->mrb()->raisef(state->mrb()->argument_error(),
+		    "wrong number of indices (given %i, expected %d)", count,
+		    EXPECTED);
+	}
+	const auto row = mrb_integer(state->mrb()->to_int(args[0]));
+	const auto column
+	    = Columns == 1 ? 0 : mrb_integer(state->mrb()->to_int(args[1]));
+	if (row < 0 || row >= Rows || column < 0 || column >= Columns) {
+		state->mrb()->raise(state->mrb()->index_error(),
+		    "Index out of range");
+	}
+	/* column-major, like Eigen */
+	return static_cast<int>(column * Rows + row);
+}
+
+/**
+ * @overload Euler::Math::Vec3#[](index)
+ *   @return [Float] The component at index.
+ * @overload Euler::Math::Mat3#[](row, column)
+ *   @return [Float] The element at row, column.
+ */
+template <int Rows, int Columns>
+static mrb_value
+small_get(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	mrb_value *args;
+	mrb_int count;
+	state->mrb()->get_args("*", &args, &count);
+	const auto index = read_index<Rows, Columns>(mrb, args, count);
+	const auto m = Small<Rows, Columns>::checked_elements(mrb, self);
+	return state->mrb()->float_value(m[index]);
+}
+
+template <int Rows, int Columns>
+static mrb_value
+small_set(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	mrb_value *args;
+	mrb_int count;
+	state->mrb()->get_args("*", &args, &count);
+	if (count < 1) {
+		state->mrb()->raise(state->mrb()->argument_error(),
+		    "Missing value to assign");
+	}
+	const auto index = read_index<Rows, Columns>(mrb, args, count - 1);
+	const auto value = read_float(mrb, args[count - 1]);
+	Small<Rows, Columns>::checked_elements(mrb, self)[index] = value;
+	return args[count - 1];
+}
+
+template <int Rows, int Columns, bool Subtract>
+static mrb_value
+small_add(mrb_state *mrb, const mrb_value self)
+{
+	using S = Small<Rows, Columns>;
+	const auto state = euler::util::State::get(mrb);
+	mrb_value other;
+	state->mrb()->get_args("o", &other);
+	const auto lhs = S::read(mrb, self);
+	const auto rhs = S::read(mrb, other);
+	float *out;
+	const auto result = S::create(mrb, out);
+	if constexpr (Subtract) S::map(out) = lhs - rhs;
+	else S::map(out) = lhs + rhs;
+	return result;
+}
+
+/**
+ * @overload Euler::Math::Vec3#*(scalar)
+ *   @return [Euler::Math::Vec3]
+ * @overload Euler::Math::Mat3#*(other)
+ *   @param other [Numeric, Euler::Math::Mat3, Euler::Math::Vec3]
+ *   @return [Euler::Math::Mat3, Euler::Math::Vec3] The scaled matrix, or
+ *     the matrix product.
+ */
+template <int Rows, int Columns>
+static mrb_value
+small_multiply(mrb_state *mrb, const mrb_value self)
+{
+	using S = Small<Rows, Columns>;
+	using V = Small<Rows, 1>;
+	const auto state = euler::util::State::get(mrb);
+	mrb_value other;
+	state->mrb()->get_args("o", &other);
+	const auto lhs = S::read(mrb, self);
+	float *out;
+	if (is_number(other)) {
+		const auto scale = read_float(mrb, other);
+		const auto result = S::create(mrb, out);
+		S::map(out) = lhs * scale;
+		return result;
+	}
+	if constexpr (!S::IS_VECTOR) {
+		if (const auto rhs = S::elements(mrb, other); rhs != nullptr) {
+			const auto result = S::create(mrb, out);
+			S::map(out).noalias()
+			    = lhs * typename S::ConstMap(rhs);
+			return result;
+		}
+		if (const auto rhs = V::elements(mrb, other); rhs != nullptr) {
+			const auto result = V::create(mrb, out);
+			V::map(out).noalias()
+			    = lhs * typename V::ConstMap(rhs);
+			return result;
+		}
+	}
+	state->mrb()->raisef(state->mrb()->type_error(),
+	    "Cannot multiply a Euler::Math::%s by that",
+	    class_name<Rows, Columns>());
+}
+
+template <int Rows, int Columns>
+static mrb_value
+small_divide(mrb_state *mrb, const mrb_value self)
+{
+	using S = Small<Rows, Columns>;
+	const auto state = euler::util::State::get(mrb);
+	mrb_float divisor;
+	state->mrb()->get_args("f", &divisor);
+	const auto lhs = S::read(mrb, self);
+	float *out;
+	const auto result = S::create(mrb, out);
+	S::map(out) = lhs / static_cast<float>(divisor);
+	return result;
+}
+
+template <int Rows, int Columns>
+static mrb_value
+small_negate(mrb_state *mrb, const mrb_value self)
+{
+	using S = Small<Rows, Columns>;
+	const auto lhs = S::read(mrb, self);
+	float *out;
+	const auto result = S::create(mrb, out);
+	S::map(out) = -lhs;
+	return result;
+}
+
+template <int Rows, int Columns>
+static mrb_value
+small_equal(mrb_state *mrb, const mrb_value self)
+{
+	using S = Small<Rows, Columns>;
+	const auto state = euler::util::State::get(mrb);
+	mrb_value other;
+	state->mrb()->get_args("o", &other);
+	const auto rhs = S::elements(mrb, other);
+	if (rhs == nullptr) return mrb_false_value();
+	return mrb_bool_value(S::read(mrb, self) == typename S::ConstMap(rhs));
+}
+
+template <int Rows>
+static mrb_value
+vec_dot(mrb_state *mrb, const mrb_value self)
+{
+	using S = Small<Rows, 1>;
+	const auto state = euler::util::State::get(mrb);
+	mrb_value other;
+	state->mrb()->get_args("o", &other);
+	const auto dot = S::read(mrb, self).dot(S::read(mrb, other));
+	return state->mrb()->float_value(dot);
+}
+
+template <int Rows>
+static mrb_value
+vec_length(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	const auto length = Small<Rows, 1>::read(mrb, self).norm();
+	return state->mrb()->float_value(length);
+}
+
+template <int Rows>
+static mrb_value
+vec_length_squared(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	const auto length = Small<Rows, 1>::read(mrb, self).squaredNorm();
+	return state->mrb()->float_value(length);
+}
+
+/**
+ * @overload Euler::Math::Vec3#normalize
+ *   @return [Euler::Math::Vec3] A unit vector in the same direction, or a
+ *     zero vector if this one is zero.
+ */
+template <int Rows>
+static mrb_value
+vec_normalize(mrb_state *mrb, const mrb_value self)
+{
+	using S = Small<Rows, 1>;
+	const auto v = S::read(mrb, self);
+	float *out;
+	const auto result = S::create(mrb, out);
+	S::map(out) = v.normalized();
+	return result;
+}
+
+/**
+ * @overload Euler::Math::Vec2#cross(other)
+ *   @return [Float] The z component of the 3D cross product.
+ * @overload Euler::Math::Vec3#cross(other)
+ *   @return [Euler::Math::Vec3]
+ */
+template <int Rows>
+static mrb_value
+vec_cross(mrb_state *mrb, const mrb_value self)
+{
+	using S = Small<Rows, 1>;
+	const auto state = euler::util::State::get(mrb);
+	mrb_value other;
+	state->mrb()->get_args("o", &other);
+	const auto lhs = S::read(mrb, self);
+	const auto rhs = S::read(mrb, other);
+	if constexpr (Rows == 2) {
+		return state->mrb()->float_value(
+		    lhs.x() * rhs.y() - lhs.y() * rhs.x());
+	} else {
+		float *out;
+		const auto result = S::create(mrb, out);
+		S::map(out) = lhs.cross(rhs);
+		return result;
+	}
+}
+
+template <int Rows>
+static mrb_value
+mat_transpose(mrb_state *mrb, const mrb_value self)
+{
+	using S = Small<Rows, Rows>;
+	const auto m = S::read(mrb, self);
+	float *out;
+	const auto result = S::create(mrb, out);
+	S::map(out) = m.transpose();
+	return result;
+}
+
+template <int Rows>
+static mrb_value
+mat_determinant(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	const auto m = Small<Rows, Rows>::read(mrb, self);
+	return state->mrb()->float_value(m.determinant());
+}
+
+/**
+ * @overload Euler::Math::Mat3#inverse
+ *   @return [Euler::Math::Mat3]
+ *   @raise [ArgumentError] If the matrix is singular.
+ */
+template <int Rows>
+static mrb_value
+mat_inverse(mrb_state *mrb, const mrb_value self)
+{
+	using S = Small<Rows, Rows>;
+	const auto state = euler::util::State::get(mrb);
+	const auto m = S::read(mrb, self);
+	if (m.determinant() == 0.0f) {
+		state->mrb()->raise(state->mrb()->argument_error(),
+		    "Matrix is not invertible");
+	}
+	float *out;
+	const auto result = S::create(mrb, out);
+	/* closed-form cofactors for all of these sizes */
+	S::map(out) = m.inverse();
+	return result;
+}
+
+template <int Rows, int Columns>
+static mrb_value
+small_to_a(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	const auto m = Small<Rows, Columns>::read(mrb, self);
+	const auto &ruby = state->mrb();
+	const auto out = ruby->ary_new_capa(Rows);
+	for (int i = 0; i < Rows; ++i) {
+		if constexpr (Columns == 1) {
+			ruby->ary_push(out, ruby->float_value(m(i)));
+			continue;
+		}
+		const auto row = ruby->ary_new_capa(Columns);
+		for (int j = 0; j < Columns; ++j)
+			ruby->ary_push(row, ruby->float_value(m(i, j)));
+		ruby->ary_push(out, row);
+	}
+	return out;
+}
+
+/**
+ * @overload Euler::Math::Mat3#to_matrix
+ *   @return [Euler::Math::Matrix] A :float Matrix with the same elements.
+ */
+template <int Rows, int Columns>
+static mrb_value
+small_to_matrix(mrb_state *mrb, const mrb_value self)
+{
+	using euler::math::DenseMatrix;
+	using euler::math::Matrix;
+	const auto state = euler::util::State::get(mrb);
+	const auto m = Small<Rows, Columns>::read(mrb, self);
+	auto matrix = euler::util::make_reference<Matrix>(
+	    Matrix::Storage(DenseMatrix<float>(m)));
+	return state->wrap(matrix);
+}
+
+template <int Rows, int Columns>
+static mrb_value
+small_to_s(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	const auto m = Small<Rows, Columns>::read(mrb, self);
+	std::string out = class_name<Rows, Columns>();
+	out += Columns == 1 ? "(" : "[";
+	for (int i = 0; i < Rows; ++i) {
+		if (i > 0) out += ", ";
+		if constexpr (Columns != 1) out += "[";
+		for (int j = 0; j < Columns; ++j) {
+			char buf[32];
+			snprintf(buf, sizeof(buf), j > 0 ? ", %g" : "%g",
+			    static_cast<double>(m(i, j)));
+			out += buf;
+		}
+		if constexpr (Columns != 1) out += "]";
+	}
+	out += Columns == 1 ? ")" : "]";
+	return state->mrb()->str_new(out.data(), out.size());
+}
+
+template <int Rows, int Columns>
+RClass *
+Small<Rows, Columns>::init(const util::Reference<util::State> &state,
+    RClass *mod)
+{
+	const auto &mrb = state->mrb();
+	const auto cls = mrb->define_class_under(mod,
+	    class_name<Rows, Columns>(), state->object_class());
+	if constexpr (Layout<Rows, Columns>::INLINE) {
+		MRB_SET_INSTANCE_TT(cls, MRB_TT_ISTRUCT);
+	} else {
+		MRB_SET_INSTANCE_TT(cls, MRB_TT_DATA);
+		mrb->define_class_method(cls, "allocate",
+		    small_allocate<Rows, Columns>, MRB_ARGS_NONE());
+	}
+	mrb->define_method(cls, "initialize",
+	    small_initialize<Rows, Columns>, MRB_ARGS_ANY());
+	mrb->define_method(cls, "initialize_copy",
+	    small_initialize_copy<Rows, Columns>, MRB_ARGS_REQ(1));
+	mrb->define_method(cls, "[]", small_get<Rows, Columns>,
+	    MRB_ARGS_ARG(1, 1));
+	mrb->define_method(cls, "[]=", small_set<Rows, Columns>,
+	    MRB_ARGS_ARG(2, 1));
+	mrb->define_method(cls, "+", small_add<Rows, Columns, false>,
+	    MRB_ARGS_REQ(1));
+	mrb->define_method(cls, "-", small_add<Rows, Columns, true>,
+	    MRB_ARGS_REQ(1));
+	mrb->define_method(cls, "*", small_multiply<Rows, Columns>,
+	    MRB_ARGS_REQ(1));
+	mrb->define_method(cls, "/", small_divide<Rows, Columns>,
+	    MRB_ARGS_REQ(1));
+	mrb->define_method(cls, "-@", small_negate<Rows, Columns>,
+	    MRB_ARGS_NONE());
+	mrb->define_method(cls, "==", small_equal<Rows, Columns>,
+	    MRB_ARGS_REQ(1));
+	mrb->define_method(cls, "to_a", small_to_a<Rows, Columns>,
+	    MRB_ARGS_NONE());
+	mrb->define_method(cls, "to_matrix", small_to_matrix<Rows, Columns>,
+	    MRB_ARGS_NONE());
+	mrb->define_method(cls, "to_s", small_to_s<Rows, Columns>,
+	    MRB_ARGS_NONE());
+	mrb->define_method(cls, "inspect", small_to_s<Rows, Columns>,
+	    MRB_ARGS_NONE());
+	if constexpr (IS_VECTOR) {
+		mrb->define_method(cls, "x", small_component<Rows, 1, 0>,
+		    MRB_ARGS_NONE());
+		mrb->define_method(cls, "x=", small_set_component<Rows, 1, 0>,
+		    MRB_ARGS_REQ(1));
+		mrb->define_method(cls, "y", small_component<Rows, 1, 1>,
+		    MRB_ARGS_NONE());
+		mrb->define_method(cls, "y=", small_set_component<Rows, 1, 1>,
+		    MRB_ARGS_REQ(1));
+		if constexpr (Rows > 2) {
+			mrb->define_method(cls, "z",
+			    small_component<Rows, 1, 2>, MRB_ARGS_NONE());
+			mrb->define_method(cls, "z=",
+			    small_set_component<Rows, 1, 2>, MRB_ARGS_REQ(1));
+		}
+		if constexpr (Rows > 3) {
+			mrb->define_method(cls, "w",
+			    small_component<Rows, 1, 3>, MRB_ARGS_NONE());
+			mrb->define_method(cls, "w=",
+			    small_set_component<Rows, 1, 3>, MRB_ARGS_REQ(1));
+		}
+		mrb->define_method(cls, "dot", vec_dot<Rows>, MRB_ARGS_REQ(1));
+		mrb->define_method(cls, "length", vec_length<Rows>,
+		    MRB_ARGS_NONE());
+		mrb->define_method(cls, "length_squared",
+		    vec_length_squared<Rows>, MRB_ARGS_NONE());
+		mrb->define_method(cls, "normalize", vec_normalize<Rows>,
+		    MRB_ARGS_NONE());
+		if constexpr (Rows < 4) {
+			mrb->define_method(cls, "cross", vec_cross<Rows>,
+			    MRB_ARGS_REQ(1));
+		}
+	} else {
+		mrb->define_class_method(cls, "identity",
+		    small_identity<Rows, Columns>, MRB_ARGS_NONE());
+		mrb->define_method(cls, "transpose", mat_transpose<Rows>,
+		    MRB_ARGS_NONE());
+		mrb->define_method(cls, "determinant", mat_determinant<Rows>,
+		    MRB_ARGS_NONE());
+		mrb->define_method(cls, "inverse", mat_inverse<Rows>,
+		    MRB_ARGS_NONE());
+	}
+	return cls;
+}
+
+template struct euler::math::Small<2, 1>;
+template struct euler::math::Small<3, 1>;
+template struct euler::math::Small<4, 1>;
+template struct euler::math::Small<2, 2>;
+template struct euler::math::Small<3, 3>;
+template struct euler::math::Small<4, 4>;
+
+void
+euler::math::init_small(const util::Reference<util::State> &state,
+    RClass *mod)
+{
+	auto &math = state->modules().math;
+	math.vec2 = SmallVec2::init(state, mod);
+	math.vec3 = SmallVec3::init(state, mod);
+	math.vec4 = SmallVec4::init(state, mod);
+	math.mat2 = SmallMat2::init(state, mod);
+	math.mat3 = SmallMat3::init(state, mod);
+	math.mat4 = SmallMat4::init(state, mod);
+}
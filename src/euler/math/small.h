@@ -0,0 +1,78 @@
+/* SPDX-License-Identifier: ISC */
+
+#ifndef EULER_MATH_SMALL_H
+#define EULER_MATH_SMALL_H
+
+#include <Eigen/Eigen>
+
+#include "euler/util/ext.h"
+#include "euler/util/object.h"
+
+namespace euler::math {
+
+/* Euler::Math::Vec2 through Mat4: float vectors and square matrices with the
+ * size fixed at compile time. Unlike Matrix these are not util::Objects; the
+ * elements live in the Ruby object itself, so every operation runs on fully
+ * unrolled Eigen code and costs exactly one mruby object for its result.
+ *
+ * Vec2, Vec3, Vec4 and Mat2 fit in an mruby istruct. Mat3 and Mat4 don't, and
+ * are RData pointing at blocks that are recycled through a free list rather
+ * than returned to the heap. */
+template <int Rows, int Columns> struct Small {
+	static_assert(Columns == 1 || Columns == Rows);
+
+	using Value = Eigen::Matrix<float, Rows, Columns>;
+	/* unaligned: neither istructs nor pool blocks are 16-byte aligned */
+	using Map = Eigen::Map<Value>;
+	using ConstMap = Eigen::Map<const Value>;
+
+	static constexpr bool IS_VECTOR = Columns == 1;
+	static constexpr int SIZE = Rows * Columns;
+
+	static RClass *fetch_class(const util::Reference<util::State> &state);
+	static RClass *init(const util::Reference<util::State> &state,
+	    RClass *mod);
+
+	/* The elements of value, column-major; nullptr if value isn't one of
+	 * these. */
+	static float *elements(mrb_state *mrb, mrb_value value);
+	/* Like elements, but raises TypeError instead of returning nullptr. */
+	static float *checked_elements(mrb_state *mrb, mrb_value value);
+	/* A new, uninitialized object; its elements are returned in out. */
+	static mrb_value create(mrb_state *mrb, float *&out);
+
+	static Map
+	map(float *elements)
+	{
+		return Map(elements);
+	}
+
+	static mrb_value
+	wrap(mrb_state *mrb, const Value &value)
+	{
+		float *out;
+		const auto result = create(mrb, out);
+		map(out) = value;
+		return result;
+	}
+
+	static ConstMap
+	read(mrb_state *mrb, const mrb_value value)
+	{
+		return ConstMap(checked_elements(mrb, value));
+	}
+};
+
+using SmallVec2 = Small<2, 1>;
+using SmallVec3 = Small<3, 1>;
+using SmallVec4 = Small<4, 1>;
+using SmallMat2 = Small<2, 2>;
+using SmallMat3 = Small<3, 3>;
+using SmallMat4 = Small<4, 4>;
+
+/* Defines all six classes under mod. */
+void init_small(const util::Reference<util::State> &state, RClass *mod);
+
+} /* namespace euler::math */
+
+#endif /* EULER_MATH_SMALL_H */
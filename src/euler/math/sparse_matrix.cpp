@@ -0,0 +1,471 @@
+/* SPDX-License-Identifier: ISC */
+
+#include "euler/math/sparse_matrix.h"
+
+#include <cstdio>
+#include <vector>
+
+#include <mruby/array.h>
+
+#include "euler/math/matrix.h"
+#include "euler/util/state.h"
+
+using euler::math::DenseMatrix;
+using euler::math::Matrix;
+using euler::math::SparseMatrix;
+using euler::math::SparseStorage;
+using euler::math::Triplet;
+using euler::util::size_type;
+
+SparseMatrix::SparseMatrix(const size_type rows, const size_type columns)
+    : _storage(rows, columns)
+{
+	_storage.makeCompressed();
+}
+
+SparseMatrix::SparseMatrix(SparseStorage storage)
+    : _storage(std::move(storage))
+{
+	_storage.makeCompressed();
+}
+
+void
+SparseMatrix::set_from_triplets(const size_type rows, const size_type columns,
+    const std::span<const Triplet> triplets)
+{
+	_storage.resize(rows, columns);
+	_storage.setFromTriplets(triplets.begin(), triplets.end());
+	_storage.makeCompressed();
+}
+
+bool
+SparseMatrix::set_from_csr(const size_type rows, const size_type columns,
+    const std::span<const size_type> row_offsets,
+    const std::span<const size_type> column_indices,
+    const std::span<const double> values)
+{
+	const auto count = static_cast<size_type>(values.size());
+	if (rows < 0 || columns < 0
+	    || row_offsets.size() != static_cast<size_t>(rows) + 1
+	    || column_indices.size() != values.size() || row_offsets[0] != 0
+	    || row_offsets[rows] != count)
+		return false;
+	std::vector<Triplet> triplets;
+	triplets.reserve(values.size());
+	for (size_type i = 0; i < rows; ++i) {
+		if (row_offsets[i] > row_offsets[i + 1]) return false;
+		for (auto k = row_offsets[i]; k < row_offsets[i + 1]; ++k) {
+			const auto j = column_indices[k];
+			if (j < 0 || j >= columns) return false;
+			triplets.emplace_back(i, j, values[k]);
+		}
+	}
+	set_from_triplets(rows, columns, triplets);
+	return true;
+}
+
+static void
+check_size(mrb_state *mrb, const mrb_int rows, const mrb_int columns)
+{
+	if (rows >= 0 && columns >= 0) return;
+	const auto state = euler::util::State::get(mrb);
+	state->mrb()->raise(state->mrb()->argument_error(),
+	    "Matrix dimensions must not be negative");
+}
+
+/* Wraps a new matrix before anything can raise, like Matrix does. */
+static mrb_value
+new_sparse(mrb_state *mrb, SparseMatrix *&matrix)
+{
+	const auto state = euler::util::State::get(mrb);
+	auto ref = euler::util::make_reference<SparseMatrix>();
+	matrix = ref.get();
+	return state->wrap(ref);
+}
+
+static mrb_value
+wrap_sparse(mrb_state *mrb, SparseStorage storage)
+{
+	const auto state = euler::util::State::get(mrb);
+	auto ref = euler::util::make_reference<SparseMatrix>(
+	    std::move(storage));
+	return state->wrap(ref);
+}
+
+static mrb_value
+sparse_allocate(mrb_state *mrb, mrb_value)
+{
+	const auto state = euler::util::State::get(mrb);
+	auto matrix = euler::util::make_reference<SparseMatrix>();
+	return state->wrap(matrix);
+}
+
+/**
+ * @overload Euler::Math::SparseMatrix#initialize(rows, columns)
+ *   Creates a matrix with no nonzeros.
+ *   @param rows [Integer] The number of rows.
+ *   @param columns [Integer] The number of columns.
+ */
+static mrb_value
+sparse_initialize(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	mrb_int rows, columns;
+	state->mrb()->get_args("ii", &rows, &columns);
+	check_size(mrb, rows, columns);
+	auto matrix = euler::util::Reference<SparseMatrix>::unwrap(mrb, self);
+	matrix->set_from_triplets(rows, columns, {});
+	return mrb_nil_value();
+}
+
+/**
+ * @overload Euler::Math::SparseMatrix.from_triplets(rows, columns, triplets)
+ *   @example A 2x2 diagonal matrix
+ *     Euler::Math::SparseMatrix.from_triplets(2, 2, [[0, 0, 4], [1, 1, 9]])
+ *   @param rows [Integer] The number of rows.
+ *   @param columns [Integer] The number of columns.
+ *   @param triplets [Array<Array(Integer, Integer, Numeric)>] Row, column
+ *     and value of each nonzero; values at the same position are summed.
+ *   @return [Euler::Math::SparseMatrix]
+ *   @raise [IndexError] If a position is outside the matrix.
+ */
+static mrb_value
+sparse_from_triplets(mrb_state *mrb, mrb_value)
+{
+	const auto state = euler::util::State::get(mrb);
+	mrb_int rows, columns;
+	mrb_value array;
+	state->mrb()->get_args("iiA", &rows, &columns, &array);
+	check_size(mrb, rows, columns);
+	const char *error = nullptr;
+	bool outside = false;
+	mrb_int i = 0, j = 0;
+	{
+		std::vector<Triplet> triplets;
+		triplets.reserve(RARRAY_LEN(array));
+		for (mrb_int k = 0; k < RARRAY_LEN(array); ++k) {
+			const auto entry = RARRAY_PTR(array)[k];
+			if (!mrb_array_p(entry) || RARRAY_LEN(entry) != 3) {
+				error = "Expected [row, column, value] "
+					"triplets";
+				break;
+			}
+			i = mrb_integer(
+			    state->mrb()->to_int(RARRAY_PTR(entry)[0]));
+			j = mrb_integer(
+			    state->mrb()->to_int(RARRAY_PTR(entry)[1]));
+			if (i < 0 || i >= rows || j < 0 || j >= columns) {
+				outside = true;
+				break;
+			}
+			const auto value
+			    = state->mrb()->to_flo(RARRAY_PTR(entry)[2]);
+			triplets.emplace_back(i, j, value);
+		}
+		if (error == nullptr && !outside) {
+			SparseMatrix *matrix;
+			const auto out = new_sparse(mrb, matrix);
+			matrix->set_from_triplets(rows, columns, triplets);
+			return out;
+		}
+	}
+	if (outside) {
+		state->mrb()->raisef(state->mrb()->index_error(),
+		    "Index (%i, %i) outside of a %ix%i matrix", i, j, rows,
+		    columns);
+	}
+	state->mrb()->raise(state->mrb()->argument_error(), error);
+}
+
+static std::vector<size_type>
+read_indices(mrb_state *mrb, const mrb_value array)
+{
+	const auto state = euler::util::State::get(mrb);
+	std::vector<size_type> out(RARRAY_LEN(array));
+	for (size_t i = 0; i < out.size(); ++i) {
+		out[i] = mrb_integer(
+		    state->mrb()->to_int(RARRAY_PTR(array)[i]));
+	}
+	return out;
+}
+
+/**
+ * @overload Euler::Math::SparseMatrix.from_csr(rows, columns, ptr, idx, values)
+ *   Builds a matrix from compressed sparse row arrays.
+ *   @param rows [Integer] The number of rows.
+ *   @param columns [Integer] The number of columns.
+ *   @param ptr [Array<Integer>] rows + 1 offsets into the other two arrays,
+ *     where each row's nonzeros start; the last is the nonzero count.
+ *   @param idx [Array<Integer>] The column of each nonzero.
+ *   @param values [Array<Numeric>] The value of each nonzero.
+ *   @return [Euler::Math::SparseMatrix]
+ *   @raise [ArgumentError] If the arrays are inconsistent.
+ */
+static mrb_value
+sparse_from_csr(mrb_state *mrb, mrb_value)
+{
+	const auto state = euler::util::State::get(mrb);
+	mrb_int rows, columns;
+	mrb_value offsets_value, indices_value, values_value;
+	state->mrb()->get_args("iiAAA", &rows, &columns, &offsets_value,
+	    &indices_value, &values_value);
+	check_size(mrb, rows, columns);
+	bool valid;
+	mrb_value out;
+	{
+		const auto offsets = read_indices(mrb, offsets_value);
+		const auto indices = read_indices(mrb, indices_value);
+		std::vector<double> values(RARRAY_LEN(values_value));
+		for (size_t i = 0; i < values.size(); ++i) {
+			values[i] = state->mrb()->to_flo(
+			    RARRAY_PTR(values_value)[i]);
+		}
+		SparseMatrix *matrix;
+		out = new_sparse(mrb, matrix);
+		valid = matrix->set_from_csr(rows, columns, offsets, indices,
+		    values);
+	}
+	if (valid) return out;
+	state->mrb()->raise(state->mrb()->argument_error(),
+	    "Inconsistent CSR arrays");
+}
+
+/**
+ * @overload Euler::Math::SparseMatrix.from_matrix(matrix)
+ *   @param matrix [Euler::Math::Matrix] A dense matrix.
+ *   @return [Euler::Math::SparseMatrix] Its nonzero elements.
+ */
+static mrb_value
+sparse_from_matrix(mrb_state *mrb, mrb_value)
+{
+	const auto state = euler::util::State::get(mrb);
+	mrb_value value;
+	state->mrb()->get_args("o", &value);
+	const auto dense = state->unwrap<Matrix>(value);
+	DenseMatrix<double> scratch;
+	const auto &m = dense->as(scratch);
+	return wrap_sparse(mrb, m.sparseView());
+}
+
+static mrb_value
+sparse_row_count(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	const auto matrix = state->unwrap<SparseMatrix>(self);
+	return state->mrb()->int_value(matrix->row_count());
+}
+
+static mrb_value
+sparse_column_count(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	const auto matrix = state->unwrap<SparseMatrix>(self);
+	return state->mrb()->int_value(matrix->column_count());
+}
+
+static mrb_value
+sparse_nonzero_count(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	const auto matrix = state->unwrap<SparseMatrix>(self);
+	return state->mrb()->int_value(matrix->nonzero_count());
+}
+
+/**
+ * @overload Euler::Math::SparseMatrix#[](row, column)
+ *   @return [Float] The element; 0.0 where there is no nonzero.
+ *   @raise [IndexError] If the element is outside the matrix.
+ */
+static mrb_value
+sparse_get(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	mrb_int row, column;
+	state->mrb()->get_args("ii", &row, &column);
+	mrb_int rows, columns;
+	{
+		const auto matrix = state->unwrap<SparseMatrix>(self);
+		rows = matrix->row_count();
+		columns = matrix->column_count();
+		if (row >= 0 && row < rows && column >= 0 && column < columns) {
+			const auto &m = matrix->storage();
+			return state->mrb()->float_value(m.coeff(row, column));
+		}
+	}
+	state->mrb()->raisef(state->mrb()->index_error(),
+	    "Index (%i, %i) outside of a %ix%i matrix", row, column, rows,
+	    columns);
+}
+
+/**
+ * @overload Euler::Math::SparseMatrix#values
+ *   @return [Array<Float>] The nonzeros column by column, rows ascending.
+ */
+static mrb_value
+sparse_values(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	const auto matrix = state->unwrap<SparseMatrix>(self);
+	const auto values = std::as_const(*matrix.get()).values();
+	const auto out = state->mrb()->ary_new_capa(values.size());
+	for (const auto value : values)
+		state->mrb()->ary_push(out, state->mrb()->float_value(value));
+	return out;
+}
+
+/**
+ * @overload Euler::Math::SparseMatrix#values=(values)
+ *   Replaces the nonzeros in the order #values returns them, keeping the
+ *   sparsity pattern, so a factorizer can skip straight to refactorizing.
+ *   @param values [Array<Numeric>, Euler::Math::Matrix] One value per
+ *     nonzero.
+ *   @raise [ArgumentError] If the count doesn't match.
+ */
+static mrb_value
+sparse_set_values(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	mrb_value value;
+	state->mrb()->get_args("o", &value);
+	{
+		auto matrix = state->unwrap<SparseMatrix>(self);
+		auto values = matrix->values();
+		const auto count = static_cast<mrb_int>(values.size());
+		if (mrb_array_p(value) && RARRAY_LEN(value) == count) {
+			for (size_t i = 0; i < values.size(); ++i) {
+				values[i] = state->mrb()->to_flo(
+				    RARRAY_PTR(value)[i]);
+			}
+			return value;
+		}
+		if (!mrb_array_p(value)) {
+			const auto dense = state->unwrap<Matrix>(value);
+			DenseMatrix<double> scratch;
+			const auto &m = dense->as(scratch);
+			if (static_cast<size_t>(m.size()) == values.size()) {
+				std::copy_n(m.data(), values.size(),
+				    values.data());
+				return value;
+			}
+		}
+	}
+	state->mrb()->raise(state->mrb()->argument_error(),
+	    "Expected one value per nonzero");
+}
+
+/**
+ * @overload Euler::Math::SparseMatrix#*(other)
+ *   @param other [Euler::Math::Matrix, Euler::Math::SparseMatrix, Numeric]
+ *   @return [Euler::Math::Matrix, Euler::Math::SparseMatrix] A dense double
+ *     matrix for a dense operand, and a sparse one otherwise.
+ *   @raise [ArgumentError] If the shapes don't allow the product.
+ */
+static mrb_value
+sparse_mul(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	mrb_value other;
+	state->mrb()->get_args("o", &other);
+	{
+		const auto matrix = state->unwrap<SparseMatrix>(self);
+		const auto &a = matrix->storage();
+		if (mrb_integer_p(other) || mrb_float_p(other))
+			return wrap_sparse(mrb,
+			    a * state->mrb()->to_flo(other));
+		if (state->mrb()->obj_is_kind_of(other,
+			state->modules().math.sparse_matrix)) {
+			const auto rhs = state->unwrap<SparseMatrix>(other);
+			if (rhs->row_count() == a.cols()) {
+				SparseStorage product = a * rhs->storage();
+				return wrap_sparse(mrb, std::move(product));
+			}
+		} else {
+			const auto rhs = state->unwrap<Matrix>(other);
+			if (rhs->row_count() == a.cols()) {
+				DenseMatrix<double> scratch;
+				const auto &x = rhs->as(scratch);
+				DenseMatrix<double> product = a * x;
+				auto out = euler::util::make_reference<Matrix>(
+				    Matrix::Storage(std::move(product)));
+				return state->wrap(out);
+			}
+		}
+	}
+	state->mrb()->raise(state->mrb()->argument_error(),
+	    "Matrix shapes don't allow the product");
+}
+
+static mrb_value
+sparse_transpose(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	const auto matrix = state->unwrap<SparseMatrix>(self);
+	return wrap_sparse(mrb, SparseStorage(matrix->storage().transpose()));
+}
+
+/**
+ * @overload Euler::Math::SparseMatrix#to_matrix
+ *   @return [Euler::Math::Matrix] A dense double copy.
+ */
+static mrb_value
+sparse_to_matrix(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	const auto matrix = state->unwrap<SparseMatrix>(self);
+	auto out = euler::util::make_reference<Matrix>(
+	    Matrix::Storage(DenseMatrix<double>(matrix->storage())));
+	return state->wrap(out);
+}
+
+static mrb_value
+sparse_to_s(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	const auto matrix = state->unwrap<SparseMatrix>(self);
+	char buf[96];
+	const auto len = snprintf(buf, sizeof(buf),
+	    "SparseMatrix(%lldx%lld, %lld nonzeros)",
+	    static_cast<long long>(matrix->row_count()),
+	    static_cast<long long>(matrix->column_count()),
+	    static_cast<long long>(matrix->nonzero_count()));
+	return state->mrb()->str_new(buf, len);
+}
+
+RClass *
+SparseMatrix::init(const util::Reference<util::State> &state, RClass *mod,
+    RClass *super)
+{
+	const auto &mrb = state->mrb();
+	const auto cls = mrb->define_class_under(mod, "SparseMatrix",
+	    super != nullptr ? super : state->object_class());
+	MRB_SET_INSTANCE_TT(cls, MRB_TT_DATA);
+	mrb->define_class_method(cls, "allocate", sparse_allocate,
+	    MRB_ARGS_NONE());
+	mrb->define_class_method(cls, "from_triplets", sparse_from_triplets,
+	    MRB_ARGS_REQ(3));
+	mrb->define_class_method(cls, "from_csr", sparse_from_csr,
+	    MRB_ARGS_REQ(5));
+	mrb->define_class_method(cls, "from_matrix", sparse_from_matrix,
+	    MRB_ARGS_REQ(1));
+	mrb->define_method(cls, "initialize", sparse_initialize,
+	    MRB_ARGS_REQ(2));
+	mrb->define_method(cls, "row_count", sparse_row_count,
+	    MRB_ARGS_NONE());
+	mrb->define_method(cls, "column_count", sparse_column_count,
+	    MRB_ARGS_NONE());
+	mrb->define_method(cls, "nonzero_count", sparse_nonzero_count,
+	    MRB_ARGS_NONE());
+	mrb->define_method(cls, "[]", sparse_get, MRB_ARGS_REQ(2));
+	mrb->define_method(cls, "values", sparse_values, MRB_ARGS_NONE());
+	mrb->define_method(cls, "values=", sparse_set_values,
+	    MRB_ARGS_REQ(1));
+	mrb->define_method(cls, "*", sparse_mul, MRB_ARGS_REQ(1));
+	mrb->define_method(cls, "transpose", sparse_transpose,
+	    MRB_ARGS_NONE());
+	mrb->define_method(cls, "t", sparse_transpose, MRB_ARGS_NONE());
+	mrb->define_method(cls, "to_matrix", sparse_to_matrix,
+	    MRB_ARGS_NONE());
+	mrb->define_method(cls, "to_s", sparse_to_s, MRB_ARGS_NONE());
+	mrb->define_method(cls, "inspect", sparse_to_s, MRB_ARGS_NONE());
+	return cls;
+}
@@ -0,0 +1,90 @@
+/* SPDX-License-Identifier: ISC */
+
+#ifndef EULER_MATH_SPARSE_MATRIX_H
+#define EULER_MATH_SPARSE_MATRIX_H
+
+#include <span>
+
+#include <Eigen/Sparse>
+
+#include "euler/util/ext.h"
+#include "euler/util/object.h"
+#include "euler/util/types.h"
+
+namespace euler::math {
+
+/* Compressed sparse column storage, which is what Eigen's direct solvers
+ * factorize; CSR input is converted on construction. */
+using SparseStorage = Eigen::SparseMatrix<double>;
+using Triplet = Eigen::Triplet<double, SparseStorage::StorageIndex>;
+
+/* A double sparse matrix, always kept compressed so that its index arrays
+ * can be compared directly. The pattern only changes when the whole matrix
+ * is rebuilt; replacing the values keeps it, which lets a
+ * SparseSolveFactorizer skip its symbolic analysis. */
+class SparseMatrix final : public util::Object {
+	BIND_MRUBY("Euler::Math::SparseMatrix", SparseMatrix,
+	    math.sparse_matrix);
+
+public:
+	SparseMatrix() = default;
+	SparseMatrix(util::size_type rows, util::size_type columns);
+	explicit SparseMatrix(SparseStorage storage);
+
+	/* Entries at the same position are summed. */
+	void set_from_triplets(util::size_type rows, util::size_type columns,
+	    std::span<const Triplet> triplets);
+	/* row_offsets has rows + 1 entries; column_indices and values one per
+	 * nonzero. Returns false, leaving the matrix alone, if the arrays are
+	 * inconsistent. */
+	bool set_from_csr(util::size_type rows, util::size_type columns,
+	    std::span<const util::size_type> row_offsets,
+	    std::span<const util::size_type> column_indices,
+	    std::span<const double> values);
+
+	[[nodiscard]] util::size_type
+	row_count() const
+	{
+		return _storage.rows();
+	}
+
+	[[nodiscard]] util::size_type
+	column_count() const
+	{
+		return _storage.cols();
+	}
+
+	[[nodiscard]] util::size_type
+	nonzero_count() const
+	{
+		return _storage.nonZeros();
+	}
+
+	[[nodiscard]] const SparseStorage &
+	storage() const
+	{
+		return _storage;
+	}
+
+	/* The nonzeros in storage order: column by column, rows ascending. */
+	[[nodiscard]] std::span<double>
+	values()
+	{
+		return { _storage.valuePtr(),
+			static_cast<size_t>(_storage.nonZeros()) };
+	}
+
+	[[nodiscard]] std::span<const double>
+	values() const
+	{
+		return { _storage.valuePtr(),
+			static_cast<size_t>(_storage.nonZeros()) };
+	}
+
+private:
+	SparseStorage _storage;
+};
+
+} /* namespace euler::math */
+
+#endif /* EULER_MATH_SPARSE_MATRIX_H */
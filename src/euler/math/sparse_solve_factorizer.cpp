@@ -0,0 +1,480 @@
+/* SPDX-License-Identifier: ISC */
+
+#include "euler/math/sparse_solve_factorizer.h"
+
+#include <algorithm>
+
+#include "euler/math/matrix.h"
+#include "euler/util/state.h"
+
+using euler::math::DenseMatrix;
+using euler::math::Matrix;
+using euler::math::SparseMatrix;
+using euler::math::SparseSolveFactorizer;
+using Method = SparseSolveFactorizer::Method;
+
+static constexpr const char *METHOD_NAMES[] = {
+	"ldlt",
+	"lu",
+	"cg",
+};
+
+const char *
+SparseSolveFactorizer::method_name(const Method method)
+{
+	return METHOD_NAMES[static_cast<size_t>(method)];
+}
+
+std::optional<Method>
+SparseSolveFactorizer::parse_method(const std::string_view name)
+{
+	for (size_t i = 0; i < std::size(METHOD_NAMES); ++i)
+		if (name == METHOD_NAMES[i]) return static_cast<Method>(i);
+	return std::nullopt;
+}
+
+SparseSolveFactorizer::SparseSolveFactorizer(const Method method)
+{
+	reset(method);
+}
+
+void
+SparseSolveFactorizer::reset(const Method method)
+{
+	_method = method;
+	switch (method) {
+	case Method::LDLT: _solver.emplace<LDLTSolver>(); break;
+	case Method::LU: _solver.emplace<LUSolver>(); break;
+	case Method::ConjugateGradient: _solver.emplace<CGSolver>(); break;
+	}
+	_rows = _columns = 0;
+	_outer.clear();
+	_inner.clear();
+	_analyzed = _factorized = false;
+}
+
+bool
+SparseSolveFactorizer::same_pattern(const SparseStorage &m) const
+{
+	/* both sides are compressed, so equal arrays mean equal patterns */
+	const auto nonzeros = static_cast<size_t>(m.nonZeros());
+	return m.rows() == _rows && m.cols() == _columns
+	    && nonzeros == _inner.size()
+	    && std::equal(_outer.begin(), _outer.end(), m.outerIndexPtr())
+	    && std::equal(_inner.begin(), _inner.end(), m.innerIndexPtr());
+}
+
+void
+SparseSolveFactorizer::remember_pattern(const SparseStorage &m)
+{
+	_rows = m.rows();
+	_columns = m.cols();
+	_outer.assign(m.outerIndexPtr(), m.outerIndexPtr() + m.cols() + 1);
+	_inner.assign(m.innerIndexPtr(), m.innerIndexPtr() + m.nonZeros());
+}
+
+Eigen::ComputationInfo
+SparseSolveFactorizer::compute(const SparseMatrix &matrix)
+{
+	const auto &m = matrix.storage();
+	_factorized = false;
+	return std::visit(
+	    [&](auto &solver) {
+		    if (!_analyzed || !same_pattern(m)) {
+			    /* SparseLU can't report on an analysis alone;
+			     * failures surface from factorize */
+			    solver.analyzePattern(m);
+			    ++_analyses;
+			    _analyzed = true;
+			    remember_pattern(m);
+		    }
+		    solver.factorize(m);
+		    ++_factorizations;
+		    _factorized = solver.info() == Eigen::Success;
+		    return solver.info();
+	    },
+	    _solver);
+}
+
+Eigen::ComputationInfo
+SparseSolveFactorizer::solve(const Dense &b, Dense &x, const bool warm_start)
+{
+	return std::visit(
+	    [&](auto &solver) {
+		    using S = std::decay_t<decltype(solver)>;
+		    const auto guessed = warm_start && x.rows() == b.rows()
+			&& x.cols() == b.cols();
+		    if constexpr (std::is_same_v<S, CGSolver>) {
+			    if (guessed) x = solver.solveWithGuess(b, x);
+			    else x = solver.solve(b);
+		    } else {
+			    x = solver.solve(b);
+		    }
+		    return solver.info();
+	    },
+	    _solver);
+}
+
+void
+SparseSolveFactorizer::set_tolerance(const double tolerance)
+{
+	if (auto cg = std::get_if<CGSolver>(&_solver))
+		cg->setTolerance(tolerance);
+}
+
+void
+SparseSolveFactorizer::set_max_iterations(const util::size_type iterations)
+{
+	if (auto cg = std::get_if<CGSolver>(&_solver))
+		cg->setMaxIterations(iterations);
+}
+
+double
+SparseSolveFactorizer::tolerance() const
+{
+	const auto cg = std::get_if<CGSolver>(&_solver);
+	return cg != nullptr ? cg->tolerance() : 0.0;
+}
+
+euler::util::size_type
+SparseSolveFactorizer::iterations() const
+{
+	const auto cg = std::get_if<CGSolver>(&_solver);
+	return cg != nullptr && _factorized ? cg->iterations() : 0;
+}
+
+double
+SparseSolveFactorizer::error() const
+{
+	const auto cg = std::get_if<CGSolver>(&_solver);
+	return cg != nullptr && _factorized ? cg->error() : 0.0;
+}
+
+static Method
+read_method(mrb_state *mrb, const mrb_sym sym)
+{
+	const auto state = euler::util::State::get(mrb);
+	const auto name = state->mrb()->sym_name(sym);
+	const auto method = SparseSolveFactorizer::parse_method(name);
+	if (!method.has_value()) {
+		state->mrb()->raisef(state->mrb()->argument_error(),
+		    "Unknown solver %s; expected ldlt, lu or cg", name);
+	}
+	return *method;
+}
+
+static mrb_value
+factorizer_allocate(mrb_state *mrb, mrb_value)
+{
+	const auto state = euler::util::State::get(mrb);
+	auto factorizer = euler::util::make_reference<SparseSolveFactorizer>();
+	return state->wrap(factorizer);
+}
+
+/**
+ * @overload Euler::Math::SparseSolveFactorizer#initialize(method = :ldlt)
+ *   @param method [Symbol] :ldlt for symmetric positive definite matrices,
+ *     :lu for any square matrix, or :cg to solve symmetric positive
+ *     definite ones iteratively, starting from a guess.
+ */
+static mrb_value
+factorizer_initialize(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	mrb_sym method = EULER_SYM(ldlt);
+	state->mrb()->get_args("|n", &method);
+	const auto parsed = read_method(mrb, method);
+	auto factorizer
+	    = euler::util::Reference<SparseSolveFactorizer>::unwrap(mrb, self);
+	factorizer->reset(parsed);
+	return mrb_nil_value();
+}
+
+/**
+ * @overload Euler::Math::SparseSolveFactorizer#compute(matrix)
+ *   Factorizes matrix for the following solves. If it has the same
+ *   sparsity pattern as the last one, only the numeric factorization is
+ *   redone.
+ *   @param matrix [Euler::Math::SparseMatrix] A square matrix.
+ *   @return [self]
+ *   @raise [ArgumentError] If matrix isn't square.
+ *   @raise [RuntimeError] If the factorization fails, for example because
+ *     matrix is singular or not positive definite.
+ */
+static mrb_value
+factorizer_compute(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	mrb_value matrix_value;
+	state->mrb()->get_args("o", &matrix_value);
+	const char *error;
+	{
+		auto factorizer = state->unwrap<SparseSolveFactorizer>(self);
+		const auto matrix = state->unwrap<SparseMatrix>(matrix_value);
+		if (matrix->row_count() != matrix->column_count()) {
+			error = nullptr;
+		} else {
+			const auto info = factorizer->compute(*matrix.get());
+			/* the iterative solver keeps reading the matrix */
+			state->mrb()->iv_set(self, EULER_IVSYM(matrix),
+			    matrix_value);
+			if (info == Eigen::Success) return self;
+			error = info == Eigen::NumericalIssue
+			    ? "Factorization failed; the matrix is singular or "
+			      "not positive definite"
+			    : "Factorization failed";
+		}
+	}
+	if (error == nullptr) {
+		state->mrb()->raise(state->mrb()->argument_error(),
+		    "Only square matrices can be factorized");
+	}
+	state->mrb()->raise(state->mrb()->runtime_error(), error);
+}
+
+/* Why b can't be solved for, or null if it can. */
+static const char *
+rhs_error(mrb_state *mrb, const SparseSolveFactorizer &factorizer,
+    const Matrix &b, RClass *&error_class)
+{
+	const auto state = euler::util::State::get(mrb);
+	if (!factorizer.factorized()) {
+		error_class = state->mrb()->runtime_error();
+		return "Nothing to solve with; call compute first";
+	}
+	if (b.row_count() != factorizer.size()) {
+		error_class = state->mrb()->argument_error();
+		return "The right-hand side needs one row per matrix row";
+	}
+	return nullptr;
+}
+
+/* Why a solve failed, or null if it didn't. */
+static const char *
+solve_error(const Eigen::ComputationInfo info)
+{
+	switch (info) {
+	case Eigen::Success: return nullptr;
+	case Eigen::NoConvergence:
+		return "The conjugate gradient solver didn't converge within "
+		       "max_iterations";
+	default: return "Solve failed";
+	}
+}
+
+/**
+ * @overload Euler::Math::SparseSolveFactorizer#solve(b, guess = nil)
+ *   @param b [Euler::Math::Matrix] One right-hand side per column.
+ *   @param guess [Euler::Math::Matrix, nil] Where the conjugate gradient
+ *     solver starts, usually the last frame's solution; ignored by the
+ *     direct methods.
+ *   @return [Euler::Math::Matrix] The double solution x of A x = b.
+ *   @raise [RuntimeError] If nothing has been computed, or the conjugate
+ *     gradient solver didn't converge.
+ */
+static mrb_value
+factorizer_solve(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	mrb_value b_value, guess_value = mrb_nil_value();
+	state->mrb()->get_args("o|o", &b_value, &guess_value);
+	const char *error;
+	RClass *error_class = state->mrb()->runtime_error();
+	{
+		auto factorizer = state->unwrap<SparseSolveFactorizer>(self);
+		const auto b = state->unwrap<Matrix>(b_value);
+		error = rhs_error(mrb, *factorizer.get(), *b.get(),
+		    error_class);
+		if (error == nullptr) {
+			SparseSolveFactorizer::Dense x;
+			DenseMatrix<double> scratch;
+			const auto warm = !mrb_nil_p(guess_value);
+			if (warm) {
+				x = state->unwrap<Matrix>(guess_value)->as(
+				    scratch);
+			}
+			const auto info = factorizer->solve(b->as(scratch), x,
+			    warm);
+			error = solve_error(info);
+			if (error == nullptr) {
+				auto out = euler::util::make_reference<Matrix>(
+				    Matrix::Storage(std::move(x)));
+				return state->wrap(out);
+			}
+		}
+	}
+	state->mrb()->raise(error_class, error);
+}
+
+/**
+ * @overload Euler::Math::SparseSolveFactorizer#solve!(b, x)
+ *   Solves into x, which is also the conjugate gradient solver's starting
+ *   point; a matrix that is reused every frame is warm-started for free.
+ *   @param b [Euler::Math::Matrix] One right-hand side per column.
+ *   @param x [Euler::Math::Matrix] Replaced by the double solution.
+ *   @return [Euler::Math::Matrix] x
+ *   @raise [RuntimeError] If nothing has been computed, or the conjugate
+ *     gradient solver didn't converge; x then holds its last iterate.
+ */
+static mrb_value
+factorizer_solve_bang(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	mrb_value b_value, x_value;
+	state->mrb()->get_args("oo", &b_value, &x_value);
+	const char *error;
+	RClass *error_class = state->mrb()->runtime_error();
+	{
+		auto factorizer = state->unwrap<SparseSolveFactorizer>(self);
+		const auto b = state->unwrap<Matrix>(b_value);
+		auto x = state->unwrap<Matrix>(x_value);
+		error = rhs_error(mrb, *factorizer.get(), *b.get(),
+		    error_class);
+		if (error == nullptr) {
+			if (x->type() != Matrix::Type::Double)
+				x->storage() = x->cast<double>();
+			DenseMatrix<double> scratch;
+			const auto info = factorizer->solve(b->as(scratch),
+			    x->as<double>(), true);
+			error = solve_error(info);
+			if (error == nullptr) return x_value;
+		}
+	}
+	state->mrb()->raise(error_class, error);
+}
+
+/**
+ * @overload Euler::Math::SparseSolveFactorizer#solver
+ *   @return [Symbol] :ldlt, :lu or :cg
+ */
+static mrb_value
+factorizer_solver(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	const auto factorizer = state->unwrap<SparseSolveFactorizer>(self);
+	const auto name = SparseSolveFactorizer::method_name(
+	    factorizer->method());
+	return mrb_symbol_value(state->mrb()->intern_cstr(name));
+}
+
+static mrb_value
+factorizer_factorized(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	const auto factorizer = state->unwrap<SparseSolveFactorizer>(self);
+	return mrb_bool_value(factorizer->factorized());
+}
+
+/**
+ * @overload Euler::Math::SparseSolveFactorizer#analysis_count
+ *   Like factorization_count: how often compute actually ran that phase.
+ *   @return [Integer]
+ */
+template <uint64_t (SparseSolveFactorizer::*Getter)() const>
+static mrb_value
+factorizer_counter(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	const auto factorizer = state->unwrap<SparseSolveFactorizer>(self);
+	const auto value = ((*factorizer.get()).*Getter)();
+	return state->mrb()->int_value(static_cast<mrb_int>(value));
+}
+
+static mrb_value
+factorizer_tolerance(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	const auto factorizer = state->unwrap<SparseSolveFactorizer>(self);
+	return state->mrb()->float_value(factorizer->tolerance());
+}
+
+/**
+ * @overload Euler::Math::SparseSolveFactorizer#tolerance=(tolerance)
+ *   The relative residual at which the conjugate gradient solver stops.
+ *   @param tolerance [Float]
+ */
+static mrb_value
+factorizer_set_tolerance(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	mrb_float tolerance;
+	state->mrb()->get_args("f", &tolerance);
+	auto factorizer = state->unwrap<SparseSolveFactorizer>(self);
+	factorizer->set_tolerance(tolerance);
+	return state->mrb()->float_value(tolerance);
+}
+
+static mrb_value
+factorizer_set_max_iterations(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	mrb_int iterations;
+	state->mrb()->get_args("i", &iterations);
+	auto factorizer = state->unwrap<SparseSolveFactorizer>(self);
+	factorizer->set_max_iterations(iterations);
+	return state->mrb()->int_value(iterations);
+}
+
+/**
+ * @overload Euler::Math::SparseSolveFactorizer#iterations
+ *   @return [Integer] How many iterations the last conjugate gradient solve
+ *     took; 0 for the direct methods.
+ */
+static mrb_value
+factorizer_iterations(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	const auto factorizer = state->unwrap<SparseSolveFactorizer>(self);
+	return state->mrb()->int_value(factorizer->iterations());
+}
+
+/**
+ * @overload Euler::Math::SparseSolveFactorizer#error
+ *   @return [Float] The relative residual of the last conjugate gradient
+ *     solve; 0.0 for the direct methods.
+ */
+static mrb_value
+factorizer_error(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	const auto factorizer = state->unwrap<SparseSolveFactorizer>(self);
+	return state->mrb()->float_value(factorizer->error());
+}
+
+RClass *
+SparseSolveFactorizer::init(const util::Reference<util::State> &state,
+    RClass *mod, RClass *super)
+{
+	const auto &mrb = state->mrb();
+	const auto cls = mrb->define_class_under(mod, "SparseSolveFactorizer",
+	    super != nullptr ? super : state->object_class());
+	MRB_SET_INSTANCE_TT(cls, MRB_TT_DATA);
+	mrb->define_class_method(cls, "allocate", factorizer_allocate,
+	    MRB_ARGS_NONE());
+	mrb->define_method(cls, "initialize", factorizer_initialize,
+	    MRB_ARGS_OPT(1));
+	mrb->define_method(cls, "compute", factorizer_compute,
+	    MRB_ARGS_REQ(1));
+	mrb->define_method(cls, "solve", factorizer_solve, MRB_ARGS_ARG(1, 1));
+	mrb->define_method(cls, "solve!", factorizer_solve_bang,
+	    MRB_ARGS_REQ(2));
+	mrb->define_method(cls, "solver", factorizer_solver, MRB_ARGS_NONE());
+	mrb->define_method(cls, "factorized?", factorizer_factorized,
+	    MRB_ARGS_NONE());
+	mrb->define_method(cls, "analysis_count",
+	    factorizer_counter<&SparseSolveFactorizer::analysis_count>,
+	    MRB_ARGS_NONE());
+	mrb->define_method(cls, "factorization_count",
+	    factorizer_counter<&SparseSolveFactorizer::factorization_count>,
+	    MRB_ARGS_NONE());
+	mrb->define_method(cls, "tolerance", factorizer_tolerance,
+	    MRB_ARGS_NONE());
+	mrb->define_method(cls, "tolerance=", factorizer_set_tolerance,
+	    MRB_ARGS_REQ(1));
+	mrb->define_method(cls, "max_iterations=",
+	    factorizer_set_max_iterations, MRB_ARGS_REQ(1));
+	mrb->define_method(cls, "iterations", factorizer_iterations,
+	    MRB_ARGS_NONE());
+	mrb->define_method(cls, "error", factorizer_error, MRB_ARGS_NONE());
+	return cls;
+}
@@ -0,0 +1,124 @@
+/* SPDX-License-Identifier: ISC */
+
+#ifndef EULER_MATH_SPARSE_SOLVE_FACTORIZER_H
+#define EULER_MATH_SPARSE_SOLVE_FACTORIZER_H
+
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+#include <Eigen/IterativeLinearSolvers>
+#include <Eigen/SparseCholesky>
+#include <Eigen/SparseLU>
+
+#include "euler/math/sparse_matrix.h"
+
+namespace euler::math {
+
+/* Solves A x = b for one sparse A and any number of right-hand sides. The
+ * symbolic analysis (fill-reducing ordering and elimination tree) depends
+ * only on where A's nonzeros are, so compute keeps it for as long as every
+ * new matrix has the pattern it was made for and only refactorizes the
+ * values. Rebuilding a matrix from the same triplets every frame counts as
+ * the same pattern. */
+class SparseSolveFactorizer final : public util::Object {
+	BIND_MRUBY("Euler::Math::SparseSolveFactorizer", SparseSolveFactorizer,
+	    math.sparse_solve_factorizer);
+
+public:
+	enum class Method {
+		/* symmetric positive (semi-)definite; reads the lower
+		 * triangle */
+		LDLT,
+		/* any square matrix */
+		LU,
+		/* symmetric positive definite; iterative, and the only method
+		 * that uses an initial guess */
+		ConjugateGradient,
+	};
+
+	using Dense = Eigen::MatrixXd;
+	using LDLTSolver = Eigen::SimplicialLDLT<SparseStorage>;
+	using LUSolver = Eigen::SparseLU<SparseStorage>;
+	using CGSolver = Eigen::ConjugateGradient<SparseStorage,
+	    Eigen::Lower | Eigen::Upper>;
+
+	static const char *method_name(Method method);
+	static std::optional<Method> parse_method(std::string_view name);
+
+	explicit SparseSolveFactorizer(Method method = Method::LDLT);
+
+	/* Switches to method, forgetting any analysis and factorization. */
+	void reset(Method method);
+
+	[[nodiscard]] Method
+	method() const
+	{
+		return _method;
+	}
+
+	/* Factorizes matrix, which must be square, reusing the previous
+	 * symbolic analysis if the pattern is unchanged. The conjugate
+	 * gradient solver keeps reading matrix, which must outlive the next
+	 * compute. */
+	Eigen::ComputationInfo compute(const SparseMatrix &matrix);
+
+	/* Solves for every column of b, which needs one row per row of the
+	 * matrix. With warm_start, the conjugate gradient solver starts from
+	 * x rather than zero; the direct methods ignore it. */
+	Eigen::ComputationInfo solve(const Dense &b, Dense &x,
+	    bool warm_start = false);
+
+	[[nodiscard]] bool
+	factorized() const
+	{
+		return _factorized;
+	}
+
+	[[nodiscard]] util::size_type
+	size() const
+	{
+		return _rows;
+	}
+
+	/* How often the symbolic and numeric phases actually ran. */
+	[[nodiscard]] uint64_t
+	analysis_count() const
+	{
+		return _analyses;
+	}
+
+	[[nodiscard]] uint64_t
+	factorization_count() const
+	{
+		return _factorizations;
+	}
+
+	/* Conjugate gradient only. */
+	void set_tolerance(double tolerance);
+	void set_max_iterations(util::size_type iterations);
+	[[nodiscard]] double tolerance() const;
+	[[nodiscard]] util::size_type iterations() const;
+	[[nodiscard]] double error() const;
+
+private:
+	bool same_pattern(const SparseStorage &m) const;
+	void remember_pattern(const SparseStorage &m);
+
+	Method _method;
+	std::variant<LDLTSolver, LUSolver, CGSolver> _solver;
+	util::size_type _rows = 0;
+	util::size_type _columns = 0;
+	std::vector<SparseStorage::StorageIndex> _outer;
+	std::vector<SparseStorage::StorageIndex> _inner;
+	bool _analyzed = false;
+	bool _factorized = false;
+	uint64_t _analyses = 0;
+	uint64_t _factorizations = 0;
+};
+
+} /* namespace euler::math */
+
+#endif /* EULER_MATH_SPARSE_SOLVE_FACTORIZER_H */
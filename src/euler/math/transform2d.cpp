@@ -0,0 +1,650 @@
+/* SPDX-License-Identifier: ISC */
+
+#include "euler/math/transform2d.h"
+
+#include <array>
+#include <cmath>
+
+#include "euler/util/state.h"
+
+using euler::math::DenseMatrix;
+using euler::math::Matrix;
+using euler::math::size_type;
+using euler::math::ufunc::GRAIN;
+using euler::math::ufunc::Operand;
+using euler::math::ufunc::PARALLEL_THRESHOLD;
+using namespace euler::math::transform2d;
+
+/* Rows per pass over a chunk, so a kernel's temporaries and lanes of
+ * constants stay in L1. */
+static constexpr size_t BATCH = 128;
+
+template <typename T> using Column = Eigen::Array<T, Eigen::Dynamic, 1>;
+/* A temporary that lives on the stack, for results that would otherwise
+ * overwrite an input another output still needs. */
+template <typename T>
+using Batch = Eigen::Array<T, Eigen::Dynamic, 1, Eigen::ColMajor, BATCH, 1>;
+
+/* Width columns of an operand over runs of at most BATCH rows. A matrix with
+ * a row per result row is read in place; a single row or a number is copied
+ * into lanes of constants once, so kernels only see contiguous lanes. */
+template <typename T, size_type Width> class Lanes {
+public:
+	Lanes(const DenseMatrix<T> *matrix, const double scalar)
+	{
+		if (matrix != nullptr && matrix->rows() != 1) {
+			for (size_type j = 0; j < Width; ++j)
+				_columns[j] = matrix->data()
+				    + j * matrix->rows();
+			_step = 1;
+			return;
+		}
+		for (size_type j = 0; j < Width; ++j) {
+			_constants[j].fill(matrix != nullptr
+				? (*matrix)(0, j)
+				: static_cast<T>(scalar));
+			_columns[j] = _constants[j].data();
+		}
+		_step = 0;
+	}
+
+	Lanes(const Lanes &) = delete;
+	Lanes &operator=(const Lanes &) = delete;
+
+	Eigen::Map<const Column<T>>
+	operator()(const size_type column, const size_t begin,
+	    const size_t count) const
+	{
+		return { _columns[column] + begin * _step,
+			static_cast<Eigen::Index>(count) };
+	}
+
+private:
+	std::array<const T *, Width> _columns;
+	std::array<std::array<T, BATCH>, Width> _constants;
+	size_t _step;
+};
+
+template <typename T>
+static Eigen::Map<Column<T>>
+lane(DenseMatrix<T> &m, const size_type column, const size_t begin,
+    const size_t count)
+{
+	return { m.data() + column * m.rows() + begin,
+		static_cast<Eigen::Index>(count) };
+}
+
+/* Calls chunk on [0, rows) in GRAIN-sized chunks, on the pool for large
+ * inputs; chunk sets up its lanes and hands them to for_batches. */
+template <typename F>
+static void
+for_chunks(euler::util::Jobs *jobs, const size_t rows, const F &chunk)
+{
+	if (jobs == nullptr || rows < PARALLEL_THRESHOLD) {
+		for (size_t begin = 0; begin < rows; begin += GRAIN)
+			chunk(begin, std::min(rows, begin + GRAIN));
+		return;
+	}
+	jobs->parallel_for(0, rows, GRAIN, chunk);
+}
+
+template <typename F>
+static void
+for_batches(const size_t begin, const size_t end, const F &batch)
+{
+	for (size_t at = begin; at < end; at += BATCH)
+		batch(at, std::min(BATCH, end - at));
+}
+
+/* Runs fill on out's storage if it is already an R matrix of the right shape,
+ * and on a new one otherwise, as in ufunc. */
+template <typename R, typename F>
+static void
+produce(Matrix &out, const size_type rows, const size_type columns,
+    const F &fill)
+{
+	auto m = std::get_if<DenseMatrix<R>>(&out.storage());
+	if (m != nullptr && m->rows() == rows && m->cols() == columns) {
+		fill(*m);
+		return;
+	}
+	DenseMatrix<R> result(rows, columns);
+	fill(result);
+	out.storage() = std::move(result);
+}
+
+/* m as R, converted into scratch if it is some other type. */
+template <typename R>
+static const DenseMatrix<R> &
+as_type(const Matrix &m, DenseMatrix<R> &scratch)
+{
+	if (m.type() == Matrix::type_of<R>()) return m.as<R>();
+	scratch = m.cast<R>();
+	return scratch;
+}
+
+/* operand's matrix as R, or null for a number. */
+template <typename R>
+static const DenseMatrix<R> *
+as_type(const Operand &operand, DenseMatrix<R> &scratch)
+{
+	if (operand.matrix == nullptr) return nullptr;
+	return &as_type<R>(*operand.matrix, scratch);
+}
+
+/* Calls fn with float for a Float type and with double for any other. */
+template <typename F>
+static void
+visit_floating(const Matrix::Type type, F &&fn)
+{
+	if (type == Matrix::Type::Float)
+		fn(float {});
+	else
+		fn(double {});
+}
+
+size_type
+euler::math::transform2d::operand_width(const Op op)
+{
+	switch (op) {
+	case Op::Transform: return TRANSFORM_WIDTH;
+	case Op::Rotate: return 1;
+	default: return POINT_WIDTH;
+	}
+}
+
+std::optional<size_type>
+euler::math::transform2d::result_rows(
+    const std::initializer_list<const Matrix *> matrices)
+{
+	size_type rows = 1;
+	for (const auto *m : matrices) {
+		if (m == nullptr || m->row_count() == 1) continue;
+		if (rows != 1 && m->row_count() != rows) return std::nullopt;
+		rows = m->row_count();
+	}
+	return rows;
+}
+
+template <typename R>
+static void
+apply_typed(const Op op, const Lanes<R, POINT_WIDTH> &points,
+    const DenseMatrix<R> *matrix, const double scalar, DenseMatrix<R> &out,
+    const size_t begin, const size_t end)
+{
+	switch (op) {
+	case Op::Transform: {
+		const Lanes<R, TRANSFORM_WIDTH> m(matrix, scalar);
+		for_batches(begin, end, [&](const size_t at, const size_t n) {
+			const auto x = points(0, at, n);
+			const auto y = points(1, at, n);
+			const Batch<R> moved_x = m(0, at, n) * x
+			    + m(1, at, n) * y + m(4, at, n);
+			lane(out, 1, at, n) = m(2, at, n) * x + m(3, at, n) * y
+			    + m(5, at, n);
+			lane(out, 0, at, n) = moved_x;
+		});
+		break;
+	}
+	case Op::Rotate: {
+		const Lanes<R, 1> angle(matrix, scalar);
+		for_batches(begin, end, [&](const size_t at, const size_t n) {
+			const auto x = points(0, at, n);
+			const auto y = points(1, at, n);
+			const Batch<R> cos = angle(0, at, n).cos();
+			const Batch<R> sin = angle(0, at, n).sin();
+			const Batch<R> moved_x = cos * x - sin * y;
+			lane(out, 1, at, n) = sin * x + cos * y;
+			lane(out, 0, at, n) = moved_x;
+		});
+		break;
+	}
+	case Op::Scale: {
+		const Lanes<R, POINT_WIDTH> factor(matrix, scalar);
+		for_batches(begin, end, [&](const size_t at, const size_t n) {
+			const auto x = points(0, at, n);
+			const auto y = points(1, at, n);
+			lane(out, 0, at, n) = x * factor(0, at, n);
+			lane(out, 1, at, n) = y * factor(1, at, n);
+		});
+		break;
+	}
+	case Op::Translate: {
+		const Lanes<R, POINT_WIDTH> offset(matrix, scalar);
+		for_batches(begin, end, [&](const size_t at, const size_t n) {
+			const auto x = points(0, at, n);
+			const auto y = points(1, at, n);
+			lane(out, 0, at, n) = x + offset(0, at, n);
+			lane(out, 1, at, n) = y + offset(1, at, n);
+		});
+		break;
+	}
+	}
+}
+
+void
+euler::math::transform2d::apply(const Op op, const Matrix &points,
+    const Operand &operand, Matrix &out, util::Jobs *jobs)
+{
+	const auto rows = *result_rows({ &points, operand.matrix });
+	visit_floating(points.type(), [&]<typename R>(R) {
+		DenseMatrix<R> scratch_points, scratch_operand;
+		const auto &from = as_type<R>(points, scratch_points);
+		const auto *by = as_type<R>(operand, scratch_operand);
+		produce<R>(out, rows, POINT_WIDTH, [&](auto &result) {
+			for_chunks(jobs, rows,
+			    [&](const size_t begin, const size_t end) {
+				    const Lanes<R, POINT_WIDTH> p(&from, 0.0);
+				    apply_typed<R>(op, p, by, operand.scalar,
+					result, begin, end);
+			    });
+		});
+	});
+}
+
+/* Fills the N x 1 out with measure(x, y) of each point. */
+template <typename F>
+static void
+measure(const Matrix &points, Matrix &out, euler::util::Jobs *jobs,
+    const F &per_point)
+{
+	const auto rows = points.row_count();
+	visit_floating(points.type(), [&]<typename R>(R) {
+		DenseMatrix<R> scratch;
+		const auto &from = as_type<R>(points, scratch);
+		produce<R>(out, rows, 1, [&](auto &result) {
+			for_chunks(jobs, rows,
+			    [&](const size_t begin, const size_t end) {
+				    const Lanes<R, POINT_WIDTH> p(&from, 0.0);
+				    for_batches(begin, end,
+					[&](const size_t at, const size_t n) {
+						lane(result, 0, at, n)
+						    = per_point(p(0, at, n),
+							p(1, at, n));
+					});
+			    });
+		});
+	});
+}
+
+void
+euler::math::transform2d::angles(const Matrix &points, Matrix &out,
+    util::Jobs *jobs)
+{
+	/* Eigen has no packet atan2, so this one is scalar */
+	measure(points, out, jobs, [](const auto &x, const auto &y) {
+		return y.binaryExpr(x, [](const auto a, const auto b) {
+			return std::atan2(a, b);
+		});
+	});
+}
+
+void
+euler::math::transform2d::lengths(const Matrix &points, Matrix &out,
+    util::Jobs *jobs)
+{
+	measure(points, out, jobs, [](const auto &x, const auto &y) {
+		return (x.square() + y.square()).sqrt();
+	});
+}
+
+template <typename R>
+static void
+compose_typed(const DenseMatrix<R> &a, const DenseMatrix<R> &b,
+    DenseMatrix<R> &out, const size_t begin, const size_t end)
+{
+	const Lanes<R, TRANSFORM_WIDTH> p(&a, 0.0);
+	const Lanes<R, TRANSFORM_WIDTH> q(&b, 0.0);
+	for_batches(begin, end, [&](const size_t at, const size_t n) {
+		const auto pa = p(0, at, n);
+		const auto pb = p(1, at, n);
+		const auto pc = p(2, at, n);
+		const auto pd = p(3, at, n);
+		const auto qx = q(4, at, n);
+		const auto qy = q(5, at, n);
+		const Batch<R> ra = pa * q(0, at, n) + pb * q(2, at, n);
+		const Batch<R> rb = pa * q(1, at, n) + pb * q(3, at, n);
+		const Batch<R> rc = pc * q(0, at, n) + pd * q(2, at, n);
+		const Batch<R> rd = pc * q(1, at, n) + pd * q(3, at, n);
+		const Batch<R> rx = pa * qx + pb * qy + p(4, at, n);
+		lane(out, 5, at, n) = pc * qx + pd * qy + p(5, at, n);
+		lane(out, 0, at, n) = ra;
+		lane(out, 1, at, n) = rb;
+		lane(out, 2, at, n) = rc;
+		lane(out, 3, at, n) = rd;
+		lane(out, 4, at, n) = rx;
+	});
+}
+
+void
+euler::math::transform2d::compose(const Matrix &a, const Matrix &b,
+    Matrix &out, util::Jobs *jobs)
+{
+	const auto rows = *result_rows({ &a, &b });
+	visit_floating(a.type(), [&]<typename R>(R) {
+		DenseMatrix<R> scratch_a, scratch_b;
+		const auto &outer = as_type<R>(a, scratch_a);
+		const auto &inner = as_type<R>(b, scratch_b);
+		produce<R>(out, rows, TRANSFORM_WIDTH, [&](auto &result) {
+			for_chunks(jobs, rows,
+			    [&](const size_t begin, const size_t end) {
+				    compose_typed<R>(outer, inner, result,
+					begin, end);
+			    });
+		});
+	});
+}
+
+template <typename R>
+static void
+make_typed(const DenseMatrix<R> *translations, const double translation,
+    const DenseMatrix<R> *angles, const double angle,
+    const DenseMatrix<R> *scales, const double scale, DenseMatrix<R> &out,
+    const size_t begin, const size_t end)
+{
+	const Lanes<R, POINT_WIDTH> t(translations, translation);
+	const Lanes<R, 1> a(angles, angle);
+	const Lanes<R, POINT_WIDTH> s(scales, scale);
+	for_batches(begin, end, [&](const size_t at, const size_t n) {
+		const Batch<R> cos = a(0, at, n).cos();
+		const Batch<R> sin = a(0, at, n).sin();
+		lane(out, 0, at, n) = cos * s(0, at, n);
+		lane(out, 1, at, n) = -sin * s(1, at, n);
+		lane(out, 2, at, n) = sin * s(0, at, n);
+		lane(out, 3, at, n) = cos * s(1, at, n);
+		lane(out, 4, at, n) = t(0, at, n);
+		lane(out, 5, at, n) = t(1, at, n);
+	});
+}
+
+void
+euler::math::transform2d::make(const Operand &translations,
+    const Operand &angles, const Operand &scales, Matrix &out,
+    util::Jobs *jobs)
+{
+	const auto rows = *result_rows(
+	    { translations.matrix, angles.matrix, scales.matrix });
+	/* Float only if there are matrices and all of them are Float */
+	auto type = Matrix::Type::Double;
+	for (const auto *m : { translations.matrix, angles.matrix,
+		 scales.matrix }) {
+		if (m == nullptr) continue;
+		if (m->type() != Matrix::Type::Float) {
+			type = Matrix::Type::Double;
+			break;
+		}
+		type = Matrix::Type::Float;
+	}
+	visit_floating(type, [&]<typename R>(R) {
+		DenseMatrix<R> scratch_t, scratch_a, scratch_s;
+		const auto *t = as_type<R>(translations, scratch_t);
+		const auto *a = as_type<R>(angles, scratch_a);
+		const auto *s = as_type<R>(scales, scratch_s);
+		produce<R>(out, rows, TRANSFORM_WIDTH, [&](auto &result) {
+			for_chunks(jobs, rows,
+			    [&](const size_t begin, const size_t end) {
+				    make_typed<R>(t, translations.scalar, a,
+					angles.scalar, s, scales.scalar,
+					result, begin, end);
+			    });
+		});
+	});
+}
+
+static constexpr const char *OP_NAMES[] = {
+	"transform_points",
+	"rotate_points",
+	"scale_points",
+	"translate_points",
+};
+
+static constexpr const char *OP_BANG_NAMES[] = {
+	"transform_points!",
+	"rotate_points!",
+	"scale_points!",
+	"translate_points!",
+};
+
+static constexpr const char *OPERAND_WIDTH_ERRORS[] = {
+	"Transforms must have 6 columns",
+	"Angles must have 1 column",
+	"Scale factors must have 2 columns",
+	"Offsets must have 2 columns",
+};
+
+/**
+ * @overload Euler::Math::Matrix#transform_points(transforms)
+ *   Like rotate_points, scale_points and translate_points: moves the points
+ *   in the rows of an N x 2 matrix. A single row of either operand applies to
+ *   every row of the other.
+ *   @param transforms [Euler::Math::Matrix] N x 6 affine transforms (a, b, c,
+ *     d, tx, ty), mapping a point to (a x + b y + tx, c x + d y + ty); for
+ *     rotate_points, N x 1 angles in radians; for scale_points and
+ *     translate_points, N x 2 factors or offsets. All but transform_points
+ *     also take a number.
+ *   @return [Euler::Math::Matrix] A new N x 2 matrix; :double unless the
+ *     points are :float.
+ *   @raise [ArgumentError] If the shapes don't fit.
+ *
+ * @overload Euler::Math::Matrix#transform_points!(transforms)
+ *   The in-place form of transform_points, and likewise for the others.
+ *   @return [self]
+ *   @raise [TypeError] If self isn't a float or double matrix.
+ */
+template <Op O, bool InPlace>
+static mrb_value
+matrix_apply(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	mrb_value operand_value;
+	state->mrb()->get_args("o", &operand_value);
+	const char *error = nullptr;
+	/* null for a type that can't be moved in place */
+	RClass *error_class = state->mrb()->argument_error();
+	{
+		auto points = state->unwrap<Matrix>(self);
+		euler::util::Reference<Matrix> holder;
+		Operand operand;
+		const auto rows = points->row_count();
+		if (InPlace && points->type() != Matrix::Type::Float
+		    && points->type() != Matrix::Type::Double) {
+			error_class = nullptr;
+		} else if (points->column_count() != POINT_WIDTH) {
+			error = "Points must have 2 columns";
+		} else if (!euler::math::ufunc::read_operand(mrb,
+			       operand_value, operand, holder)
+		    || (O == Op::Transform && operand.matrix == nullptr)) {
+			error = O == Op::Transform
+			    ? "Expected a Matrix"
+			    : "Expected a Matrix or a number";
+			error_class = state->mrb()->type_error();
+		} else if (operand.matrix != nullptr
+		    && operand.matrix->column_count() != operand_width(O)) {
+			error = OPERAND_WIDTH_ERRORS[static_cast<size_t>(O)];
+		} else {
+			const auto count = result_rows(
+			    { points.get(), operand.matrix });
+			if (!count.has_value())
+				error = "Row counts don't match";
+			else if (InPlace && *count != rows)
+				error = "Cannot move points in place into more "
+					"rows";
+		}
+		if (error == nullptr && error_class != nullptr) {
+			auto jobs = state->jobs();
+			if (InPlace) {
+				apply(O, *points.get(), operand, *points.get(),
+				    jobs.get());
+				return self;
+			}
+			auto out = euler::util::make_reference<Matrix>();
+			apply(O, *points.get(), operand, *out.get(),
+			    jobs.get());
+			return state->wrap(out);
+		}
+	}
+	if (error_class == nullptr) {
+		state->mrb()->raisef(state->mrb()->type_error(),
+		    "%s needs a float or double matrix; use %s",
+		    OP_BANG_NAMES[static_cast<size_t>(O)],
+		    OP_NAMES[static_cast<size_t>(O)]);
+	}
+	state->mrb()->raise(error_class, error);
+}
+
+/**
+ * @overload Euler::Math::Matrix#point_angles
+ *   Like point_lengths: measures each point of an N x 2 matrix as a vector.
+ *   @return [Euler::Math::Matrix] N x 1 angles from the x axis in radians,
+ *     or lengths; :double unless the points are :float.
+ *   @raise [ArgumentError] If the matrix doesn't have 2 columns.
+ */
+template <bool Angles>
+static mrb_value
+matrix_measure(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	{
+		const auto points = state->unwrap<Matrix>(self);
+		if (points->column_count() == POINT_WIDTH) {
+			auto jobs = state->jobs();
+			auto out = euler::util::make_reference<Matrix>();
+			if (Angles)
+				angles(*points.get(), *out.get(), jobs.get());
+			else
+				lengths(*points.get(), *out.get(), jobs.get());
+			return state->wrap(out);
+		}
+	}
+	state->mrb()->raise(state->mrb()->argument_error(),
+	    "Points must have 2 columns");
+}
+
+/**
+ * @overload Euler::Math::Matrix#compose_transforms(other)
+ *   Row by row, the transform that applies other and then self, so a
+ *   parent's world transforms composed with their children's local ones give
+ *   the children's world transforms.
+ *   @param other [Euler::Math::Matrix] N x 6 transforms; a single row of
+ *     either matrix applies to every row of the other.
+ *   @return [Euler::Math::Matrix] A new N x 6 matrix; :double unless self is
+ *     :float.
+ *   @raise [ArgumentError] If the shapes don't fit.
+ */
+static mrb_value
+matrix_compose_transforms(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	mrb_value other_value;
+	state->mrb()->get_args("o", &other_value);
+	const char *error = nullptr;
+	{
+		const auto a = state->unwrap<Matrix>(self);
+		const auto b = state->unwrap<Matrix>(other_value);
+		if (a->column_count() != TRANSFORM_WIDTH
+		    || b->column_count() != TRANSFORM_WIDTH)
+			error = "Transforms must have 6 columns";
+		else if (!result_rows({ a.get(), b.get() }).has_value())
+			error = "Row counts don't match";
+		if (error == nullptr) {
+			auto jobs = state->jobs();
+			auto out = euler::util::make_reference<Matrix>();
+			compose(*a.get(), *b.get(), *out.get(), jobs.get());
+			return state->wrap(out);
+		}
+	}
+	state->mrb()->raise(state->mrb()->argument_error(), error);
+}
+
+/**
+ * @overload Euler::Math::Matrix.transforms(translations = 0, angles = 0,
+ *     scales = 1)
+ *   Builds affine transforms that scale, then rotate, then translate.
+ *   @example
+ *     # one transform per sprite, all at half size
+ *     Euler::Math::Matrix.transforms(positions, rotations, 0.5)
+ *   @param translations [Euler::Math::Matrix, Numeric] N x 2 offsets.
+ *   @param angles [Euler::Math::Matrix, Numeric] N x 1 angles in radians.
+ *   @param scales [Euler::Math::Matrix, Numeric] N x 2 factors.
+ *   @return [Euler::Math::Matrix] N x 6 transforms; :float only if every
+ *     matrix given is.
+ *   @raise [ArgumentError] If the shapes don't fit.
+ */
+static mrb_value
+matrix_transforms(mrb_state *mrb, mrb_value)
+{
+	const auto state = euler::util::State::get(mrb);
+	mrb_value values[] = {
+		state->mrb()->int_value(0),
+		state->mrb()->int_value(0),
+		state->mrb()->int_value(1),
+	};
+	state->mrb()->get_args("|ooo", &values[0], &values[1], &values[2]);
+	static constexpr size_type WIDTHS[] = { POINT_WIDTH, 1, POINT_WIDTH };
+	static constexpr const char *WIDTH_ERRORS[] = {
+		"Translations must have 2 columns",
+		"Angles must have 1 column",
+		"Scale factors must have 2 columns",
+	};
+	const char *error = nullptr;
+	auto error_class = state->mrb()->argument_error();
+	{
+		euler::util::Reference<Matrix> holders[3];
+		Operand operands[3];
+		for (size_t i = 0; i < 3 && error == nullptr; ++i) {
+			if (!euler::math::ufunc::read_operand(mrb, values[i],
+				operands[i], holders[i])) {
+				error = "Expected a Matrix or a number";
+				error_class = state->mrb()->type_error();
+			} else if (operands[i].matrix != nullptr
+			    && operands[i].matrix->column_count()
+				!= WIDTHS[i]) {
+				error = WIDTH_ERRORS[i];
+			}
+		}
+		if (error == nullptr
+		    && !result_rows({ operands[0].matrix, operands[1].matrix,
+					operands[2].matrix })
+			    .has_value())
+			error = "Row counts don't match";
+		if (error == nullptr) {
+			auto jobs = state->jobs();
+			auto out = euler::util::make_reference<Matrix>();
+			make(operands[0], operands[1], operands[2], *out.get(),
+			    jobs.get());
+			return state->wrap(out);
+		}
+	}
+	state->mrb()->raise(error_class, error);
+}
+
+template <Op O>
+static void
+define_op(const euler::util::Reference<euler::util::State> &state,
+    RClass *cls)
+{
+	const auto index = static_cast<size_t>(O);
+	state->mrb()->define_method(cls, OP_NAMES[index],
+	    matrix_apply<O, false>, MRB_ARGS_REQ(1));
+	state->mrb()->define_method(cls, OP_BANG_NAMES[index],
+	    matrix_apply<O, true>, MRB_ARGS_REQ(1));
+}
+
+void
+euler::math::transform2d::define(const util::Reference<util::State> &state,
+    RClass *cls)
+{
+	const auto &mrb = state->mrb();
+	define_op<Op::Transform>(state, cls);
+	define_op<Op::Rotate>(state, cls);
+	define_op<Op::Scale>(state, cls);
+	define_op<Op::Translate>(state, cls);
+	mrb->define_method(cls, "point_angles", matrix_measure<true>,
+	    MRB_ARGS_NONE());
+	mrb->define_method(cls, "point_lengths", matrix_measure<false>,
+	    MRB_ARGS_NONE());
+	mrb->define_method(cls, "compose_transforms",
+	    matrix_compose_transforms, MRB_ARGS_REQ(1));
+	mrb->define_class_method(cls, "transforms", matrix_transforms,
+	    MRB_ARGS_OPT(3));
+}
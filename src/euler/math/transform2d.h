@@ -0,0 +1,74 @@
+/* SPDX-License-Identifier: ISC */
+
+#ifndef EULER_MATH_TRANSFORM2D_H
+#define EULER_MATH_TRANSFORM2D_H
+
+#include <initializer_list>
+#include <optional>
+
+#include "euler/math/matrix.h"
+#include "euler/math/ufunc.h"
+#include "euler/util/jobs.h"
+
+namespace euler::math::transform2d {
+
+/* Batched forms of the Vec2 helpers in math.h for point and transform arrays
+ * kept as matrices: points are N x 2 (x, y) and affine transforms N x 6
+ * (a, b, c, d, tx, ty), mapping a point to (a x + b y + tx, c x + d y + ty).
+ * Matrices are column-major, so each column is a contiguous lane and every
+ * kernel is a few vectorized Eigen array expressions over runs of rows.
+ *
+ * Any matrix operand may have a single row, which applies to every row of
+ * the result; where a kernel takes an Operand, a number applies to every row
+ * and column. Results have the type of the points, or of a, if that is Float
+ * or Double, and are Double otherwise; other operands are converted to match.
+ * out may be any input of its shape. Inputs of at least
+ * ufunc::PARALLEL_THRESHOLD rows are split on the job pool; jobs may be null
+ * to stay on the calling thread. */
+
+inline constexpr size_type POINT_WIDTH = 2;
+inline constexpr size_type TRANSFORM_WIDTH = 6;
+
+enum class Op {
+	/* by an N x 6 matrix of transforms; numbers aren't allowed */
+	Transform,
+	/* about the origin, by an N x 1 matrix of angles in radians */
+	Rotate,
+	/* by an N x 2 matrix of x and y factors */
+	Scale,
+	/* by an N x 2 matrix of x and y offsets */
+	Translate,
+};
+
+/* The number of columns op's operand takes. */
+size_type operand_width(Op op);
+
+/* The row count of a result of the given operands (null for numbers): that
+ * of any matrix with other than one row, or one. Empty if two matrices have
+ * different row counts, neither of which is one. */
+std::optional<size_type> result_rows(
+    std::initializer_list<const Matrix *> matrices);
+
+/* Moves every point; operand must have operand_width(op) columns. */
+void apply(Op op, const Matrix &points, const ufunc::Operand &operand,
+    Matrix &out, util::Jobs *jobs);
+/* The angle of each point from the x axis, in radians, as N x 1. */
+void angles(const Matrix &points, Matrix &out, util::Jobs *jobs);
+/* The length of each point as a vector, as N x 1. */
+void lengths(const Matrix &points, Matrix &out, util::Jobs *jobs);
+/* Row by row, the transform that applies b and then a, so a parent's world
+ * transform composed with a child's local one gives the child's world one. */
+void compose(const Matrix &a, const Matrix &b, Matrix &out,
+    util::Jobs *jobs);
+/* Row by row, the transform that scales, then rotates, then translates.
+ * translations and scales take two columns and angles one; the result is
+ * Float only if every matrix operand is. */
+void make(const ufunc::Operand &translations, const ufunc::Operand &angles,
+    const ufunc::Operand &scales, Matrix &out, util::Jobs *jobs);
+
+/* Defines the Ruby methods for all of the above on Matrix. */
+void define(const util::Reference<util::State> &state, RClass *cls);
+
+} /* namespace euler::math::transform2d */
+
+#endif /* EULER_MATH_TRANSFORM2D_H */
@@ -0,0 +1,909 @@
+/* SPDX-License-Identifier: ISC */
+
+#include "euler/math/ufunc.h"
+
+#include <bit>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <vector>
+
+#include "euler/util/math.h"
+#include "euler/util/state.h"
+
+using euler::math::DenseMatrix;
+using euler::math::Mask;
+using euler::math::Matrix;
+using euler::math::size_type;
+using namespace euler::math::ufunc;
+
+template <typename T> using Column = Eigen::Array<T, Eigen::Dynamic, 1>;
+
+template <typename T>
+static Eigen::Map<const Column<T>>
+segment(const DenseMatrix<T> &m, const size_t begin, const size_t end)
+{
+	return { m.data() + begin, static_cast<Eigen::Index>(end - begin) };
+}
+
+template <typename T>
+static Eigen::Map<Column<T>>
+segment(DenseMatrix<T> &m, const size_t begin, const size_t end)
+{
+	return { m.data() + begin, static_cast<Eigen::Index>(end - begin) };
+}
+
+/* Calls body on [0, size) in GRAIN-sized chunks, which start at multiples of
+ * GRAIN whether or not they run on the pool. */
+template <typename F>
+static void
+for_chunks(euler::util::Jobs *jobs, const size_t size, const F &body)
+{
+	if (jobs == nullptr || size < PARALLEL_THRESHOLD) {
+		for (size_t begin = 0; begin < size; begin += GRAIN)
+			body(begin, std::min(size, begin + GRAIN));
+		return;
+	}
+	jobs->parallel_for(0, size, GRAIN, body);
+}
+
+/* Runs fill on out's storage if it is already an R matrix of the right shape,
+ * and on a new one otherwise. Elementwise kernels can always write over their
+ * own input. */
+template <typename R, typename F>
+static void
+produce(Matrix &out, const size_type rows, const size_type columns,
+    const F &fill)
+{
+	auto m = std::get_if<DenseMatrix<R>>(&out.storage());
+	if (m != nullptr && m->rows() == rows && m->cols() == columns) {
+		fill(*m);
+		return;
+	}
+	DenseMatrix<R> result(rows, columns);
+	fill(result);
+	out.storage() = std::move(result);
+}
+
+/* m as R, converted into scratch if it is some other type. */
+template <typename R>
+static const DenseMatrix<R> &
+as_type(const Matrix &m, DenseMatrix<R> &scratch)
+{
+	if (m.type() == Matrix::type_of<R>()) return m.as<R>();
+	scratch = m.cast<R>();
+	return scratch;
+}
+
+/* condition as R, reduced to zeros and ones in its own type first when it
+ * is some other type, so that 0.5 or 1e-50 cannot convert to zero */
+template <typename R>
+static const DenseMatrix<R> &
+as_selector(const Matrix &condition, DenseMatrix<R> &scratch)
+{
+	if (condition.type() == Matrix::type_of<R>()) return condition.as<R>();
+	Matrix::visit_type(condition.type(), [&]<typename C>(C) {
+		scratch = (condition.as<C>().array() != C(0))
+			      .template cast<R>()
+			      .matrix();
+	});
+	return scratch;
+}
+
+static bool
+is_floating(const Matrix::Type type)
+{
+	return type == Matrix::Type::Float || type == Matrix::Type::Double;
+}
+
+Matrix::Type
+euler::math::ufunc::result_type(const Unary op, const Matrix::Type type)
+{
+	if (is_floating(type)) return type;
+	switch (op) {
+	case Unary::Abs:
+	case Unary::Floor:
+	case Unary::Ceil:
+	case Unary::Round: return type;
+	default: return Matrix::Type::Double;
+	}
+}
+
+template <typename R, typename T>
+static void
+apply_typed(const Unary op, const DenseMatrix<T> &in, DenseMatrix<R> &out,
+    euler::util::Jobs *jobs)
+{
+	for_chunks(jobs, in.size(), [&](const size_t begin, const size_t end) {
+		const auto x = segment(in, begin, end).template cast<R>();
+		auto y = segment(out, begin, end);
+		if constexpr (std::is_floating_point_v<R>) {
+			switch (op) {
+			case Unary::Sqrt: y = x.sqrt(); return;
+			case Unary::Exp: y = x.exp(); return;
+			case Unary::Log: y = x.log(); return;
+			case Unary::Abs: y = x.abs(); return;
+			case Unary::Sin: y = x.sin(); return;
+			case Unary::Cos: y = x.cos(); return;
+			case Unary::Tan: y = x.tan(); return;
+			case Unary::Floor: y = x.floor(); return;
+			case Unary::Ceil: y = x.ceil(); return;
+			case Unary::Round: y = x.round(); return;
+			}
+		} else if constexpr (std::is_signed_v<R>) {
+			if (op == Unary::Abs) y = x.abs();
+			else y = x;
+		} else {
+			/* only the integer-preserving functions get here, and
+			 * all of them are the identity on unsigned types */
+			y = x;
+		}
+	});
+}
+
+void
+euler::math::ufunc::apply(const Unary op, const Matrix &in, Matrix &out,
+    util::Jobs *jobs)
+{
+	const auto type = result_type(op, in.type());
+	Matrix::visit_type(in.type(), [&]<typename T>(T) {
+		const auto &source = in.as<T>();
+		const auto fill = [&](auto &result) {
+			apply_typed(op, source, result, jobs);
+		};
+		if (type == in.type())
+			produce<T>(out, source.rows(), source.cols(), fill);
+		else produce<double>(out, source.rows(), source.cols(), fill);
+	});
+}
+
+void
+euler::math::ufunc::pow(const Matrix &in, const double exponent, Matrix &out,
+    util::Jobs *jobs)
+{
+	const auto type = is_floating(in.type()) ? in.type()
+						 : Matrix::Type::Double;
+	Matrix::visit_type(type, [&]<typename R>(R) {
+		DenseMatrix<R> scratch;
+		const auto &source = as_type<R>(in, scratch);
+		const auto p = static_cast<R>(exponent);
+		const auto fill = [&](auto &result) {
+			for_chunks(jobs, source.size(),
+			    [&](const size_t begin, const size_t end) {
+				    segment(result, begin, end)
+					= segment(source, begin, end).pow(p);
+			    });
+		};
+		produce<R>(out, source.rows(), source.cols(), fill);
+	});
+}
+
+void
+euler::math::ufunc::clamp(Matrix &m, const double min, const double max,
+    util::Jobs *jobs)
+{
+	Matrix::visit_type(m.type(), [&]<typename T>(T) {
+		auto &values = m.as<T>();
+		const auto lo = saturate<T>(min);
+		const auto hi = saturate<T>(max);
+		for_chunks(jobs, values.size(),
+		    [&](const size_t begin, const size_t end) {
+			    auto x = segment(values, begin, end);
+			    x = x.max(lo).min(hi);
+		    });
+	});
+}
+
+void
+euler::math::ufunc::lerp(const Matrix &a, const Matrix &b, const double t,
+    Matrix &out, util::Jobs *jobs)
+{
+	auto type = Matrix::promote(a.type(), b.type());
+	if (!is_floating(type)) type = Matrix::Type::Double;
+	Matrix::visit_type(type, [&]<typename R>(R) {
+		DenseMatrix<R> scratch_a, scratch_b;
+		const auto &from = as_type<R>(a, scratch_a);
+		const auto &to = as_type<R>(b, scratch_b);
+		const auto weight = static_cast<R>(t);
+		produce<R>(out, from.rows(), from.cols(), [&](auto &result) {
+			for_chunks(jobs, from.size(),
+			    [&](const size_t begin, const size_t end) {
+				    const auto x = segment(from, begin, end);
+				    const auto y = segment(to, begin, end);
+				    segment(result, begin, end)
+					= x + (y - x) * weight;
+			    });
+		});
+	});
+}
+
+/* Calls fn with either a segment of operand or the broadcast scalar. */
+template <typename R, typename F>
+static void
+with_operand(const Operand &operand, const DenseMatrix<R> *matrix,
+    const size_t begin, const size_t end, const F &fn)
+{
+	if (matrix != nullptr) {
+		fn(segment(*matrix, begin, end));
+		return;
+	}
+	const auto size = static_cast<Eigen::Index>(end - begin);
+	fn(Column<R>::Constant(size, static_cast<R>(operand.scalar)));
+}
+
+/* The type where produces: that of its matrix operands, or Double if both are
+ * scalars. */
+static Matrix::Type
+where_type(const Operand &a, const Operand &b)
+{
+	if (a.matrix != nullptr && b.matrix != nullptr)
+		return Matrix::promote(a.matrix->type(), b.matrix->type());
+	if (a.matrix != nullptr) return a.matrix->type();
+	if (b.matrix != nullptr) return b.matrix->type();
+	return Matrix::Type::Double;
+}
+
+void
+euler::math::ufunc::where(const Matrix &condition, const Operand &a,
+    const Operand &b, Matrix &out, util::Jobs *jobs)
+{
+	Matrix::visit_type(where_type(a, b), [&]<typename R>(R) {
+		DenseMatrix<R> scratch_c, scratch_a, scratch_b;
+		const auto &mask = as_selector<R>(condition, scratch_c);
+		const auto *then = a.matrix != nullptr
+		    ? &as_type<R>(*a.matrix, scratch_a)
+		    : nullptr;
+		const auto *otherwise = b.matrix != nullptr
+		    ? &as_type<R>(*b.matrix, scratch_b)
+		    : nullptr;
+		const auto chunk = [&](auto &result, const size_t begin,
+				       const size_t end) {
+			const auto selector = segment(mask, begin, end) != R(0);
+			auto y = segment(result, begin, end);
+			const auto pick = [&](const auto &x) {
+				const auto select = [&](const auto &z) {
+					y = selector.select(x, z);
+				};
+				with_operand(b, otherwise, begin, end, select);
+			};
+			with_operand(a, then, begin, end, pick);
+		};
+		produce<R>(out, mask.rows(), mask.cols(), [&](auto &result) {
+			for_chunks(jobs, mask.size(),
+			    [&](const size_t begin, const size_t end) {
+				    chunk(result, begin, end);
+			    });
+		});
+	});
+}
+
+/* Calls fn with the index of every set bit of mask in [begin, end), in order;
+ * begin is a multiple of the word size. */
+template <typename F>
+static void
+for_set_bits(const Mask &mask, const size_t begin, const size_t end,
+    const F &fn)
+{
+	const auto *words = mask.words();
+	for (size_t first = begin; first < end; first += Mask::WORD_BITS) {
+		auto word = words[first / Mask::WORD_BITS];
+		for (; word != 0; word &= word - 1)
+			fn(first + std::countr_zero(word));
+	}
+}
+
+void
+euler::math::ufunc::where(const Mask &condition, const Operand &a,
+    const Operand &b, Matrix &out, util::Jobs *jobs)
+{
+	Matrix::visit_type(where_type(a, b), [&]<typename R>(R) {
+		DenseMatrix<R> scratch_a, scratch_b;
+		const R *then = a.matrix != nullptr
+		    ? as_type<R>(*a.matrix, scratch_a).data()
+		    : nullptr;
+		const R *otherwise = b.matrix != nullptr
+		    ? as_type<R>(*b.matrix, scratch_b).data()
+		    : nullptr;
+		const auto then_scalar = saturate<R>(a.scalar);
+		const auto otherwise_scalar = saturate<R>(b.scalar);
+		const auto rows = condition.row_count();
+		const auto columns = condition.column_count();
+		produce<R>(out, rows, columns, [&](auto &result) {
+			auto *y = result.data();
+			for_chunks(jobs, condition.size(),
+			    [&](const size_t begin, const size_t end) {
+				    for (size_t i = begin; i < end; ++i) {
+					    if (condition.get(i)) {
+						    y[i] = then != nullptr
+							? then[i]
+							: then_scalar;
+					    } else {
+						    y[i] = otherwise != nullptr
+							? otherwise[i]
+							: otherwise_scalar;
+					    }
+				    }
+			    });
+		});
+	});
+}
+
+void
+euler::math::ufunc::assign(Matrix &m, const Mask &mask, const Operand &value,
+    util::Jobs *jobs)
+{
+	Matrix::visit_type(m.type(), [&]<typename T>(T) {
+		DenseMatrix<T> scratch;
+		const T *source = value.matrix != nullptr
+		    ? as_type<T>(*value.matrix, scratch).data()
+		    : nullptr;
+		const auto scalar = saturate<T>(value.scalar);
+		auto *y = m.as<T>().data();
+		const auto set = [&](const size_t i) {
+			y[i] = source != nullptr ? source[i] : scalar;
+		};
+		for_chunks(jobs, mask.size(),
+		    [&](const size_t begin, const size_t end) {
+			    for_set_bits(mask, begin, end, set);
+		    });
+	});
+}
+
+void
+euler::math::ufunc::select(const Matrix &m, const Mask &mask, Matrix &out,
+    util::Jobs *jobs)
+{
+	/* count every chunk first, so each one knows where its output
+	 * starts and all of them can copy at once */
+	const auto size = mask.size();
+	std::vector<size_t> offsets((size + GRAIN - 1) / GRAIN + 1, 0);
+	for_chunks(jobs, size, [&](const size_t begin, const size_t end) {
+		offsets[begin / GRAIN + 1] = mask.count(begin, end);
+	});
+	std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+	Matrix::visit_type(m.type(), [&]<typename T>(T) {
+		const auto *x = m.as<T>().data();
+		DenseMatrix<T> result(static_cast<Eigen::Index>(offsets.back()),
+		    1);
+		auto *y = result.data();
+		const auto copy = [&](const size_t begin, const size_t end) {
+			auto next = offsets[begin / GRAIN];
+			for_set_bits(mask, begin, end,
+			    [&](const size_t i) { y[next++] = x[i]; });
+		};
+		for_chunks(jobs, size, copy);
+		out.storage() = std::move(result);
+	});
+}
+
+template <typename F>
+static void
+visit_comparison(const Comparison op, F &&fn)
+{
+	switch (op) {
+	case Comparison::Equal: fn(std::equal_to<>()); break;
+	case Comparison::NotEqual: fn(std::not_equal_to<>()); break;
+	case Comparison::Less: fn(std::less<>()); break;
+	case Comparison::LessEqual: fn(std::less_equal<>()); break;
+	case Comparison::Greater: fn(std::greater<>()); break;
+	case Comparison::GreaterEqual: fn(std::greater_equal<>()); break;
+	}
+}
+
+/* Whether value converts to T without changing. */
+template <typename T>
+static bool
+is_exact(const double value)
+{
+	if constexpr (std::is_floating_point_v<T>) {
+		return static_cast<double>(static_cast<T>(value)) == value;
+	} else {
+		/* limits::max() + 1 is a power of two, so exact in a double */
+		using limits = std::numeric_limits<T>;
+		const auto bound = static_cast<double>(limits::max()) + 1.0;
+		return value >= static_cast<double>(limits::lowest())
+		    && value < bound && std::trunc(value) == value;
+	}
+}
+
+/* Packs bit(i) for every i in [begin, end) into out's words; begin is a
+ * multiple of the word size. */
+template <typename F>
+static void
+pack_bits(Mask &out, const size_t begin, const size_t end, const F &bit)
+{
+	auto *words = out.words();
+	for (size_t first = begin; first < end; first += Mask::WORD_BITS) {
+		const auto last = std::min(end, first + Mask::WORD_BITS);
+		Mask::Word word = 0;
+		for (size_t i = first; i < last; ++i)
+			word |= static_cast<Mask::Word>(bit(i)) << (i - first);
+		words[first / Mask::WORD_BITS] = word;
+	}
+}
+
+void
+euler::math::ufunc::compare(const Comparison op, const Matrix &a,
+    const Operand &b, Mask &out, util::Jobs *jobs)
+{
+	out.resize(a.row_count(), a.column_count());
+	const auto run = [&](const auto *x, const auto &y) {
+		visit_comparison(op, [&](const auto cmp) {
+			for_chunks(jobs, out.size(),
+			    [&](const size_t begin, const size_t end) {
+				    pack_bits(out, begin, end,
+					[&](const size_t i) {
+						return cmp(x[i], y(i));
+					});
+			    });
+		});
+	};
+	if (b.matrix != nullptr) {
+		const auto type = Matrix::promote(a.type(), b.matrix->type());
+		Matrix::visit_type(type, [&]<typename R>(R) {
+			DenseMatrix<R> scratch_a, scratch_b;
+			const auto *x = as_type<R>(a, scratch_a).data();
+			const auto *y = as_type<R>(*b.matrix, scratch_b).data();
+			run(x, [y](const size_t i) { return y[i]; });
+		});
+		return;
+	}
+	Matrix::visit_type(a.type(), [&]<typename T>(T) {
+		const auto *x = a.as<T>().data();
+		/* anything T can't hold is compared as a double instead, which
+		 * orders every T correctly against it */
+		if (is_exact<T>(b.scalar)) {
+			const auto y = static_cast<T>(b.scalar);
+			run(x, [y](size_t) { return y; });
+		} else {
+			const auto y = b.scalar;
+			run(x, [y](size_t) { return y; });
+		}
+	});
+}
+
+/* Combines the partial result of every chunk in order, so the answer doesn't
+ * depend on how the chunks were scheduled. */
+template <typename A, typename Chunk, typename Combine>
+static A
+reduce_chunks(euler::util::Jobs *jobs, const size_t size, const Chunk &chunk,
+    const Combine &combine, const A empty)
+{
+	if (size == 0) return empty;
+	std::vector<A> partials((size + GRAIN - 1) / GRAIN);
+	for_chunks(jobs, size, [&](const size_t begin, const size_t end) {
+		partials[begin / GRAIN] = chunk(begin, end);
+	});
+	A out = partials[0];
+	for (size_t i = 1; i < partials.size(); ++i)
+		out = combine(out, partials[i]);
+	return out;
+}
+
+template <typename T>
+static Result
+reduce_typed(const Reduction op, const DenseMatrix<T> &m,
+    euler::util::Jobs *jobs)
+{
+	using Sum = std::conditional_t<std::is_floating_point_v<T>, double,
+	    std::conditional_t<std::is_signed_v<T>, int64_t, uint64_t>>;
+	const auto size = static_cast<size_t>(m.size());
+	const auto add = [](auto a, auto b) { return a + b; };
+	switch (op) {
+	case Reduction::Sum:
+		return reduce_chunks<Sum>(jobs, size,
+		    [&](const size_t begin, const size_t end) {
+			    return segment(m, begin, end)
+				.template cast<Sum>()
+				.sum();
+		    },
+		    add, Sum(0));
+	case Reduction::Min:
+		return static_cast<Sum>(reduce_chunks<T>(jobs, size,
+		    [&](const size_t begin, const size_t end) {
+			    return segment(m, begin, end).minCoeff();
+		    },
+		    [](T a, T b) { return std::min(a, b); }, T(0)));
+	case Reduction::Max:
+		return static_cast<Sum>(reduce_chunks<T>(jobs, size,
+		    [&](const size_t begin, const size_t end) {
+			    return segment(m, begin, end).maxCoeff();
+		    },
+		    [](T a, T b) { return std::max(a, b); }, T(0)));
+	case Reduction::Mean: {
+		const auto sum = reduce_chunks<double>(jobs, size,
+		    [&](const size_t begin, const size_t end) {
+			    return segment(m, begin, end)
+				.template cast<double>()
+				.sum();
+		    },
+		    add, 0.0);
+		if (size == 0) return std::nan("");
+		return sum / static_cast<double>(size);
+	}
+	case Reduction::Norm:
+		return std::sqrt(reduce_chunks<double>(jobs, size,
+		    [&](const size_t begin, const size_t end) {
+			    return segment(m, begin, end)
+				.template cast<double>()
+				.square()
+				.sum();
+		    },
+		    add, 0.0));
+	}
+	return 0.0;
+}
+
+Result
+euler::math::ufunc::reduce(const Reduction op, const Matrix &m,
+    util::Jobs *jobs)
+{
+	return std::visit(
+	    [&](const auto &values) { return reduce_typed(op, values, jobs); },
+	    m.storage());
+}
+
+static constexpr const char *UNARY_NAMES[] = {
+	"sqrt",
+	"exp",
+	"log",
+	"abs",
+	"sin",
+	"cos",
+	"tan",
+	"floor",
+	"ceil",
+	"round",
+};
+
+static constexpr const char *UNARY_BANG_NAMES[] = {
+	"sqrt!",
+	"exp!",
+	"log!",
+	"abs!",
+	"sin!",
+	"cos!",
+	"tan!",
+	"floor!",
+	"ceil!",
+	"round!",
+};
+
+/**
+ * @overload Euler::Math::Matrix#sqrt
+ *   Like exp, log, abs, sin, cos, tan, floor, ceil and round: applies the
+ *   function to every element.
+ *   @return [Euler::Math::Matrix] A new matrix; :double for integer inputs,
+ *     except from abs, floor, ceil and round.
+ */
+template <Unary Op>
+static mrb_value
+matrix_unary(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	const auto matrix = euler::util::Reference<Matrix>::unwrap(mrb, self);
+	auto jobs = state->jobs();
+	auto out = euler::util::make_reference<Matrix>();
+	apply(Op, *matrix.get(), *out.get(), jobs.get());
+	return state->wrap(out);
+}
+
+/**
+ * @overload Euler::Math::Matrix#sqrt!
+ *   The in-place form of sqrt, and likewise for the others.
+ *   @return [self]
+ *   @raise [TypeError] If the result wouldn't fit the matrix's type.
+ */
+template <Unary Op>
+static mrb_value
+matrix_unary_bang(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	auto matrix = euler::util::Reference<Matrix>::unwrap(mrb, self);
+	if (result_type(Op, matrix->type()) != matrix->type()) {
+		state->mrb()->raisef(state->mrb()->type_error(),
+		    "%s needs a float or double matrix; use %s",
+		    UNARY_BANG_NAMES[static_cast<size_t>(Op)],
+		    UNARY_NAMES[static_cast<size_t>(Op)]);
+	}
+	auto jobs = state->jobs();
+	apply(Op, *matrix.get(), *matrix.get(), jobs.get());
+	return self;
+}
+
+/**
+ * @overload Euler::Math::Matrix#pow(exponent)
+ *   @param exponent [Numeric]
+ *   @return [Euler::Math::Matrix] Every element raised to exponent.
+ */
+static mrb_value
+matrix_pow(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	mrb_float exponent;
+	state->mrb()->get_args("f", &exponent);
+	const auto matrix = euler::util::Reference<Matrix>::unwrap(mrb, self);
+	auto jobs = state->jobs();
+	auto out = euler::util::make_reference<Matrix>();
+	pow(*matrix.get(), exponent, *out.get(), jobs.get());
+	return state->wrap(out);
+}
+
+/**
+ * @overload Euler::Math::Matrix#lerp(other, t)
+ *   @param other [Euler::Math::Matrix] A matrix of the same shape.
+ *   @param t [Float] The weight of other.
+ *   @return [Euler::Math::Matrix] self + (other - self) * t
+ */
+static mrb_value
+matrix_lerp(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	mrb_value other_value;
+	mrb_float t;
+	state->mrb()->get_args("of", &other_value, &t);
+	{
+		const auto matrix = state->unwrap<Matrix>(self);
+		const auto other = state->unwrap<Matrix>(other_value);
+		if (matrix->row_count() == other->row_count()
+		    && matrix->column_count() == other->column_count()) {
+			auto jobs = state->jobs();
+			auto out = euler::util::make_reference<Matrix>();
+			lerp(*matrix.get(), *other.get(), t, *out.get(),
+			    jobs.get());
+			return state->wrap(out);
+		}
+	}
+	state->mrb()->raise(state->mrb()->argument_error(),
+	    "Cannot interpolate between matrices of different shapes");
+}
+
+bool
+euler::math::ufunc::read_operand(mrb_state *mrb, const mrb_value value,
+    Operand &operand, util::Reference<Matrix> &holder)
+{
+	const auto state = euler::util::State::get(mrb);
+	if (mrb_integer_p(value) || mrb_float_p(value)) {
+		operand.scalar = state->mrb()->to_flo(value);
+		return true;
+	}
+	if (!state->mrb()->obj_is_kind_of(value, state->modules().math.matrix))
+		return false;
+	holder = state->unwrap<Matrix>(value);
+	operand.matrix = holder.get();
+	return true;
+}
+
+/**
+ * @overload Euler::Math::Matrix.where(condition, a, b)
+ *   @param condition [Euler::Math::Mask, Euler::Math::Matrix] Picks a where
+ *     set, or nonzero for a matrix, and b elsewhere.
+ *   @param a [Euler::Math::Matrix, Numeric]
+ *   @param b [Euler::Math::Matrix, Numeric]
+ *   @return [Euler::Math::Matrix]
+ */
+static mrb_value
+matrix_where(mrb_state *mrb, mrb_value)
+{
+	const auto state = euler::util::State::get(mrb);
+	mrb_value condition_value, a_value, b_value;
+	state->mrb()->get_args("ooo", &condition_value, &a_value, &b_value);
+	const char *error = nullptr;
+	{
+		euler::util::Reference<Matrix> condition;
+		euler::util::Reference<Mask> mask;
+		size_type rows, columns;
+		if (state->mrb()->obj_is_kind_of(condition_value,
+			state->modules().math.mask)) {
+			mask = state->unwrap<Mask>(condition_value);
+			rows = mask->row_count();
+			columns = mask->column_count();
+		} else {
+			condition = state->unwrap<Matrix>(condition_value);
+			rows = condition->row_count();
+			columns = condition->column_count();
+		}
+		euler::util::Reference<Matrix> a_holder, b_holder;
+		Operand a, b;
+		if (!read_operand(mrb, a_value, a, a_holder)
+		    || !read_operand(mrb, b_value, b, b_holder)) {
+			error = "Expected a Matrix or a number";
+		} else {
+			for (const auto *m : { a.matrix, b.matrix }) {
+				if (m == nullptr) continue;
+				if (m->row_count() != rows
+				    || m->column_count() != columns)
+					error = "Matrix shapes don't match";
+			}
+		}
+		if (error == nullptr) {
+			auto jobs = state->jobs();
+			auto out = euler::util::make_reference<Matrix>();
+			if (mask.get() != nullptr) {
+				where(*mask.get(), a, b, *out.get(),
+				    jobs.get());
+			} else {
+				where(*condition.get(), a, b, *out.get(),
+				    jobs.get());
+			}
+			return state->wrap(out);
+		}
+	}
+	state->mrb()->raise(state->mrb()->argument_error(), error);
+}
+
+/**
+ * @overload Euler::Math::Matrix#select(mask)
+ *   @param mask [Euler::Math::Mask] A mask of the same shape.
+ *   @return [Euler::Math::Matrix] A column vector of the elements where mask
+ *     is set, in column-major order.
+ */
+static mrb_value
+matrix_select(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	mrb_value mask_value;
+	state->mrb()->get_args("o", &mask_value);
+	{
+		const auto matrix = state->unwrap<Matrix>(self);
+		const auto mask = state->unwrap<Mask>(mask_value);
+		if (mask->same_shape(matrix->row_count(),
+			matrix->column_count())) {
+			auto jobs = state->jobs();
+			auto out = euler::util::make_reference<Matrix>();
+			select(*matrix.get(), *mask.get(), *out.get(),
+			    jobs.get());
+			return state->wrap(out);
+		}
+	}
+	state->mrb()->raise(state->mrb()->argument_error(),
+	    "Mask and matrix shapes don't match");
+}
+
+/**
+ * @overload Euler::Math::Matrix#<(other)
+ *   Like <=, >, >=, eq and ne: compares element by element.
+ *   @param other [Euler::Math::Matrix, Numeric] A matrix of the same shape,
+ *     or a number to compare every element with.
+ *   @return [Euler::Math::Mask] Set where the comparison holds.
+ */
+template <Comparison Op>
+static mrb_value
+matrix_compare(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	mrb_value other_value;
+	state->mrb()->get_args("o", &other_value);
+	const char *error = "Matrix shapes don't match";
+	{
+		const auto matrix = state->unwrap<Matrix>(self);
+		euler::util::Reference<Matrix> holder;
+		Operand other;
+		if (!read_operand(mrb, other_value, other, holder)) {
+			error = "Expected a Matrix or a number";
+		} else if (other.matrix == nullptr
+		    || (other.matrix->row_count() == matrix->row_count()
+			&& other.matrix->column_count()
+			    == matrix->column_count())) {
+			auto jobs = state->jobs();
+			auto out = euler::util::make_reference<Mask>();
+			compare(Op, *matrix.get(), other, *out.get(),
+			    jobs.get());
+			return state->wrap(out);
+		}
+	}
+	state->mrb()->raise(state->mrb()->argument_error(), error);
+}
+
+/**
+ * @overload Euler::Math::Matrix#==(other)
+ *   Like !=: compares whole matrices, so that a matrix can be a condition or
+ *   an Array member. Use eq and ne for element by element masks.
+ *   @param other [Object]
+ *   @return [Boolean] Whether other is a matrix of the same shape whose
+ *     elements all equal self's, whatever the element types.
+ */
+template <bool Equal>
+static mrb_value
+matrix_equal(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	mrb_value other_value;
+	state->mrb()->get_args("o", &other_value);
+	if (!state->mrb()->obj_is_kind_of(other_value,
+		state->modules().math.matrix))
+		return mrb_bool_value(!Equal);
+	const auto matrix = state->unwrap<Matrix>(self);
+	const auto other = state->unwrap<Matrix>(other_value);
+	if (matrix->row_count() != other->row_count()
+	    || matrix->column_count() != other->column_count())
+		return mrb_bool_value(!Equal);
+	auto jobs = state->jobs();
+	Mask equal;
+	compare(Comparison::Equal, *matrix.get(), { other.get(), 0.0 }, equal,
+	    jobs.get());
+	return mrb_bool_value(equal.all() == Equal);
+}
+
+/**
+ * @overload Euler::Math::Matrix#sum
+ *   Like min, max, mean and norm: reduces every element to one number.
+ *   @return [Numeric, nil] An Integer for integer matrices except from mean
+ *     and norm; nil for the min or max of an empty matrix.
+ */
+template <Reduction Op>
+static mrb_value
+matrix_reduce(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	const auto matrix = euler::util::Reference<Matrix>::unwrap(mrb, self);
+	if ((Op == Reduction::Min || Op == Reduction::Max)
+	    && matrix->row_count() * matrix->column_count() == 0)
+		return mrb_nil_value();
+	auto jobs = state->jobs();
+	const auto result = reduce(Op, *matrix.get(), jobs.get());
+	return std::visit(
+	    [&](const auto value) {
+		    return euler::util::wrap_num(state->mrb(), value);
+	    },
+	    result);
+}
+
+template <Unary Op>
+static void
+define_unary(const euler::util::Reference<euler::util::State> &state,
+    RClass *cls)
+{
+	const auto index = static_cast<size_t>(Op);
+	state->mrb()->define_method(cls, UNARY_NAMES[index], matrix_unary<Op>,
+	    MRB_ARGS_NONE());
+	state->mrb()->define_method(cls, UNARY_BANG_NAMES[index],
+	    matrix_unary_bang<Op>, MRB_ARGS_NONE());
+}
+
+void
+euler::math::ufunc::define(const util::Reference<util::State> &state,
+    RClass *cls)
+{
+	const auto &mrb = state->mrb();
+	define_unary<Unary::Sqrt>(state, cls);
+	define_unary<Unary::Exp>(state, cls);
+	define_unary<Unary::Log>(state, cls);
+	define_unary<Unary::Abs>(state, cls);
+	define_unary<Unary::Sin>(state, cls);
+	define_unary<Unary::Cos>(state, cls);
+	define_unary<Unary::Tan>(state, cls);
+	define_unary<Unary::Floor>(state, cls);
+	define_unary<Unary::Ceil>(state, cls);
+	define_unary<Unary::Round>(state, cls);
+	mrb->define_method(cls, "pow", matrix_pow, MRB_ARGS_REQ(1));
+	mrb->define_method(cls, "lerp", matrix_lerp, MRB_ARGS_REQ(2));
+	mrb->define_class_method(cls, "where", matrix_where, MRB_ARGS_REQ(3));
+	mrb->define_method(cls, "select", matrix_select, MRB_ARGS_REQ(1));
+	mrb->define_method(cls, "==", matrix_equal<true>, MRB_ARGS_REQ(1));
+	mrb->define_method(cls, "!=", matrix_equal<false>, MRB_ARGS_REQ(1));
+	mrb->define_method(cls, "eq", matrix_compare<Comparison::Equal>,
+	    MRB_ARGS_REQ(1));
+	mrb->define_method(cls, "ne", matrix_compare<Comparison::NotEqual>,
+	    MRB_ARGS_REQ(1));
+	mrb->define_method(cls, "<", matrix_compare<Comparison::Less>,
+	    MRB_ARGS_REQ(1));
+	mrb->define_method(cls, "<=", matrix_compare<Comparison::LessEqual>,
+	    MRB_ARGS_REQ(1));
+	mrb->define_method(cls, ">", matrix_compare<Comparison::Greater>,
+	    MRB_ARGS_REQ(1));
+	mrb->define_method(cls, ">=",
+	    matrix_compare<Comparison::GreaterEqual>, MRB_ARGS_REQ(1));
+	mrb->define_method(cls, "sum", matrix_reduce<Reduction::Sum>,
+	    MRB_ARGS_NONE());
+	mrb->define_method(cls, "min", matrix_reduce<Reduction::Min>,
+	    MRB_ARGS_NONE());
+	mrb->define_method(cls, "max", matrix_reduce<Reduction::Max>,
+	    MRB_ARGS_NONE());
+	mrb->define_method(cls, "mean", matrix_reduce<Reduction::Mean>,
+	    MRB_ARGS_NONE());
+	mrb->define_method(cls, "norm", matrix_reduce<Reduction::Norm>,
+	    MRB_ARGS_NONE());
+}
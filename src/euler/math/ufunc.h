@@ -0,0 +1,127 @@
+/* SPDX-License-Identifier: ISC */
+
+#ifndef EULER_MATH_UFUNC_H
+#define EULER_MATH_UFUNC_H
+
+#include <limits>
+#include <type_traits>
+
+#include "euler/math/mask.h"
+#include "euler/math/matrix.h"
+#include "euler/util/jobs.h"
+
+namespace euler::math::ufunc {
+
+/* Elementwise functions and reductions over the coefficients of a Matrix,
+ * run as Eigen array expressions instead of a Ruby block per element. Inputs
+ * of at least PARALLEL_THRESHOLD coefficients are split into GRAIN-sized
+ * chunks on the job pool; jobs may be null to stay on the calling thread. */
+
+enum class Unary {
+	Sqrt,
+	Exp,
+	Log,
+	Abs,
+	Sin,
+	Cos,
+	Tan,
+	Floor,
+	Ceil,
+	Round,
+};
+
+enum class Reduction {
+	Sum,
+	Min,
+	Max,
+	Mean,
+	Norm,
+};
+
+enum class Comparison {
+	Equal,
+	NotEqual,
+	Less,
+	LessEqual,
+	Greater,
+	GreaterEqual,
+};
+
+inline constexpr size_t PARALLEL_THRESHOLD = 1 << 16;
+/* a whole number of Mask words, so no two chunks write the same word */
+inline constexpr size_t GRAIN = 1 << 14;
+static_assert(GRAIN % Mask::WORD_BITS == 0);
+
+/* Either a matrix or a scalar broadcast over every coefficient. */
+struct Operand {
+	const Matrix *matrix = nullptr;
+	double scalar = 0.0;
+};
+
+/* Converts a bound to T, saturating instead of overflowing. */
+template <typename T>
+T
+saturate(const double value)
+{
+	if constexpr (std::is_floating_point_v<T>) {
+		return static_cast<T>(value);
+	} else {
+		using limits = std::numeric_limits<T>;
+		if (value <= static_cast<double>(limits::lowest()))
+			return limits::lowest();
+		if (value >= static_cast<double>(limits::max()))
+			return limits::max();
+		return static_cast<T>(value);
+	}
+}
+
+/* The type op produces from type: Double for integer inputs, except for the
+ * functions that map integers to integers. */
+Matrix::Type result_type(Unary op, Matrix::Type type);
+
+/* out may be in. */
+void apply(Unary op, const Matrix &in, Matrix &out, util::Jobs *jobs);
+void pow(const Matrix &in, double exponent, Matrix &out, util::Jobs *jobs);
+void clamp(Matrix &m, double min, double max, util::Jobs *jobs);
+/* out = a + (b - a) * t, in the promoted type of a and b, or Double if that
+ * is an integer type. a and b must have the same shape. */
+void lerp(const Matrix &a, const Matrix &b, double t, Matrix &out,
+    util::Jobs *jobs);
+/* out = condition != 0 ? a : b, coefficient by coefficient. Matrix operands
+ * must have condition's shape. */
+void where(const Matrix &condition, const Operand &a, const Operand &b,
+    Matrix &out, util::Jobs *jobs);
+
+/* Mask variants of the above: condition must have the shape of every matrix
+ * operand. */
+void where(const Mask &condition, const Operand &a, const Operand &b,
+    Matrix &out, util::Jobs *jobs);
+/* Sets the coefficients of m where mask is set; m keeps its type. */
+void assign(Matrix &m, const Mask &mask, const Operand &value,
+    util::Jobs *jobs);
+/* The coefficients of m where mask is set, in column-major order, as a column
+ * vector of m's type. out may be m. */
+void select(const Matrix &m, const Mask &mask, Matrix &out, util::Jobs *jobs);
+
+/* out = a op b. A matrix b must have a's shape; a scalar b is compared
+ * exactly, so an integer matrix is never compared to a truncated bound. */
+void compare(Comparison op, const Matrix &a, const Operand &b, Mask &out,
+    util::Jobs *jobs);
+
+/* Float and Double matrices reduce in double; integer ones in 64-bit
+ * integers, except for Mean and Norm. Min and Max of an empty matrix are
+ * undefined. */
+using Result = std::variant<double, int64_t, uint64_t>;
+Result reduce(Reduction op, const Matrix &m, util::Jobs *jobs);
+
+/* Reads a number or a Matrix, which holder keeps alive; false for anything
+ * else. */
+bool read_operand(mrb_state *mrb, mrb_value value, Operand &operand,
+    util::Reference<Matrix> &holder);
+
+/* Defines the Ruby methods for all of the above on Matrix. */
+void define(const util::Reference<util::State> &state, RClass *cls);
+
+} /* namespace euler::math::ufunc */
+
+#endif /* EULER_MATH_UFUNC_H */
@@ -617,7 +617,7 @@ body_joints(mrb_state *mrb, mrb_value self)
 {
 	const auto state = euler::util::State::get(mrb);
 	const auto body = Body::unwrap(mrb, self);
-	auto joints = body->joints();
+	auto joints = body->joints(&state->frame_arena());
 	const mrb_value out = state->mrb()->ary_new_capa(joints.size());
 	for (const auto &joint : joints)
 		state->mrb()->ary_push(out, joint->wrap(state));
@@ -1002,7 +1002,7 @@ body_shapes(mrb_state *mrb, mrb_value self)
 {
 	const auto state = euler::util::State::get(mrb);
 	const auto body = Body::unwrap(mrb, self);
-	const auto shapes = body->shapes();
+	const auto shapes = body->shapes(&state->frame_arena());
 	const mrb_value out = state->mrb()->ary_new_capa(shapes.size());
 	for (auto shape : shapes)
 		state->mrb()->ary_push(out, state->wrap(shape));
@@ -1544,14 +1544,14 @@ Body::is_valid()
 	return b2Body_IsValid(_id);
 }
 
-std::vector<euler::util::Reference<euler::physics::Joint>>
-Body::joints()
+std::pmr::vector<euler::util::Reference<euler::physics::Joint>>
+Body::joints(std::pmr::memory_resource *resource)
 {
-	std::vector<b2JointId> b2_joints;
+	std::pmr::vector<b2JointId> b2_joints(resource);
 	const auto count = b2Body_GetJointCount(_id);
 	b2_joints.resize(static_cast<size_t>(count));
 	b2Body_GetJoints(_id, b2_joints.data(), count);
-	std::vector<util::Reference<Joint>> joints;
+	std::pmr::vector<util::Reference<Joint>> joints(resource);
 	joints.reserve(static_cast<size_t>(count));
 	for (const auto &b2_joint : b2_joints) {
 		auto joint = Joint::wrap(b2_joint);
@@ -1716,14 +1716,14 @@ Body::set_type(b2BodyType type)
 	b2Body_SetType(_id, type);
 }
 
-std::vector<euler::util::Reference<euler::physics::Shape>>
-Body::shapes()
+std::pmr::vector<euler::util::Reference<euler::physics::Shape>>
+Body::shapes(std::pmr::memory_resource *resource)
 {
-	std::vector<b2ShapeId> b2_shapes;
+	std::pmr::vector<b2ShapeId> b2_shapes(resource);
 	const auto count = b2Body_GetShapeCount(_id);
 	b2_shapes.resize(static_cast<size_t>(count));
 	b2Body_GetShapes(_id, b2_shapes.data(), count);
-	std::vector<util::Reference<Shape>> shapes;
+	std::pmr::vector<util::Reference<Shape>> shapes(resource);
 	shapes.reserve(static_cast<size_t>(count));
 	for (const auto &b2_shape : b2_shapes) {
 		auto ptr = new Shape(b2_shape);
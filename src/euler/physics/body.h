@@ -3,6 +3,7 @@
 #ifndef EULER_PHYSICS_BODY_H
 #define EULER_PHYSICS_BODY_H
 
+#include <memory_resource>
 #include <vector>
 
 #include <box2d/box2d.h>
@@ -65,7 +66,9 @@ public:
 	bool is_enabled();
 	bool is_sleep_enabled();
 	bool is_valid();
-	std::vector<util::Reference<Joint>> joints();
+	std::pmr::vector<util::Reference<Joint>> joints(
+	    std::pmr::memory_resource *resource
+	    = std::pmr::get_default_resource());
 	float linear_damping();
 	b2Vec2 linear_velocity();
 	b2Vec2 local_center_of_mass();
@@ -92,7 +95,9 @@ public:
 	void set_sleep_threshold(float value);
 	void set_transform(b2Vec2 position, b2Rot rotation);
 	void set_type(b2BodyType type);
-	std::vector<util::Reference<Shape>> shapes();
+	std::pmr::vector<util::Reference<Shape>> shapes(
+	    std::pmr::memory_resource *resource
+	    = std::pmr::get_default_resource());
 	void set_sleep_enabled(bool enabled);
 	float sleep_threshold();
 	void target_transform(b2Transform tform, float step = 1.0,
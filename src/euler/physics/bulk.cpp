@@ -0,0 +1,488 @@
+/* SPDX-License-Identifier: ISC */
+
+#include "euler/physics/bulk.h"
+
+#ifdef EULER_MATH
+
+#include <iterator>
+#include <vector>
+
+#include <mruby/array.h>
+
+#include "euler/physics/body.h"
+#include "euler/physics/world.h"
+
+using euler::math::DenseMatrix;
+using euler::math::Matrix;
+using euler::physics::bulk::Field;
+namespace bulk = euler::physics::bulk;
+
+/* in the order of Field */
+static constexpr struct {
+	const char *name;
+	int width;
+	bool readable;
+	bool writable;
+} FIELDS[] = {
+	{ "position", 2, true, true },
+	{ "rotation", 2, true, true },
+	{ "angle", 1, true, true },
+	{ "linear_velocity", 2, true, true },
+	{ "angular_velocity", 1, true, true },
+	{ "mass", 1, true, false },
+	{ "force", 2, false, true },
+	{ "impulse", 2, false, true },
+};
+
+std::optional<Field>
+bulk::parse_field(const std::string_view name)
+{
+	for (size_t i = 0; i < std::size(FIELDS); ++i)
+		if (name == FIELDS[i].name) return static_cast<Field>(i);
+	return std::nullopt;
+}
+
+int
+bulk::field_width(const Field field)
+{
+	return FIELDS[static_cast<size_t>(field)].width;
+}
+
+bool
+bulk::is_readable(const Field field)
+{
+	return FIELDS[static_cast<size_t>(field)].readable;
+}
+
+bool
+bulk::is_writable(const Field field)
+{
+	return FIELDS[static_cast<size_t>(field)].writable;
+}
+
+template <typename T>
+static b2Vec2
+read_vec(const DenseMatrix<T> &m, const Eigen::Index row,
+    const Eigen::Index column)
+{
+	return { static_cast<float>(m(row, column)),
+		static_cast<float>(m(row, column + 1)) };
+}
+
+template <typename T>
+static void
+write_vec(DenseMatrix<T> &m, const Eigen::Index row, const Eigen::Index column,
+    const b2Vec2 v)
+{
+	m(row, column) = static_cast<T>(v.x);
+	m(row, column + 1) = static_cast<T>(v.y);
+}
+
+template <typename T>
+void
+bulk::gather(const std::span<const b2BodyId> bodies,
+    const std::span<const Field> fields, DenseMatrix<T> &out)
+{
+	/* a field at a time, so that each pass writes down whole columns */
+	const auto count = static_cast<Eigen::Index>(bodies.size());
+	Eigen::Index column = 0;
+	for (const auto field : fields) {
+		for (Eigen::Index i = 0; i < count; ++i) {
+			const auto id = bodies[i];
+			switch (field) {
+			case Field::Position:
+				write_vec(out, i, column,
+				    b2Body_GetPosition(id));
+				break;
+			case Field::Rotation: {
+				const auto q = b2Body_GetRotation(id);
+				write_vec(out, i, column, b2Vec2 { q.c, q.s });
+				break;
+			}
+			case Field::Angle:
+				out(i, column) = static_cast<T>(
+				    b2Rot_GetAngle(b2Body_GetRotation(id)));
+				break;
+			case Field::LinearVelocity:
+				write_vec(out, i, column,
+				    b2Body_GetLinearVelocity(id));
+				break;
+			case Field::AngularVelocity:
+				out(i, column) = static_cast<T>(
+				    b2Body_GetAngularVelocity(id));
+				break;
+			case Field::Mass:
+				out(i, column)
+				    = static_cast<T>(b2Body_GetMass(id));
+				break;
+			case Field::Force:
+			case Field::Impulse: break;
+			}
+		}
+		column += field_width(field);
+	}
+}
+
+template <typename T>
+void
+bulk::scatter(const std::span<const b2BodyId> bodies,
+    const std::span<const Field> fields, const DenseMatrix<T> &in)
+{
+	const auto count = static_cast<Eigen::Index>(bodies.size());
+	for (Eigen::Index i = 0; i < count; ++i) {
+		const auto id = bodies[i];
+		std::optional<b2Vec2> position;
+		std::optional<b2Rot> rotation;
+		Eigen::Index column = 0;
+		for (const auto field : fields) {
+			switch (field) {
+			case Field::Position:
+				position = read_vec(in, i, column);
+				break;
+			case Field::Rotation: {
+				const auto v = read_vec(in, i, column);
+				rotation = v.x == 0.0f && v.y == 0.0f
+				    ? b2Rot_identity
+				    : b2NormalizeRot({ v.x, v.y });
+				break;
+			}
+			case Field::Angle:
+				rotation = b2MakeRot(
+				    static_cast<float>(in(i, column)));
+				break;
+			case Field::LinearVelocity:
+				b2Body_SetLinearVelocity(id,
+				    read_vec(in, i, column));
+				break;
+			case Field::AngularVelocity:
+				b2Body_SetAngularVelocity(id,
+				    static_cast<float>(in(i, column)));
+				break;
+			case Field::Mass: break;
+			case Field::Force:
+				b2Body_ApplyForceToCenter(id,
+				    read_vec(in, i, column), true);
+				break;
+			case Field::Impulse:
+				b2Body_ApplyLinearImpulseToCenter(id,
+				    read_vec(in, i, column), true);
+				break;
+			}
+			column += field_width(field);
+		}
+		if (!position.has_value() && !rotation.has_value()) continue;
+		if (!position.has_value()) position = b2Body_GetPosition(id);
+		if (!rotation.has_value()) rotation = b2Body_GetRotation(id);
+		b2Body_SetTransform(id, *position, *rotation);
+	}
+}
+
+template <typename T>
+size_t
+bulk::contact_points(const b2BodyId body, DenseMatrix<T> &out,
+    std::pmr::memory_resource *resource)
+{
+	std::pmr::vector<b2ContactData> contacts(
+	    static_cast<size_t>(b2Body_GetContactCapacity(body)), resource);
+	const auto count = b2Body_GetContactData(body, contacts.data(),
+	    static_cast<int>(contacts.size()));
+	size_t total = 0;
+	for (int c = 0; c < count; ++c) {
+		const auto &manifold = contacts[c].manifold;
+		for (int p = 0; p < manifold.pointCount; ++p, ++total) {
+			const auto row = static_cast<Eigen::Index>(total);
+			if (row >= out.rows()) continue;
+			const auto &point = manifold.points[p];
+			write_vec(out, row, 0, point.point);
+			write_vec(out, row, 2, manifold.normal);
+			out(row, 4) = static_cast<T>(point.separation);
+			out(row, 5) = static_cast<T>(point.normalImpulse);
+		}
+	}
+	return total;
+}
+
+template <typename T>
+void
+bulk::cast_rays(const b2WorldId world, const DenseMatrix<T> &rays,
+    DenseMatrix<T> &out)
+{
+	const auto filter = b2DefaultQueryFilter();
+	for (Eigen::Index i = 0; i < rays.rows(); ++i) {
+		const auto result = b2World_CastRayClosest(world,
+		    read_vec(rays, i, 0), read_vec(rays, i, 2), filter);
+		if (!result.hit) {
+			out.row(i).setZero();
+			continue;
+		}
+		out(i, 0) = T(1);
+		out(i, 1) = static_cast<T>(result.fraction);
+		write_vec(out, i, 2, result.point);
+		write_vec(out, i, 4, result.normal);
+	}
+}
+
+#define INSTANTIATE(T)                                                         \
+	template void bulk::gather(std::span<const b2BodyId>,                 \
+	    std::span<const Field>, DenseMatrix<T> &);                        \
+	template void bulk::scatter(std::span<const b2BodyId>,                \
+	    std::span<const Field>, const DenseMatrix<T> &);                  \
+	template size_t bulk::contact_points(b2BodyId, DenseMatrix<T> &,      \
+	    std::pmr::memory_resource *);                                     \
+	template void bulk::cast_rays(b2WorldId, const DenseMatrix<T> &,      \
+	    DenseMatrix<T> &);
+INSTANTIATE(float)
+INSTANTIATE(double)
+#undef INSTANTIATE
+
+/* Calls fn with m's storage if m holds floats or doubles; false otherwise. */
+template <typename F>
+static bool
+visit_floating(Matrix &m, const F &fn)
+{
+	switch (m.type()) {
+	case Matrix::Type::Float: fn(m.as<float>()); return true;
+	case Matrix::Type::Double: fn(m.as<double>()); return true;
+	default: return false;
+	}
+}
+
+static void
+read_bodies(mrb_state *mrb, const mrb_value array,
+    std::pmr::vector<b2BodyId> &ids)
+{
+	const auto state = euler::util::State::get(mrb);
+	if (!mrb_array_p(array)) {
+		state->mrb()->raise(state->mrb()->type_error(),
+		    "Expected an Array of bodies");
+	}
+	const auto count = RARRAY_LEN(array);
+	ids.reserve(static_cast<size_t>(count));
+	for (mrb_int i = 0; i < count; ++i) {
+		const auto id
+		    = euler::physics::Body::unwrap(mrb, RARRAY_PTR(array)[i])
+			  ->id();
+		if (!b2Body_IsValid(id)) {
+			state->mrb()->raisef(state->mrb()->argument_error(),
+			    "Body %i is no longer valid", i);
+		}
+		ids.push_back(id);
+	}
+}
+
+/* Reads field names into fields, defaulting to :position, and returns their
+ * total width. */
+static int
+read_fields(mrb_state *mrb, const mrb_value *names, const mrb_int count,
+    const bool writing, std::pmr::vector<Field> &fields)
+{
+	const auto state = euler::util::State::get(mrb);
+	if (count == 0) fields.push_back(Field::Position);
+	for (mrb_int i = 0; i < count; ++i) {
+		if (!mrb_symbol_p(names[i])) {
+			state->mrb()->raise(state->mrb()->type_error(),
+			    "Fields are given as symbols");
+		}
+		const auto name = state->mrb()->sym_name(mrb_symbol(names[i]));
+		const auto field = bulk::parse_field(name);
+		if (!field.has_value()) {
+			state->mrb()->raisef(state->mrb()->argument_error(),
+			    "Unknown body field %s", name);
+		}
+		if (writing ? !bulk::is_writable(*field)
+			    : !bulk::is_readable(*field)) {
+			state->mrb()->raisef(state->mrb()->argument_error(),
+			    writing ? "Body field %s can't be written"
+				    : "Body field %s can't be read",
+			    name);
+		}
+		fields.push_back(*field);
+	}
+	int width = 0;
+	for (const auto field : fields) width += bulk::field_width(field);
+	return width;
+}
+
+/**
+ * @overload Euler::Physics::Body.gather(bodies, out, *fields)
+ *   Copies fields of every body into the rows of a matrix, without making a
+ *   Ruby object per value. Keep out between frames; it is only resized when
+ *   the number of bodies or fields changes.
+ *   @param bodies [Array<Euler::Physics::Body>]
+ *   @param out [Euler::Math::Matrix] A float or double matrix, given one row
+ *     per body and a column per scalar.
+ *   @param fields [Array<Symbol>] Any of :position, :rotation (cos, sin),
+ *     :angle, :linear_velocity, :angular_velocity and :mass, in column
+ *     order; :position if none are given.
+ *   @return [Euler::Math::Matrix] out
+ *   @raise [TypeError] If out has an integer type.
+ */
+static mrb_value
+body_gather(mrb_state *mrb, mrb_value)
+{
+	const auto state = euler::util::State::get(mrb);
+	mrb_value bodies, out_value;
+	const mrb_value *names;
+	mrb_int count;
+	state->mrb()->get_args("oo*", &bodies, &out_value, &names, &count);
+	std::pmr::vector<Field> fields(&state->frame_arena());
+	const auto width = read_fields(mrb, names, count, false, fields);
+	std::pmr::vector<b2BodyId> ids(&state->frame_arena());
+	read_bodies(mrb, bodies, ids);
+	{
+		auto out = state->unwrap<Matrix>(out_value);
+		const auto rows = static_cast<Eigen::Index>(ids.size());
+		if (visit_floating(*out.get(),
+			[&]<typename T>(DenseMatrix<T> &m) {
+				m.resize(rows, width);
+				bulk::gather<T>(ids, fields, m);
+			}))
+			return out_value;
+	}
+	state->mrb()->raise(state->mrb()->type_error(),
+	    "Expected a float or double matrix");
+}
+
+/**
+ * @overload Euler::Physics::Body.scatter(bodies, values, *fields)
+ *   Sets fields of every body from the rows of a matrix, laid out as
+ *   Body.gather lays them out.
+ *   @param bodies [Array<Euler::Physics::Body>]
+ *   @param values [Euler::Math::Matrix] A float or double matrix with one
+ *     row per body and a column per scalar.
+ *   @param fields [Array<Symbol>] Any of :position, :rotation (cos, sin),
+ *     :angle, :linear_velocity, :angular_velocity, :force and :impulse; the
+ *     last two are applied at the center of mass and wake the body.
+ *   @return [Euler::Math::Matrix] values
+ *   @raise [ArgumentError] If values has the wrong shape.
+ *   @raise [TypeError] If values has an integer type.
+ */
+static mrb_value
+body_scatter(mrb_state *mrb, mrb_value)
+{
+	const auto state = euler::util::State::get(mrb);
+	mrb_value bodies, in_value;
+	const mrb_value *names;
+	mrb_int count;
+	state->mrb()->get_args("oo*", &bodies, &in_value, &names, &count);
+	std::pmr::vector<Field> fields(&state->frame_arena());
+	const auto width = read_fields(mrb, names, count, true, fields);
+	std::pmr::vector<b2BodyId> ids(&state->frame_arena());
+	read_bodies(mrb, bodies, ids);
+	auto error_class = state->mrb()->type_error();
+	const char *error = "Expected a float or double matrix";
+	{
+		auto in = state->unwrap<Matrix>(in_value);
+		const auto rows = static_cast<Eigen::Index>(ids.size());
+		if (in->row_count() != rows || in->column_count() != width) {
+			error_class = state->mrb()->argument_error();
+			error = "Matrix shape doesn't match bodies and fields";
+		} else if (visit_floating(*in.get(),
+			       [&]<typename T>(DenseMatrix<T> &m) {
+				       bulk::scatter<T>(ids, fields, m);
+			       })) {
+			return in_value;
+		}
+	}
+	state->mrb()->raise(error_class, error);
+}
+
+/**
+ * @overload Euler::Physics::Body#contact_points(out)
+ *   Fills the rows of out with the body's contact points: point x and y,
+ *   normal x and y, separation and normal impulse. out is never resized.
+ *   @param out [Euler::Math::Matrix] A float or double matrix with six
+ *     columns.
+ *   @return [Integer] The number of contact points, which may be more than
+ *     out has rows for.
+ */
+static mrb_value
+body_contact_points(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	mrb_value out_value;
+	state->mrb()->get_args("o", &out_value);
+	auto error_class = state->mrb()->type_error();
+	const char *error = "Expected a float or double matrix";
+	{
+		const auto body = euler::physics::Body::unwrap(mrb, self);
+		auto out = state->unwrap<Matrix>(out_value);
+		size_t total = 0;
+		if (out->column_count() != bulk::CONTACT_POINT_WIDTH) {
+			error_class = state->mrb()->argument_error();
+			error = "Contact points take six columns";
+		} else if (visit_floating(*out.get(),
+			       [&]<typename T>(DenseMatrix<T> &m) {
+				       auto &arena = state->frame_arena();
+				       total = bulk::contact_points<T>(
+					   body->id(), m, &arena);
+			       })) {
+			return state->mrb()->int_value(
+			    static_cast<mrb_int>(total));
+		}
+	}
+	state->mrb()->raise(error_class, error);
+}
+
+/**
+ * @overload Euler::Physics::World#cast_rays(rays, out)
+ *   Casts a closest-hit ray for every row of rays, with the default filter.
+ *   @param rays [Euler::Math::Matrix] A float or double matrix of origin x
+ *     and y and translation x and y, one ray per row.
+ *   @param out [Euler::Math::Matrix] A float or double matrix, given one row
+ *     per ray of hit (1 or 0), fraction, point x and y and normal x and y.
+ *     It is only resized when the number of rays changes.
+ *   @return [Euler::Math::Matrix] out
+ */
+static mrb_value
+world_cast_rays(mrb_state *mrb, const mrb_value self)
+{
+	const auto state = euler::util::State::get(mrb);
+	mrb_value rays_value, out_value;
+	state->mrb()->get_args("oo", &rays_value, &out_value);
+	auto error_class = state->mrb()->type_error();
+	const char *error = "Expected float or double matrices";
+	{
+		const auto world = state->unwrap<euler::physics::World>(self);
+		const auto rays = state->unwrap<Matrix>(rays_value);
+		auto out = state->unwrap<Matrix>(out_value);
+		const auto floating = rays->type() == Matrix::Type::Float
+		    || rays->type() == Matrix::Type::Double;
+		if (rays->column_count() != 4) {
+			error_class = state->mrb()->argument_error();
+			error = "Rays take four columns";
+		} else if (floating
+		    && visit_floating(*out.get(),
+			[&]<typename T>(DenseMatrix<T> &m) {
+				m.resize(rays->row_count(),
+				    bulk::RAY_RESULT_WIDTH);
+				if (rays->type() == Matrix::type_of<T>()) {
+					bulk::cast_rays<T>(world->id(),
+					    rays->as<T>(), m);
+				} else {
+					bulk::cast_rays<T>(world->id(),
+					    rays->cast<T>(), m);
+				}
+			})) {
+			return out_value;
+		}
+	}
+	state->mrb()->raise(error_class, error);
+}
+
+void
+bulk::init(const util::Reference<util::State> &state)
+{
+	const auto &mrb = state->mrb();
+	const auto &physics = state->modules().physics;
+	mrb->define_class_method(physics.body, "gather", body_gather,
+	    MRB_ARGS_ANY());
+	mrb->define_class_method(physics.body, "scatter", body_scatter,
+	    MRB_ARGS_ANY());
+	mrb->define_method(physics.body, "contact_points", body_contact_points,
+	    MRB_ARGS_REQ(1));
+	mrb->define_method(physics.world, "cast_rays", world_cast_rays,
+	    MRB_ARGS_REQ(2));
+}
+
+#endif /* EULER_MATH */
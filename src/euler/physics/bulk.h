@@ -0,0 +1,86 @@
+/* SPDX-License-Identifier: ISC */
+
+#ifndef EULER_PHYSICS_BULK_H
+#define EULER_PHYSICS_BULK_H
+
+#ifdef EULER_MATH
+
+#include <memory_resource>
+#include <optional>
+#include <span>
+#include <string_view>
+
+#include <box2d/box2d.h>
+
+#include "euler/math/matrix.h"
+#include "euler/util/object.h"
+#include "euler/util/state.h"
+
+namespace euler::physics::bulk {
+
+/* Moves per-body quantities, contact points and ray results between Box2D
+ * and the rows of float or double matrices, one row per item and one column
+ * per scalar, so that numeric code never builds a Ruby object per vector.
+ * Matrices passed in are filled in place, and are only resized when their
+ * shape is wrong, so a matrix kept across frames is never reallocated. */
+
+enum class Field {
+	/* x, y */
+	Position,
+	/* cos, sin */
+	Rotation,
+	/* radians */
+	Angle,
+	/* x, y */
+	LinearVelocity,
+	AngularVelocity,
+	/* read only */
+	Mass,
+	/* write only, applied at the center of mass; x, y */
+	Force,
+	/* write only, applied at the center of mass; x, y */
+	Impulse,
+};
+
+std::optional<Field> parse_field(std::string_view name);
+/* The number of columns field takes. */
+int field_width(Field field);
+bool is_readable(Field field);
+bool is_writable(Field field);
+
+/* Row i of out gets fields, in order, of bodies[i]. out must have one row per
+ * body and the fields' total width in columns. */
+template <typename T>
+void gather(std::span<const b2BodyId> bodies, std::span<const Field> fields,
+    math::DenseMatrix<T> &out);
+/* The reverse of gather; position and rotation from the same row are set
+ * together, forces and impulses wake the body. */
+template <typename T>
+void scatter(std::span<const b2BodyId> bodies, std::span<const Field> fields,
+    const math::DenseMatrix<T> &in);
+
+inline constexpr int CONTACT_POINT_WIDTH = 6;
+/* One row per manifold point of body's touching contacts: point x and y,
+ * normal x and y (from shape A to shape B), separation and normal impulse.
+ * Fills at most out.rows() rows and returns how many points there are. */
+template <typename T>
+size_t contact_points(b2BodyId body, math::DenseMatrix<T> &out,
+    std::pmr::memory_resource *resource);
+
+inline constexpr int RAY_RESULT_WIDTH = 6;
+/* Casts one closest-hit ray per row of rays (origin x and y, translation x
+ * and y). Row i of out gets hit (1 or 0), fraction, point x and y and normal
+ * x and y; misses are all zero. out must have one row per ray. */
+template <typename T>
+void cast_rays(b2WorldId world, const math::DenseMatrix<T> &rays,
+    math::DenseMatrix<T> &out);
+
+/* Defines Body.gather, Body.scatter, Body#contact_points and
+ * World#cast_rays. */
+void init(const util::Reference<util::State> &state);
+
+} /* namespace euler::physics::bulk */
+
+#endif /* EULER_MATH */
+
+#endif /* EULER_PHYSICS_BULK_H */
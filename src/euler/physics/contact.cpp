@@ -95,6 +95,13 @@ Contact::HitEvent::wrap(mrb_state *mrb)
 	return hash;
 }
 
+Contact::Events::Events(std::pmr::memory_resource *resource)
+    : start_events(resource)
+    , end_events(resource)
+    , hit_events(resource)
+{
+}
+
 Contact::Events::~Events() = default;
 Contact::~Contact() { world()->drop_contact(_id); }
 
@@ -196,9 +203,10 @@ Contact::Event::wrap(mrb_state *mrb)
 }
 
 Contact::Events
-Contact::Events::from_b2(const b2ContactEvents &events)
+Contact::Events::from_b2(const b2ContactEvents &events,
+    std::pmr::memory_resource *resource)
 {
-	Events out;
+	Events out(resource);
 	out.start_events.reserve(events.beginCount);
 	for (int i = 0; i < events.beginCount; ++i) {
 		const auto &event = events.beginEvents[i];
@@ -3,6 +3,7 @@
 #ifndef EULER_PHYSICS_CONTACT_H
 #define EULER_PHYSICS_CONTACT_H
 
+#include <memory_resource>
 #include <vector>
 #include <box2d/box2d.h>
 #include <box2d/id.h>
@@ -54,11 +55,15 @@ public:
 	};
 
 	struct Events {
+		explicit Events(std::pmr::memory_resource *resource
+		    = std::pmr::get_default_resource());
 		~Events();
-		std::vector<Event> start_events;
-		std::vector<Event> end_events;
-		std::vector<HitEvent> hit_events;
-		static Events from_b2(const b2ContactEvents &events);
+		std::pmr::vector<Event> start_events;
+		std::pmr::vector<Event> end_events;
+		std::pmr::vector<HitEvent> hit_events;
+		static Events from_b2(const b2ContactEvents &events,
+		    std::pmr::memory_resource *resource
+		    = std::pmr::get_default_resource());
 		mrb_value wrap(mrb_state *mrb);
 	};
 
@@ -5,6 +5,7 @@
 #include <box2d/box2d.h>
 
 #include "euler/physics/body.h"
+#include "euler/physics/bulk.h"
 #include "euler/physics/chain.h"
 #include "euler/physics/contact.h"
 #include "euler/physics/distance_joint.h"
@@ -38,5 +39,8 @@ euler::physics::init(const util::Reference<util::State> &state, RClass *outer)
 	physics.weld_joint = WeldJoint::init(state, mod, joint);
 	physics.wheel_joint = WheelJoint::init(state, mod, joint);
 	physics.world = World::init(state, mod);
+#ifdef EULER_MATH
+	bulk::init(state);
+#endif
 	return mod;
 }
\ No newline at end of file
@@ -327,15 +327,16 @@ Joint::Event::from_b2(const b2JointEvent &event)
 }
 
 Joint::Events
-Joint::Events::from_b2(const b2JointEvents &events)
+Joint::Events::from_b2(const b2JointEvents &events,
+    std::pmr::memory_resource *resource)
 {
-	std::vector<Event> joint_events;
+	std::pmr::vector<Event> joint_events(resource);
 	joint_events.reserve(events.count);
 	for (int i = 0; i < events.count; ++i) {
 		const b2JointEvent &b2_event = events.jointEvents[i];
 		joint_events.push_back(Event::from_b2(b2_event));
 	}
-	return Events { joint_events };
+	return Events { std::move(joint_events) };
 }
 
 mrb_value
@@ -3,6 +3,7 @@
 #ifndef EULER_PHYSICS_JOINT_H
 #define EULER_PHYSICS_JOINT_H
 
+#include <memory_resource>
 #include <vector>
 
 #include <box2d/id.h>
@@ -37,8 +38,10 @@ public:
 	};
 
 	struct Events {
-		std::vector<Event> events;
-		static Events from_b2(const b2JointEvents &events);
+		std::pmr::vector<Event> events;
+		static Events from_b2(const b2JointEvents &events,
+		    std::pmr::memory_resource *resource
+		    = std::pmr::get_default_resource());
 		mrb_value wrap(mrb_state *mrb) const;
 	};
 
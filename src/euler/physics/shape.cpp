@@ -1635,9 +1635,10 @@ box2d_shape_init(mrb_state *mrb, RClass *mod)
 }
 
 Shape::SensorEvents
-Shape::SensorEvents::from_b2(const b2SensorEvents &events)
+Shape::SensorEvents::from_b2(const b2SensorEvents &events,
+    std::pmr::memory_resource *resource)
 {
-	SensorEvents out;
+	SensorEvents out(resource);
 	out.start.reserve(events.beginCount);
 	out.end.reserve(events.endCount);
 	for (int i = 0; i < events.beginCount; ++i) {
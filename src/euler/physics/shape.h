@@ -3,6 +3,7 @@
 #ifndef EULER_PHYSICS_SHAPE_H
 #define EULER_PHYSICS_SHAPE_H
 
+#include <memory_resource>
 #include <variant>
 #include <vector>
 
@@ -56,9 +57,17 @@ public:
 	};
 
 	struct SensorEvents {
-		std::vector<SensorEvent> start;
-		std::vector<SensorEvent> end;
-		static SensorEvents from_b2(const b2SensorEvents &events);
+		explicit SensorEvents(std::pmr::memory_resource *resource
+		    = std::pmr::get_default_resource())
+		    : start(resource)
+		    , end(resource)
+		{
+		}
+		std::pmr::vector<SensorEvent> start;
+		std::pmr::vector<SensorEvent> end;
+		static SensorEvents from_b2(const b2SensorEvents &events,
+		    std::pmr::memory_resource *resource
+		    = std::pmr::get_default_resource());
 		mrb_value wrap(mrb_state *mrb);
 	};
 
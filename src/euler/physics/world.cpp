@@ -11,6 +11,7 @@
 
 #include "euler/physics/shape.h"
 #include "euler/physics/util.h"
+#include "euler/util/profiler.h"
 
 using euler::physics::World;
 
@@ -194,7 +195,7 @@ world_body_events(mrb_state *mrb, const mrb_value self)
 {
 	const auto state = euler::util::State::get(mrb);
 	const auto world = state->unwrap<World>(self);
-	auto events = world->body_events();
+	auto events = world->body_events(&state->frame_arena());
 	const mrb_value ary = state->mrb()->ary_new_capa(events.size());
 	for (auto &event : events) state->mrb()->ary_push(ary, event.wrap(mrb));
 	return ary;
@@ -210,7 +211,7 @@ world_sensor_events(mrb_state *mrb, const mrb_value self)
 {
 	const auto state = euler::util::State::get(mrb);
 	const auto world = state->unwrap<World>(self);
-	return world->sensor_events().wrap(mrb);
+	return world->sensor_events(&state->frame_arena()).wrap(mrb);
 }
 
 // static mrb_value
@@ -231,7 +232,7 @@ world_contact_events(mrb_state *mrb, const mrb_value self)
 {
 	const auto state = euler::util::State::get(mrb);
 	const auto world = state->unwrap<World>(self);
-	return world->contact_events().wrap(mrb);
+	return world->contact_events(&state->frame_arena()).wrap(mrb);
 }
 
 static mrb_value
@@ -239,7 +240,7 @@ world_joint_events(mrb_state *mrb, const mrb_value self)
 {
 	const auto state = euler::util::State::get(mrb);
 	const auto world = state->unwrap<World>(self);
-	return world->joint_events().wrap(mrb);
+	return world->joint_events(&state->frame_arena()).wrap(mrb);
 }
 
 /* TODO: arg cleanup */
@@ -1234,12 +1235,13 @@ World::is_valid() const
 void
 World::step(float dt, int substep_count)
 {
+	util::Profiler::Zone zone("physics.step");
 	b2World_Step(_id, dt, substep_count);
 }
-std::vector<euler::physics::Body::MoveEvent>
-World::body_events() const
+std::pmr::vector<euler::physics::Body::MoveEvent>
+World::body_events(std::pmr::memory_resource *resource) const
 {
-	std::vector<Body::MoveEvent> events;
+	std::pmr::vector<Body::MoveEvent> events(resource);
 	b2BodyEvents b2_events = b2World_GetBodyEvents(_id);
 	events.reserve(b2_events.moveCount);
 	for (int i = 0; i < b2_events.moveCount; ++i) {
@@ -1250,22 +1252,22 @@ World::body_events() const
 	return events;
 }
 euler::physics::Shape::SensorEvents
-World::sensor_events() const
+World::sensor_events(std::pmr::memory_resource *resource) const
 {
 	const auto events = b2World_GetSensorEvents(_id);
-	return Shape::SensorEvents::from_b2(events);
+	return Shape::SensorEvents::from_b2(events, resource);
 }
 euler::physics::Contact::Events
-World::contact_events() const
+World::contact_events(std::pmr::memory_resource *resource) const
 {
 	const auto events = b2World_GetContactEvents(_id);
-	return Contact::Events::from_b2(events);
+	return Contact::Events::from_b2(events, resource);
 }
 euler::physics::Joint::Events
-World::joint_events() const
+World::joint_events(std::pmr::memory_resource *resource) const
 {
 	const auto events = b2World_GetJointEvents(_id);
-	return Joint::Events::from_b2(events);
+	return Joint::Events::from_b2(events, resource);
 }
 b2TreeStats
 World::overlap_aabb(const b2AABB &aabb, const b2QueryFilter filter,
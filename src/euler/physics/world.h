@@ -4,6 +4,7 @@
 #define EULER_PHYSICS_WORLD_H
 
 #include <functional>
+#include <memory_resource>
 #include <vector>
 #include <box2d/box2d.h>
 #include <box2d/id.h>
@@ -80,12 +81,19 @@ public:
 
 	void step(float dt, int substep_count = 4);
 
-	[[nodiscard]] std::vector<Body::MoveEvent> body_events() const;
+	/* Event lists are built in resource, normally the state's frame
+	 * arena, since they are only needed until they reach Ruby. */
+	[[nodiscard]] std::pmr::vector<Body::MoveEvent> body_events(
+	    std::pmr::memory_resource *resource
+	    = std::pmr::get_default_resource()) const;
 
-	Shape::SensorEvents sensor_events() const;
+	Shape::SensorEvents sensor_events(std::pmr::memory_resource *resource
+	    = std::pmr::get_default_resource()) const;
 
-	Contact::Events contact_events() const;
-	Joint::Events joint_events() const;
+	Contact::Events contact_events(std::pmr::memory_resource *resource
+	    = std::pmr::get_default_resource()) const;
+	Joint::Events joint_events(std::pmr::memory_resource *resource
+	    = std::pmr::get_default_resource()) const;
 
 	b2TreeStats overlap_aabb(const b2AABB &aabb, const b2QueryFilter filter,
 	    OverlapFn callback) const;
@@ -0,0 +1,193 @@
+/* SPDX-License-Identifier: ISC */
+
+#include "euler/util/binary_log.h"
+
+#include <cerrno>
+#include <chrono>
+#include <stdexcept>
+
+using euler::util::BinaryLog;
+
+static uint64_t
+steady_now()
+{
+	const auto time = std::chrono::steady_clock::now().time_since_epoch();
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(time)
+	    .count();
+}
+
+static uint64_t
+system_now()
+{
+	const auto time = std::chrono::system_clock::now().time_since_epoch();
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(time)
+	    .count();
+}
+
+void
+BinaryLog::put_string(std::vector<std::byte> &bytes, const std::string_view str)
+{
+	put(bytes, static_cast<uint16_t>(str.size()));
+	const auto data = reinterpret_cast<const std::byte *>(str.data());
+	bytes.insert(bytes.end(), data, data + str.size());
+}
+
+BinaryLog::BinaryLog(const std::filesystem::path &path)
+    : _serial(_next_serial.fetch_add(1, std::memory_order_relaxed))
+    , _file(std::fopen(path.string().c_str(), "wb"))
+{
+	if (_file == nullptr) {
+		throw std::runtime_error("Failed to open log file: "
+		    + path.string() + ": " + std::strerror(errno));
+	}
+	std::vector<std::byte> header;
+	const auto magic = reinterpret_cast<const std::byte *>(MAGIC.data());
+	header.insert(header.end(), magic, magic + MAGIC.size());
+	put(header, VERSION);
+	put(header, steady_now());
+	put(header, system_now());
+	std::fwrite(header.data(), 1, header.size(), _file);
+	/* records from loggers without a subsystem */
+	_subsystems.emplace_back();
+}
+
+BinaryLog::~BinaryLog()
+{
+	flush();
+	std::fclose(_file);
+}
+
+BinaryLog::ThreadCache &
+BinaryLog::thread_cache(const uint64_t serial)
+{
+	/* by log serial, so a thread switching between logs keeps one buffer
+	 * in each. Serials are never reused, so the entry of a destroyed log
+	 * is never looked up again. */
+	thread_local std::unordered_map<uint64_t, ThreadCache> caches;
+	thread_local uint64_t last_serial = 0;
+	thread_local ThreadCache *last = nullptr;
+	if (serial != last_serial) {
+		last = &caches[serial];
+		last_serial = serial;
+	}
+	return *last;
+}
+
+uint16_t
+BinaryLog::subsystem(const std::string_view name)
+{
+	std::scoped_lock lock(_sites_mutex);
+	for (size_t i = 0; i < _subsystems.size(); ++i)
+		if (_subsystems[i] == name) return static_cast<uint16_t>(i);
+	/* out of ids; shows up without a subsystem */
+	if (_subsystems.size() > UINT16_MAX) return 0;
+	_subsystems.emplace_back(name);
+	return static_cast<uint16_t>(_subsystems.size() - 1);
+}
+
+uint32_t
+BinaryLog::register_site(const SiteKey &key, const std::string_view format,
+    const std::span<const Arg> signature)
+{
+	std::scoped_lock lock(_sites_mutex);
+	const auto [it, inserted] = _site_ids.try_emplace(key,
+	    static_cast<uint32_t>(_sites.size()));
+	if (inserted) {
+		_sites.push_back({
+		    std::string(format.substr(0, UINT16_MAX)),
+		    { signature.begin(), signature.end() },
+		});
+	}
+	return it->second;
+}
+
+BinaryLog::ThreadBuffer &
+BinaryLog::begin_record(const std::string_view format,
+    const void *signature_key, const std::span<const Arg> signature,
+    const uint8_t severity, const uint16_t subsystem)
+{
+	auto &cache = thread_cache(_serial);
+	if (cache.buffer == nullptr) {
+		/* first record from this thread */
+		std::scoped_lock lock(_threads_mutex);
+		auto &owned = _threads.emplace_back(
+		    std::make_unique<ThreadBuffer>());
+		owned->id = static_cast<uint32_t>(_threads.size() - 1);
+		owned->bytes.reserve(BLOCK_SIZE);
+		cache.buffer = owned.get();
+	}
+	const SiteKey key { format.data(), signature_key };
+	auto site = cache.sites.find(key);
+	if (site == cache.sites.end()) {
+		site = cache.sites
+			   .emplace(key, register_site(key, format, signature))
+			   .first;
+	}
+	auto &buffer = *cache.buffer;
+	buffer.mutex.lock();
+	put(buffer.bytes, site->second);
+	put(buffer.bytes, subsystem);
+	put(buffer.bytes, severity);
+	put(buffer.bytes, steady_now());
+	return buffer;
+}
+
+void
+BinaryLog::end_record(ThreadBuffer &buffer)
+{
+	if (buffer.bytes.size() >= BLOCK_SIZE) write_block(buffer);
+	buffer.mutex.unlock();
+}
+
+void
+BinaryLog::write_definitions()
+{
+	std::vector<std::byte> bytes;
+	{
+		std::scoped_lock lock(_sites_mutex);
+		for (; _written_sites < _sites.size(); ++_written_sites) {
+			const auto &site = _sites[_written_sites];
+			put(bytes, Chunk::Site);
+			put(bytes, static_cast<uint32_t>(_written_sites));
+			put_string(bytes, site.format);
+			put(bytes, static_cast<uint8_t>(site.signature.size()));
+			for (const auto arg : site.signature) put(bytes, arg);
+		}
+		for (; _written_subsystems < _subsystems.size();
+		    ++_written_subsystems) {
+			put(bytes, Chunk::Subsystem);
+			put(bytes, static_cast<uint16_t>(_written_subsystems));
+			put_string(bytes, _subsystems[_written_subsystems]);
+		}
+	}
+	std::fwrite(bytes.data(), 1, bytes.size(), _file);
+}
+
+void
+BinaryLog::write_block(ThreadBuffer &buffer)
+{
+	if (buffer.bytes.empty()) return;
+	std::scoped_lock lock(_file_mutex);
+	/* the records can only name sites registered before now */
+	write_definitions();
+	std::vector<std::byte> header;
+	put(header, Chunk::Records);
+	put(header, buffer.id);
+	put(header, static_cast<uint32_t>(buffer.bytes.size()));
+	std::fwrite(header.data(), 1, header.size(), _file);
+	std::fwrite(buffer.bytes.data(), 1, buffer.bytes.size(), _file);
+	buffer.bytes.clear();
+}
+
+void
+BinaryLog::flush()
+{
+	std::scoped_lock lock(_threads_mutex);
+	for (const auto &buffer : _threads) {
+		std::scoped_lock buffer_lock(buffer->mutex);
+		write_block(*buffer);
+	}
+	std::scoped_lock file_lock(_file_mutex);
+	write_definitions();
+	std::fflush(_file);
+}
@@ -0,0 +1,248 @@
+/* SPDX-License-Identifier: ISC */
+
+#ifndef EULER_UTIL_BINARY_LOG_H
+#define EULER_UTIL_BINARY_LOG_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+namespace euler::util {
+
+/* Log file that defers formatting. Each call site's format string is written
+ * once, the first time it is used; after that a record is just the site id,
+ * a timestamp and the raw argument bytes, appended to a buffer owned by the
+ * logging thread. Nothing is formatted until log_decode reads the file back.
+ *
+ * A call site is identified by the address of its format string together
+ * with its argument types, so format strings must be literals. Arguments
+ * that can't be stored as bytes make the record fall back to formatting on
+ * the spot. Files are in host byte order.
+ *
+ * File layout: MAGIC, VERSION (u32), then the steady and system clocks in
+ * nanoseconds (u64 each) sampled together, then chunks. Every chunk starts
+ * with its Chunk byte:
+ *   Site:      id (u32), format length (u16), format, argument count (u8),
+ *              one Arg byte per argument
+ *   Subsystem: id (u16), name length (u16), name
+ *   Records:   thread (u32), byte length (u32), records
+ * and each record is site (u32), subsystem (u16), severity (u8), steady
+ * clock (u64), then the arguments: bool and char as u8, integers as i64 or
+ * u64, floats as f32, other floating types as f64, pointers as u64 and
+ * strings as a u32 length followed by the bytes. Version 1 files predate
+ * Float32. */
+class BinaryLog {
+public:
+	static constexpr std::array<char, 8> MAGIC
+	    = { 'E', 'U', 'L', 'E', 'R', 'L', 'O', 'G' };
+	static constexpr uint32_t VERSION = 2;
+	/* a thread's records are written out once they reach this size */
+	static constexpr size_t BLOCK_SIZE = 64 * 1024;
+
+	enum class Chunk : uint8_t {
+		Site = 1,
+		Subsystem = 2,
+		Records = 3,
+	};
+
+	enum class Arg : uint8_t {
+		Bool,
+		Char,
+		Int,
+		Uint,
+		Float,
+		Pointer,
+		String,
+		/* kept apart from Float so it formats as a float would */
+		Float32,
+		/* not storable; never written */
+		None = 0xff,
+	};
+
+	/* what a logger in binary mode hands to Logger::log */
+	struct Channel {
+		BinaryLog *log = nullptr;
+		uint16_t subsystem = 0;
+	};
+
+	template <typename T>
+	static consteval Arg
+	arg_type()
+	{
+		using U = std::remove_cvref_t<T>;
+		if constexpr (std::is_same_v<U, bool>) return Arg::Bool;
+		else if constexpr (std::is_same_v<U, char>) return Arg::Char;
+		else if constexpr (std::is_integral_v<U>
+		    && std::is_signed_v<U>)
+			return Arg::Int;
+		else if constexpr (std::is_integral_v<U>) return Arg::Uint;
+		else if constexpr (std::is_same_v<U, float>)
+			return Arg::Float32;
+		else if constexpr (std::is_floating_point_v<U>)
+			return Arg::Float;
+		else if constexpr (std::is_convertible_v<const U &,
+				       std::string_view>)
+			return Arg::String;
+		else if constexpr (std::is_pointer_v<U>
+		    || std::is_null_pointer_v<U>)
+			return Arg::Pointer;
+		else return Arg::None;
+	}
+
+	/* Throws std::runtime_error if the file can't be created. */
+	explicit BinaryLog(const std::filesystem::path &path);
+	/* Writes out every thread's buffer. */
+	~BinaryLog();
+	BinaryLog(const BinaryLog &) = delete;
+	BinaryLog &operator=(const BinaryLog &) = delete;
+
+	/* Returns the id records use for a subsystem name. */
+	uint16_t subsystem(std::string_view name);
+	/* Writes out every thread's buffer and flushes the file. */
+	void flush();
+
+	template <typename... Args>
+	void
+	record(const uint8_t severity, const uint16_t subsystem,
+	    const std::format_string<Args...> &format, Args &&...args)
+	{
+		if constexpr (((arg_type<Args>() != Arg::None) && ...)) {
+			const auto &signature
+			    = SIGNATURE<std::remove_cvref_t<Args>...>;
+			auto &buffer = begin_record(format.get(), &signature,
+			    signature, severity, subsystem);
+			(encode(buffer.bytes, args), ...);
+			end_record(buffer);
+		} else {
+			const auto text
+			    = std::format(format, std::forward<Args>(args)...);
+			record(severity, subsystem, "{}", text);
+		}
+	}
+
+private:
+	struct ThreadBuffer {
+		std::mutex mutex;
+		std::vector<std::byte> bytes;
+		uint32_t id = 0;
+	};
+
+	struct SiteKey {
+		const char *format;
+		const void *signature;
+
+		bool operator==(const SiteKey &) const = default;
+	};
+
+	struct SiteKeyHash {
+		size_t
+		operator()(const SiteKey &key) const
+		{
+			const auto a = reinterpret_cast<uintptr_t>(key.format);
+			const auto b
+			    = reinterpret_cast<uintptr_t>(key.signature);
+			return std::hash<uintptr_t>()(
+			    a ^ (b * 0x9e3779b97f4a7c15));
+		}
+	};
+
+	using SiteMap = std::unordered_map<SiteKey, uint32_t, SiteKeyHash>;
+
+	/* a thread's view of one log */
+	struct ThreadCache {
+		ThreadBuffer *buffer = nullptr;
+		SiteMap sites;
+	};
+
+	struct Site {
+		std::string format;
+		std::vector<Arg> signature;
+	};
+
+	template <typename... Args>
+	static constexpr std::array<Arg, sizeof...(Args)> SIGNATURE
+	    = { arg_type<Args>()... };
+
+	template <typename T>
+	static void
+	put(std::vector<std::byte> &bytes, const T value)
+	{
+		const size_t size = bytes.size();
+		bytes.resize(size + sizeof(T));
+		std::memcpy(bytes.data() + size, &value, sizeof(T));
+	}
+	static void put_string(std::vector<std::byte> &bytes,
+	    std::string_view str);
+
+	template <typename T>
+	static void
+	encode(std::vector<std::byte> &bytes, const T &value)
+	{
+		constexpr auto type = arg_type<T>();
+		if constexpr (type == Arg::Bool || type == Arg::Char) {
+			put(bytes, static_cast<uint8_t>(value));
+		} else if constexpr (type == Arg::Int) {
+			put(bytes, static_cast<int64_t>(value));
+		} else if constexpr (type == Arg::Uint) {
+			put(bytes, static_cast<uint64_t>(value));
+		} else if constexpr (type == Arg::Float32) {
+			put(bytes, value);
+		} else if constexpr (type == Arg::Float) {
+			put(bytes, static_cast<double>(value));
+		} else if constexpr (type == Arg::Pointer) {
+			put(bytes, static_cast<uint64_t>(
+			    reinterpret_cast<uintptr_t>(value)));
+		} else {
+			const std::string_view str(value);
+			put(bytes, static_cast<uint32_t>(str.size()));
+			const auto data
+			    = reinterpret_cast<const std::byte *>(str.data());
+			bytes.insert(bytes.end(), data, data + str.size());
+		}
+	}
+
+	static ThreadCache &thread_cache(uint64_t serial);
+	/* Returns the calling thread's buffer, locked, with the record header
+	 * already written. */
+	ThreadBuffer &begin_record(std::string_view format,
+	    const void *signature_key, std::span<const Arg> signature,
+	    uint8_t severity, uint16_t subsystem);
+	void end_record(ThreadBuffer &buffer);
+	uint32_t register_site(const SiteKey &key, std::string_view format,
+	    std::span<const Arg> signature);
+	/* needs the buffer locked */
+	void write_block(ThreadBuffer &buffer);
+	/* needs _file_mutex held */
+	void write_definitions();
+
+	static inline std::atomic<uint64_t> _next_serial = 1;
+
+	uint64_t _serial;
+	FILE *_file;
+	std::mutex _file_mutex;
+	std::mutex _threads_mutex;
+	std::vector<std::unique_ptr<ThreadBuffer>> _threads;
+	std::mutex _sites_mutex;
+	SiteMap _site_ids;
+	std::vector<Site> _sites;
+	std::vector<std::string> _subsystems;
+	/* sites and subsystems already in the file; under _file_mutex */
+	size_t _written_sites = 0;
+	size_t _written_subsystems = 0;
+};
+
+} /* namespace euler::util */
+
+#endif /* EULER_UTIL_BINARY_LOG_H */
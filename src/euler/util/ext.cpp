@@ -3,7 +3,11 @@
 #include "euler/util/ext.h"
 
 #include "euler/util/color.h"
+#include "euler/util/image.h"
+#include "euler/util/image_loader.h"
+#include "euler/util/jobs.h"
 #include "euler/util/logger.h"
+#include "euler/util/profiler.h"
 #include "euler/util/version.h"
 
 RClass *
@@ -14,6 +18,11 @@ euler::util::init(const Reference<State> &state, RClass *, RClass *)
 	util.logger = Logger::init(state, mod);
 	util.version = Version::init(state, mod);
 	util.color = Color::init(state, mod);
+	util.image = Image::init(state, mod);
+	util.pending_image = PendingImage::init(state, mod);
+	util.jobs = Jobs::init(state, mod);
+	util.job = Job::init(state, mod);
+	util.profiler = Profiler::init(state, mod);
 	return mod;
 }
 
@@ -2,3 +2,47 @@
 
 #include "euler/util/font.h"
 
+using euler::util::BitmapFont;
+
+BitmapFont::BitmapFont(std::string path, const Layout &layout)
+    : _path(std::move(path))
+    , _layout(layout)
+{
+	const auto cw = static_cast<float>(layout.cell_width);
+	const auto ch = static_cast<float>(layout.cell_height);
+	const int columns = layout.columns > 0 ? layout.columns : 1;
+	_glyphs.reserve(layout.count);
+	for (char32_t i = 0; i < layout.count; ++i) {
+		const auto index = static_cast<int>(i);
+		_glyphs.push_back(Glyph {
+		    .x = static_cast<float>(index % columns) * cw,
+		    .y = static_cast<float>(index / columns) * ch,
+		    .w = cw,
+		    .h = ch,
+		    .advance = cw,
+		});
+	}
+}
+
+std::string
+BitmapFont::path() const
+{
+	return _path;
+}
+
+const BitmapFont::Glyph *
+BitmapFont::glyph(const char32_t codepoint) const
+{
+	if (codepoint >= _layout.first
+	    && codepoint - _layout.first < _glyphs.size())
+		return &_glyphs[codepoint - _layout.first];
+	if (_layout.fallback == 0 || codepoint == _layout.fallback)
+		return nullptr;
+	return glyph(_layout.fallback);
+}
+
+float
+BitmapFont::line_height() const
+{
+	return static_cast<float>(_layout.cell_height);
+}
@@ -3,16 +3,59 @@
 #ifndef EULER_UTIL_FONT_H
 #define EULER_UTIL_FONT_H
 
+#include <string>
+#include <vector>
+
 #include "euler/util/object.h"
 
 namespace euler::util {
 class Font : public util::Object {
 public:
+	/* Where a glyph sits on the font's sheet, in sheet pixels, and how far
+	 * the pen moves after drawing it. */
+	struct Glyph {
+		float x = 0.0f;
+		float y = 0.0f;
+		float w = 0.0f;
+		float h = 0.0f;
+		float advance = 0.0f;
+	};
+
 	virtual std::string path() const = 0;
+	/* null if the font has no glyph for codepoint */
+	virtual const Glyph *glyph(char32_t codepoint) const = 0;
+	/* distance between baselines at the font's native size */
+	virtual float line_height() const = 0;
+};
+
+/* Font drawn from a sheet of equally sized cells laid out in rows, with
+ * codepoint first in the top left cell. The glyph table is built once up
+ * front, so lookups are an index. */
+class BitmapFont final : public Font {
+public:
+	struct Layout {
+		int cell_width = 8;
+		int cell_height = 16;
+		int columns = 16;
+		char32_t first = 0;
+		char32_t count = 128;
+		/* drawn for codepoints outside the sheet; 0 draws nothing */
+		char32_t fallback = '?';
+	};
+
+	BitmapFont(std::string path, const Layout &layout);
+	~BitmapFont() override = default;
 
+	std::string path() const override;
+	const Glyph *glyph(char32_t codepoint) const override;
+	float line_height() const override;
+
+private:
+	std::string _path;
+	std::vector<Glyph> _glyphs;
+	Layout _layout;
 };
 } /* namespace euler::util */
 
 
 #endif /* EULER_UTIL_FONT_H */
-
@@ -0,0 +1,84 @@
+/* SPDX-License-Identifier: ISC */
+
+#include "euler/util/frame_arena.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+using euler::util::FrameArena;
+
+FrameArena::FrameArena(const size_t initial_capacity)
+{
+	add_block(std::max<size_t>(initial_capacity, 1024));
+	/* the first block is not something a frame asked for */
+	_stats.heap_allocations = 0;
+}
+
+FrameArena::~FrameArena()
+{
+	for (const auto &block : _blocks) std::free(block.data);
+}
+
+void
+FrameArena::add_block(const size_t size)
+{
+	const auto data = static_cast<std::byte *>(std::malloc(size));
+	if (data == nullptr) throw std::bad_alloc();
+	_blocks.push_back({ data, size });
+	_cursor = data;
+	_end = data + size;
+	_last = nullptr;
+	_stats.capacity += size;
+	++_stats.heap_allocations;
+}
+
+void *
+FrameArena::do_allocate(const size_t bytes, const size_t alignment)
+{
+	auto address = reinterpret_cast<uintptr_t>(_cursor);
+	address = (address + alignment - 1) & ~(alignment - 1);
+	auto ptr = reinterpret_cast<std::byte *>(address);
+	if (ptr + bytes > _end) {
+		/* double each time, so even a huge frame needs few blocks */
+		add_block(std::max(_blocks.back().size * 2,
+		    bytes + alignment));
+		address = reinterpret_cast<uintptr_t>(_cursor);
+		address = (address + alignment - 1) & ~(alignment - 1);
+		ptr = reinterpret_cast<std::byte *>(address);
+	}
+	_last = _cursor;
+	_cursor = ptr + bytes;
+	++_stats.allocations;
+	_stats.bytes += bytes;
+	return ptr;
+}
+
+void
+FrameArena::do_deallocate(void *ptr, const size_t bytes, size_t)
+{
+	/* only the newest allocation can be handed back */
+	if (_last == nullptr) return;
+	if (static_cast<std::byte *>(ptr) + bytes != _cursor) return;
+	_cursor = _last;
+	_last = nullptr;
+}
+
+void
+FrameArena::reset()
+{
+	_last_frame = _stats;
+	if (_blocks.size() > 1) {
+		const size_t capacity = _stats.capacity;
+		for (const auto &block : _blocks) std::free(block.data);
+		_blocks.clear();
+		_stats.capacity = 0;
+		add_block(capacity);
+	}
+	_cursor = _blocks.back().data;
+	_end = _cursor + _blocks.back().size;
+	_last = nullptr;
+	_stats = Stats {};
+	_stats.capacity = _blocks.back().size;
+}
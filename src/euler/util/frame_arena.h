@@ -0,0 +1,81 @@
+/* SPDX-License-Identifier: ISC */
+
+#ifndef EULER_UTIL_FRAME_ARENA_H
+#define EULER_UTIL_FRAME_ARENA_H
+
+#include <cstddef>
+#include <memory_resource>
+#include <vector>
+
+namespace euler::util {
+
+/* Linear allocator for data that only lives until the end of the frame,
+ * usable through std::pmr containers. Deallocation is a no-op apart from
+ * giving back the most recent allocation, so a growing vector does not leak
+ * its old storage; everything else is reclaimed at once by reset().
+ *
+ * When a frame outgrows the arena another block is taken from the heap, and
+ * on reset the blocks are merged into one large enough for that frame, so a
+ * steady workload stops touching the heap after its first few frames.
+ * Main thread only. */
+class FrameArena final : public std::pmr::memory_resource {
+public:
+	struct Stats {
+		size_t allocations = 0;
+		size_t bytes = 0;
+		/* blocks the arena itself had to take from the heap */
+		size_t heap_allocations = 0;
+		size_t capacity = 0;
+	};
+
+	explicit FrameArena(size_t initial_capacity = 64 * 1024);
+	~FrameArena() override;
+	FrameArena(const FrameArena &) = delete;
+	FrameArena &operator=(const FrameArena &) = delete;
+
+	/* Ends the frame. Anything allocated from the arena is invalid once
+	 * this returns. */
+	void reset();
+
+	/* the frame in progress */
+	[[nodiscard]] const Stats &
+	stats() const
+	{
+		return _stats;
+	}
+	/* the frame before the last reset */
+	[[nodiscard]] const Stats &
+	last_frame() const
+	{
+		return _last_frame;
+	}
+
+protected:
+	void *do_allocate(size_t bytes, size_t alignment) override;
+	void do_deallocate(void *ptr, size_t bytes, size_t alignment) override;
+	[[nodiscard]] bool
+	do_is_equal(const memory_resource &other) const noexcept override
+	{
+		return this == &other;
+	}
+
+private:
+	struct Block {
+		std::byte *data;
+		size_t size;
+	};
+
+	void add_block(size_t size);
+
+	std::vector<Block> _blocks;
+	std::byte *_cursor = nullptr;
+	std::byte *_end = nullptr;
+	/* start of the latest allocation, for do_deallocate */
+	std::byte *_last = nullptr;
+	Stats _stats;
+	Stats _last_frame;
+};
+
+} /* namespace euler::util */
+
+#endif /* EULER_UTIL_FRAME_ARENA_H */
@@ -1,3 +1,305 @@
 /* SPDX-License-Identifier: ISC */
 
 #include "euler/util/image.h"
+
+#include <algorithm>
+#include <atomic>
+#include <format>
+#include <limits>
+#include <vector>
+
+#include "euler/util/image_loader.h"
+#include "euler/util/pixel.h"
+
+using euler::util::Image;
+
+namespace {
+struct Span {
+	int x0;
+	int y0;
+	int x1;
+	int y1;
+	[[nodiscard]] bool
+	empty() const
+	{
+		return x0 >= x1 || y0 >= y1;
+	}
+};
+} /* namespace */
+
+static Span
+clip(const Image &image, const int x, const int y, const int w, const int h)
+{
+	const auto [iw, ih] = image.dimensions();
+	return Span {
+		.x0 = std::clamp(x, 0, static_cast<int>(iw)),
+		.y0 = std::clamp(y, 0, static_cast<int>(ih)),
+		.x1 = std::clamp(x + w, 0, static_cast<int>(iw)),
+		.y1 = std::clamp(y + h, 0, static_cast<int>(ih)),
+	};
+}
+
+void
+Image::fill_rect(const int16_t x, const int16_t y, const int16_t w,
+    const int16_t h, const Color color)
+{
+	uint32_t *data = raw_data();
+	if (data == nullptr) return;
+	const auto span = clip(*this, x, y, w, h);
+	if (span.empty()) return;
+	const int stride = dimensions().first;
+	const uint32_t value = pixel::pack(color);
+	for (int row = span.y0; row < span.y1; ++row) {
+		pixel::fill(data + row * stride + span.x0, span.x1 - span.x0,
+		    value);
+	}
+}
+
+void
+Image::blend_rect(const int16_t x, const int16_t y, const int16_t w,
+    const int16_t h, const Color color)
+{
+	if (color.alpha() == 0xFF) {
+		fill_rect(x, y, w, h, color);
+		return;
+	}
+	uint32_t *data = raw_data();
+	if (data == nullptr || color.alpha() == 0) return;
+	const auto span = clip(*this, x, y, w, h);
+	if (span.empty()) return;
+	const int stride = dimensions().first;
+	/* one row of the source colour, reused for every destination row */
+	thread_local std::vector<uint32_t> row_buffer;
+	row_buffer.assign(span.x1 - span.x0, pixel::pack(color));
+	for (int row = span.y0; row < span.y1; ++row) {
+		pixel::blend_straight(data + row * stride + span.x0,
+		    row_buffer.data(), row_buffer.size());
+	}
+}
+
+void
+Image::blit(const Image &src, const int16_t x, const int16_t y,
+    const BlendMode mode)
+{
+	uint32_t *data = raw_data();
+	const uint32_t *src_data = src.raw_data();
+	if (data == nullptr || src_data == nullptr) return;
+	const auto [sw, sh] = src.dimensions();
+	const auto span = clip(*this, x, y, sw, sh);
+	if (span.empty()) return;
+	const int stride = dimensions().first;
+	const size_t count = span.x1 - span.x0;
+	for (int row = span.y0; row < span.y1; ++row) {
+		uint32_t *dst = data + row * stride + span.x0;
+		const uint32_t *from
+		    = src_data + (row - y) * sw + (span.x0 - x);
+		switch (mode) {
+		case BlendMode::Copy:
+			std::copy_n(from, count, dst);
+			break;
+		case BlendMode::Alpha:
+			pixel::blend_straight(dst, from, count);
+			break;
+		case BlendMode::Premultiplied:
+			pixel::blend(dst, from, count);
+			break;
+		}
+	}
+}
+
+void
+Image::premultiply()
+{
+	uint32_t *data = raw_data();
+	if (data == nullptr) return;
+	const auto [w, h] = dimensions();
+	pixel::premultiply(data, static_cast<size_t>(w) * h);
+}
+
+void
+Image::unpremultiply()
+{
+	uint32_t *data = raw_data();
+	if (data == nullptr) return;
+	const auto [w, h] = dimensions();
+	pixel::unpremultiply(data, static_cast<size_t>(w) * h);
+}
+
+void
+Image::swizzle()
+{
+	uint32_t *data = raw_data();
+	if (data == nullptr) return;
+	const auto [w, h] = dimensions();
+	pixel::swizzle(data, data, static_cast<size_t>(w) * h);
+}
+
+/* Image dimensions and coordinates are 16-bit; anything wider would wrap
+ * around rather than clip. */
+static int16_t
+read_coordinate(mrb_state *mrb, const mrb_int value)
+{
+	if (value >= std::numeric_limits<int16_t>::min()
+	    && value <= std::numeric_limits<int16_t>::max())
+		return static_cast<int16_t>(value);
+	const auto state = euler::util::State::get(mrb);
+	state->mrb()->raise(state->mrb()->range_error(),
+	    "Image coordinates must fit in 16 bits");
+}
+
+/* Image.new(width, height, label = nil) creates a blank, transparent image
+ * with CPU-side pixels. The label names the upload and is generated when
+ * omitted. */
+static mrb_value
+image_initialize(mrb_state *mrb, const mrb_value self)
+{
+	using namespace euler::util;
+	static std::atomic<uint64_t> serial = 0;
+	const auto state = State::get(mrb);
+	mrb_int width, height;
+	const char *label = nullptr;
+	state->mrb()->get_args("ii|z!", &width, &height, &label);
+	if (DATA_PTR(self) != nullptr)
+		state->mrb()->raise(state->mrb()->argument_error(),
+		    "Image is already initialized");
+	const int16_t w = read_coordinate(mrb, width);
+	const int16_t h = read_coordinate(mrb, height);
+	if (w <= 0 || h <= 0)
+		state->mrb()->raise(state->mrb()->range_error(),
+		    "Image dimensions must be positive");
+	const std::string name = label != nullptr
+	    ? std::string(label)
+	    : std::format("euler:image:{}", serial.fetch_add(1));
+	void *ptr;
+	{
+		auto image = state->image_loader()->create_image(name.c_str(),
+		    w, h, Color(0, 0, 0, 0));
+		ptr = image == nullptr ? nullptr : image.wrap();
+	}
+	if (ptr == nullptr)
+		state->mrb()->raise(state->mrb()->runtime_error(),
+		    "Could not allocate the image");
+	mrb_data_init(self, ptr, &Image::TYPE);
+	return mrb_nil_value();
+}
+
+static mrb_value
+image_width(mrb_state *mrb, const mrb_value self)
+{
+	using namespace euler::util;
+	const auto image = Reference<Image>::unwrap(mrb, self);
+	return State::get(mrb)->mrb()->int_value(image->dimensions().first);
+}
+
+static mrb_value
+image_height(mrb_state *mrb, const mrb_value self)
+{
+	using namespace euler::util;
+	const auto image = Reference<Image>::unwrap(mrb, self);
+	return State::get(mrb)->mrb()->int_value(image->dimensions().second);
+}
+
+static void
+require_pixels(mrb_state *mrb, const euler::util::Reference<Image> &image)
+{
+	if (image->raw_data() != nullptr) return;
+	const auto state = euler::util::State::get(mrb);
+	state->mrb()->raise(state->mrb()->argument_error(),
+	    "Image has no CPU-side pixel data");
+}
+
+template <void (Image::*Method)(int16_t, int16_t, int16_t, int16_t,
+    euler::util::Color)>
+static mrb_value
+image_rect_op(mrb_state *mrb, const mrb_value self)
+{
+	using namespace euler::util;
+	mrb_int x, y, w, h;
+	mrb_value color;
+	State::get(mrb)->mrb()->get_args("iiiio", &x, &y, &w, &h, &color);
+	const int16_t x16 = read_coordinate(mrb, x);
+	const int16_t y16 = read_coordinate(mrb, y);
+	const int16_t w16 = read_coordinate(mrb, w);
+	const int16_t h16 = read_coordinate(mrb, h);
+	auto image = Reference<Image>::unwrap(mrb, self);
+	require_pixels(mrb, image);
+	(image.get()->*Method)(x16, y16, w16, h16, Color::read(mrb, color));
+	return self;
+}
+
+static mrb_value
+image_blit(mrb_state *mrb, const mrb_value self)
+{
+	using namespace euler::util;
+	const auto state = State::get(mrb);
+	mrb_value src_value;
+	mrb_int x, y;
+	mrb_sym mode_sym = EULER_SYM(alpha);
+	state->mrb()->get_args("oii|n", &src_value, &x, &y, &mode_sym);
+	const int16_t x16 = read_coordinate(mrb, x);
+	const int16_t y16 = read_coordinate(mrb, y);
+	const auto image = Reference<Image>::unwrap(mrb, self);
+	require_pixels(mrb, image);
+	const auto src = Reference<Image>::unwrap(mrb, src_value);
+	require_pixels(mrb, src);
+	Image::BlendMode mode;
+	if (mode_sym == EULER_SYM(alpha)) mode = Image::BlendMode::Alpha;
+	else if (mode_sym == EULER_SYM(copy)) mode = Image::BlendMode::Copy;
+	else if (mode_sym == EULER_SYM(premultiplied))
+		mode = Image::BlendMode::Premultiplied;
+	else
+		state->mrb()->raise(state->mrb()->argument_error(),
+		    "blend mode must be :alpha, :copy or :premultiplied");
+	image->blit(*src.get(), x16, y16, mode);
+	return self;
+}
+
+template <void (Image::*Method)()>
+static mrb_value
+image_whole_op(mrb_state *mrb, const mrb_value self)
+{
+	using namespace euler::util;
+	auto image = Reference<Image>::unwrap(mrb, self);
+	require_pixels(mrb, image);
+	(image.get()->*Method)();
+	return self;
+}
+
+static mrb_value
+image_load_async(mrb_state *mrb, mrb_value)
+{
+	using namespace euler::util;
+	const auto state = State::get(mrb);
+	const char *path;
+	state->mrb()->get_args("z", &path);
+	auto handle = state->image_loader()->load_image_async(path);
+	return state->wrap(handle);
+}
+
+RClass *
+Image::init(const Reference<State> &state, RClass *mod, RClass *)
+{
+	const auto cls = state->mrb()->define_class_under(mod, "Image",
+	    state->object_class());
+	MRB_SET_INSTANCE_TT(cls, MRB_TT_DATA);
+	state->mrb()->define_class_method(cls, "load_async", image_load_async,
+	    MRB_ARGS_REQ(1));
+	state->mrb()->define_method(cls, "initialize", image_initialize,
+	    MRB_ARGS_ARG(2, 1));
+	state->mrb()->define_method(cls, "width", image_width, MRB_ARGS_NONE());
+	state->mrb()->define_method(cls, "height", image_height,
+	    MRB_ARGS_NONE());
+	state->mrb()->define_method(cls, "fill_rect",
+	    image_rect_op<&Image::fill_rect>, MRB_ARGS_REQ(5));
+	state->mrb()->define_method(cls, "blend_rect",
+	    image_rect_op<&Image::blend_rect>, MRB_ARGS_REQ(5));
+	state->mrb()->define_method(cls, "blit", image_blit,
+	    MRB_ARGS_REQ(3) | MRB_ARGS_OPT(1));
+	state->mrb()->define_method(cls, "premultiply!",
+	    image_whole_op<&Image::premultiply>, MRB_ARGS_NONE());
+	state->mrb()->define_method(cls, "unpremultiply!",
+	    image_whole_op<&Image::unpremultiply>, MRB_ARGS_NONE());
+	state->mrb()->define_method(cls, "swizzle!",
+	    image_whole_op<&Image::swizzle>, MRB_ARGS_NONE());
+	return cls;
+}
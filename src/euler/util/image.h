@@ -4,13 +4,25 @@
 #define EULER_UTIL_IMAGE_H
 
 #include "euler/util/color.h"
+#include "euler/util/ext.h"
 #include "euler/util/object.h"
 
 namespace euler::util {
 class Image : public Object {
+	BIND_MRUBY("Euler::Util::Image", Image, util.image);
+
 public:
 	~Image() override = default;
 
+	enum class BlendMode {
+		/* overwrite the destination */
+		Copy,
+		/* straight-alpha source-over */
+		Alpha,
+		/* source-over for images holding premultiplied pixels */
+		Premultiplied,
+	};
+
 	/* Specifies a location on a texture sheet. Generally used for
 	 * spritesheets. */
 	struct Location {
@@ -71,6 +83,20 @@ public:
 	virtual uint32_t *raw_data() = 0;
 	virtual const uint32_t *raw_data() const = 0;
 	virtual std::string label() const = 0;
+
+	/* Bulk operations over raw_data(), clipped to the image bounds. They
+	 * run whole rows through the SIMD kernels in util/pixel and do nothing
+	 * on images without CPU-side pixels. */
+	virtual void fill_rect(int16_t x, int16_t y, int16_t w, int16_t h,
+	    Color color);
+	virtual void blend_rect(int16_t x, int16_t y, int16_t w, int16_t h,
+	    Color color);
+	virtual void blit(const Image &src, int16_t x, int16_t y,
+	    BlendMode mode = BlendMode::Alpha);
+	virtual void premultiply();
+	virtual void unpremultiply();
+	/* reverses the byte order of every pixel (RGBA <-> ABGR) */
+	virtual void swizzle();
 };
 } /* namespace euler::util */
 
@@ -2,3 +2,211 @@
 
 #include "euler/util/image_loader.h"
 
+#include <algorithm>
+
+#include "euler/util/state.h"
+
+using euler::util::ImageLoader;
+using euler::util::PendingImage;
+
+ImageLoader::ImageLoader(Reference<Jobs> jobs)
+    : _jobs(std::move(jobs))
+{
+}
+
+ImageLoader::~ImageLoader()
+{
+	shutdown();
+}
+
+void
+ImageLoader::shutdown()
+{
+	for (const auto &[path, task] : _tasks) _jobs->wait(task);
+	_tasks.clear();
+	_queued.clear();
+}
+
+euler::util::Reference<PendingImage>
+ImageLoader::load_image_async(const char *path)
+{
+	if (const auto it = _cache.find(path); it != _cache.end())
+		return it->second;
+	auto handle = make_reference<PendingImage>(path);
+	_cache.emplace(path, handle);
+	if (!decodes_on_workers()) {
+		_queued.emplace_back(path);
+		return handle;
+	}
+	auto task = _jobs->submit([this, path = std::string(path)] {
+		Result result;
+		result.path = path;
+		result.ok = decode_image(path.c_str(), result.decoded);
+		std::scoped_lock lock(_mutex);
+		_completed.push_back(std::move(result));
+	});
+	_tasks.emplace(path, std::move(task));
+	return handle;
+}
+
+void
+ImageLoader::finish(Result &result)
+{
+	const auto it = _cache.find(result.path);
+	if (it == _cache.end()) return;
+	const auto handle = it->second;
+	/* a duplicate decode after an evict; the first one won */
+	if (handle->is_done()) return;
+	if (result.ok)
+		handle->_image = finish_image(result.path,
+		    std::move(result.decoded));
+	if (handle->_image != nullptr) {
+		handle->_status = PendingImage::Status::Ready;
+		return;
+	}
+	/* failures are not cached, so a later request tries again */
+	handle->_status = PendingImage::Status::Failed;
+	_cache.erase(it);
+}
+
+void
+ImageLoader::decode_now(const std::string &path)
+{
+	Result result;
+	result.path = path;
+	result.ok = decode_image(path.c_str(), result.decoded);
+	finish(result);
+}
+
+void
+ImageLoader::finish_completed()
+{
+	std::vector<Result> completed;
+	{
+		std::scoped_lock lock(_mutex);
+		completed.swap(_completed);
+	}
+	for (auto &result : completed) finish(result);
+	/* a task is only done once its result is queued, so everything
+	 * dropped here has either been finished or is in _completed */
+	if (!completed.empty()) {
+		std::erase_if(_tasks,
+		    [](const auto &pair) { return pair.second->is_done(); });
+	}
+}
+
+void
+ImageLoader::poll()
+{
+	finish_completed();
+	const auto start = std::chrono::steady_clock::now();
+	while (!_queued.empty()) {
+		const auto path = std::move(_queued.front());
+		_queued.pop_front();
+		decode_now(path);
+		if (std::chrono::steady_clock::now() - start
+		    >= MAIN_THREAD_BUDGET)
+			break;
+	}
+}
+
+void
+ImageLoader::wait(const Reference<PendingImage> &handle)
+{
+	if (const auto it = std::ranges::find(_queued, handle->path());
+	    it != _queued.end()) {
+		_queued.erase(it);
+		decode_now(handle->path());
+	}
+	while (!handle->is_done()) {
+		const auto [first, last] = _tasks.equal_range(handle->path());
+		for (auto it = first; it != last; ++it) _jobs->wait(it->second);
+		finish_completed();
+	}
+}
+
+void
+ImageLoader::evict(const char *path)
+{
+	const auto it = _cache.find(path);
+	if (it != _cache.end() && it->second->is_done()) _cache.erase(it);
+}
+
+void
+ImageLoader::clear_cache()
+{
+	std::erase_if(_cache,
+	    [](const auto &pair) { return pair.second->is_done(); });
+}
+
+static euler::util::Reference<PendingImage>
+poll_handle(mrb_state *mrb, const mrb_value self)
+{
+	using namespace euler::util;
+	auto handle = Reference<PendingImage>::unwrap(mrb, self);
+	if (!handle->is_done())
+		State::get(mrb)->image_loader()->finish_completed();
+	return handle;
+}
+
+static mrb_value
+pending_image_path(mrb_state *mrb, const mrb_value self)
+{
+	using namespace euler::util;
+	const auto handle = Reference<PendingImage>::unwrap(mrb, self);
+	return State::get(mrb)->mrb()->str_new_cstr(handle->path().c_str());
+}
+
+static mrb_value
+pending_image_ready(mrb_state *mrb, const mrb_value self)
+{
+	const auto handle = poll_handle(mrb, self);
+	return mrb_bool_value(
+	    handle->status() == PendingImage::Status::Ready);
+}
+
+static mrb_value
+pending_image_failed(mrb_state *mrb, const mrb_value self)
+{
+	const auto handle = poll_handle(mrb, self);
+	return mrb_bool_value(
+	    handle->status() == PendingImage::Status::Failed);
+}
+
+static mrb_value
+pending_image_image(mrb_state *mrb, const mrb_value self)
+{
+	using namespace euler::util;
+	auto image = poll_handle(mrb, self)->image();
+	return State::get(mrb)->wrap(image);
+}
+
+static mrb_value
+pending_image_wait(mrb_state *mrb, const mrb_value self)
+{
+	using namespace euler::util;
+	const auto state = State::get(mrb);
+	const auto handle = Reference<PendingImage>::unwrap(mrb, self);
+	state->image_loader()->wait(handle);
+	auto image = handle->image();
+	return state->wrap(image);
+}
+
+RClass *
+PendingImage::init(const Reference<State> &state, RClass *mod, RClass *)
+{
+	const auto cls = state->mrb()->define_class_under(mod, "PendingImage",
+	    state->object_class());
+	MRB_SET_INSTANCE_TT(cls, MRB_TT_DATA);
+	state->mrb()->define_method(cls, "path", pending_image_path,
+	    MRB_ARGS_NONE());
+	state->mrb()->define_method(cls, "ready?", pending_image_ready,
+	    MRB_ARGS_NONE());
+	state->mrb()->define_method(cls, "failed?", pending_image_failed,
+	    MRB_ARGS_NONE());
+	state->mrb()->define_method(cls, "image", pending_image_image,
+	    MRB_ARGS_NONE());
+	state->mrb()->define_method(cls, "wait", pending_image_wait,
+	    MRB_ARGS_NONE());
+	return cls;
+}
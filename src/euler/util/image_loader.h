@@ -3,17 +3,164 @@
 #ifndef EULER_UTIL_IMAGE_LOADER_H
 #define EULER_UTIL_IMAGE_LOADER_H
 
+#include <chrono>
+#include <cstdlib>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "euler/util/ext.h"
 #include "euler/util/image.h"
+#include "euler/util/jobs.h"
 #include "euler/util/object.h"
 
 namespace euler::util {
+
+/* Handle for an image requested through ImageLoader::load_image_async. Only
+ * ever touched on the main thread; the image becomes available once the
+ * loader has been polled after the decode finished. */
+class PendingImage final : public Object {
+	BIND_MRUBY("Euler::Util::PendingImage", PendingImage,
+	    util.pending_image);
+	friend class ImageLoader;
+
+public:
+	enum class Status {
+		Pending,
+		Ready,
+		Failed,
+	};
+
+	explicit PendingImage(std::string path)
+	    : _path(std::move(path))
+	{
+	}
+	~PendingImage() override = default;
+
+	[[nodiscard]] Status
+	status() const
+	{
+		return _status;
+	}
+	[[nodiscard]] bool
+	is_done() const
+	{
+		return _status != Status::Pending;
+	}
+	[[nodiscard]] const std::string &
+	path() const
+	{
+		return _path;
+	}
+	/* null until the image is ready */
+	[[nodiscard]] Reference<Image>
+	image() const
+	{
+		return _image;
+	}
+
+private:
+	std::string _path;
+	Reference<Image> _image;
+	Status _status = Status::Pending;
+};
+
 class ImageLoader : public Object {
 public:
+	/* Result of a decode, as straight-alpha 0xAABBGGRR pixels allocated
+	 * with malloc so they can be handed to an Image that owns them. */
+	struct Decoded {
+		struct Free {
+			void
+			operator()(uint32_t *pixels) const
+			{
+				std::free(pixels);
+			}
+		};
+		std::unique_ptr<uint32_t, Free> pixels;
+		int16_t width = 0;
+		int16_t height = 0;
+	};
+
+	/* Decodes run as tasks on the shared job pool, unless the subclass
+	 * can only decode on the main thread. */
+	explicit ImageLoader(Reference<Jobs> jobs);
+	~ImageLoader() override;
+
 	[[nodiscard]] virtual Reference<Image> load_image(const char *path) = 0;
 	[[nodiscard]] virtual Reference<Image> create_image(const char *label,
 	    int16_t w, int16_t h, Color)
 	    = 0;
+
+	/* Queues path for decoding. Requests for a path that is already
+	 * loading or loaded share a single handle. */
+	[[nodiscard]] Reference<PendingImage> load_image_async(
+	    const char *path);
+	/* Finishes every decode that has completed since the last call, and
+	 * runs main-thread decodes for up to MAIN_THREAD_BUDGET. Must be
+	 * called on the main thread, once per tick. */
+	void poll();
+	/* Like poll, but only finishes decodes done by workers, so checking
+	 * on handles never decodes on the main thread. */
+	void finish_completed();
+	/* Blocks until handle is done, running queued jobs (this decode
+	 * among them, if no worker has picked it up yet) meanwhile. */
+	void wait(const Reference<PendingImage> &handle);
+	/* Forgets finished handles, so the next request decodes again.
+	 * Handles still loading are kept. */
+	void evict(const char *path);
+	void clear_cache();
+
+	/* Main-thread decoding a single poll may spend, so a level's worth
+	 * of images is spread over ticks rather than loaded in one. At least
+	 * one image is decoded per poll. */
+	static constexpr std::chrono::milliseconds MAIN_THREAD_BUDGET { 4 };
+
+protected:
+	/* Whether decode_image may run on worker threads. */
+	[[nodiscard]] virtual bool
+	decodes_on_workers() const
+	{
+		return true;
+	}
+	/* Runs on a worker thread if decodes_on_workers(), and from poll or
+	 * wait on the main thread otherwise; must not touch Ruby or any
+	 * Object. */
+	virtual bool decode_image(const char *path, Decoded &out) = 0;
+	/* Runs on the main thread with a successful decode, and should make
+	 * the pixels available to the renderer. */
+	virtual Reference<Image> finish_image(const std::string &path,
+	    Decoded &&decoded)
+	    = 0;
+	/* Waits for the decodes still in flight. Subclasses must call this
+	 * from their destructor, since those call back into decode_image. */
+	void shutdown();
+
+private:
+	struct Result {
+		std::string path;
+		Decoded decoded;
+		bool ok = false;
+	};
+
+	void finish(Result &result);
+	/* Decodes and finishes path on the calling thread. */
+	void decode_now(const std::string &path);
+
+	Reference<Jobs> _jobs;
+	std::unordered_map<std::string, Reference<PendingImage>> _cache;
+	/* decodes not yet finished by poll, by path */
+	std::unordered_multimap<std::string, Jobs::Handle> _tasks;
+	/* paths waiting for a main-thread decode, oldest first */
+	std::deque<std::string> _queued;
+	std::mutex _mutex;
+	/* guarded by _mutex */
+	std::vector<Result> _completed;
 };
+
 } /* namespace euler::util */
 
 #endif /* EULER_UTIL_IMAGE_LOADER_H */
@@ -0,0 +1,301 @@
+/* SPDX-License-Identifier: ISC */
+
+#include "euler/util/jobs.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+#include "euler/util/state.h"
+
+using euler::util::Job;
+using euler::util::Jobs;
+
+/* the pool and queue the current thread works for, if any */
+static thread_local const Jobs *current_pool = nullptr;
+static thread_local size_t current_queue = 0;
+/* the task running on this thread, which owns whatever it submits */
+static thread_local const Jobs::Task *current_task = nullptr;
+
+Jobs::Jobs(unsigned threads)
+{
+	if (threads == 0) {
+		const unsigned hardware = std::thread::hardware_concurrency();
+		threads = hardware > 1 ? hardware - 1 : 1;
+	}
+	_queues.reserve(threads);
+	for (unsigned i = 0; i < threads; ++i)
+		_queues.push_back(std::make_unique<Queue>());
+	_workers.reserve(threads);
+	for (unsigned i = 0; i < threads; ++i) {
+		_workers.emplace_back([this, i](const std::stop_token &stop) {
+			work(stop, i);
+		});
+	}
+}
+
+Jobs::~Jobs()
+{
+	for (auto &worker : _workers) worker.request_stop();
+	_workers.clear();
+}
+
+void
+Jobs::push(Handle task)
+{
+	/* workers keep their own work local; everyone else spreads it out */
+	const size_t index = current_pool == this
+	    ? current_queue
+	    : _next_queue.fetch_add(1, std::memory_order_relaxed)
+		% _queues.size();
+	{
+		/* counted before the task is visible, so a pop can never take
+		 * _pending below zero; taken so a worker can't miss the wakeup
+		 * between checking _pending and going to sleep */
+		std::scoped_lock lock(_sleep_mutex);
+		_pending.fetch_add(1, std::memory_order_release);
+	}
+	{
+		auto &queue = *_queues[index];
+		std::scoped_lock lock(queue.mutex);
+		queue.tasks.push_back(std::move(task));
+	}
+	_wake.notify_one();
+}
+
+Jobs::Handle
+Jobs::take(Queue &queue, const bool newest, const void *group)
+{
+	const auto covered = [group](const Handle &task) {
+		return group == nullptr || task.get() == group
+		    || task->_group == group;
+	};
+	std::scoped_lock lock(queue.mutex);
+	auto &tasks = queue.tasks;
+	if (tasks.empty()) return nullptr;
+	Handle task;
+	if (newest) {
+		const auto it
+		    = std::find_if(tasks.rbegin(), tasks.rend(), covered);
+		if (it == tasks.rend()) return nullptr;
+		task = std::move(*it);
+		tasks.erase(std::next(it).base());
+	} else {
+		const auto it
+		    = std::find_if(tasks.begin(), tasks.end(), covered);
+		if (it == tasks.end()) return nullptr;
+		task = std::move(*it);
+		tasks.erase(it);
+	}
+	_pending.fetch_sub(1, std::memory_order_relaxed);
+	return task;
+}
+
+Jobs::Handle
+Jobs::pop(const void *group)
+{
+	const size_t count = _queues.size();
+	const bool worker = current_pool == this;
+	if (worker) {
+		auto task = take(*_queues[current_queue], true, group);
+		if (task != nullptr) return task;
+	}
+	/* steal the oldest work, which tends to be the largest */
+	const size_t start = worker
+	    ? current_queue + 1
+	    : _next_queue.load(std::memory_order_relaxed);
+	for (size_t i = 0; i < count; ++i) {
+		auto task = take(*_queues[(start + i) % count], false, group);
+		if (task != nullptr) return task;
+	}
+	return nullptr;
+}
+
+bool
+Jobs::run_one(const void *group)
+{
+	const auto task = pop(group);
+	if (task == nullptr) return false;
+	run(task);
+	return true;
+}
+
+void
+Jobs::run(const Handle &task)
+{
+	const Task *outer = current_task;
+	current_task = task.get();
+	task->_fn();
+	current_task = outer;
+	/* drop captures now rather than whenever the last handle goes */
+	task->_fn = nullptr;
+	task->_done.store(true, std::memory_order_release);
+	task->_done.notify_all();
+}
+
+void
+Jobs::work(const std::stop_token &stop, const size_t index)
+{
+	current_pool = this;
+	current_queue = index;
+	while (!stop.stop_requested()) {
+		if (run_one()) continue;
+		std::unique_lock lock(_sleep_mutex);
+		_wake.wait(lock, stop, [this] {
+			return _pending.load(std::memory_order_acquire) > 0;
+		});
+	}
+}
+
+Jobs::Handle
+Jobs::submit(std::function<void()> fn)
+{
+	auto task = std::make_shared<Task>(std::move(fn));
+	task->_group = current_task;
+	push(task);
+	return task;
+}
+
+void
+Jobs::wait(const Handle &task)
+{
+	while (!task->is_done()) {
+		if (run_one(task.get())) continue;
+		task->_done.wait(false, std::memory_order_acquire);
+	}
+}
+
+void
+Jobs::parallel_for(const size_t begin, const size_t end, size_t grain,
+    const Range &body)
+{
+	if (begin >= end) return;
+	grain = std::max<size_t>(grain, 1);
+	const size_t chunks = (end - begin + grain - 1) / grain;
+	if (chunks == 1) {
+		body(begin, end);
+		return;
+	}
+	/* shared, since the last chunk notifies after the caller may have
+	 * seen the count reach zero and returned */
+	const auto remaining = std::make_shared<std::atomic<size_t>>(chunks);
+	const auto finish = [remaining] {
+		if (remaining->fetch_sub(1, std::memory_order_acq_rel) == 1)
+			remaining->notify_all();
+	};
+	/* the counter doubles as the group tag of this call's chunks */
+	const void *group = remaining.get();
+	for (size_t chunk = 1; chunk < chunks; ++chunk) {
+		const size_t from = begin + chunk * grain;
+		const size_t to = std::min(end, from + grain);
+		auto task = std::make_shared<Task>([&body, from, to, finish] {
+			body(from, to);
+			finish();
+		});
+		task->_group = group;
+		push(std::move(task));
+	}
+	body(begin, std::min(end, begin + grain));
+	finish();
+	for (;;) {
+		const size_t left = remaining->load(std::memory_order_acquire);
+		if (left == 0) break;
+		if (run_one(group)) continue;
+		remaining->wait(left, std::memory_order_acquire);
+	}
+}
+
+mrb_value
+Job::value(mrb_state *mrb)
+{
+	if (!is_done()) return mrb_nil_value();
+	return _finish(mrb);
+}
+
+static mrb_value
+jobs_threads(mrb_state *mrb, mrb_value)
+{
+	using namespace euler::util;
+	const auto state = State::get(mrb);
+	return state->mrb()->int_value(state->jobs()->thread_count());
+}
+
+static mrb_value
+jobs_read_file(mrb_state *mrb, mrb_value)
+{
+	using namespace euler::util;
+	const auto state = State::get(mrb);
+	const char *path;
+	state->mrb()->get_args("z", &path);
+	struct Result {
+		std::string data;
+		bool ok = false;
+	};
+	const auto result = std::make_shared<Result>();
+	const auto jobs = state->jobs();
+	auto task = jobs->submit([result, path = std::string(path)] {
+		std::ifstream in(path, std::ios::binary);
+		if (!in) return;
+		result->data.assign(std::istreambuf_iterator<char>(in),
+		    std::istreambuf_iterator<char>());
+		result->ok = !in.bad();
+	});
+	auto job = make_reference<Job>(jobs, std::move(task),
+	    [result](mrb_state *mrb) {
+		    if (!result->ok) return mrb_nil_value();
+		    return State::get(mrb)->mrb()->str_new(result->data.data(),
+			result->data.size());
+	    });
+	return state->wrap(job);
+}
+
+static mrb_value
+job_done(mrb_state *mrb, const mrb_value self)
+{
+	using namespace euler::util;
+	const auto job = Reference<Job>::unwrap(mrb, self);
+	return mrb_bool_value(job->is_done());
+}
+
+static mrb_value
+job_value(mrb_state *mrb, const mrb_value self)
+{
+	using namespace euler::util;
+	auto job = Reference<Job>::unwrap(mrb, self);
+	return job.get()->value(mrb);
+}
+
+static mrb_value
+job_wait(mrb_state *mrb, const mrb_value self)
+{
+	using namespace euler::util;
+	auto job = Reference<Job>::unwrap(mrb, self);
+	job.get()->wait();
+	return job.get()->value(mrb);
+}
+
+RClass *
+Jobs::init(const Reference<State> &state, RClass *mod, RClass *)
+{
+	const auto cls = state->mrb()->define_class_under(mod, "Jobs",
+	    state->object_class());
+	MRB_SET_INSTANCE_TT(cls, MRB_TT_DATA);
+	state->mrb()->define_class_method(cls, "threads", jobs_threads,
+	    MRB_ARGS_NONE());
+	state->mrb()->define_class_method(cls, "read_file", jobs_read_file,
+	    MRB_ARGS_REQ(1));
+	return cls;
+}
+
+RClass *
+Job::init(const Reference<State> &state, RClass *mod, RClass *)
+{
+	const auto cls = state->mrb()->define_class_under(mod, "Job",
+	    state->object_class());
+	MRB_SET_INSTANCE_TT(cls, MRB_TT_DATA);
+	state->mrb()->define_method(cls, "done?", job_done, MRB_ARGS_NONE());
+	state->mrb()->define_method(cls, "value", job_value, MRB_ARGS_NONE());
+	state->mrb()->define_method(cls, "wait", job_wait, MRB_ARGS_NONE());
+	return cls;
+}
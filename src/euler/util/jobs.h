@@ -0,0 +1,140 @@
+/* SPDX-License-Identifier: ISC */
+
+#ifndef EULER_UTIL_JOBS_H
+#define EULER_UTIL_JOBS_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "euler/util/ext.h"
+#include "euler/util/object.h"
+
+namespace euler::util {
+
+/* Work-stealing thread pool shared by the engine. Every worker owns a deque:
+ * it pushes and pops its own work at the back and steals from the front of
+ * the others when it runs dry. A thread blocked in wait() or parallel_for()
+ * only helps with work that belongs to what it is waiting on: the awaited
+ * task and the tasks submitted from inside it, or the chunks of its own
+ * parallel_for. Unrelated work, such as a long file read, stays on the
+ * workers, so the main thread's wait is never held up by it.
+ *
+ * Task bodies run on arbitrary threads and must not touch Ruby, nor throw. */
+class Jobs final : public Object {
+	BIND_MRUBY("Euler::Util::Jobs", Jobs, util.jobs);
+
+public:
+	class Task {
+		friend class Jobs;
+
+	public:
+		explicit Task(std::function<void()> fn)
+		    : _fn(std::move(fn))
+		{
+		}
+
+		[[nodiscard]] bool
+		is_done() const
+		{
+			return _done.load(std::memory_order_acquire);
+		}
+
+	private:
+		std::function<void()> _fn;
+		std::atomic<bool> _done = false;
+		/* what a waiter must be waiting on to help with this task: the
+		 * task it was submitted from, or its parallel_for */
+		const void *_group = nullptr;
+	};
+	using Handle = std::shared_ptr<Task>;
+	using Range = std::function<void(size_t begin, size_t end)>;
+
+	/* With threads == 0 the worker count is derived from the hardware
+	 * concurrency, leaving a core for the main thread. */
+	explicit Jobs(unsigned threads = 0);
+	/* Stops the workers; tasks still queued are dropped, so wait on
+	 * anything whose side effects matter first. */
+	~Jobs() override;
+
+	Handle submit(std::function<void()> fn);
+	/* Splits [begin, end) into chunks of at most grain indices and calls
+	 * body on each in parallel, returning once all of them have run. */
+	void parallel_for(size_t begin, size_t end, size_t grain,
+	    const Range &body);
+	/* Blocks until task is done, running it or its subtasks meanwhile. */
+	void wait(const Handle &task);
+
+	[[nodiscard]] unsigned
+	thread_count() const
+	{
+		return static_cast<unsigned>(_workers.size());
+	}
+
+private:
+	struct Queue {
+		std::mutex mutex;
+		std::deque<Handle> tasks;
+	};
+
+	void push(Handle task);
+	/* With a group, only tasks that group covers are taken. */
+	Handle take(Queue &queue, bool newest, const void *group);
+	Handle pop(const void *group = nullptr);
+	bool run_one(const void *group = nullptr);
+	void run(const Handle &task);
+	void work(const std::stop_token &stop, size_t index);
+
+	std::vector<std::unique_ptr<Queue>> _queues;
+	std::vector<std::jthread> _workers;
+	std::atomic<size_t> _next_queue = 0;
+	/* tasks pushed and not yet popped, for idle workers to sleep on */
+	std::atomic<size_t> _pending = 0;
+	std::mutex _sleep_mutex;
+	std::condition_variable_any _wake;
+};
+
+/* Ruby handle for a native job. The body runs on the pool; finish turns its
+ * result into a Ruby value and is only ever called on the main thread. */
+class Job final : public Object {
+	BIND_MRUBY("Euler::Util::Job", Job, util.job);
+
+public:
+	using Finish = std::function<mrb_value(mrb_state *)>;
+
+	Job(Reference<Jobs> jobs, Jobs::Handle task, Finish finish)
+	    : _jobs(std::move(jobs))
+	    , _task(std::move(task))
+	    , _finish(std::move(finish))
+	{
+	}
+	~Job() override = default;
+
+	[[nodiscard]] bool
+	is_done() const
+	{
+		return _task->is_done();
+	}
+	void
+	wait()
+	{
+		_jobs->wait(_task);
+	}
+	/* nil until the job is done */
+	mrb_value value(mrb_state *mrb);
+
+private:
+	Reference<Jobs> _jobs;
+	Jobs::Handle _task;
+	Finish _finish;
+};
+
+} /* namespace euler::util */
+
+#endif /* EULER_UTIL_JOBS_H */
@@ -0,0 +1,374 @@
+/* SPDX-License-Identifier: ISC */
+
+/* Turns a file written by util::BinaryLog back into text:
+ *
+ *   euler_log_decode <log> [output]
+ *
+ * Records from every thread are merged in time order, one line each. Must run
+ * on a machine with the same byte order as the one that wrote the log. */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <variant>
+#include <vector>
+
+#include "euler/util/binary_log.h"
+
+using euler::util::BinaryLog;
+using Arg = BinaryLog::Arg;
+using Value = std::variant<bool, char, int64_t, uint64_t, float, double,
+    const void *, std::string>;
+
+namespace {
+struct Site {
+	std::string format;
+	std::vector<Arg> signature;
+	bool defined = false;
+};
+
+struct Record {
+	uint64_t time;
+	uint32_t site;
+	uint16_t subsystem;
+	uint8_t severity;
+	std::vector<Value> args;
+};
+
+class Reader {
+public:
+	Reader(const std::byte *data, const size_t size)
+	    : _data(data)
+	    , _size(size)
+	{
+	}
+
+	[[nodiscard]] size_t
+	remaining() const
+	{
+		return _size - _offset;
+	}
+
+	[[nodiscard]] size_t
+	offset() const
+	{
+		return _offset;
+	}
+
+	template <typename T>
+	bool
+	read(T &value)
+	{
+		if (remaining() < sizeof(T)) return false;
+		std::memcpy(&value, _data + _offset, sizeof(T));
+		_offset += sizeof(T);
+		return true;
+	}
+
+	bool
+	read(std::string &value, const size_t length)
+	{
+		if (remaining() < length) return false;
+		value.assign(reinterpret_cast<const char *>(_data + _offset),
+		    length);
+		_offset += length;
+		return true;
+	}
+
+	/* Splits off the next size bytes as a reader of their own. */
+	bool
+	take(Reader &out, const size_t size)
+	{
+		if (remaining() < size) return false;
+		out = Reader(_data + _offset, size);
+		_offset += size;
+		return true;
+	}
+
+private:
+	const std::byte *_data;
+	size_t _size;
+	size_t _offset = 0;
+};
+} /* namespace */
+
+static constexpr const char *SEVERITY_NAMES[] = {
+	"debug",
+	"info",
+	"warn",
+	"error",
+	"fatal",
+	"any",
+};
+
+static bool
+read_value(Reader &reader, const Arg type, Value &value)
+{
+	switch (type) {
+	case Arg::Bool: {
+		uint8_t v;
+		if (!reader.read(v)) return false;
+		value = v != 0;
+		return true;
+	}
+	case Arg::Char: {
+		uint8_t v;
+		if (!reader.read(v)) return false;
+		value = static_cast<char>(v);
+		return true;
+	}
+	case Arg::Int: {
+		int64_t v;
+		if (!reader.read(v)) return false;
+		value = v;
+		return true;
+	}
+	case Arg::Uint: {
+		uint64_t v;
+		if (!reader.read(v)) return false;
+		value = v;
+		return true;
+	}
+	case Arg::Float32: {
+		float v;
+		if (!reader.read(v)) return false;
+		value = v;
+		return true;
+	}
+	case Arg::Float: {
+		double v;
+		if (!reader.read(v)) return false;
+		value = v;
+		return true;
+	}
+	case Arg::Pointer: {
+		uint64_t v;
+		if (!reader.read(v)) return false;
+		value = reinterpret_cast<const void *>(
+		    static_cast<uintptr_t>(v));
+		return true;
+	}
+	case Arg::String: {
+		uint32_t length;
+		std::string v;
+		if (!reader.read(length) || !reader.read(v, length))
+			return false;
+		value = std::move(v);
+		return true;
+	}
+	default: return false;
+	}
+}
+
+static std::string
+format_value(const std::string &spec, const Value &value)
+{
+	const auto field = "{" + spec + "}";
+	try {
+		return std::visit(
+		    [&](auto v) {
+			    return std::vformat(field,
+				std::make_format_args(v));
+		    },
+		    value);
+	} catch (const std::format_error &) {
+		return "{?}";
+	}
+}
+
+static const Value *
+arg_at(const std::vector<Value> &args, const std::string_view id,
+    size_t &next)
+{
+	size_t index = next;
+	if (id.empty()) ++next;
+	else index = std::strtoul(std::string(id).c_str(), nullptr, 10);
+	return index < args.size() ? &args[index] : nullptr;
+}
+
+/* The std::format grammar, one replacement field at a time, so each field
+ * only ever sees its own argument. */
+static std::string
+render(const std::string_view format, const std::vector<Value> &args)
+{
+	std::string out;
+	size_t next = 0;
+	for (size_t i = 0; i < format.size(); ++i) {
+		const char c = format[i];
+		if (c == '}' || c == '{') {
+			if (i + 1 < format.size() && format[i + 1] == c) {
+				out.push_back(c);
+				++i;
+				continue;
+			}
+		}
+		if (c != '{') {
+			out.push_back(c);
+			continue;
+		}
+		size_t end = i + 1;
+		for (int depth = 1; end < format.size(); ++end) {
+			if (format[end] == '{') ++depth;
+			if (format[end] == '}' && --depth == 0) break;
+		}
+		const auto field = format.substr(i + 1, end - i - 1);
+		i = end;
+		const auto colon = field.find(':');
+		const auto *value = arg_at(args, field.substr(0, colon), next);
+		std::string spec;
+		if (colon != std::string_view::npos) {
+			/* nested fields hold a width or precision */
+			for (size_t j = colon; j < field.size(); ++j) {
+				if (field[j] != '{') {
+					spec.push_back(field[j]);
+					continue;
+				}
+				const auto close = field.find('}', j);
+				const auto *nested = arg_at(args,
+				    field.substr(j + 1, close - j - 1), next);
+				if (nested != nullptr)
+					spec += format_value("", *nested);
+				j = close;
+			}
+		}
+		out += value != nullptr ? format_value(spec, *value) : "{?}";
+	}
+	return out;
+}
+
+static bool
+read_records(Reader &reader, const std::vector<Site> &sites,
+    std::vector<Record> &records)
+{
+	while (reader.remaining() > 0) {
+		Record record;
+		if (!reader.read(record.site) || !reader.read(record.subsystem)
+		    || !reader.read(record.severity)
+		    || !reader.read(record.time))
+			return false;
+		if (record.site >= sites.size() || !sites[record.site].defined)
+			return false;
+		const auto &signature = sites[record.site].signature;
+		record.args.resize(signature.size());
+		for (size_t i = 0; i < signature.size(); ++i)
+			if (!read_value(reader, signature[i], record.args[i]))
+				return false;
+		records.push_back(std::move(record));
+	}
+	return true;
+}
+
+int
+main(const int argc, const char **argv)
+{
+	if (argc < 2 || argc > 3) {
+		fprintf(stderr, "usage: %s <log> [output]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	std::ifstream file(argv[1], std::ios::binary);
+	if (!file) {
+		fprintf(stderr, "Failed to open %s\n", argv[1]);
+		return EXIT_FAILURE;
+	}
+	const std::string contents((std::istreambuf_iterator<char>(file)),
+	    std::istreambuf_iterator<char>());
+	Reader reader(reinterpret_cast<const std::byte *>(contents.data()),
+	    contents.size());
+
+	std::string magic;
+	uint32_t version;
+	uint64_t steady_base;
+	uint64_t system_base;
+	if (!reader.read(magic, BinaryLog::MAGIC.size())
+	    || magic != std::string_view(BinaryLog::MAGIC.data(),
+		BinaryLog::MAGIC.size())
+	    || !reader.read(version) || version == 0
+	    || version > BinaryLog::VERSION
+	    || !reader.read(steady_base) || !reader.read(system_base)) {
+		fprintf(stderr, "%s is not an Euler binary log\n", argv[1]);
+		return EXIT_FAILURE;
+	}
+
+	std::vector<Site> sites;
+	std::vector<std::string> subsystems;
+	std::vector<Record> records;
+	while (reader.remaining() > 0) {
+		const size_t offset = reader.offset();
+		BinaryLog::Chunk chunk;
+		bool ok = reader.read(chunk);
+		if (ok && chunk == BinaryLog::Chunk::Site) {
+			uint32_t id;
+			uint16_t length;
+			uint8_t count;
+			Site site;
+			ok = reader.read(id) && reader.read(length)
+			    && reader.read(site.format, length)
+			    && reader.read(count);
+			site.signature.resize(count);
+			for (size_t i = 0; ok && i < count; ++i)
+				ok = reader.read(site.signature[i]);
+			if (ok) {
+				site.defined = true;
+				if (sites.size() <= id) sites.resize(id + 1);
+				sites[id] = std::move(site);
+			}
+		} else if (ok && chunk == BinaryLog::Chunk::Subsystem) {
+			uint16_t id;
+			uint16_t length;
+			std::string name;
+			ok = reader.read(id) && reader.read(length)
+			    && reader.read(name, length);
+			if (ok) {
+				if (subsystems.size() <= id)
+					subsystems.resize(id + 1);
+				subsystems[id] = std::move(name);
+			}
+		} else if (ok && chunk == BinaryLog::Chunk::Records) {
+			uint32_t thread;
+			uint32_t length;
+			Reader block(nullptr, 0);
+			ok = reader.read(thread) && reader.read(length)
+			    && reader.take(block, length)
+			    && read_records(block, sites, records);
+		} else {
+			ok = false;
+		}
+		if (!ok) {
+			/* most likely cut short by a crash; keep what came
+			 * before */
+			fprintf(stderr, "%s: unreadable data at offset %zu\n",
+			    argv[1], offset);
+			break;
+		}
+	}
+
+	FILE *out = argc == 3 ? std::fopen(argv[2], "w") : stdout;
+	if (out == nullptr) {
+		fprintf(stderr, "Failed to open %s\n", argv[2]);
+		return EXIT_FAILURE;
+	}
+	std::ranges::stable_sort(records, {}, &Record::time);
+	for (const auto &record : records) {
+		using namespace std::chrono;
+		const auto wall = sys_time<nanoseconds>(
+		    nanoseconds(system_base + (record.time - steady_base)));
+		const auto severity = std::min<size_t>(record.severity,
+		    std::size(SEVERITY_NAMES) - 1);
+		const auto &subsystem = record.subsystem < subsystems.size()
+		    ? subsystems[record.subsystem]
+		    : std::string();
+		const auto line = std::format("{:%F %T} [{}] {}: {}",
+		    floor<microseconds>(wall), subsystem,
+		    SEVERITY_NAMES[severity],
+		    render(sites[record.site].format, record.args));
+		fprintf(out, "%s\n", line.c_str());
+	}
+	return out == stdout || std::fclose(out) == 0 ? EXIT_SUCCESS
+						     : EXIT_FAILURE;
+}
@@ -0,0 +1,185 @@
+/* SPDX-License-Identifier: ISC */
+
+#include "euler/util/log_queue.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <format>
+
+using euler::util::LogQueue;
+
+/* how long the drain thread sleeps when nothing wakes it */
+static constexpr auto IDLE_TIMEOUT = std::chrono::milliseconds(10);
+
+LogQueue::LogQueue(Sink sink, size_t capacity, const Overflow overflow,
+    std::function<void()> after_drain)
+    : _overflow(overflow)
+    , _sink(std::move(sink))
+    , _after_drain(std::move(after_drain))
+{
+	static_assert(sizeof(Slot) == SLOT_SIZE);
+	capacity = std::bit_ceil(std::max<size_t>(capacity, 16));
+	_slots = std::make_unique<Slot[]>(capacity);
+	_mask = capacity - 1;
+	for (size_t i = 0; i < capacity; ++i)
+		_slots[i].sequence.store(i, std::memory_order_relaxed);
+	_thread = std::jthread(
+	    [this](const std::stop_token &stop) { drain(stop); });
+}
+
+LogQueue::~LogQueue()
+{
+	_thread.request_stop();
+	_thread = {};
+}
+
+void
+LogQueue::wake()
+{
+	/* pairs with the fence in drain(), so either this sees the drain
+	 * thread asleep or it sees the line just published */
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (!_sleeping.load(std::memory_order_relaxed)) return;
+	std::scoped_lock lock(_wake_mutex);
+	_wake.notify_one();
+}
+
+bool
+LogQueue::try_push(const Logger::Severity severity, std::string_view line)
+{
+	/* a single line may take at most half the queue */
+	const size_t max_count = (_mask + 1) / 2;
+	line = line.substr(0, max_count * PAYLOAD);
+	const size_t count
+	    = std::max<size_t>(1, (line.size() + PAYLOAD - 1) / PAYLOAD);
+	size_t position = _enqueue.load(std::memory_order_relaxed);
+	for (;;) {
+		/* the drain thread frees slots in order, so if the last one
+		 * of the run is free, all of them are */
+		const size_t last = position + count - 1;
+		const size_t sequence
+		    = slot(last).sequence.load(std::memory_order_acquire);
+		const auto diff = static_cast<std::ptrdiff_t>(sequence - last);
+		if (diff == 0) {
+			if (_enqueue.compare_exchange_weak(position,
+				position + count, std::memory_order_relaxed))
+				break;
+		} else if (diff < 0) {
+			return false;
+		} else {
+			position = _enqueue.load(std::memory_order_relaxed);
+		}
+	}
+	for (size_t i = count; i-- > 0;) {
+		auto &current = slot(position + i);
+		const auto chunk
+		    = line.substr(std::min(line.size(), i * PAYLOAD), PAYLOAD);
+		std::memcpy(current.text, chunk.data(), chunk.size());
+		if (i == 0) {
+			current.length = static_cast<uint32_t>(line.size());
+			current.count = static_cast<uint16_t>(count);
+			current.severity = severity;
+		}
+		/* the first slot goes last: once it is visible, so is the
+		 * rest of the line */
+		current.sequence.store(position + i + 1,
+		    std::memory_order_release);
+	}
+	return true;
+}
+
+bool
+LogQueue::push(const Logger::Severity severity, const std::string_view line)
+{
+	while (!try_push(severity, line)) {
+		switch (_overflow) {
+		case Overflow::Count:
+			_dropped.fetch_add(1, std::memory_order_relaxed);
+			[[fallthrough]];
+		case Overflow::Drop:
+			_total_dropped.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		case Overflow::Block:
+			break;
+		}
+		wake();
+		std::this_thread::yield();
+	}
+	wake();
+	return true;
+}
+
+bool
+LogQueue::drain_one(std::string &buffer)
+{
+	const auto &first = slot(_dequeue);
+	if (first.sequence.load(std::memory_order_acquire) != _dequeue + 1)
+		return false;
+	const size_t count = first.count;
+	const size_t length = first.length;
+	const auto severity = first.severity;
+	buffer.clear();
+	for (size_t i = 0; i < count; ++i) {
+		const size_t chunk = std::min(PAYLOAD, length - buffer.size());
+		buffer.append(slot(_dequeue + i).text, chunk);
+	}
+	for (size_t i = 0; i < count; ++i) {
+		slot(_dequeue + i).sequence.store(_dequeue + i + _mask + 1,
+		    std::memory_order_release);
+	}
+	_dequeue += count;
+	/* handed over only after the slots are free, so a sink that logs
+	 * cannot deadlock on a full queue */
+	_sink(severity, buffer);
+	_delivered.store(_dequeue, std::memory_order_release);
+	_delivered.notify_all();
+	return true;
+}
+
+void
+LogQueue::drain(const std::stop_token &stop)
+{
+	std::string buffer;
+	const auto ready = [this] {
+		const auto &first = slot(_dequeue);
+		return first.sequence.load(std::memory_order_acquire)
+		    == _dequeue + 1;
+	};
+	for (;;) {
+		/* read before draining, so lines pushed before the stop was
+		 * requested are still delivered */
+		const bool stopping = stop.stop_requested();
+		bool drained = false;
+		while (drain_one(buffer)) drained = true;
+		if (const size_t lost = _dropped.exchange(0,
+			std::memory_order_relaxed)) {
+			_sink(Logger::Severity::Warn,
+			    std::format("{} log lines dropped", lost));
+			drained = true;
+		}
+		if (drained && _after_drain) _after_drain();
+		if (stopping) return;
+		_sleeping.store(true, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (!ready()) {
+			std::unique_lock lock(_wake_mutex);
+			_wake.wait_for(lock, stop, IDLE_TIMEOUT, ready);
+		}
+		_sleeping.store(false, std::memory_order_relaxed);
+	}
+}
+
+void
+LogQueue::flush()
+{
+	const size_t target = _enqueue.load(std::memory_order_acquire);
+	{
+		std::scoped_lock lock(_wake_mutex);
+		_wake.notify_one();
+	}
+	size_t delivered;
+	while ((delivered = _delivered.load(std::memory_order_acquire))
+	    < target)
+		_delivered.wait(delivered, std::memory_order_acquire);
+}
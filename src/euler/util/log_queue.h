@@ -0,0 +1,105 @@
+/* SPDX-License-Identifier: ISC */
+
+#ifndef EULER_UTIL_LOG_QUEUE_H
+#define EULER_UTIL_LOG_QUEUE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <thread>
+
+#include "euler/util/logger.h"
+
+namespace euler::util {
+
+/* Bounded multi-producer, single-consumer queue of formatted log lines,
+ * drained by its own thread. Producers claim a run of fixed-size slots with a
+ * single compare-and-swap and copy the line in; a line longer than one slot
+ * spans several. The drain thread hands each line to the sink, so slow
+ * terminals and disks no longer stall the threads that log.
+ *
+ * Lines are delivered in the order their slots were claimed. */
+class LogQueue {
+public:
+	enum class Overflow {
+		/* discard the line */
+		Drop,
+		/* discard the line and report how many were lost once there is
+		 * room again */
+		Count,
+		/* wait for room */
+		Block,
+	};
+
+	using Sink = std::function<void(Logger::Severity, std::string_view)>;
+
+	/* capacity is in slots and rounded up to a power of two. sink runs
+	 * on the drain thread only; after_drain, if set, runs there once
+	 * each time the queue has been emptied, for flushing files. */
+	LogQueue(Sink sink, size_t capacity = 8192,
+	    Overflow overflow = Overflow::Count,
+	    std::function<void()> after_drain = nullptr);
+	/* Delivers everything queued, then stops the drain thread. */
+	~LogQueue();
+	LogQueue(const LogQueue &) = delete;
+	LogQueue &operator=(const LogQueue &) = delete;
+
+	/* Returns false if the line was dropped. */
+	bool push(Logger::Severity severity, std::string_view line);
+	/* Blocks until every line pushed before the call has reached the
+	 * sink. Must not be called from the sink. */
+	void flush();
+
+	[[nodiscard]] size_t
+	dropped() const
+	{
+		return _total_dropped.load(std::memory_order_relaxed);
+	}
+
+private:
+	static constexpr size_t SLOT_SIZE = 128;
+
+	struct Slot {
+		std::atomic<size_t> sequence;
+		/* only set in the first slot of a line */
+		uint32_t length;
+		Logger::Severity severity;
+		uint16_t count;
+		char text[SLOT_SIZE - 18];
+	};
+	static constexpr size_t PAYLOAD = sizeof(Slot::text);
+
+	Slot &
+	slot(const size_t position) const
+	{
+		return _slots[position & _mask];
+	}
+	bool try_push(Logger::Severity severity, std::string_view line);
+	bool drain_one(std::string &buffer);
+	void drain(const std::stop_token &stop);
+	void wake();
+
+	std::unique_ptr<Slot[]> _slots;
+	size_t _mask;
+	Overflow _overflow;
+	Sink _sink;
+	std::function<void()> _after_drain;
+	alignas(64) std::atomic<size_t> _enqueue = 0;
+	alignas(64) size_t _dequeue = 0;
+	/* position everything before which has reached the sink */
+	std::atomic<size_t> _delivered = 0;
+	std::atomic<size_t> _dropped = 0;
+	std::atomic<size_t> _total_dropped = 0;
+	std::atomic<bool> _sleeping = false;
+	std::mutex _wake_mutex;
+	std::condition_variable_any _wake;
+	std::jthread _thread;
+};
+
+} /* namespace euler::util */
+
+#endif /* EULER_UTIL_LOG_QUEUE_H */
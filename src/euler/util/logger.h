@@ -10,6 +10,7 @@
 #include <mruby.h>
 #include <mruby/data.h>
 
+#include "euler/util/binary_log.h"
 #include "euler/util/ext.h"
 #include "euler/util/object.h"
 
@@ -44,6 +45,13 @@ public:
 	    Args &&...args) const
 	{
 		if (level < severity()) return;
+		if (const auto channel = binary_channel();
+		    channel.log != nullptr) {
+			channel.log->record(static_cast<uint8_t>(level),
+			    channel.subsystem, message,
+			    std::forward<Args>(args)...);
+			return;
+		}
 		auto str = std::format(message, std::forward<Args>(args)...);
 		write_log(level, str);
 	}
@@ -81,12 +89,27 @@ public:
 	fatal(const std::format_string<Args...> &message, Args &&...args) const
 	{
 		log(Severity::Fatal, message, std::forward<Args>(args)...);
+		flush();
 		std::abort();
 	}
 
+	/* Blocks until every line logged so far has been written out. Only
+	 * loggers that write in the background need to override it. */
+	virtual void
+	flush() const
+	{
+	}
+
 protected:
 	virtual void write_log(Severity level, const std::string &message) const
 	    = 0;
+	/* Loggers writing a BinaryLog return it here; log() then records the
+	 * arguments instead of formatting them. */
+	[[nodiscard]] virtual BinaryLog::Channel
+	binary_channel() const
+	{
+		return {};
+	}
 };
 } /* namespace euler::util */
 
@@ -0,0 +1,789 @@
+/* SPDX-License-Identifier: ISC */
+
+#include "euler/util/pixel.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+
+/* Every kernel comes in up to three widths. Each variant handles as many
+ * whole vectors as it can and returns how many pixels it consumed, so the
+ * public entry points chain AVX2 -> SSE2/NEON -> scalar over the remainder.
+ * AVX2 and SSSE3 are selected at runtime on x86 so that a baseline build
+ * still uses them where available. */
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define EULER_PIXEL_SSE2
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define EULER_PIXEL_NEON
+#endif
+
+#if defined(EULER_PIXEL_SSE2) && defined(__GNUC__)
+#include <immintrin.h>
+#define EULER_PIXEL_X86_DISPATCH
+#define EULER_TARGET_AVX2 __attribute__((target("avx2")))
+#define EULER_TARGET_SSSE3 __attribute__((target("ssse3")))
+#endif
+
+using namespace euler::util;
+
+static inline uint32_t
+blend_scalar(const uint32_t dst, const uint32_t src, const uint32_t inv_a)
+{
+	uint32_t out = 0;
+	for (int shift = 0; shift < 32; shift += 8) {
+		const uint32_t d = dst >> shift & 0xFF;
+		const uint32_t s = src >> shift & 0xFF;
+		const uint32_t c = s + pixel::div255(d * inv_a);
+		out |= std::min(0xFFu, c) << shift;
+	}
+	return out;
+}
+
+static inline uint32_t
+blend_straight_scalar(const uint32_t dst, const uint32_t src)
+{
+	const uint32_t a = src >> 24;
+	const uint32_t inv_a = 0xFF - a;
+	uint32_t out = 0;
+	for (int shift = 0; shift < 24; shift += 8) {
+		const uint32_t d = dst >> shift & 0xFF;
+		const uint32_t s = src >> shift & 0xFF;
+		out |= pixel::div255(s * a + d * inv_a) << shift;
+	}
+	const uint32_t da = dst >> 24;
+	return out | pixel::div255(a * 0xFF + da * inv_a) << 24;
+}
+
+static inline uint32_t
+premultiply_scalar(const uint32_t p)
+{
+	const uint32_t a = p >> 24;
+	return a << 24 | pixel::div255((p >> 16 & 0xFF) * a) << 16
+	    | pixel::div255((p >> 8 & 0xFF) * a) << 8
+	    | pixel::div255((p & 0xFF) * a);
+}
+
+static constexpr std::array<uint32_t, 256>
+make_reciprocals()
+{
+	std::array<uint32_t, 256> table = {};
+	/* 16.16 fixed-point 255/a, rounded */
+	for (uint32_t a = 1; a < 256; ++a)
+		table[a] = (255u * 65536u + a / 2) / a;
+	return table;
+}
+
+static constexpr auto RECIPROCALS = make_reciprocals();
+
+/* The vector kernels have no 32-bit multiply to spare, so each reciprocal is
+ * split into its whole and fractional 16-bit halves and c * r >> 16 becomes
+ * c * whole + (c * frac >> 16). Both tables hold one pixel's worth of 16-bit
+ * lanes; the alpha lane multiplies by exactly one so alpha passes through. */
+static constexpr std::array<uint64_t, 256>
+make_reciprocal_lanes(const bool whole)
+{
+	std::array<uint64_t, 256> table = {};
+	for (uint32_t a = 0; a < 256; ++a) {
+		const uint64_t r = whole ? RECIPROCALS[a] >> 16
+					 : RECIPROCALS[a] & 0xFFFF;
+		table[a] = r | r << 16 | r << 32 | uint64_t(whole) << 48;
+	}
+	return table;
+}
+
+[[maybe_unused]] static constexpr auto RECIPROCAL_WHOLE
+    = make_reciprocal_lanes(true);
+[[maybe_unused]] static constexpr auto RECIPROCAL_FRAC
+    = make_reciprocal_lanes(false);
+
+static inline uint32_t
+unpremultiply_scalar(const uint32_t p)
+{
+	const uint32_t a = p >> 24;
+	const uint32_t recip = RECIPROCALS[a];
+	const uint32_t r = std::min(0xFFu, ((p & 0xFF) * recip) >> 16);
+	const uint32_t g = std::min(0xFFu, ((p >> 8 & 0xFF) * recip) >> 16);
+	const uint32_t b = std::min(0xFFu, ((p >> 16 & 0xFF) * recip) >> 16);
+	return a << 24 | b << 16 | g << 8 | r;
+}
+
+#if defined(EULER_PIXEL_SSE2)
+
+/* round(x / 255) on unsigned 16-bit lanes holding at most 255 * 255 */
+static inline __m128i
+div255_sse2(__m128i x)
+{
+	x = _mm_add_epi16(x, _mm_set1_epi16(128));
+	return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+}
+
+/* broadcasts each pixel's alpha across its four 16-bit lanes */
+static inline __m128i
+alpha_sse2(const __m128i x)
+{
+	const __m128i lo = _mm_shufflelo_epi16(x, _MM_SHUFFLE(3, 3, 3, 3));
+	return _mm_shufflehi_epi16(lo, _MM_SHUFFLE(3, 3, 3, 3));
+}
+
+static size_t
+fill_sse2(uint32_t *dst, const size_t count, const uint32_t value)
+{
+	const __m128i v = _mm_set1_epi32(static_cast<int>(value));
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4)
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), v);
+	return i;
+}
+
+static size_t
+blend_uniform_sse2(uint32_t *dst, const size_t count, const uint32_t value)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i src = _mm_set1_epi32(static_cast<int>(value));
+	const __m128i inv
+	    = _mm_set1_epi16(static_cast<short>(0xFF - (value >> 24)));
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		auto ptr = reinterpret_cast<__m128i *>(dst + i);
+		const __m128i d = _mm_loadu_si128(ptr);
+		const __m128i lo
+		    = _mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), inv);
+		const __m128i hi
+		    = _mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), inv);
+		const __m128i scaled
+		    = _mm_packus_epi16(div255_sse2(lo), div255_sse2(hi));
+		_mm_storeu_si128(ptr, _mm_adds_epu8(scaled, src));
+	}
+	return i;
+}
+
+static size_t
+blend_sse2(uint32_t *dst, const uint32_t *src, const size_t count)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i ones = _mm_set1_epi16(0xFF);
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		auto ptr = reinterpret_cast<__m128i *>(dst + i);
+		const __m128i d = _mm_loadu_si128(ptr);
+		const __m128i s = _mm_loadu_si128(
+		    reinterpret_cast<const __m128i *>(src + i));
+		const __m128i inv_lo = _mm_sub_epi16(ones,
+		    alpha_sse2(_mm_unpacklo_epi8(s, zero)));
+		const __m128i inv_hi = _mm_sub_epi16(ones,
+		    alpha_sse2(_mm_unpackhi_epi8(s, zero)));
+		const __m128i lo
+		    = _mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), inv_lo);
+		const __m128i hi
+		    = _mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), inv_hi);
+		const __m128i scaled
+		    = _mm_packus_epi16(div255_sse2(lo), div255_sse2(hi));
+		_mm_storeu_si128(ptr, _mm_adds_epu8(scaled, s));
+	}
+	return i;
+}
+
+/* s * a + d * (255 - a) per channel; the alpha lane uses 255 in place of a
+ * for the source term, giving a + da * (255 - a) / 255 */
+static inline __m128i
+lerp_half_sse2(const __m128i s, const __m128i d)
+{
+	const __m128i alpha_lane = _mm_set_epi16(0xFF, 0, 0, 0, 0xFF, 0, 0, 0);
+	const __m128i a = alpha_sse2(s);
+	const __m128i inv = _mm_sub_epi16(_mm_set1_epi16(0xFF), a);
+	const __m128i m = _mm_or_si128(a, alpha_lane);
+	return div255_sse2(_mm_add_epi16(_mm_mullo_epi16(s, m),
+	    _mm_mullo_epi16(d, inv)));
+}
+
+static size_t
+blend_straight_sse2(uint32_t *dst, const uint32_t *src, const size_t count)
+{
+	const __m128i zero = _mm_setzero_si128();
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		auto ptr = reinterpret_cast<__m128i *>(dst + i);
+		const __m128i d = _mm_loadu_si128(ptr);
+		const __m128i s = _mm_loadu_si128(
+		    reinterpret_cast<const __m128i *>(src + i));
+		const __m128i lo = lerp_half_sse2(_mm_unpacklo_epi8(s, zero),
+		    _mm_unpacklo_epi8(d, zero));
+		const __m128i hi = lerp_half_sse2(_mm_unpackhi_epi8(s, zero),
+		    _mm_unpackhi_epi8(d, zero));
+		_mm_storeu_si128(ptr, _mm_packus_epi16(lo, hi));
+	}
+	return i;
+}
+
+static inline __m128i
+premultiply_half_sse2(const __m128i p)
+{
+	const __m128i alpha_lane = _mm_set_epi16(0xFF, 0, 0, 0, 0xFF, 0, 0, 0);
+	const __m128i m = _mm_or_si128(alpha_sse2(p), alpha_lane);
+	return div255_sse2(_mm_mullo_epi16(p, m));
+}
+
+static size_t
+premultiply_sse2(uint32_t *dst, const size_t count)
+{
+	const __m128i zero = _mm_setzero_si128();
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		auto ptr = reinterpret_cast<__m128i *>(dst + i);
+		const __m128i p = _mm_loadu_si128(ptr);
+		const __m128i lo
+		    = premultiply_half_sse2(_mm_unpacklo_epi8(p, zero));
+		const __m128i hi
+		    = premultiply_half_sse2(_mm_unpackhi_epi8(p, zero));
+		_mm_storeu_si128(ptr, _mm_packus_epi16(lo, hi));
+	}
+	return i;
+}
+
+/* One unpacked half holds two pixels; a0 and a1 are their alphas. */
+static inline __m128i
+unpremultiply_half_sse2(const __m128i p, const uint32_t a0,
+    const uint32_t a1)
+{
+	const __m128i whole = _mm_set_epi64x(
+	    static_cast<long long>(RECIPROCAL_WHOLE[a1]),
+	    static_cast<long long>(RECIPROCAL_WHOLE[a0]));
+	const __m128i frac
+	    = _mm_set_epi64x(static_cast<long long>(RECIPROCAL_FRAC[a1]),
+		static_cast<long long>(RECIPROCAL_FRAC[a0]));
+	const __m128i x = _mm_add_epi16(_mm_mullo_epi16(p, whole),
+	    _mm_mulhi_epu16(p, frac));
+	/* unsigned min(x, 255) */
+	return _mm_sub_epi16(x, _mm_subs_epu16(x, _mm_set1_epi16(0xFF)));
+}
+
+static size_t
+unpremultiply_sse2(uint32_t *dst, const size_t count)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i opaque = _mm_set1_epi32(static_cast<int>(0xFF000000));
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		auto ptr = reinterpret_cast<__m128i *>(dst + i);
+		const __m128i p = _mm_loadu_si128(ptr);
+		const __m128i a = _mm_and_si128(p, opaque);
+		if (_mm_movemask_epi8(_mm_cmpeq_epi32(a, opaque)) == 0xFFFF)
+			continue;
+		const __m128i lo = unpremultiply_half_sse2(
+		    _mm_unpacklo_epi8(p, zero), dst[i] >> 24,
+		    dst[i + 1] >> 24);
+		const __m128i hi = unpremultiply_half_sse2(
+		    _mm_unpackhi_epi8(p, zero), dst[i + 2] >> 24,
+		    dst[i + 3] >> 24);
+		_mm_storeu_si128(ptr, _mm_packus_epi16(lo, hi));
+	}
+	return i;
+}
+
+static size_t
+swizzle_sse2(uint32_t *dst, const uint32_t *src, const size_t count)
+{
+	const __m128i mask = _mm_set1_epi32(0x00FF00FF);
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m128i p = _mm_loadu_si128(
+		    reinterpret_cast<const __m128i *>(src + i));
+		/* swap halves, then swap the bytes within each half */
+		p = _mm_shufflelo_epi16(p, _MM_SHUFFLE(2, 3, 0, 1));
+		p = _mm_shufflehi_epi16(p, _MM_SHUFFLE(2, 3, 0, 1));
+		p = _mm_or_si128(_mm_and_si128(_mm_srli_epi16(p, 8), mask),
+		    _mm_slli_epi16(_mm_and_si128(p, mask), 8));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), p);
+	}
+	return i;
+}
+
+#elif defined(EULER_PIXEL_NEON)
+
+/* round(x / 255), narrowed to bytes */
+static inline uint8x8_t
+div255_neon(const uint16x8_t x)
+{
+	return vraddhn_u16(x, vrshrq_n_u16(x, 8));
+}
+
+/* broadcasts each pixel's alpha byte across the pixel */
+static inline uint8x16_t
+alpha_neon(const uint8x16_t p)
+{
+	const uint32x4_t a = vshrq_n_u32(vreinterpretq_u32_u8(p), 24);
+	return vreinterpretq_u8_u32(vmulq_n_u32(a, 0x01010101));
+}
+
+static inline uint8x16_t
+alpha_lane_neon()
+{
+	return vreinterpretq_u8_u32(vdupq_n_u32(0xFF000000));
+}
+
+static size_t
+fill_neon(uint32_t *dst, const size_t count, const uint32_t value)
+{
+	const uint32x4_t v = vdupq_n_u32(value);
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) vst1q_u32(dst + i, v);
+	return i;
+}
+
+static size_t
+blend_uniform_neon(uint32_t *dst, const size_t count, const uint32_t value)
+{
+	const uint8x16_t src = vreinterpretq_u8_u32(vdupq_n_u32(value));
+	const uint8x8_t inv
+	    = vdup_n_u8(static_cast<uint8_t>(0xFF - (value >> 24)));
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		const uint8x16_t d = vreinterpretq_u8_u32(vld1q_u32(dst + i));
+		const uint8x8_t lo = div255_neon(vmull_u8(vget_low_u8(d), inv));
+		const uint8x8_t hi
+		    = div255_neon(vmull_u8(vget_high_u8(d), inv));
+		const uint8x16_t out = vqaddq_u8(vcombine_u8(lo, hi), src);
+		vst1q_u32(dst + i, vreinterpretq_u32_u8(out));
+	}
+	return i;
+}
+
+static size_t
+blend_neon(uint32_t *dst, const uint32_t *src, const size_t count)
+{
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		const uint8x16_t d = vreinterpretq_u8_u32(vld1q_u32(dst + i));
+		const uint8x16_t s = vreinterpretq_u8_u32(vld1q_u32(src + i));
+		const uint8x16_t inv = vmvnq_u8(alpha_neon(s));
+		const uint8x8_t lo = div255_neon(
+		    vmull_u8(vget_low_u8(d), vget_low_u8(inv)));
+		const uint8x8_t hi = div255_neon(
+		    vmull_u8(vget_high_u8(d), vget_high_u8(inv)));
+		const uint8x16_t out = vqaddq_u8(vcombine_u8(lo, hi), s);
+		vst1q_u32(dst + i, vreinterpretq_u32_u8(out));
+	}
+	return i;
+}
+
+static size_t
+blend_straight_neon(uint32_t *dst, const uint32_t *src, const size_t count)
+{
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		const uint8x16_t d = vreinterpretq_u8_u32(vld1q_u32(dst + i));
+		const uint8x16_t s = vreinterpretq_u8_u32(vld1q_u32(src + i));
+		const uint8x16_t a = alpha_neon(s);
+		const uint8x16_t inv = vmvnq_u8(a);
+		const uint8x16_t m = vorrq_u8(a, alpha_lane_neon());
+		uint16x8_t lo = vmull_u8(vget_low_u8(s), vget_low_u8(m));
+		uint16x8_t hi = vmull_u8(vget_high_u8(s), vget_high_u8(m));
+		lo = vmlal_u8(lo, vget_low_u8(d), vget_low_u8(inv));
+		hi = vmlal_u8(hi, vget_high_u8(d), vget_high_u8(inv));
+		const uint8x16_t out
+		    = vcombine_u8(div255_neon(lo), div255_neon(hi));
+		vst1q_u32(dst + i, vreinterpretq_u32_u8(out));
+	}
+	return i;
+}
+
+static size_t
+premultiply_neon(uint32_t *dst, const size_t count)
+{
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		const uint8x16_t p = vreinterpretq_u8_u32(vld1q_u32(dst + i));
+		const uint8x16_t m = vorrq_u8(alpha_neon(p), alpha_lane_neon());
+		const uint8x8_t lo = div255_neon(
+		    vmull_u8(vget_low_u8(p), vget_low_u8(m)));
+		const uint8x8_t hi = div255_neon(
+		    vmull_u8(vget_high_u8(p), vget_high_u8(m)));
+		vst1q_u32(dst + i, vreinterpretq_u32_u8(vcombine_u8(lo, hi)));
+	}
+	return i;
+}
+
+static inline uint8x8_t
+unpremultiply_half_neon(const uint8x8_t p, const uint32_t a0,
+    const uint32_t a1)
+{
+	const uint16x8_t c = vmovl_u8(p);
+	const uint16x8_t whole = vcombine_u16(vcreate_u16(RECIPROCAL_WHOLE[a0]),
+	    vcreate_u16(RECIPROCAL_WHOLE[a1]));
+	const uint16x4_t frac0 = vcreate_u16(RECIPROCAL_FRAC[a0]);
+	const uint16x4_t frac1 = vcreate_u16(RECIPROCAL_FRAC[a1]);
+	const uint16x8_t part = vcombine_u16(
+	    vshrn_n_u32(vmull_u16(vget_low_u16(c), frac0), 16),
+	    vshrn_n_u32(vmull_u16(vget_high_u16(c), frac1), 16));
+	return vqmovn_u16(vmlaq_u16(part, c, whole));
+}
+
+static size_t
+unpremultiply_neon(uint32_t *dst, const size_t count)
+{
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		const uint32x4_t v = vld1q_u32(dst + i);
+		const uint32x2_t both
+		    = vand_u32(vget_low_u32(v), vget_high_u32(v));
+		if ((vget_lane_u32(both, 0) & vget_lane_u32(both, 1))
+		    >= 0xFF000000)
+			continue;
+		const uint8x16_t p = vreinterpretq_u8_u32(v);
+		const uint8x8_t lo = unpremultiply_half_neon(vget_low_u8(p),
+		    dst[i] >> 24, dst[i + 1] >> 24);
+		const uint8x8_t hi = unpremultiply_half_neon(vget_high_u8(p),
+		    dst[i + 2] >> 24, dst[i + 3] >> 24);
+		vst1q_u32(dst + i, vreinterpretq_u32_u8(vcombine_u8(lo, hi)));
+	}
+	return i;
+}
+
+static size_t
+swizzle_neon(uint32_t *dst, const uint32_t *src, const size_t count)
+{
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		const uint8x16_t p = vreinterpretq_u8_u32(vld1q_u32(src + i));
+		vst1q_u32(dst + i, vreinterpretq_u32_u8(vrev32q_u8(p)));
+	}
+	return i;
+}
+
+#endif
+
+#if defined(EULER_PIXEL_X86_DISPATCH)
+
+static bool
+has_avx2()
+{
+	static const bool value = __builtin_cpu_supports("avx2");
+	return value;
+}
+
+static bool
+has_ssse3()
+{
+	static const bool value = __builtin_cpu_supports("ssse3");
+	return value;
+}
+
+EULER_TARGET_AVX2 static inline __m256i
+div255_avx2(__m256i x)
+{
+	x = _mm256_add_epi16(x, _mm256_set1_epi16(128));
+	return _mm256_srli_epi16(_mm256_add_epi16(x, _mm256_srli_epi16(x, 8)),
+	    8);
+}
+
+EULER_TARGET_AVX2 static inline __m256i
+alpha_avx2(const __m256i x)
+{
+	const __m256i lo = _mm256_shufflelo_epi16(x, _MM_SHUFFLE(3, 3, 3, 3));
+	return _mm256_shufflehi_epi16(lo, _MM_SHUFFLE(3, 3, 3, 3));
+}
+
+EULER_TARGET_AVX2 static size_t
+fill_avx2(uint32_t *dst, const size_t count, const uint32_t value)
+{
+	const __m256i v = _mm256_set1_epi32(static_cast<int>(value));
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8)
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), v);
+	return i;
+}
+
+EULER_TARGET_AVX2 static size_t
+blend_uniform_avx2(uint32_t *dst, const size_t count, const uint32_t value)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i src = _mm256_set1_epi32(static_cast<int>(value));
+	const __m256i inv
+	    = _mm256_set1_epi16(static_cast<short>(0xFF - (value >> 24)));
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		auto ptr = reinterpret_cast<__m256i *>(dst + i);
+		const __m256i d = _mm256_loadu_si256(ptr);
+		const __m256i lo
+		    = _mm256_mullo_epi16(_mm256_unpacklo_epi8(d, zero), inv);
+		const __m256i hi
+		    = _mm256_mullo_epi16(_mm256_unpackhi_epi8(d, zero), inv);
+		const __m256i scaled
+		    = _mm256_packus_epi16(div255_avx2(lo), div255_avx2(hi));
+		_mm256_storeu_si256(ptr, _mm256_adds_epu8(scaled, src));
+	}
+	return i;
+}
+
+EULER_TARGET_AVX2 static size_t
+blend_avx2(uint32_t *dst, const uint32_t *src, const size_t count)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i ones = _mm256_set1_epi16(0xFF);
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		auto ptr = reinterpret_cast<__m256i *>(dst + i);
+		const __m256i d = _mm256_loadu_si256(ptr);
+		const __m256i s = _mm256_loadu_si256(
+		    reinterpret_cast<const __m256i *>(src + i));
+		const __m256i inv_lo = _mm256_sub_epi16(ones,
+		    alpha_avx2(_mm256_unpacklo_epi8(s, zero)));
+		const __m256i inv_hi = _mm256_sub_epi16(ones,
+		    alpha_avx2(_mm256_unpackhi_epi8(s, zero)));
+		const __m256i lo
+		    = _mm256_mullo_epi16(_mm256_unpacklo_epi8(d, zero), inv_lo);
+		const __m256i hi
+		    = _mm256_mullo_epi16(_mm256_unpackhi_epi8(d, zero), inv_hi);
+		const __m256i scaled
+		    = _mm256_packus_epi16(div255_avx2(lo), div255_avx2(hi));
+		_mm256_storeu_si256(ptr, _mm256_adds_epu8(scaled, s));
+	}
+	return i;
+}
+
+EULER_TARGET_AVX2 static inline __m256i
+lerp_half_avx2(const __m256i s, const __m256i d)
+{
+	const __m256i alpha_lane = _mm256_set1_epi64x(0x00FF000000000000);
+	const __m256i a = alpha_avx2(s);
+	const __m256i inv = _mm256_sub_epi16(_mm256_set1_epi16(0xFF), a);
+	const __m256i m = _mm256_or_si256(a, alpha_lane);
+	return div255_avx2(_mm256_add_epi16(_mm256_mullo_epi16(s, m),
+	    _mm256_mullo_epi16(d, inv)));
+}
+
+EULER_TARGET_AVX2 static size_t
+blend_straight_avx2(uint32_t *dst, const uint32_t *src, const size_t count)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		auto ptr = reinterpret_cast<__m256i *>(dst + i);
+		const __m256i d = _mm256_loadu_si256(ptr);
+		const __m256i s = _mm256_loadu_si256(
+		    reinterpret_cast<const __m256i *>(src + i));
+		const __m256i lo = lerp_half_avx2(_mm256_unpacklo_epi8(s, zero),
+		    _mm256_unpacklo_epi8(d, zero));
+		const __m256i hi = lerp_half_avx2(_mm256_unpackhi_epi8(s, zero),
+		    _mm256_unpackhi_epi8(d, zero));
+		_mm256_storeu_si256(ptr, _mm256_packus_epi16(lo, hi));
+	}
+	return i;
+}
+
+EULER_TARGET_AVX2 static inline __m256i
+premultiply_half_avx2(const __m256i p)
+{
+	const __m256i alpha_lane = _mm256_set1_epi64x(0x00FF000000000000);
+	const __m256i m = _mm256_or_si256(alpha_avx2(p), alpha_lane);
+	return div255_avx2(_mm256_mullo_epi16(p, m));
+}
+
+EULER_TARGET_AVX2 static size_t
+premultiply_avx2(uint32_t *dst, const size_t count)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		auto ptr = reinterpret_cast<__m256i *>(dst + i);
+		const __m256i p = _mm256_loadu_si256(ptr);
+		const __m256i lo
+		    = premultiply_half_avx2(_mm256_unpacklo_epi8(p, zero));
+		const __m256i hi
+		    = premultiply_half_avx2(_mm256_unpackhi_epi8(p, zero));
+		_mm256_storeu_si256(ptr, _mm256_packus_epi16(lo, hi));
+	}
+	return i;
+}
+
+/* The unpacks work per 128-bit lane, so the low half of eight pixels holds
+ * pixels 0, 1, 4 and 5 and the high half holds 2, 3, 6 and 7. */
+EULER_TARGET_AVX2 static inline __m256i
+unpremultiply_half_avx2(const __m256i p, const uint32_t *alpha)
+{
+	const __m256i whole = _mm256_set_epi64x(
+	    static_cast<long long>(RECIPROCAL_WHOLE[alpha[5] >> 24]),
+	    static_cast<long long>(RECIPROCAL_WHOLE[alpha[4] >> 24]),
+	    static_cast<long long>(RECIPROCAL_WHOLE[alpha[1] >> 24]),
+	    static_cast<long long>(RECIPROCAL_WHOLE[alpha[0] >> 24]));
+	const __m256i frac = _mm256_set_epi64x(
+	    static_cast<long long>(RECIPROCAL_FRAC[alpha[5] >> 24]),
+	    static_cast<long long>(RECIPROCAL_FRAC[alpha[4] >> 24]),
+	    static_cast<long long>(RECIPROCAL_FRAC[alpha[1] >> 24]),
+	    static_cast<long long>(RECIPROCAL_FRAC[alpha[0] >> 24]));
+	const __m256i x = _mm256_add_epi16(_mm256_mullo_epi16(p, whole),
+	    _mm256_mulhi_epu16(p, frac));
+	return _mm256_min_epu16(x, _mm256_set1_epi16(0xFF));
+}
+
+EULER_TARGET_AVX2 static size_t
+unpremultiply_avx2(uint32_t *dst, const size_t count)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i opaque
+	    = _mm256_set1_epi32(static_cast<int>(0xFF000000));
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		auto ptr = reinterpret_cast<__m256i *>(dst + i);
+		const __m256i p = _mm256_loadu_si256(ptr);
+		const __m256i a = _mm256_and_si256(p, opaque);
+		if (_mm256_movemask_epi8(_mm256_cmpeq_epi32(a, opaque)) == -1)
+			continue;
+		const __m256i lo = unpremultiply_half_avx2(
+		    _mm256_unpacklo_epi8(p, zero), dst + i);
+		const __m256i hi = unpremultiply_half_avx2(
+		    _mm256_unpackhi_epi8(p, zero), dst + i + 2);
+		_mm256_storeu_si256(ptr, _mm256_packus_epi16(lo, hi));
+	}
+	return i;
+}
+
+EULER_TARGET_AVX2 static size_t
+swizzle_avx2(uint32_t *dst, const uint32_t *src, const size_t count)
+{
+	const __m256i mask = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10,
+	    9, 8, 15, 14, 13, 12, 3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14,
+	    13, 12);
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		const __m256i p = _mm256_loadu_si256(
+		    reinterpret_cast<const __m256i *>(src + i));
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i),
+		    _mm256_shuffle_epi8(p, mask));
+	}
+	return i;
+}
+
+EULER_TARGET_SSSE3 static size_t
+swizzle_ssse3(uint32_t *dst, const uint32_t *src, const size_t count)
+{
+	const __m128i mask = _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9,
+	    8, 15, 14, 13, 12);
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		const __m128i p = _mm_loadu_si128(
+		    reinterpret_cast<const __m128i *>(src + i));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i),
+		    _mm_shuffle_epi8(p, mask));
+	}
+	return i;
+}
+
+#endif
+
+void
+pixel::fill(uint32_t *dst, const size_t count, const uint32_t value)
+{
+	size_t i = 0;
+#if defined(EULER_PIXEL_X86_DISPATCH)
+	if (has_avx2()) i += fill_avx2(dst, count, value);
+#endif
+#if defined(EULER_PIXEL_SSE2)
+	i += fill_sse2(dst + i, count - i, value);
+#elif defined(EULER_PIXEL_NEON)
+	i += fill_neon(dst + i, count - i, value);
+#endif
+	for (; i < count; ++i) dst[i] = value;
+}
+
+void
+pixel::blend(uint32_t *dst, const size_t count, const uint32_t value)
+{
+	const uint32_t alpha = value >> 24;
+	if (alpha == 0) return;
+	if (alpha == 0xFF) {
+		fill(dst, count, value);
+		return;
+	}
+	size_t i = 0;
+#if defined(EULER_PIXEL_X86_DISPATCH)
+	if (has_avx2()) i += blend_uniform_avx2(dst, count, value);
+#endif
+#if defined(EULER_PIXEL_SSE2)
+	i += blend_uniform_sse2(dst + i, count - i, value);
+#elif defined(EULER_PIXEL_NEON)
+	i += blend_uniform_neon(dst + i, count - i, value);
+#endif
+	const uint32_t inv_a = 0xFF - alpha;
+	for (; i < count; ++i) dst[i] = blend_scalar(dst[i], value, inv_a);
+}
+
+void
+pixel::blend(uint32_t *dst, const uint32_t *src, const size_t count)
+{
+	size_t i = 0;
+#if defined(EULER_PIXEL_X86_DISPATCH)
+	if (has_avx2()) i += blend_avx2(dst, src, count);
+#endif
+#if defined(EULER_PIXEL_SSE2)
+	i += blend_sse2(dst + i, src + i, count - i);
+#elif defined(EULER_PIXEL_NEON)
+	i += blend_neon(dst + i, src + i, count - i);
+#endif
+	for (; i < count; ++i)
+		dst[i] = blend_scalar(dst[i], src[i], 0xFF - (src[i] >> 24));
+}
+
+void
+pixel::blend_straight(uint32_t *dst, const uint32_t *src, const size_t count)
+{
+	size_t i = 0;
+#if defined(EULER_PIXEL_X86_DISPATCH)
+	if (has_avx2()) i += blend_straight_avx2(dst, src, count);
+#endif
+#if defined(EULER_PIXEL_SSE2)
+	i += blend_straight_sse2(dst + i, src + i, count - i);
+#elif defined(EULER_PIXEL_NEON)
+	i += blend_straight_neon(dst + i, src + i, count - i);
+#endif
+	for (; i < count; ++i) dst[i] = blend_straight_scalar(dst[i], src[i]);
+}
+
+void
+pixel::premultiply(uint32_t *dst, const size_t count)
+{
+	size_t i = 0;
+#if defined(EULER_PIXEL_X86_DISPATCH)
+	if (has_avx2()) i += premultiply_avx2(dst, count);
+#endif
+#if defined(EULER_PIXEL_SSE2)
+	i += premultiply_sse2(dst + i, count - i);
+#elif defined(EULER_PIXEL_NEON)
+	i += premultiply_neon(dst + i, count - i);
+#endif
+	for (; i < count; ++i) dst[i] = premultiply_scalar(dst[i]);
+}
+
+void
+pixel::unpremultiply(uint32_t *dst, const size_t count)
+{
+	size_t i = 0;
+#if defined(EULER_PIXEL_X86_DISPATCH)
+	if (has_avx2()) i += unpremultiply_avx2(dst, count);
+#endif
+#if defined(EULER_PIXEL_SSE2)
+	i += unpremultiply_sse2(dst + i, count - i);
+#elif defined(EULER_PIXEL_NEON)
+	i += unpremultiply_neon(dst + i, count - i);
+#endif
+	for (; i < count; ++i) dst[i] = unpremultiply_scalar(dst[i]);
+}
+
+void
+pixel::swizzle(uint32_t *dst, const uint32_t *src, const size_t count)
+{
+	size_t i = 0;
+#if defined(EULER_PIXEL_X86_DISPATCH)
+	if (has_avx2()) i += swizzle_avx2(dst, src, count);
+	if (has_ssse3()) i += swizzle_ssse3(dst + i, src + i, count - i);
+#endif
+#if defined(EULER_PIXEL_SSE2)
+	i += swizzle_sse2(dst + i, src + i, count - i);
+#elif defined(EULER_PIXEL_NEON)
+	i += swizzle_neon(dst + i, src + i, count - i);
+#endif
+	for (; i < count; ++i) dst[i] = std::byteswap(src[i]);
+}
@@ -0,0 +1,77 @@
+/* SPDX-License-Identifier: ISC */
+
+#ifndef EULER_UTIL_PIXEL_H
+#define EULER_UTIL_PIXEL_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "euler/util/color.h"
+
+/* Span kernels for packed 32-bit pixel buffers. Pixels are stored as
+ * 0xAABBGGRR words, which is RGBA in memory order on little-endian hosts and
+ * the layout DragonRuby expects from drb_upload_pixel_array. */
+
+namespace euler::util::pixel {
+
+[[nodiscard]] inline uint32_t
+pack(const Color color)
+{
+	return static_cast<uint32_t>(color.alpha()) << 24
+	    | static_cast<uint32_t>(color.blue()) << 16
+	    | static_cast<uint32_t>(color.green()) << 8
+	    | static_cast<uint32_t>(color.red());
+}
+
+[[nodiscard]] constexpr Color
+unpack(const uint32_t value)
+{
+	return Color(value & 0xFF, value >> 8 & 0xFF, value >> 16 & 0xFF,
+	    value >> 24 & 0xFF);
+}
+
+/* Exact round(x / 255) for x in [0, 255 * 255] */
+[[nodiscard]] constexpr uint32_t
+div255(const uint32_t x)
+{
+	return (x + 128 + ((x + 128) >> 8)) >> 8;
+}
+
+/* Packs a color with its channels scaled by alpha. Blending is done in
+ * premultiplied space so that drawing onto a transparent buffer composites
+ * correctly once the buffer is converted back with unpremultiply(). */
+[[nodiscard]] inline uint32_t
+premultiply(const Color color)
+{
+	const uint32_t a = color.alpha();
+	return a << 24 | div255(color.blue() * a) << 16
+	    | div255(color.green() * a) << 8 | div255(color.red() * a);
+}
+
+/* Overwrites count pixels with value. */
+void fill(uint32_t *dst, size_t count, uint32_t value);
+
+/* Composites a premultiplied value over count premultiplied pixels. */
+void blend(uint32_t *dst, size_t count, uint32_t value);
+
+/* Composites count premultiplied src pixels over premultiplied dst. */
+void blend(uint32_t *dst, const uint32_t *src, size_t count);
+
+/* Source-over for straight-alpha buffers: each colour channel is
+ * interpolated towards src by its alpha, and the alpha channels combine as
+ * a + da * (1 - a). */
+void blend_straight(uint32_t *dst, const uint32_t *src, size_t count);
+
+/* Converts count straight-alpha pixels to premultiplied alpha in place. */
+void premultiply(uint32_t *dst, size_t count);
+
+/* Converts count premultiplied pixels back to straight alpha in place. */
+void unpremultiply(uint32_t *dst, size_t count);
+
+/* Reverses the byte order of each pixel (RGBA <-> ABGR). dst may equal
+ * src. */
+void swizzle(uint32_t *dst, const uint32_t *src, size_t count);
+
+} /* namespace euler::util::pixel */
+
+#endif /* EULER_UTIL_PIXEL_H */
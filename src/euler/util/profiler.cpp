@@ -0,0 +1,399 @@
+/* SPDX-License-Identifier: ISC */
+
+#include "euler/util/profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <format>
+
+#include "euler/util/state.h"
+
+using euler::util::Profiler;
+
+Profiler::~Profiler() = default;
+
+Profiler &
+Profiler::get()
+{
+	/* never destroyed, since pool threads may still be recording while
+	 * statics are torn down */
+	static auto *profiler = new Profiler();
+	return *profiler;
+}
+
+uint64_t
+Profiler::now()
+{
+	const auto time = std::chrono::steady_clock::now().time_since_epoch();
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(time)
+	    .count();
+}
+
+Profiler::ThreadBuffer &
+Profiler::thread_buffer()
+{
+	thread_local ThreadBuffer *buffer = nullptr;
+	if (buffer != nullptr) return *buffer;
+	auto &profiler = get();
+	std::scoped_lock lock(profiler._threads_mutex);
+	auto &owned = profiler._threads.emplace_back(
+	    std::make_unique<ThreadBuffer>());
+	owned->id = static_cast<uint32_t>(profiler._threads.size() - 1);
+	buffer = owned.get();
+	return *buffer;
+}
+
+void
+Profiler::record(ThreadBuffer &buffer, const Record &record)
+{
+	const size_t head = buffer.head.load(std::memory_order_relaxed);
+	const size_t tail = buffer.tail.load(std::memory_order_acquire);
+	if (head - tail >= ThreadBuffer::CAPACITY) {
+		buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+	buffer.records[head % ThreadBuffer::CAPACITY] = record;
+	buffer.head.store(head + 1, std::memory_order_release);
+}
+
+uint64_t
+Profiler::begin_zone()
+{
+	++thread_buffer().depth;
+	return now();
+}
+
+void
+Profiler::end_zone(const char *name, const uint64_t start)
+{
+	const uint64_t end = now();
+	auto &buffer = thread_buffer();
+	--buffer.depth;
+	record(buffer, { name, start, end, buffer.depth });
+}
+
+void
+Profiler::begin(const char *name)
+{
+	if (!enabled()) return;
+	auto &buffer = thread_buffer();
+	if (buffer.open_count == ThreadBuffer::MAX_OPEN) {
+		++buffer.overflow;
+		buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+	buffer.open[buffer.open_count++] = { name, begin_zone(), 0, 0 };
+}
+
+void
+Profiler::end()
+{
+	auto &buffer = thread_buffer();
+	/* matches a begin that found the stack full */
+	if (buffer.overflow > 0) {
+		--buffer.overflow;
+		return;
+	}
+	/* nothing open if profiling was enabled inside the zone */
+	if (buffer.open_count == 0) return;
+	const auto &open = buffer.open[--buffer.open_count];
+	end_zone(open.name, open.start);
+}
+
+void
+Profiler::end_frame()
+{
+	std::vector<ThreadBuffer *> threads;
+	{
+		std::scoped_lock lock(_threads_mutex);
+		threads.reserve(_threads.size());
+		for (const auto &buffer : _threads)
+			threads.push_back(buffer.get());
+	}
+	const size_t slot = _frame % WINDOW;
+	for (auto &[name, entry] : _entries) {
+		entry.nanoseconds[slot] = 0;
+		entry.calls[slot] = 0;
+	}
+	for (auto *buffer : threads) {
+		const size_t tail
+		    = buffer->tail.load(std::memory_order_relaxed);
+		const size_t head
+		    = buffer->head.load(std::memory_order_acquire);
+		for (size_t i = tail; i != head; ++i) {
+			const auto &record
+			    = buffer->records[i % ThreadBuffer::CAPACITY];
+			auto &entry = _entries[record.name];
+			entry.nanoseconds[slot] += record.end - record.start;
+			++entry.calls[slot];
+			entry.depth = std::min(entry.depth, record.depth);
+			if (!_capturing || _captured.size() >= _max_captured)
+				continue;
+			_captured.push_back({
+			    record.name,
+			    record.start,
+			    record.end,
+			    buffer->id,
+			});
+		}
+		buffer->tail.store(head, std::memory_order_release);
+		_dropped += buffer->dropped.exchange(0,
+		    std::memory_order_relaxed);
+	}
+	++_frame;
+}
+
+std::vector<Profiler::Summary>
+Profiler::summary() const
+{
+	std::vector<Summary> out;
+	const size_t frames = std::min<uint64_t>(_frame, WINDOW);
+	if (frames == 0) return out;
+	out.reserve(_entries.size());
+	for (const auto &[name, entry] : _entries) {
+		uint64_t total = 0;
+		uint64_t max = 0;
+		uint64_t calls = 0;
+		for (size_t i = 0; i < frames; ++i) {
+			total += entry.nanoseconds[i];
+			max = std::max(max, entry.nanoseconds[i]);
+			calls += entry.calls[i];
+		}
+		if (calls == 0) continue;
+		out.push_back({
+		    .name = name,
+		    .depth = entry.depth,
+		    .mean_ms = static_cast<double>(total) / 1e6
+			/ static_cast<double>(frames),
+		    .max_ms = static_cast<double>(max) / 1e6,
+		    .calls = static_cast<double>(calls)
+			/ static_cast<double>(frames),
+		});
+	}
+	std::ranges::sort(out, [](const Summary &a, const Summary &b) {
+		return a.mean_ms > b.mean_ms;
+	});
+	return out;
+}
+
+void
+Profiler::start_capture(const size_t max_zones)
+{
+	_captured.clear();
+	_max_captured = max_zones;
+	_capturing = true;
+}
+
+void
+Profiler::stop_capture()
+{
+	_capturing = false;
+}
+
+static void
+append_json_string(std::string &out, const std::string_view str)
+{
+	out.push_back('"');
+	for (const char c : str) {
+		switch (c) {
+		case '"':
+			out.append("\\\"");
+			break;
+		case '\\':
+			out.append("\\\\");
+			break;
+		case '\n':
+			out.append("\\n");
+			break;
+		default:
+			if (static_cast<unsigned char>(c) < 0x20)
+				out.append(std::format("\\u{:04x}", c));
+			else
+				out.push_back(c);
+		}
+	}
+	out.push_back('"');
+}
+
+std::string
+Profiler::trace_json() const
+{
+	std::string out = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	const uint64_t base = _captured.empty() ? 0 : _captured.front().start;
+	bool first = true;
+	for (const auto &zone : _captured) {
+		if (!first) out.push_back(',');
+		first = false;
+		out.append("{\"name\":");
+		append_json_string(out, zone.name);
+		/* timestamps are in microseconds; zones on other threads can
+		 * start before the first one drained */
+		const auto offset = static_cast<int64_t>(zone.start - base);
+		const double ts = static_cast<double>(offset) / 1e3;
+		const double dur = static_cast<double>(zone.end - zone.start)
+		    / 1e3;
+		out.append(std::format(
+		    ",\"cat\":\"euler\",\"ph\":\"X\",\"pid\":0,\"tid\":{},"
+		    "\"ts\":{:.3f},\"dur\":{:.3f}}}",
+		    zone.thread, ts, dur));
+	}
+	out.append("]}");
+	return out;
+}
+
+bool
+Profiler::write_trace(const char *path) const
+{
+	FILE *file = std::fopen(path, "wb");
+	if (file == nullptr) return false;
+	const auto json = trace_json();
+	const bool ok = std::fwrite(json.data(), 1, json.size(), file)
+	    == json.size();
+	return std::fclose(file) == 0 && ok;
+}
+
+const char *
+Profiler::intern(const std::string_view name)
+{
+	if (const auto it = _names.find(name); it != _names.end())
+		return it->c_str();
+	return _names.emplace(name).first->c_str();
+}
+
+static mrb_value
+profiler_enabled(mrb_state *, mrb_value)
+{
+	return mrb_bool_value(Profiler::enabled());
+}
+
+static mrb_value
+profiler_set_enabled(mrb_state *mrb, mrb_value)
+{
+	const auto state = euler::util::State::get(mrb);
+	mrb_bool enabled;
+	state->mrb()->get_args("b", &enabled);
+	Profiler::set_enabled(enabled);
+	return mrb_bool_value(enabled);
+}
+
+static mrb_value
+profiler_zone_body(mrb_state *mrb, const mrb_value block)
+{
+	return euler::util::State::get(mrb)->mrb()->yield_argv(block, 0,
+	    nullptr);
+}
+
+static mrb_value
+profiler_zone_ensure(mrb_state *, mrb_value)
+{
+	Profiler::end();
+	return mrb_nil_value();
+}
+
+/**
+ * @overload Euler::Util::Profiler.zone(name, &block)
+ *   Times the block as a zone called name.
+ *   @return The value of the block.
+ */
+static mrb_value
+profiler_zone(mrb_state *mrb, mrb_value)
+{
+	const auto state = euler::util::State::get(mrb);
+	const char *name;
+	mrb_value block;
+	state->mrb()->get_args("z&!", &name, &block);
+	if (!Profiler::enabled())
+		return state->mrb()->yield_argv(block, 0, nullptr);
+	Profiler::begin(Profiler::get().intern(name));
+	return state->mrb()->ensure(profiler_zone_body, block,
+	    profiler_zone_ensure, mrb_nil_value());
+}
+
+static mrb_value
+profiler_summary(mrb_state *mrb, mrb_value)
+{
+	const auto &ruby = euler::util::State::get(mrb)->mrb();
+	const auto summary = Profiler::get().summary();
+	const auto ary
+	    = ruby->ary_new_capa(static_cast<mrb_int>(summary.size()));
+	for (const auto &zone : summary) {
+		const auto hash = ruby->hash_new_capa(5);
+		ruby->hash_set(hash, "name",
+		    ruby->str_new(zone.name.data(), zone.name.size()));
+		ruby->hash_set(hash, "depth", ruby->int_value(zone.depth));
+		ruby->hash_set(hash, "mean_ms",
+		    ruby->float_value(zone.mean_ms));
+		ruby->hash_set(hash, "max_ms", ruby->float_value(zone.max_ms));
+		ruby->hash_set(hash, "calls", ruby->float_value(zone.calls));
+		ruby->ary_push(ary, hash);
+	}
+	return ary;
+}
+
+static mrb_value
+profiler_start_capture(mrb_state *mrb, mrb_value)
+{
+	const auto state = euler::util::State::get(mrb);
+	mrb_int max_zones = 1 << 20;
+	state->mrb()->get_args("|i", &max_zones);
+	Profiler::get().start_capture(
+	    static_cast<size_t>(std::max<mrb_int>(max_zones, 0)));
+	return mrb_nil_value();
+}
+
+static mrb_value
+profiler_stop_capture(mrb_state *, mrb_value)
+{
+	Profiler::get().stop_capture();
+	return mrb_nil_value();
+}
+
+static mrb_value
+profiler_trace(mrb_state *mrb, mrb_value)
+{
+	const auto state = euler::util::State::get(mrb);
+	const auto json = Profiler::get().trace_json();
+	return state->mrb()->str_new(json.data(), json.size());
+}
+
+/**
+ * @overload Euler::Util::Profiler.write_trace(path)
+ *   Writes the captured zones as Chrome trace JSON, which chrome://tracing
+ *   and Perfetto both open.
+ *   @return [Boolean] Whether the file was written.
+ */
+static mrb_value
+profiler_write_trace(mrb_state *mrb, mrb_value)
+{
+	const auto state = euler::util::State::get(mrb);
+	const char *path;
+	state->mrb()->get_args("z", &path);
+	return mrb_bool_value(Profiler::get().write_trace(path));
+}
+
+RClass *
+Profiler::init(const Reference<State> &state, RClass *mod, RClass *)
+{
+	const auto &ruby = state->mrb();
+	const auto cls
+	    = ruby->define_class_under(mod, "Profiler", state->object_class());
+	MRB_SET_INSTANCE_TT(cls, MRB_TT_DATA);
+	ruby->define_class_method(cls, "enabled?", profiler_enabled,
+	    MRB_ARGS_NONE());
+	ruby->define_class_method(cls, "enabled=", profiler_set_enabled,
+	    MRB_ARGS_REQ(1));
+	ruby->define_class_method(cls, "zone", profiler_zone,
+	    MRB_ARGS_REQ(1) | MRB_ARGS_BLOCK());
+	ruby->define_class_method(cls, "summary", profiler_summary,
+	    MRB_ARGS_NONE());
+	ruby->define_class_method(cls, "start_capture", profiler_start_capture,
+	    MRB_ARGS_OPT(1));
+	ruby->define_class_method(cls, "stop_capture", profiler_stop_capture,
+	    MRB_ARGS_NONE());
+	ruby->define_class_method(cls, "trace", profiler_trace,
+	    MRB_ARGS_NONE());
+	ruby->define_class_method(cls, "write_trace", profiler_write_trace,
+	    MRB_ARGS_REQ(1));
+	return cls;
+}
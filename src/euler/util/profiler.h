@@ -0,0 +1,177 @@
+/* SPDX-License-Identifier: ISC */
+
+#ifndef EULER_UTIL_PROFILER_H
+#define EULER_UTIL_PROFILER_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "euler/util/ext.h"
+#include "euler/util/object.h"
+
+namespace euler::util {
+
+/* Hierarchical frame profiler. Zones are timed into a buffer owned by the
+ * thread that ran them, which only that thread writes and only end_frame()
+ * reads, so recording takes no locks. end_frame() runs on the main thread
+ * once per tick: it folds the frame into a rolling per-zone summary and, while
+ * a capture is running, keeps the raw zones for a Chrome trace (which Perfetto
+ * also reads).
+ *
+ * Zone names must outlive the profiler: string literals, or names passed
+ * through intern(). Recording is skipped entirely while disabled. */
+class Profiler final : public Object {
+	BIND_MRUBY("Euler::Util::Profiler", Profiler, util.profiler);
+
+public:
+	/* frames the summary averages over */
+	static constexpr size_t WINDOW = 120;
+
+	struct Summary {
+		std::string_view name;
+		/* nesting depth the zone was seen at, 0 for outermost */
+		uint32_t depth;
+		double mean_ms;
+		double max_ms;
+		double calls;
+	};
+
+	class Zone {
+	public:
+		explicit Zone(const char *name)
+		    : _name(enabled() ? name : nullptr)
+		{
+			if (_name != nullptr) _start = begin_zone();
+		}
+		~Zone()
+		{
+			if (_name != nullptr) end_zone(_name, _start);
+		}
+		Zone(const Zone &) = delete;
+		Zone &operator=(const Zone &) = delete;
+
+	private:
+		const char *_name;
+		uint64_t _start = 0;
+	};
+
+	Profiler() = default;
+	~Profiler() override;
+
+	/* the process-wide profiler every zone records into */
+	static Profiler &get();
+
+	[[nodiscard]] static bool
+	enabled()
+	{
+		return _enabled.load(std::memory_order_relaxed);
+	}
+	static void
+	set_enabled(const bool enabled)
+	{
+		_enabled.store(enabled, std::memory_order_relaxed);
+	}
+	/* nanoseconds on a monotonic clock */
+	[[nodiscard]] static uint64_t now();
+
+	/* Unscoped form, for callers that can't hold a Zone across the
+	 * region (Ruby blocks). Each begin must be matched by an end on the
+	 * same thread. */
+	static void begin(const char *name);
+	static void end();
+
+	/* Main thread only. */
+	void end_frame();
+	[[nodiscard]] std::vector<Summary> summary() const;
+	void start_capture(size_t max_zones = 1 << 20);
+	void stop_capture();
+	[[nodiscard]] bool
+	is_capturing() const
+	{
+		return _capturing;
+	}
+	/* Chrome trace event JSON for the zones captured so far. */
+	[[nodiscard]] std::string trace_json() const;
+	bool write_trace(const char *path) const;
+	/* Returns a copy of name that lives as long as the profiler. */
+	const char *intern(std::string_view name);
+
+private:
+	struct Record {
+		const char *name;
+		uint64_t start;
+		uint64_t end;
+		uint32_t depth;
+	};
+
+	struct ThreadBuffer {
+		static constexpr size_t CAPACITY = 4096;
+		static constexpr size_t MAX_OPEN = 64;
+		std::array<Record, CAPACITY> records;
+		/* written by the owner, read by end_frame */
+		std::atomic<size_t> head = 0;
+		/* written by end_frame, read by the owner */
+		std::atomic<size_t> tail = 0;
+		std::atomic<size_t> dropped = 0;
+		uint32_t id = 0;
+		/* owner only */
+		uint32_t depth = 0;
+		std::array<Record, MAX_OPEN> open;
+		size_t open_count = 0;
+		/* begins past MAX_OPEN, whose ends must not pop open */
+		size_t overflow = 0;
+	};
+
+	struct Entry {
+		std::array<uint64_t, WINDOW> nanoseconds {};
+		std::array<uint32_t, WINDOW> calls {};
+		uint32_t depth = UINT32_MAX;
+	};
+
+	struct Captured {
+		const char *name;
+		uint64_t start;
+		uint64_t end;
+		uint32_t thread;
+	};
+
+	static ThreadBuffer &thread_buffer();
+	static uint64_t begin_zone();
+	static void end_zone(const char *name, uint64_t start);
+	static void record(ThreadBuffer &buffer, const Record &record);
+
+	static inline std::atomic<bool> _enabled = false;
+
+	std::mutex _threads_mutex;
+	std::vector<std::unique_ptr<ThreadBuffer>> _threads;
+	std::unordered_map<std::string_view, Entry> _entries;
+	/* transparent, so interning a name that is already known does not
+	 * allocate */
+	struct NameHash {
+		using is_transparent = void;
+		size_t
+		operator()(const std::string_view name) const
+		{
+			return std::hash<std::string_view> {}(name);
+		}
+	};
+	std::unordered_set<std::string, NameHash, std::equal_to<>> _names;
+	std::vector<Captured> _captured;
+	size_t _max_captured = 0;
+	uint64_t _frame = 0;
+	uint64_t _dropped = 0;
+	bool _capturing = false;
+};
+
+} /* namespace euler::util */
+
+#endif /* EULER_UTIL_PROFILER_H */
@@ -5,6 +5,7 @@
 
 #include <thread>
 
+#include "euler/util/frame_arena.h"
 #include "euler/util/object.h"
 #include "euler/util/ruby_state.h"
 
@@ -22,6 +23,7 @@ class Target;
 
 namespace euler::util {
 class ImageLoader;
+class Jobs;
 class Error;
 class Logger;
 class Storage;
@@ -153,12 +155,22 @@ public:
 			RClass *mod = nullptr;
 			RClass *nonscalar = nullptr;
 			RClass *cube = nullptr;
+			RClass *cube_view = nullptr;
+			RClass *expression = nullptr;
+			RClass *mask = nullptr;
+			RClass *mat2 = nullptr;
+			RClass *mat3 = nullptr;
+			RClass *mat4 = nullptr;
 			RClass *matrix = nullptr;
+			RClass *random = nullptr;
 			RClass *row_vector = nullptr;
 			RClass *running_stat = nullptr;
 			RClass *sparse_matrix = nullptr;
 			RClass *sparse_solve_factorizer = nullptr;
 			RClass *size = nullptr;
+			RClass *vec2 = nullptr;
+			RClass *vec3 = nullptr;
+			RClass *vec4 = nullptr;
 			RClass *vector = nullptr;
 		} math;
 #endif
@@ -191,7 +203,20 @@ public:
 			RClass *color = nullptr;
 			RClass *version = nullptr;
 			RClass *logger = nullptr;
+			RClass *image = nullptr;
+			RClass *pending_image = nullptr;
+			RClass *jobs = nullptr;
+			RClass *job = nullptr;
+			RClass *profiler = nullptr;
 		} util;
+
+#ifdef EULER_NATIVE
+		struct {
+			RClass *mod = nullptr;
+			RClass *sprite_batch = nullptr;
+			RClass *texture = nullptr;
+		} vulkan;
+#endif
 	};
 
 #ifdef EULER_GUI
@@ -215,6 +240,14 @@ public:
 	[[nodiscard]] virtual mrb_value gv_state() const = 0;
 	[[nodiscard]] static Reference<State> get(const mrb_state *mrb);
 	[[nodiscard]] virtual Reference<ImageLoader> image_loader() = 0;
+	[[nodiscard]] virtual Reference<Jobs> jobs() = 0;
+	/* scratch memory for the current frame, reset at the start of each
+	 * tick */
+	[[nodiscard]] FrameArena &
+	frame_arena()
+	{
+		return _frame_arena;
+	}
 
 	[[nodiscard]] virtual Reference<Window> window() = 0;
 
@@ -260,6 +293,9 @@ public:
 
 protected:
 	virtual const mrb_data_type *data_type() const = 0;
+
+private:
+	FrameArena _frame_arena;
 };
 
 #define EULER_SYM_LIT(LIT)                                                     \
@@ -0,0 +1,138 @@
+/* SPDX-License-Identifier: ISC */
+
+#include "euler/util/text_layout.h"
+
+#include <algorithm>
+#include <bit>
+#include <functional>
+
+using euler::util::TextLayoutCache;
+
+TextLayoutCache::TextLayoutCache(const uint64_t max_age)
+    : _max_age(std::max<uint64_t>(max_age, 1))
+{
+}
+
+size_t
+TextLayoutCache::KeyHash::operator()(const KeyView &key) const
+{
+	size_t hash = std::hash<std::string_view> {}(key.text);
+	hash ^= std::hash<const void *> {}(key.font) + 0x9e3779b97f4a7c15ull
+	    + (hash << 6) + (hash >> 2);
+	hash ^= std::bit_cast<uint32_t>(key.size) + 0x9e3779b97f4a7c15ull
+	    + (hash << 6) + (hash >> 2);
+	return hash;
+}
+
+/* Decodes one UTF-8 sequence, replacing malformed input with U+FFFD. */
+static char32_t
+next_codepoint(const std::string_view text, size_t &i)
+{
+	const auto lead = static_cast<unsigned char>(text[i++]);
+	if (lead < 0x80) return lead;
+	int extra;
+	char32_t cp;
+	if ((lead & 0xE0) == 0xC0) {
+		extra = 1;
+		cp = lead & 0x1F;
+	} else if ((lead & 0xF0) == 0xE0) {
+		extra = 2;
+		cp = lead & 0x0F;
+	} else if ((lead & 0xF8) == 0xF0) {
+		extra = 3;
+		cp = lead & 0x07;
+	} else {
+		return 0xFFFD;
+	}
+	for (; extra > 0; --extra) {
+		if (i >= text.size()) return 0xFFFD;
+		const auto next = static_cast<unsigned char>(text[i]);
+		if ((next & 0xC0) != 0x80) return 0xFFFD;
+		cp = cp << 6 | (next & 0x3F);
+		++i;
+	}
+	return cp;
+}
+
+void
+TextLayoutCache::build(Layout &out, const Font &font, const float size,
+    const std::string_view text)
+{
+	const float line = font.line_height();
+	const float scale = line > 0.0f ? size / line : 1.0f;
+	float x = 0.0f;
+	float y = 0.0f;
+	out.quads.reserve(text.size());
+	for (size_t i = 0; i < text.size();) {
+		const char32_t cp = next_codepoint(text, i);
+		if (cp == '\n') {
+			out.width = std::max(out.width, x);
+			x = 0.0f;
+			y += size;
+			continue;
+		}
+		const auto glyph = font.glyph(cp);
+		if (glyph == nullptr) continue;
+		/* spaces only move the pen */
+		if (cp != ' ') {
+			out.quads.push_back(Quad {
+			    .x = x,
+			    .y = y,
+			    .w = glyph->w * scale,
+			    .h = glyph->h * scale,
+			    .source_x = glyph->x,
+			    .source_y = glyph->y,
+			    .source_w = glyph->w,
+			    .source_h = glyph->h,
+			});
+		}
+		x += glyph->advance * scale;
+	}
+	out.width = std::max(out.width, x);
+	out.height = text.empty() ? 0.0f : y + size;
+}
+
+const TextLayoutCache::Layout &
+TextLayoutCache::layout(const Font &font, const float size,
+    const std::string_view text)
+{
+	const KeyView probe { &font, size, text };
+	if (const auto it = _entries.find(probe); it != _entries.end()) {
+		++_hits;
+		it->second.last_used = _frame;
+		return it->second.layout;
+	}
+	++_misses;
+	auto [it, _] = _entries.emplace(Key { &font, size, std::string(text) },
+	    Entry {});
+	it->second.last_used = _frame;
+	build(it->second.layout, font, size, text);
+	return it->second.layout;
+}
+
+void
+TextLayoutCache::next_frame()
+{
+	++_frame;
+	/* sweeping is linear in the entry count, so only do it periodically */
+	if (_frame % _max_age != 0) return;
+	std::erase_if(_entries, [this](const auto &pair) {
+		return _frame - pair.second.last_used > _max_age;
+	});
+}
+
+void
+TextLayoutCache::clear()
+{
+	_entries.clear();
+}
+
+TextLayoutCache::Stats
+TextLayoutCache::stats() const
+{
+	return Stats {
+		.hits = _hits,
+		.misses = _misses,
+		.entries = _entries.size(),
+	};
+}
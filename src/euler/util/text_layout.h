@@ -0,0 +1,126 @@
+/* SPDX-License-Identifier: ISC */
+
+#ifndef EULER_UTIL_TEXT_LAYOUT_H
+#define EULER_UTIL_TEXT_LAYOUT_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "euler/util/font.h"
+
+namespace euler::util {
+
+/* Caches laid out text keyed by (font, size, string), so text that does not
+ * change between frames is laid out once and then costs a single lookup.
+ * Entries unused for max_age frames are dropped by next_frame(); returned
+ * references stay valid until then. Fonts are keyed by address, so clear()
+ * the cache before reusing a font's storage for a different font. */
+class TextLayoutCache {
+public:
+	/* A positioned glyph: dest is relative to the text's top left corner,
+	 * source is the glyph's rect on the font sheet. */
+	struct Quad {
+		float x;
+		float y;
+		float w;
+		float h;
+		float source_x;
+		float source_y;
+		float source_w;
+		float source_h;
+	};
+
+	struct Layout {
+		std::vector<Quad> quads;
+		float width = 0.0f;
+		float height = 0.0f;
+	};
+
+	struct Stats {
+		uint64_t hits = 0;
+		uint64_t misses = 0;
+		size_t entries = 0;
+	};
+
+	static constexpr uint64_t DEFAULT_MAX_AGE = 120;
+
+	explicit TextLayoutCache(uint64_t max_age = DEFAULT_MAX_AGE);
+
+	/* Lays out UTF-8 text at size pixels per line; '\n' starts a new
+	 * line. */
+	const Layout &layout(const Font &font, float size,
+	    std::string_view text);
+
+	void next_frame();
+	void clear();
+	[[nodiscard]] Stats stats() const;
+
+private:
+	struct KeyView {
+		const Font *font;
+		float size;
+		std::string_view text;
+	};
+
+	struct Key {
+		const Font *font;
+		float size;
+		std::string text;
+	};
+
+	/* transparent, so lookups with a KeyView do not allocate */
+	struct KeyHash {
+		using is_transparent = void;
+		size_t operator()(const KeyView &key) const;
+		size_t
+		operator()(const Key &key) const
+		{
+			return (*this)(
+			    KeyView { key.font, key.size, key.text });
+		}
+	};
+
+	struct KeyEqual {
+		using is_transparent = void;
+		static KeyView
+		view(const Key &key)
+		{
+			return { key.font, key.size, key.text };
+		}
+		static KeyView
+		view(const KeyView &key)
+		{
+			return key;
+		}
+		template <typename A, typename B>
+		bool
+		operator()(const A &a, const B &b) const
+		{
+			const auto x = view(a);
+			const auto y = view(b);
+			return x.font == y.font && x.size == y.size
+			    && x.text == y.text;
+		}
+	};
+
+	struct Entry {
+		Layout layout;
+		uint64_t last_used = 0;
+	};
+
+	static void build(Layout &out, const Font &font, float size,
+	    std::string_view text);
+
+	std::unordered_map<Key, Entry, KeyHash, KeyEqual> _entries;
+	uint64_t _frame = 0;
+	uint64_t _max_age;
+	uint64_t _hits = 0;
+	uint64_t _misses = 0;
+};
+
+} /* namespace euler::util */
+
+#endif /* EULER_UTIL_TEXT_LAYOUT_H */
@@ -0,0 +1,140 @@
+/* SPDX-License-Identifier: ISC */
+
+#include "euler/vulkan/cull_stage.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+using euler::vulkan::CullStage;
+using euler::vulkan::SpatialGrid;
+
+CullStage::CullStage(const float cell_size)
+    : _grid(cell_size)
+{
+}
+
+CullStage::Id
+CullStage::add(const util::Reference<Texture> &texture,
+    const Texture::Frame &frame, const int16_t layer)
+{
+	const Id id = _grid.insert(frame_bounds(texture.get(), frame));
+	if (id >= _sprites.size()) _sprites.resize(id + 1);
+	_sprites[id] = Sprite {
+		.texture = texture,
+		.frame = frame,
+		.layer = layer,
+	};
+	return id;
+}
+
+void
+CullStage::update(const Id id, const Texture::Frame &frame)
+{
+	if (!_grid.contains(id)) return;
+	auto &sprite = _sprites[id];
+	sprite.frame = frame;
+	_grid.update(id, frame_bounds(sprite.texture.get(), frame));
+}
+
+void
+CullStage::remove(const Id id)
+{
+	if (!_grid.contains(id)) return;
+	_grid.remove(id);
+	_sprites[id] = Sprite {};
+}
+
+void
+CullStage::clear()
+{
+	_grid.clear();
+	_sprites.clear();
+}
+
+void
+CullStage::submit(SpriteBatch &batch,
+    const std::span<const util::Reference<Camera>> cameras)
+{
+	_stats = Stats { .registered = _grid.size() };
+	for (const auto &camera : cameras) {
+		if (camera == nullptr) continue;
+		const auto state = camera->state();
+		if (state == Camera::CameraState::Disabled
+		    || state == Camera::CameraState::Deleted)
+			continue;
+		++_stats.cameras;
+		_visible.clear();
+		_grid.query(view_quad(camera->spec()), _visible);
+		for (const Id id : _visible) {
+			const auto &sprite = _sprites[id];
+			if (sprite.texture == nullptr) continue;
+			batch.draw(sprite.texture, sprite.frame,
+			    camera->index(), sprite.layer);
+			++_stats.submitted;
+		}
+		_stats.culled += _stats.registered - _visible.size();
+	}
+}
+
+SpatialGrid::Quad
+CullStage::view_quad(const Camera::Spec &spec)
+{
+	const float zoom = spec.zoom > 0.0f ? spec.zoom : 1.0f;
+	const float cx = spec.x + spec.w / 2.0f;
+	const float cy = spec.y + spec.h / 2.0f;
+	const float hw = spec.w / (2.0f * zoom);
+	const float hh = spec.h / (2.0f * zoom);
+	const float c = std::cos(spec.rotation);
+	const float s = std::sin(spec.rotation);
+	const auto corner = [&](const float x, const float y) {
+		return SpatialGrid::Point {
+			cx + x * c - y * s,
+			cy + x * s + y * c,
+		};
+	};
+	return { corner(-hw, -hh), corner(hw, -hh), corner(hw, hh),
+		corner(-hw, hh) };
+}
+
+SpatialGrid::Bounds
+CullStage::frame_bounds(const Texture *texture, const Texture::Frame &frame)
+{
+	const float texture_w = texture == nullptr ? 0.0f : texture->width();
+	const float texture_h = texture == nullptr ? 0.0f : texture->height();
+	const float w = (frame.sheet.width != 0.0f ? frame.sheet.width
+						   : texture_w)
+	    * frame.scale.x;
+	const float h = (frame.sheet.height != 0.0f ? frame.sheet.height
+						    : texture_h)
+	    * frame.scale.y;
+	/* corners relative to the rotation origin */
+	const float ox = frame.sheet.origin.x * frame.scale.x;
+	const float oy = frame.sheet.origin.y * frame.scale.y;
+	const float c = std::cos(frame.theta);
+	const float s = std::sin(frame.theta);
+	float min_x = INFINITY;
+	float min_y = INFINITY;
+	float max_x = -INFINITY;
+	float max_y = -INFINITY;
+	const std::array<SpatialGrid::Point, 4> corners { {
+	    { -ox, -oy },
+	    { w - ox, -oy },
+	    { w - ox, h - oy },
+	    { -ox, h - oy },
+	} };
+	for (const auto &p : corners) {
+		const float rx = p.x * c - p.y * s + ox;
+		const float ry = p.x * s + p.y * c + oy;
+		min_x = std::min(min_x, rx);
+		min_y = std::min(min_y, ry);
+		max_x = std::max(max_x, rx);
+		max_y = std::max(max_y, ry);
+	}
+	return SpatialGrid::Bounds {
+		.x = frame.position.x + min_x,
+		.y = frame.position.y + min_y,
+		.w = max_x - min_x,
+		.h = max_y - min_y,
+	};
+}
@@ -0,0 +1,88 @@
+/* SPDX-License-Identifier: ISC */
+
+#ifndef EULER_VULKAN_CULL_STAGE_H
+#define EULER_VULKAN_CULL_STAGE_H
+
+#include <span>
+#include <vector>
+
+#include "euler/util/object.h"
+#include "euler/vulkan/camera.h"
+#include "euler/vulkan/spatial_grid.h"
+#include "euler/vulkan/sprite_batch.h"
+#include "euler/vulkan/texture.h"
+
+namespace euler::vulkan {
+
+/* Holds the sprites of a scene in a SpatialGrid and, each frame, hands only
+ * the ones inside a camera's view to a SpriteBatch. Sprites are tagged with
+ * the camera that saw them, so a sprite visible to two cameras is submitted
+ * once per camera. */
+class CullStage final : public util::Object {
+public:
+	using Id = SpatialGrid::Id;
+
+	/* counts for the most recent submit() */
+	struct Stats {
+		size_t registered = 0;
+		/* cameras that were enabled and queried */
+		size_t cameras = 0;
+		/* sprite submissions, summed over cameras */
+		size_t submitted = 0;
+		/* registered sprites left out, summed over cameras */
+		size_t culled = 0;
+	};
+
+	explicit CullStage(float cell_size = SpatialGrid::DEFAULT_CELL_SIZE);
+	~CullStage() override = default;
+
+	/* Sprites without a texture are sized by their sheet location and
+	 * never submitted. */
+	Id add(const util::Reference<Texture> &texture,
+	    const Texture::Frame &frame, int16_t layer = 0);
+	/* update and remove ignore removed ids */
+	void update(Id id, const Texture::Frame &frame);
+	void remove(Id id);
+	void clear();
+
+	/* Adds the sprites each camera can see to batch. Disabled and deleted
+	 * cameras are skipped. */
+	void submit(SpriteBatch &batch,
+	    std::span<const util::Reference<Camera>> cameras);
+
+	/* World-space corners of the area a camera shows: the spec's rect
+	 * shrunk by zoom and rotated about its centre. */
+	static SpatialGrid::Quad view_quad(const Camera::Spec &spec);
+	/* Axis-aligned bounds of a frame drawn with texture, which may be
+	 * null. */
+	static SpatialGrid::Bounds frame_bounds(const Texture *texture,
+	    const Texture::Frame &frame);
+
+	[[nodiscard]] const Stats &
+	stats() const
+	{
+		return _stats;
+	}
+	[[nodiscard]] const SpatialGrid &
+	grid() const
+	{
+		return _grid;
+	}
+
+private:
+	struct Sprite {
+		util::Reference<Texture> texture;
+		Texture::Frame frame;
+		int16_t layer = 0;
+	};
+
+	SpatialGrid _grid;
+	/* indexed by grid id */
+	std::vector<Sprite> _sprites;
+	std::vector<Id> _visible;
+	Stats _stats;
+};
+
+} /* namespace euler::vulkan */
+
+#endif /* EULER_VULKAN_CULL_STAGE_H */
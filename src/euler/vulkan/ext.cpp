@@ -0,0 +1,17 @@
+/* SPDX-License-Identifier: ISC */
+
+#include "euler/vulkan/ext.h"
+
+#include "euler/util/state.h"
+#include "euler/vulkan/sprite_batch.h"
+#include "euler/vulkan/texture.h"
+
+RClass *
+euler::vulkan::init(const util::Reference<util::State> &state, RClass *outer)
+{
+	const auto mod = state->mrb()->define_module_under(outer, "Vulkan");
+	auto &vulkan = state->modules().vulkan;
+	vulkan.texture = Texture::init(state, mod);
+	vulkan.sprite_batch = SpriteBatch::init(state, mod);
+	return mod;
+}
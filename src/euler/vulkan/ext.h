@@ -0,0 +1,14 @@
+/* SPDX-License-Identifier: ISC */
+
+#ifndef EULER_VULKAN_EXT_H
+#define EULER_VULKAN_EXT_H
+
+#include "euler/util/object.h"
+
+namespace euler::vulkan {
+
+RClass *init(const util::Reference<util::State> &state, RClass *outer);
+
+} /* namespace euler::vulkan */
+
+#endif /* EULER_VULKAN_EXT_H */
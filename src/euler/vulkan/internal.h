@@ -14,11 +14,13 @@ typedef VK2DTexture texture_pointer;
 typedef VK2DLogger logger;
 typedef nk_context gui_context;
 typedef VK2DShader shader_pointer;
+typedef VK2DDrawCommand draw_command;
 #else
 typedef void *texture_pointer;
 typedef void logger;
 typedef void gui_context;
 typedef void *shader_pointer;
+struct draw_command;
 #endif
 
 } /* namespace euler::vulkan::detail */
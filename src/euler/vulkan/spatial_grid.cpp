@@ -0,0 +1,235 @@
+/* SPDX-License-Identifier: ISC */
+
+#include "euler/vulkan/spatial_grid.h"
+
+#include <algorithm>
+#include <cmath>
+
+using euler::vulkan::SpatialGrid;
+
+SpatialGrid::SpatialGrid(const float cell_size)
+    : _cell_size(cell_size > 0.0f ? cell_size : DEFAULT_CELL_SIZE)
+    , _inv_cell_size(1.0f / _cell_size)
+{
+}
+
+uint64_t
+SpatialGrid::cell_key(const int32_t x, const int32_t y)
+{
+	return static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32
+	    | static_cast<uint32_t>(y);
+}
+
+SpatialGrid::CellRange
+SpatialGrid::cells_for(const Bounds &bounds) const
+{
+	const auto cell = [this](const float v) {
+		return static_cast<int32_t>(std::floor(v * _inv_cell_size));
+	};
+	return CellRange {
+		.x0 = cell(bounds.x),
+		.y0 = cell(bounds.y),
+		.x1 = cell(bounds.x + bounds.w),
+		.y1 = cell(bounds.y + bounds.h),
+	};
+}
+
+void
+SpatialGrid::link(const Id id)
+{
+	auto &item = _items[id];
+	item.oversized = item.cells.count() > MAX_ITEM_CELLS;
+	if (item.oversized) {
+		_oversized.push_back(id);
+		return;
+	}
+	for (int32_t y = item.cells.y0; y <= item.cells.y1; ++y) {
+		for (int32_t x = item.cells.x0; x <= item.cells.x1; ++x)
+			_cells[cell_key(x, y)].push_back(id);
+	}
+}
+
+void
+SpatialGrid::unlink(const Id id)
+{
+	const auto &item = _items[id];
+	const auto drop = [id](std::vector<Id> &ids) {
+		const auto it = std::ranges::find(ids, id);
+		if (it == ids.end()) return;
+		*it = ids.back();
+		ids.pop_back();
+	};
+	if (item.oversized) {
+		drop(_oversized);
+		return;
+	}
+	for (int32_t y = item.cells.y0; y <= item.cells.y1; ++y) {
+		for (int32_t x = item.cells.x0; x <= item.cells.x1; ++x) {
+			const auto it = _cells.find(cell_key(x, y));
+			if (it == _cells.end()) continue;
+			drop(it->second);
+			if (it->second.empty()) _cells.erase(it);
+		}
+	}
+}
+
+SpatialGrid::Id
+SpatialGrid::insert(const Bounds &bounds)
+{
+	Id id;
+	if (!_free.empty()) {
+		id = _free.back();
+		_free.pop_back();
+	} else {
+		id = static_cast<Id>(_items.size());
+		_items.emplace_back();
+	}
+	auto &item = _items[id];
+	item.bounds = bounds;
+	item.cells = cells_for(bounds);
+	item.alive = true;
+	link(id);
+	return id;
+}
+
+void
+SpatialGrid::update(const Id id, const Bounds &bounds)
+{
+	if (!contains(id)) return;
+	auto &item = _items[id];
+	item.bounds = bounds;
+	const auto cells = cells_for(bounds);
+	if (cells == item.cells) return;
+	unlink(id);
+	item.cells = cells;
+	link(id);
+}
+
+void
+SpatialGrid::remove(const Id id)
+{
+	if (!contains(id)) return;
+	auto &item = _items[id];
+	unlink(id);
+	item.alive = false;
+	_free.push_back(id);
+}
+
+void
+SpatialGrid::clear()
+{
+	_cells.clear();
+	_items.clear();
+	_free.clear();
+	_oversized.clear();
+}
+
+void
+SpatialGrid::reset_stats()
+{
+	_stats = Stats {};
+}
+
+/* Separating axis test between an axis-aligned box and a convex quad. */
+static bool
+intersects(const SpatialGrid::Bounds &box, const SpatialGrid::Quad &quad)
+{
+	float min_x = quad[0].x;
+	float max_x = quad[0].x;
+	float min_y = quad[0].y;
+	float max_y = quad[0].y;
+	for (const auto &p : quad) {
+		min_x = std::min(min_x, p.x);
+		max_x = std::max(max_x, p.x);
+		min_y = std::min(min_y, p.y);
+		max_y = std::max(max_y, p.y);
+	}
+	if (box.x > max_x || box.x + box.w < min_x || box.y > max_y
+	    || box.y + box.h < min_y)
+		return false;
+	const std::array<SpatialGrid::Point, 4> corners { {
+	    { box.x, box.y },
+	    { box.x + box.w, box.y },
+	    { box.x + box.w, box.y + box.h },
+	    { box.x, box.y + box.h },
+	} };
+	for (size_t i = 0; i < quad.size(); ++i) {
+		const auto &a = quad[i];
+		const auto &b = quad[(i + 1) % quad.size()];
+		const float nx = a.y - b.y;
+		const float ny = b.x - a.x;
+		float quad_min = INFINITY;
+		float quad_max = -INFINITY;
+		for (const auto &p : quad) {
+			const float d = p.x * nx + p.y * ny;
+			quad_min = std::min(quad_min, d);
+			quad_max = std::max(quad_max, d);
+		}
+		float box_min = INFINITY;
+		float box_max = -INFINITY;
+		for (const auto &p : corners) {
+			const float d = p.x * nx + p.y * ny;
+			box_min = std::min(box_min, d);
+			box_max = std::max(box_max, d);
+		}
+		if (box_min > quad_max || box_max < quad_min) return false;
+	}
+	return true;
+}
+
+void
+SpatialGrid::visit(const Id id, const Quad &quad, std::vector<Id> &out)
+{
+	auto &item = _items[id];
+	if (item.stamp == _stamp) return;
+	item.stamp = _stamp;
+	++_stats.candidates;
+	if (!intersects(item.bounds, quad)) return;
+	++_stats.hits;
+	out.push_back(id);
+}
+
+void
+SpatialGrid::query(const Quad &quad, std::vector<Id> &out)
+{
+	++_stats.queries;
+	if (++_stamp == 0) {
+		/* the stamp wrapped; stale stamps could now match */
+		for (auto &item : _items) item.stamp = 0;
+		_stamp = 1;
+	}
+	Bounds area { quad[0].x, quad[0].y, 0.0f, 0.0f };
+	for (const auto &p : quad) {
+		const float x1 = std::max(area.x + area.w, p.x);
+		const float y1 = std::max(area.y + area.h, p.y);
+		area.x = std::min(area.x, p.x);
+		area.y = std::min(area.y, p.y);
+		area.w = x1 - area.x;
+		area.h = y1 - area.y;
+	}
+	const auto range = cells_for(area);
+	if (range.count() <= static_cast<int64_t>(_cells.size())) {
+		for (int32_t y = range.y0; y <= range.y1; ++y) {
+			for (int32_t x = range.x0; x <= range.x1; ++x) {
+				const auto it = _cells.find(cell_key(x, y));
+				if (it == _cells.end()) continue;
+				++_stats.cells;
+				for (const Id id : it->second)
+					visit(id, quad, out);
+			}
+		}
+	} else {
+		/* the view covers more cells than are occupied, so walk the
+		 * occupied ones instead */
+		for (const auto &[key, ids] : _cells) {
+			const auto x = static_cast<int32_t>(key >> 32);
+			const auto y = static_cast<int32_t>(key & 0xFFFFFFFF);
+			if (x < range.x0 || x > range.x1 || y < range.y0
+			    || y > range.y1)
+				continue;
+			++_stats.cells;
+			for (const Id id : ids) visit(id, quad, out);
+		}
+	}
+	for (const Id id : _oversized) visit(id, quad, out);
+}
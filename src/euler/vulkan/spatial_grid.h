@@ -0,0 +1,129 @@
+/* SPDX-License-Identifier: ISC */
+
+#ifndef EULER_VULKAN_SPATIAL_GRID_H
+#define EULER_VULKAN_SPATIAL_GRID_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace euler::vulkan {
+
+/* Uniform grid over world space. Each item is linked into every cell its
+ * bounds overlap; items spanning more than MAX_ITEM_CELLS cells are kept on a
+ * separate list that every query checks, so a few huge items do not flood
+ * the grid. Moving an item within the cells it already covers only updates
+ * its bounds. */
+class SpatialGrid {
+public:
+	using Id = uint32_t;
+
+	static constexpr float DEFAULT_CELL_SIZE = 256.0f;
+	static constexpr int MAX_ITEM_CELLS = 16;
+
+	struct Bounds {
+		float x = 0.0f;
+		float y = 0.0f;
+		float w = 0.0f;
+		float h = 0.0f;
+	};
+
+	struct Point {
+		float x;
+		float y;
+	};
+
+	/* convex quad, corners in winding order */
+	using Quad = std::array<Point, 4>;
+
+	struct Stats {
+		uint64_t queries = 0;
+		/* cells whose item lists were scanned */
+		uint64_t cells = 0;
+		/* distinct items tested against a query quad */
+		uint64_t candidates = 0;
+		/* items that passed the test */
+		uint64_t hits = 0;
+	};
+
+	explicit SpatialGrid(float cell_size = DEFAULT_CELL_SIZE);
+
+	Id insert(const Bounds &bounds);
+	/* update and remove ignore ids that aren't in the grid */
+	void update(Id id, const Bounds &bounds);
+	void remove(Id id);
+	void clear();
+
+	[[nodiscard]] bool
+	contains(const Id id) const
+	{
+		return id < _items.size() && _items[id].alive;
+	}
+
+	[[nodiscard]] const Bounds &
+	bounds(const Id id) const
+	{
+		return _items[id].bounds;
+	}
+	[[nodiscard]] size_t
+	size() const
+	{
+		return _items.size() - _free.size();
+	}
+
+	/* Appends every item whose bounds intersect quad to out, once. */
+	void query(const Quad &quad, std::vector<Id> &out);
+
+	[[nodiscard]] const Stats &
+	stats() const
+	{
+		return _stats;
+	}
+	void reset_stats();
+
+private:
+	struct CellRange {
+		int32_t x0 = 0;
+		int32_t y0 = 0;
+		int32_t x1 = -1;
+		int32_t y1 = -1;
+		[[nodiscard]] int64_t
+		count() const
+		{
+			return static_cast<int64_t>(x1 - x0 + 1)
+			    * (y1 - y0 + 1);
+		}
+		bool
+		operator==(const CellRange &) const
+		    = default;
+	};
+
+	struct Item {
+		Bounds bounds;
+		CellRange cells;
+		uint32_t stamp = 0;
+		bool alive = false;
+		bool oversized = false;
+	};
+
+	[[nodiscard]] CellRange cells_for(const Bounds &bounds) const;
+	void link(Id id);
+	void unlink(Id id);
+	void visit(Id id, const Quad &quad, std::vector<Id> &out);
+	static uint64_t cell_key(int32_t x, int32_t y);
+
+	std::unordered_map<uint64_t, std::vector<Id>> _cells;
+	std::vector<Item> _items;
+	std::vector<Id> _free;
+	std::vector<Id> _oversized;
+	Stats _stats;
+	float _cell_size;
+	float _inv_cell_size;
+	uint32_t _stamp = 0;
+};
+
+} /* namespace euler::vulkan */
+
+#endif /* EULER_VULKAN_SPATIAL_GRID_H */
@@ -0,0 +1,304 @@
+/* SPDX-License-Identifier: ISC */
+
+#include "euler/vulkan/sprite_batch.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <VK2D/Renderer.h>
+
+#include "euler/util/state.h"
+
+using euler::vulkan::SpriteBatch;
+
+static VK2DDrawCommand
+to_command(const euler::vulkan::Texture &texture,
+    const euler::vulkan::Texture::Frame &frame)
+{
+	/* a zero sized sheet means the whole texture, as with display() */
+	const float w = frame.sheet.width != 0.0f ? frame.sheet.width
+						  : texture.width();
+	const float h = frame.sheet.height != 0.0f ? frame.sheet.height
+						   : texture.height();
+	VK2DDrawCommand command = {};
+	command.textureIndex = texture.id();
+	command.colour[0] = 1.0f;
+	command.colour[1] = 1.0f;
+	command.colour[2] = 1.0f;
+	command.colour[3] = 1.0f;
+	command.texturePos[0] = frame.sheet.x;
+	command.texturePos[1] = frame.sheet.y;
+	command.texturePos[2] = w;
+	command.texturePos[3] = h;
+	command.pos[0] = frame.position.x;
+	command.pos[1] = frame.position.y;
+	command.origin[0] = frame.sheet.origin.x;
+	command.origin[1] = frame.sheet.origin.y;
+	command.scale[0] = frame.scale.x;
+	command.scale[1] = frame.scale.y;
+	command.rotation = frame.theta;
+	return command;
+}
+
+SpriteBatch::VK2DBackend::~VK2DBackend() = default;
+
+void
+SpriteBatch::VK2DBackend::submit(const Texture &texture,
+    const Camera::Index camera, const std::span<const Texture::Frame> frames)
+{
+	_commands.clear();
+	_commands.reserve(frames.size());
+	for (const auto &frame : frames)
+		_commands.push_back(to_command(texture, frame));
+	if (camera != ALL_CAMERAS) vk2dRendererLockCameras(camera);
+	vk2dRendererAddBatch(_commands.data(),
+	    static_cast<uint32_t>(_commands.size()));
+	if (camera != ALL_CAMERAS) vk2dRendererUnlockCameras();
+}
+
+void
+SpriteBatch::RecordingBackend::submit(const Texture &texture,
+    const Camera::Index camera, const std::span<const Texture::Frame> frames)
+{
+	_draws.push_back(Draw {
+	    .texture = &texture,
+	    .camera = camera,
+	    .first = _frames.size(),
+	    .count = frames.size(),
+	});
+	_frames.insert(_frames.end(), frames.begin(), frames.end());
+}
+
+void
+SpriteBatch::RecordingBackend::clear()
+{
+	_draws.clear();
+	_frames.clear();
+}
+
+uint32_t
+SpriteBatch::texture_slot(const util::Reference<Texture> &texture)
+{
+	const auto [it, inserted] = _slots.try_emplace(texture.get(),
+	    static_cast<uint32_t>(_textures.size()));
+	if (inserted) _textures.push_back(texture);
+	return it->second;
+}
+
+void
+SpriteBatch::push_key(const uint32_t slot, const Camera::Index camera,
+    const int16_t layer, const size_t count)
+{
+	/* bias the layer so negative layers sort first */
+	const auto biased = static_cast<uint16_t>(layer + 0x8000);
+	const uint64_t key = static_cast<uint64_t>(biased) << 48
+	    | static_cast<uint64_t>(camera) << 32 | slot;
+	_keys.insert(_keys.end(), count, key);
+}
+
+void
+SpriteBatch::draw(const util::Reference<Texture> &texture,
+    const Texture::Frame &frame, const Camera::Index camera,
+    const int16_t layer)
+{
+	draw(texture, std::span(&frame, 1), camera, layer);
+}
+
+void
+SpriteBatch::draw(const util::Reference<Texture> &texture,
+    const std::span<const Texture::Frame> frames, const Camera::Index camera,
+    const int16_t layer)
+{
+	if (texture == nullptr || frames.empty()) return;
+	push_key(texture_slot(texture), camera, layer, frames.size());
+	_frames.insert(_frames.end(), frames.begin(), frames.end());
+}
+
+void
+SpriteBatch::draw(const util::Reference<Texture> &texture,
+    const Columns &columns, const Camera::Index camera, const int16_t layer)
+{
+	const size_t count = std::min(columns.x.size(), columns.y.size());
+	if (texture == nullptr || count == 0) return;
+	const auto column = [count](const std::span<const float> values,
+				const size_t i, const float fallback) {
+		return values.size() >= count ? values[i] : fallback;
+	};
+	push_key(texture_slot(texture), camera, layer, count);
+	_frames.reserve(_frames.size() + count);
+	for (size_t i = 0; i < count; ++i) {
+		Texture::Frame frame {};
+		frame.sheet = columns.sheet;
+		frame.position.x = columns.x[i];
+		frame.position.y = columns.y[i];
+		frame.scale.x = column(columns.scale_x, i, 1.0f);
+		frame.scale.y = column(columns.scale_y, i, 1.0f);
+		frame.theta = column(columns.theta, i, 0.0f);
+		_frames.push_back(frame);
+	}
+}
+
+size_t
+SpriteBatch::flush(Backend &backend)
+{
+	const size_t count = _frames.size();
+	_order.resize(count);
+	for (size_t i = 0; i < count; ++i)
+		_order[i] = { _keys[i], static_cast<uint32_t>(i) };
+	/* the index breaks ties, which keeps sprites of one run in order */
+	std::ranges::sort(_order);
+	_sorted.resize(count);
+	for (size_t i = 0; i < count; ++i)
+		_sorted[i] = _frames[_order[i].second];
+
+	size_t runs = 0;
+	for (size_t first = 0; first < count;) {
+		const uint64_t key = _order[first].first;
+		size_t last = first + 1;
+		while (last < count && _order[last].first == key) ++last;
+		const auto slot = static_cast<uint32_t>(key & 0xFFFFFFFF);
+		const auto camera = static_cast<Camera::Index>(key >> 32);
+		backend.submit(*_textures[slot].get(), camera,
+		    std::span(_sorted).subspan(first, last - first));
+		++runs;
+		first = last;
+	}
+	clear();
+	return runs;
+}
+
+void
+SpriteBatch::clear()
+{
+	_frames.clear();
+	_keys.clear();
+	_textures.clear();
+	_slots.clear();
+}
+
+/* Reads a column packed as native floats, as from Array#pack("f*"). Strings
+ * are used in place unless their bytes are misaligned for float. */
+static std::span<const float>
+read_column(mrb_state *mrb, const mrb_value value, std::vector<float> &copy)
+{
+	using namespace euler::util;
+	if (mrb_nil_p(value)) return {};
+	const auto state = State::get(mrb);
+	const char *bytes = RSTRING_PTR(value);
+	const auto length = static_cast<size_t>(RSTRING_LEN(value));
+	if (length % sizeof(float) != 0)
+		state->mrb()->raise(state->mrb()->argument_error(),
+		    "Sprite columns must be packed floats");
+	const size_t count = length / sizeof(float);
+	if (reinterpret_cast<uintptr_t>(bytes) % alignof(float) == 0)
+		return { reinterpret_cast<const float *>(bytes), count };
+	copy.resize(count);
+	std::memcpy(copy.data(), bytes, length);
+	return copy;
+}
+
+static mrb_value
+sprite_batch_initialize(mrb_state *mrb, const mrb_value self)
+{
+	using namespace euler::util;
+	const auto state = State::get(mrb);
+	if (DATA_PTR(self) != nullptr)
+		state->mrb()->raise(state->mrb()->argument_error(),
+		    "SpriteBatch is already initialized");
+	void *ptr = make_reference<SpriteBatch>().wrap();
+	mrb_data_init(self, ptr, &SpriteBatch::TYPE);
+	return mrb_nil_value();
+}
+
+/* draw(texture, x, y, scale_x = nil, scale_y = nil, theta = nil, layer = 0)
+ * adds one sprite per float in x, drawing the whole texture. */
+static mrb_value
+sprite_batch_draw(mrb_state *mrb, const mrb_value self)
+{
+	using namespace euler::util;
+	using euler::vulkan::Texture;
+	const auto state = State::get(mrb);
+	mrb_value texture_value, x_value, y_value;
+	mrb_value scale_x_value = mrb_nil_value();
+	mrb_value scale_y_value = mrb_nil_value();
+	mrb_value theta_value = mrb_nil_value();
+	mrb_int layer = 0;
+	state->mrb()->get_args("oSS|S!S!S!i", &texture_value, &x_value,
+	    &y_value, &scale_x_value, &scale_y_value, &theta_value, &layer);
+	if (layer < INT16_MIN || layer > INT16_MAX)
+		state->mrb()->raise(state->mrb()->range_error(),
+		    "Sprite layers must fit in 16 bits");
+	std::vector<float> copies[5];
+	const SpriteBatch::Columns columns {
+		.sheet = {},
+		.x = read_column(mrb, x_value, copies[0]),
+		.y = read_column(mrb, y_value, copies[1]),
+		.scale_x = read_column(mrb, scale_x_value, copies[2]),
+		.scale_y = read_column(mrb, scale_y_value, copies[3]),
+		.theta = read_column(mrb, theta_value, copies[4]),
+	};
+	const size_t count = columns.x.size();
+	const auto matches = [count](const std::span<const float> column,
+				 const bool optional) {
+		return column.size() == count || (optional && column.empty());
+	};
+	if (!matches(columns.y, false) || !matches(columns.scale_x, true)
+	    || !matches(columns.scale_y, true)
+	    || !matches(columns.theta, true))
+		state->mrb()->raise(state->mrb()->argument_error(),
+		    "Sprite columns must have the same length");
+	const auto texture = Reference<Texture>::unwrap(mrb, texture_value);
+	auto batch = Reference<SpriteBatch>::unwrap(mrb, self);
+	batch->draw(texture, columns, SpriteBatch::ALL_CAMERAS,
+	    static_cast<int16_t>(layer));
+	return self;
+}
+
+static mrb_value
+sprite_batch_flush(mrb_state *mrb, const mrb_value self)
+{
+	using namespace euler::util;
+	/* Ruby only runs on the main thread, which owns the renderer */
+	static SpriteBatch::VK2DBackend backend;
+	auto batch = Reference<SpriteBatch>::unwrap(mrb, self);
+	const size_t runs = batch->flush(backend);
+	return State::get(mrb)->mrb()->int_value(static_cast<mrb_int>(runs));
+}
+
+static mrb_value
+sprite_batch_clear(mrb_state *mrb, const mrb_value self)
+{
+	using namespace euler::util;
+	auto batch = Reference<SpriteBatch>::unwrap(mrb, self);
+	batch->clear();
+	return self;
+}
+
+static mrb_value
+sprite_batch_size(mrb_state *mrb, const mrb_value self)
+{
+	using namespace euler::util;
+	const auto batch = Reference<SpriteBatch>::unwrap(mrb, self);
+	return State::get(mrb)->mrb()->int_value(
+	    static_cast<mrb_int>(batch->size()));
+}
+
+RClass *
+SpriteBatch::init(const euler::util::Reference<euler::util::State> &state,
+    RClass *mod, RClass *)
+{
+	const auto cls = state->mrb()->define_class_under(mod, "SpriteBatch",
+	    state->object_class());
+	MRB_SET_INSTANCE_TT(cls, MRB_TT_DATA);
+	state->mrb()->define_method(cls, "initialize", sprite_batch_initialize,
+	    MRB_ARGS_NONE());
+	state->mrb()->define_method(cls, "draw", sprite_batch_draw,
+	    MRB_ARGS_ARG(3, 4));
+	state->mrb()->define_method(cls, "flush", sprite_batch_flush,
+	    MRB_ARGS_NONE());
+	state->mrb()->define_method(cls, "clear", sprite_batch_clear,
+	    MRB_ARGS_NONE());
+	state->mrb()->define_method(cls, "size", sprite_batch_size,
+	    MRB_ARGS_NONE());
+	return cls;
+}
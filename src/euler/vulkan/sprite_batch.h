@@ -0,0 +1,141 @@
+/* SPDX-License-Identifier: ISC */
+
+#ifndef EULER_VULKAN_SPRITE_BATCH_H
+#define EULER_VULKAN_SPRITE_BATCH_H
+
+#include <limits>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+#include "euler/util/ext.h"
+#include "euler/util/object.h"
+#include "euler/vulkan/camera.h"
+#include "euler/vulkan/internal.h"
+#include "euler/vulkan/texture.h"
+
+namespace euler::vulkan {
+
+/* Collects sprites for a frame and submits them grouped by layer, camera and
+ * texture, so each group costs one batched draw instead of one draw per
+ * sprite. Only the layer orders sprites: within a layer, sprites using
+ * different textures or cameras may be reordered, while sprites sharing both
+ * keep the order they were added in. */
+class SpriteBatch final : public util::Object {
+	BIND_MRUBY("Euler::Vulkan::SpriteBatch", SpriteBatch,
+	    vulkan.sprite_batch);
+
+public:
+	/* Draws to every enabled camera. */
+	static constexpr Camera::Index ALL_CAMERAS
+	    = std::numeric_limits<Camera::Index>::max();
+
+	/* Receives one run of sprites that share a texture and camera. */
+	class Backend {
+	public:
+		virtual ~Backend() = default;
+		virtual void submit(const Texture &texture,
+		    Camera::Index camera,
+		    std::span<const Texture::Frame> frames)
+		    = 0;
+	};
+
+	/* Submits runs through VK2D's batched draw path. */
+	class VK2DBackend final : public Backend {
+	public:
+		~VK2DBackend() override;
+		void submit(const Texture &texture, Camera::Index camera,
+		    std::span<const Texture::Frame> frames) override;
+
+	private:
+		/* scratch reused by submit() */
+		std::vector<detail::draw_command> _commands;
+	};
+
+	/* Keeps the runs in memory instead of drawing them, so batches can be
+	 * inspected and timed without a GPU. */
+	class RecordingBackend final : public Backend {
+	public:
+		struct Draw {
+			const Texture *texture;
+			Camera::Index camera;
+			/* range of frames() this draw covers */
+			size_t first;
+			size_t count;
+		};
+
+		void submit(const Texture &texture, Camera::Index camera,
+		    std::span<const Texture::Frame> frames) override;
+		void clear();
+
+		[[nodiscard]] const std::vector<Draw> &
+		draws() const
+		{
+			return _draws;
+		}
+		[[nodiscard]] const std::vector<Texture::Frame> &
+		frames() const
+		{
+			return _frames;
+		}
+
+	private:
+		std::vector<Draw> _draws;
+		std::vector<Texture::Frame> _frames;
+	};
+
+	/* Sprites as parallel arrays sharing one sheet location. Empty scale
+	 * or theta columns mean 1 and 0. */
+	struct Columns {
+		Texture::Location sheet;
+		std::span<const float> x;
+		std::span<const float> y;
+		std::span<const float> scale_x;
+		std::span<const float> scale_y;
+		std::span<const float> theta;
+	};
+
+	SpriteBatch() = default;
+	~SpriteBatch() override = default;
+
+	void draw(const util::Reference<Texture> &texture,
+	    const Texture::Frame &frame, Camera::Index camera = ALL_CAMERAS,
+	    int16_t layer = 0);
+	void draw(const util::Reference<Texture> &texture,
+	    std::span<const Texture::Frame> frames,
+	    Camera::Index camera = ALL_CAMERAS, int16_t layer = 0);
+	/* Adds one sprite per element of columns.x. */
+	void draw(const util::Reference<Texture> &texture,
+	    const Columns &columns, Camera::Index camera = ALL_CAMERAS,
+	    int16_t layer = 0);
+
+	/* Sorts the sprites, submits them as runs and clears the batch.
+	 * Returns the number of runs submitted. */
+	size_t flush(Backend &backend);
+	void clear();
+
+	[[nodiscard]] size_t
+	size() const
+	{
+		return _frames.size();
+	}
+
+private:
+	uint32_t texture_slot(const util::Reference<Texture> &texture);
+	void push_key(uint32_t slot, Camera::Index camera, int16_t layer,
+	    size_t count);
+
+	std::vector<Texture::Frame> _frames;
+	/* per sprite: layer, camera and texture slot packed so that sorting
+	 * the keys groups runs */
+	std::vector<uint64_t> _keys;
+	std::vector<util::Reference<Texture>> _textures;
+	std::unordered_map<const Texture *, uint32_t> _slots;
+	/* scratch reused by flush() */
+	std::vector<std::pair<uint64_t, uint32_t>> _order;
+	std::vector<Texture::Frame> _sorted;
+};
+
+} /* namespace euler::vulkan */
+
+#endif /* EULER_VULKAN_SPRITE_BATCH_H */
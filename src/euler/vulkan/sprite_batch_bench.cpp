@@ -0,0 +1,160 @@
+/* SPDX-License-Identifier: ISC */
+
+/* Checks and times SpriteBatch against its RecordingBackend, so it runs
+ * without a GPU or a window:
+ *
+ *   euler_sprite_batch_bench [sprites] [rounds]
+ *
+ * Exits with a failure status if a flush breaks the ordering SpriteBatch
+ * promises: layers in order, one run per texture and camera within a layer,
+ * and sprites of one run in the order they were added. */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "euler/vulkan/sprite_batch.h"
+
+using euler::vulkan::SpriteBatch;
+using euler::vulkan::Texture;
+
+namespace {
+/* Never touches VK2D except to free its null texture. */
+class StubTexture final : public Texture {
+public:
+	StubTexture()
+	    : Texture(euler::vulkan::detail::texture_pointer {})
+	{
+	}
+};
+
+constexpr size_t TEXTURES = 8;
+constexpr int16_t LAYERS[] = { 1, -1, 0 };
+/* fill() repeats its layer, camera and texture every PERIOD sprites, and
+ * no two sprites within a period share all three */
+constexpr size_t PERIOD = 24;
+
+/* position.x numbers the sprites and position.y holds the layer, which
+ * lets check() see the order they came out in. */
+void
+fill(SpriteBatch &batch,
+    const std::vector<euler::util::Reference<Texture>> &textures,
+    const size_t sprites)
+{
+	std::vector<float> x(sprites / 2), y(sprites / 2);
+	for (size_t i = 0; i < sprites / 2; ++i) {
+		const auto layer = LAYERS[i % std::size(LAYERS)];
+		Texture::Frame frame {};
+		frame.position.x = static_cast<float>(i);
+		frame.position.y = layer;
+		frame.scale.x = 1.0f;
+		frame.scale.y = 1.0f;
+		const auto camera = static_cast<euler::vulkan::Camera::Index>(
+		    i % 3 == 0 ? SpriteBatch::ALL_CAMERAS : i % 2);
+		batch.draw(textures[i % TEXTURES], frame, camera, layer);
+	}
+	/* the second half goes through the column path in one call */
+	for (size_t i = 0; i < x.size(); ++i) {
+		x[i] = static_cast<float>(sprites / 2 + i);
+		y[i] = 2.0f;
+	}
+	const SpriteBatch::Columns columns {
+		.sheet = {},
+		.x = x,
+		.y = y,
+		.scale_x = {},
+		.scale_y = {},
+		.theta = {},
+	};
+	batch.draw(textures[0], columns, SpriteBatch::ALL_CAMERAS, 2);
+}
+
+bool
+check(const SpriteBatch::RecordingBackend &backend, const size_t sprites,
+    const size_t runs)
+{
+	const auto &draws = backend.draws();
+	const auto &frames = backend.frames();
+	if (draws.size() != runs) {
+		fprintf(stderr, "flush reported %zu runs but drew %zu\n", runs,
+		    draws.size());
+		return false;
+	}
+	if (frames.size() != sprites / 2 * 2) {
+		fprintf(stderr, "drew %zu sprites, expected %zu\n",
+		    frames.size(), sprites / 2 * 2);
+		return false;
+	}
+	/* one run per distinct key, plus the column run */
+	const size_t expected = std::min(sprites / 2, PERIOD) + 1;
+	if (draws.size() != expected) {
+		fprintf(stderr, "%zu runs, expected %zu\n", draws.size(),
+		    expected);
+		return false;
+	}
+	float layer = -1.0f;
+	for (const auto &draw : draws) {
+		for (size_t i = draw.first; i < draw.first + draw.count; ++i) {
+			const auto &frame = frames[i];
+			const float id = frame.position.x;
+			if (frame.position.y < layer) {
+				fprintf(stderr, "sprite %g after layer %g\n",
+				    id, layer);
+				return false;
+			}
+			layer = frame.position.y;
+			if (i > draw.first && id <= frames[i - 1].position.x) {
+				fprintf(stderr, "sprite %g out of order\n", id);
+				return false;
+			}
+			if (frame.scale.x != 1.0f || frame.scale.y != 1.0f
+			    || frame.theta != 0.0f) {
+				fprintf(stderr, "sprite %g transformed\n", id);
+				return false;
+			}
+		}
+	}
+	return true;
+}
+} /* namespace */
+
+int
+main(const int argc, const char **argv)
+{
+	const size_t sprites
+	    = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100000;
+	const size_t rounds
+	    = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 100;
+	if (sprites < 2 || rounds == 0) {
+		fprintf(stderr, "usage: %s [sprites >= 2] [rounds > 0]\n",
+		    argv[0]);
+		return EXIT_FAILURE;
+	}
+	std::vector<euler::util::Reference<Texture>> textures;
+	for (size_t i = 0; i < TEXTURES; ++i)
+		textures.push_back(euler::util::make_reference<StubTexture>());
+
+	SpriteBatch batch;
+	SpriteBatch::RecordingBackend backend;
+	fill(batch, textures, sprites);
+	if (!check(backend, sprites, batch.flush(backend)))
+		return EXIT_FAILURE;
+
+	using clock = std::chrono::steady_clock;
+	clock::duration elapsed {};
+	for (size_t round = 0; round < rounds; ++round) {
+		backend.clear();
+		fill(batch, textures, sprites);
+		const auto start = clock::now();
+		batch.flush(backend);
+		elapsed += clock::now() - start;
+	}
+	const auto ns
+	    = std::chrono::duration<double, std::nano>(elapsed).count();
+	printf("%zu sprites, %zu runs: %.1f ns per sprite per flush\n",
+	    sprites / 2 * 2, backend.draws().size(),
+	    ns / static_cast<double>(rounds * (sprites / 2 * 2)));
+	return EXIT_SUCCESS;
+}
@@ -2,12 +2,16 @@
 
 #include "euler/vulkan/surface.h"
 
+#include <algorithm>
+#include <format>
+
 #include <VK2D/Constants.h>
 #include <VK2D/Gui.h>
 #include <VK2D/Renderer.h>
 #include <VK2D/Texture.h>
 #include <VK2D/Structs.h>
 
+#include "euler/util/profiler.h"
 #include "euler/vulkan/renderer.h"
 
 euler::vulkan::Surface::Surface() = default;
@@ -29,6 +33,7 @@ euler::vulkan::Surface::draw(int &exit_code,
     const std::function<bool(int &)> &fn)
 {
 	// vk2dRendererStartFrame(util::COLOR_BLACK.to_float_array().data());
+	util::Profiler::Zone zone("vulkan.draw");
 	try {
 		render_debug_overlay();
 		const auto result = fn(exit_code);
@@ -49,36 +54,77 @@ euler::vulkan::Surface::draw(int &exit_code,
 void
 euler::vulkan::Surface::render_debug_overlay()
 {
-	if (_debug_font == nullptr)
+	/* the numbers are only readable a few times a second anyway, and a
+	 * title that holds still lets the layout cache hit */
+	static constexpr uint64_t TITLE_REFRESH_MS = 250;
+	static constexpr float SCALE = 2.0f;
+	static constexpr size_t PROFILER_LINES = 4;
+	if (_debug_font == nullptr) {
 		_debug_font = vk2dTextureLoad("assets/font.png");
+		_debug_glyphs = util::make_reference<util::BitmapFont>(
+		    "assets/font.png", util::BitmapFont::Layout {});
+	}
 	vk2dRendererLockCameras(VK2D_DEFAULT_CAMERA);
-	char title[100];
-	VK2DRendererConfig conf = vk2dRendererGetConfig();
-	float inUse, total;
-	vk2dRendererGetVRAMUsage(&inUse, &total);
-	sprintf(title,
-	    "Euler [%0.2fms] [%0.2ffps] %ix MSAA\nVRAM: %0.2fMiB/%0.2fGiB",
-	    vk2dRendererGetAverageFrameTime(),
-	    1000 / vk2dRendererGetAverageFrameTime(), conf.msaa, inUse,
-	    total / 1024);
+	const uint64_t now = SDL_GetTicks();
+	if (_debug_title.empty()
+	    || now - _debug_title_time >= TITLE_REFRESH_MS) {
+		const VK2DRendererConfig conf = vk2dRendererGetConfig();
+		float in_use, total;
+		vk2dRendererGetVRAMUsage(&in_use, &total);
+		const float frame_time = vk2dRendererGetAverageFrameTime();
+		_debug_title = std::format(
+		    "Euler [{:.2f}ms] [{:.2f}fps] {}x MSAA\nVRAM: "
+		    "{:.2f}MiB/{:.2f}GiB",
+		    frame_time, 1000 / frame_time, static_cast<int>(conf.msaa),
+		    in_use, total / 1024);
+		/* the costliest zones, when the profiler is running */
+		const auto zones = util::Profiler::enabled()
+		    ? util::Profiler::get().summary()
+		    : std::vector<util::Profiler::Summary> {};
+		for (size_t i = 0; i < std::min(zones.size(), PROFILER_LINES);
+		    ++i) {
+			_debug_title += std::format("\n{:{}}{} {:.2f}ms",
+			    "", zones[i].depth * 2, zones[i].name,
+			    zones[i].mean_ms);
+		}
+		_debug_title_time = now;
+	}
 	vk2dRendererSetColourMod(VK2D_BLACK);
 	int w, h;
 	SDL_GetWindowSize(window(), &w, &h);
-	vk2dDrawRectangle(0, 0, static_cast<float>(w), 17 * 2 * 2);
+	const auto lines = 1 + std::ranges::count(_debug_title, '\n');
+	vk2dDrawRectangle(0, 0, static_cast<float>(w),
+	    static_cast<float>(17 * 2 * lines));
 	vk2dRendererSetColourMod(VK2D_DEFAULT_COLOUR_MOD);
-	int x = 0, y = 0;
-	float ox = x;
-	for (int i = 0; i < (int)strlen(title); i++) {
-		if (title[i] != '\n') {
-			vk2dRendererDrawTexture(_debug_font, x, y, 2, 2, 0, 0,
-			    0, (title[i] * 8) % 128, floorf(title[i] / 16) * 16,
-			    8, 16);
-			x += 8 * 2;
-		} else {
-			x = ox;
-			y += 16 * 2;
-		}
+
+	/* the whole title goes out as one batch */
+	const auto &layout = _text_layouts.layout(*_debug_glyphs.get(),
+	    _debug_glyphs->line_height() * SCALE, _debug_title);
+	auto &commands = _debug_commands;
+	commands.clear();
+	const auto texture_index = vk2dTextureGetID(_debug_font);
+	for (const auto &quad : layout.quads) {
+		VK2DDrawCommand command = {};
+		command.textureIndex = texture_index;
+		command.colour[0] = 1.0f;
+		command.colour[1] = 1.0f;
+		command.colour[2] = 1.0f;
+		command.colour[3] = 1.0f;
+		command.texturePos[0] = quad.source_x;
+		command.texturePos[1] = quad.source_y;
+		command.texturePos[2] = quad.source_w;
+		command.texturePos[3] = quad.source_h;
+		command.pos[0] = quad.x;
+		command.pos[1] = quad.y;
+		command.scale[0] = quad.w / quad.source_w;
+		command.scale[1] = quad.h / quad.source_h;
+		commands.push_back(command);
+	}
+	if (!commands.empty()) {
+		vk2dRendererAddBatch(commands.data(),
+		    static_cast<uint32_t>(commands.size()));
 	}
+	_text_layouts.next_frame();
 
 	vk2dRendererUnlockCameras();
 }
@@ -4,11 +4,15 @@
 #define EULER_VULKAN_SURFACE_H
 
 #include <functional>
+#include <string>
+#include <vector>
 
 #include <SDL3/SDL.h>
 
 #include "euler/util/color.h"
+#include "euler/util/font.h"
 #include "euler/util/object.h"
+#include "euler/util/text_layout.h"
 #include "euler/vulkan/camera.h"
 #include "euler/vulkan/internal.h"
 #include "euler/vulkan/renderer.h"
@@ -42,6 +46,12 @@ private:
 	void set_renderer(const util::Reference<Renderer> &renderer);
 	util::Reference<Renderer> _renderer;
 	detail::texture_pointer _debug_font = nullptr;
+	util::Reference<util::BitmapFont> _debug_glyphs;
+	util::TextLayoutCache _text_layouts;
+	/* scratch reused by render_debug_overlay() */
+	std::vector<detail::draw_command> _debug_commands;
+	std::string _debug_title;
+	uint64_t _debug_title_time = 0;
 };
 
 } /* namespace euler::vulkan */
@@ -5,8 +5,18 @@
 #include <VK2D/Renderer.h>
 #include <VK2D/Texture.h>
 
+#include "euler/util/state.h"
+
 euler::vulkan::Texture::~Texture() { vk2dTextureFree(_texture); }
 
+euler::util::Reference<euler::vulkan::Texture>
+euler::vulkan::Texture::load(const char *path)
+{
+	auto texture = util::Reference<Texture>(new Texture(path));
+	if (!texture->loaded()) return util::Reference<Texture>(nullptr);
+	return texture;
+}
+
 void
 euler::vulkan::Texture::display(const Frame &spec) const
 {
@@ -59,3 +69,52 @@ euler::vulkan::Texture::Texture(float width, float height)
     : Texture(vk2dTextureCreate(width, height))
 {
 }
+
+static mrb_value
+texture_load(mrb_state *mrb, const mrb_value)
+{
+	using namespace euler::util;
+	using euler::vulkan::Texture;
+	const auto state = State::get(mrb);
+	const char *path;
+	state->mrb()->get_args("z", &path);
+	auto texture = Texture::load(path);
+	if (texture == nullptr)
+		state->mrb()->raisef(state->mrb()->runtime_error(),
+		    "Could not load texture %s", path);
+	return state->wrap(texture);
+}
+
+static mrb_value
+texture_width(mrb_state *mrb, const mrb_value self)
+{
+	using namespace euler::util;
+	using euler::vulkan::Texture;
+	const auto texture = Reference<Texture>::unwrap(mrb, self);
+	return State::get(mrb)->mrb()->float_value(texture->width());
+}
+
+static mrb_value
+texture_height(mrb_state *mrb, const mrb_value self)
+{
+	using namespace euler::util;
+	using euler::vulkan::Texture;
+	const auto texture = Reference<Texture>::unwrap(mrb, self);
+	return State::get(mrb)->mrb()->float_value(texture->height());
+}
+
+RClass *
+euler::vulkan::Texture::init(const util::Reference<util::State> &state,
+    RClass *mod, RClass *)
+{
+	const auto cls = state->mrb()->define_class_under(mod, "Texture",
+	    state->object_class());
+	MRB_SET_INSTANCE_TT(cls, MRB_TT_DATA);
+	state->mrb()->define_class_method(cls, "load", texture_load,
+	    MRB_ARGS_REQ(1));
+	state->mrb()->define_method(cls, "width", texture_width,
+	    MRB_ARGS_NONE());
+	state->mrb()->define_method(cls, "height", texture_height,
+	    MRB_ARGS_NONE());
+	return cls;
+}
@@ -6,15 +6,21 @@
 #include <filesystem>
 #include <span>
 
+#include "euler/util/ext.h"
 #include "euler/util/object.h"
 #include "euler/vulkan/internal.h"
 
 namespace euler::vulkan {
 
 class Texture : public util::Object {
+	BIND_MRUBY("Euler::Vulkan::Texture", Texture, vulkan.texture);
+
 public:
 	~Texture() override;
 
+	/* Returns nullptr if the file could not be loaded. */
+	static util::Reference<Texture> load(const char *path);
+
 	detail::texture_pointer
 	texture() const
 	{